@@ -0,0 +1,84 @@
+'use strict';
+
+// Measures the request rate of opening each request stream on a session
+// pooled by a QuicAgent against connecting a new session per request.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  pool: ['true', 'false'],
+  n: [200],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ pool, n }) {
+  const { Agent, createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+  const server = createSocket({ port: 0 });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      stream.resume();
+      stream.on('end', () => stream.end('pong'));
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const agent = new Agent({ socket: client, alpn: kALPN });
+    const options = {
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    };
+
+    let completed = 0;
+
+    function done() {
+      bench.end(n);
+      agent.close(() => {
+        client.close();
+        server.close();
+      });
+    }
+
+    function onStream(stream, session) {
+      stream.resume();
+      stream.on('end', () => {
+        if (session !== undefined)
+          session.close();
+        if (++completed === n)
+          done();
+        else
+          request();
+      });
+      stream.end('ping');
+    }
+
+    function request() {
+      if (pool === 'true') {
+        agent.openStream(options, (err, stream) => {
+          if (err)
+            throw err;
+          onStream(stream);
+        });
+      } else {
+        const session = client.connect(options);
+        session.on('secure', () => onStream(session.openStream(), session));
+      }
+    }
+
+    bench.start();
+    request();
+  });
+}
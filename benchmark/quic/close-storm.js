@@ -0,0 +1,92 @@
+'use strict';
+
+// Measures what it costs a server QuicSocket to close `sessions`
+// established QuicServerSessions at once. After every session has
+// completed its handshake, the server closes all of them together. Each
+// one sends its CONNECTION_CLOSE and leaves only a closed connection
+// record behind on the QuicSocket, which answers late packets until the
+// closing period ends.
+//
+// With metric=time, the reported rate is the number of sessions released
+// per second, counted from the close until the memoryUsage of the
+// QuicSocket is back to where it was before the first connection. With
+// metric=memory, it is the number of sessions closed per MiB of the
+// largest memoryUsage above that baseline, starting with the memory held
+// by the established sessions right before they are closed, so that, as
+// with the other benchmarks, higher is better.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  metric: ['time', 'memory'],
+  sessions: [100000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ metric, sessions }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+  const server = createSocket({
+    port: 0,
+    maxConnectionsPerHost: sessions + 1
+  });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  const serverSessions = [];
+  server.on('session', (session) => serverSessions.push(session));
+
+  server.on('ready', () => {
+    const baseline = server.memoryUsage;
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const options = {
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    };
+
+    let secure = 0;
+    for (let i = 0; i < sessions; i++) {
+      const session = client.connect(options);
+      session.on('secure', () => {
+        if (++secure === sessions)
+          setImmediate(closeAll);
+      });
+    }
+
+    function closeAll() {
+      const started = process.hrtime();
+      let peak = server.memoryUsage;
+
+      function probe() {
+        const memory = server.memoryUsage;
+        if (memory > peak)
+          peak = memory;
+        if (memory > baseline)
+          return setImmediate(probe);
+        if (metric === 'time') {
+          bench.end(sessions);
+        } else {
+          const mib = Number(peak - baseline || 1n) / 2 ** 20;
+          bench.report(sessions / mib, process.hrtime(started));
+        }
+        client.close();
+        server.close();
+      }
+
+      if (metric === 'time')
+        bench.start();
+      for (const session of serverSessions)
+        session.close();
+      probe();
+    }
+  });
+}
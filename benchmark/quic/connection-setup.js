@@ -0,0 +1,83 @@
+'use strict';
+
+// Measures the rate at which QUIC connections can be established and
+// closed between a client and server QuicSocket on the same thread.
+// When `resume` is set, every connection resumes a TLS session from a
+// ticket issued during an initial, untimed connection.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  concurrency: [1, 16],
+  resume: ['true', 'false'],
+  n: [500],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ concurrency, resume, n }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+  const server = createSocket({
+    port: 0,
+    maxConnectionsPerHost: concurrency + 1
+  });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const options = {
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    };
+
+    let started = 0;
+    let completed = 0;
+
+    // Opens an untimed connection and waits for the server to issue a
+    // session ticket that the timed connections can resume from.
+    function prime() {
+      const session = client.connect(options);
+      session.once('sessionTicket', (id, ticket, params) => {
+        options.sessionTicket = ticket;
+        options.remoteTransportParams = params;
+        session.close(start);
+      });
+    }
+
+    function start() {
+      bench.start();
+      for (let i = 0; i < Math.min(concurrency, n); i++)
+        connect();
+    }
+
+    function connect() {
+      started++;
+      const session = client.connect(options);
+      session.on('secure', () => session.close());
+      session.on('close', () => {
+        if (++completed === n) {
+          bench.end(n);
+          client.close();
+          server.close();
+        } else if (started < n) {
+          connect();
+        }
+      });
+    }
+
+    if (resume === 'true')
+      prime();
+    else
+      start();
+  });
+}
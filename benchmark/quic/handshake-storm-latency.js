@@ -0,0 +1,113 @@
+'use strict';
+
+// Measures the tail latency of small echo exchanges on already
+// established QUIC sessions while the same QuicSocket accepts a burst
+// of new connections. With asyncSigning, the handshake signatures for
+// the new connections are computed on the threadpool rather than on
+// the event loop thread.
+//
+// The reported rate is the reciprocal of the 99th percentile echo
+// latency (in seconds) so that, as with the other benchmarks, higher
+// is better.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  asyncSigning: ['true', 'false'],
+  sessions: [8],
+  storm: [100, 400],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+const kPayload = Buffer.alloc(32, 'x');
+
+function main({ asyncSigning, sessions, storm }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+  const server = createSocket({
+    port: 0,
+    maxConnectionsPerHost: sessions + storm + 1
+  });
+  server.listen({
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    asyncSigning: asyncSigning === 'true'
+  });
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      stream.on('data', (chunk) => stream.write(chunk));
+      stream.on('end', () => stream.end());
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const options = {
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    };
+
+    const streams = [];
+    for (let n = 0; n < sessions; n++) {
+      const session = client.connect(options);
+      session.on('secure', () => {
+        streams.push(session.openStream());
+        if (streams.length === sessions)
+          run(client, options, streams, storm, done);
+      });
+    }
+
+    function done(latencies) {
+      latencies.sort((a, b) => a - b);
+      const p99 = latencies[Math.floor(latencies.length * 0.99)];
+      bench.report(1e9 / Number(p99), process.hrtime(started));
+      for (const stream of streams)
+        stream.end();
+      client.close();
+      server.close();
+    }
+  });
+
+  let started;
+  function run(client, options, streams, storm, done) {
+    const latencies = [];
+    let running = true;
+    let secured = 0;
+    started = process.hrtime();
+
+    for (const stream of streams) {
+      let sent;
+      stream.on('data', () => {
+        latencies.push(process.hrtime.bigint() - sent);
+        if (running) {
+          sent = process.hrtime.bigint();
+          stream.write(kPayload);
+        }
+      });
+      sent = process.hrtime.bigint();
+      stream.write(kPayload);
+    }
+
+    for (let n = 0; n < storm; n++) {
+      const session = client.connect(options);
+      session.on('secure', () => {
+        session.close();
+        if (++secured === storm) {
+          running = false;
+          done(latencies);
+        }
+      });
+    }
+  }
+}
@@ -0,0 +1,90 @@
+'use strict';
+
+// Measures the rate at which HTTP/3 requests can be completed on a single
+// session when each response carries a body of the given size. With
+// compat=true, the server answers through the Http3ServerResponse objects
+// passed to the QuicSocket 'request' event rather than on the QuicStream.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  compat: ['true', 'false'],
+  concurrency: [1, 10],
+  size: [0, 1024],
+  n: [2000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'h3-22';
+const kServerName = 'agent1';
+
+function main({ compat, concurrency, size, n }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const body = Buffer.alloc(size, 'x');
+
+  const server = createSocket({ port: 0 });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  if (compat === 'true') {
+    server.on('request', (req, res) => {
+      res.end(body);
+      req.resume();
+    });
+  } else {
+    server.on('session', (session) => {
+      session.on('stream', (stream) => {
+        stream.on('initialHeaders', () => {
+          stream.submitInitialHeaders({ ':status': 200 });
+          stream.end(body);
+        });
+        stream.resume();
+      });
+    });
+  }
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', () => {
+      let started = 0;
+      let closed = 0;
+
+      function request() {
+        started++;
+        const stream = session.openStream();
+        stream.resume();
+        stream.on('close', () => {
+          if (++closed === n) {
+            bench.end(n);
+            client.close();
+            server.close();
+          } else if (started < n) {
+            request();
+          }
+        });
+        stream.submitInitialHeaders({
+          ':method': 'GET',
+          ':scheme': 'https',
+          ':authority': kServerName,
+          ':path': '/'
+        });
+        stream.end();
+      }
+
+      bench.start();
+      for (let i = 0; i < Math.min(concurrency, n); i++)
+        request();
+    });
+  });
+}
@@ -0,0 +1,83 @@
+'use strict';
+
+// Measures the rate at which a server can answer small request/response
+// exchanges, each carried on its own bidirectional stream, with and
+// without the liteStreams option.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  lite: ['true', 'false'],
+  concurrency: [1, 16],
+  n: [1000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ lite, concurrency, n }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const liteStreams = lite === 'true';
+  const request = Buffer.from('ping');
+  const response = Buffer.from('pong');
+
+  const server = createSocket({ port: 0 });
+  server.listen({ key, cert, ca, alpn: kALPN, liteStreams });
+
+  server.on('session', (session) => {
+    if (liteStreams) {
+      session.on('streamData', (id, chunk, fin) => {
+        if (fin)
+          session.endStream(id, response);
+      });
+    } else {
+      session.on('stream', (stream) => {
+        stream.on('data', () => {});
+        stream.on('end', () => stream.end(response));
+      });
+    }
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    let started = 0;
+    let completed = 0;
+
+    function sendRequest() {
+      started++;
+      const stream = session.openStream();
+      stream.on('data', () => {});
+      stream.on('end', () => {
+        if (++completed === n) {
+          bench.end(n);
+          session.close(() => {
+            client.close();
+            server.close();
+          });
+        } else if (started < n) {
+          sendRequest();
+        }
+      });
+      stream.end(request);
+    }
+
+    session.on('secure', () => {
+      bench.start();
+      for (let i = 0; i < Math.min(concurrency, n); i++)
+        sendRequest();
+    });
+  });
+}
@@ -0,0 +1,84 @@
+'use strict';
+
+// Compares sending a file on a QuicStream using sendFD(), which reads the
+// file natively, against piping an fs.ReadStream into the QuicStream.
+
+const common = require('../common.js');
+const path = require('path');
+const fixtures = require('../../test/common/fixtures');
+
+const file = path.join(path.resolve(__dirname, '../fixtures'), 'alice.html');
+
+const bench = common.createBenchmark(main, {
+  mode: ['fd', 'stream'],
+  concurrency: [1, 10],
+  n: [1000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ mode, concurrency, n }) {
+  const fs = require('fs');
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const fd = fs.openSync(file, 'r');
+
+  const server = createSocket({ port: 0 });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      stream.resume();
+      stream.on('end', () => {
+        if (mode === 'fd') {
+          stream.sendFD(fd);
+        } else {
+          fs.createReadStream(null, { fd, start: 0, autoClose: false })
+            .pipe(stream);
+        }
+      });
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', () => {
+      let started = 0;
+      let closed = 0;
+
+      function request() {
+        started++;
+        const stream = session.openStream();
+        stream.resume();
+        stream.on('close', () => {
+          if (++closed === n) {
+            bench.end(n);
+            client.close();
+            server.close();
+            fs.closeSync(fd);
+          } else if (started < n) {
+            request();
+          }
+        });
+        // A stream that only carries a FIN is not created on the server.
+        stream.end('GET');
+      }
+
+      bench.start();
+      for (let i = 0; i < Math.min(concurrency, n); i++)
+        request();
+    });
+  });
+}
@@ -0,0 +1,96 @@
+'use strict';
+
+// Measures the rate at which small messages can be echoed on a single
+// QuicStream using either the stream.Duplex interface or
+// readChunks()/writeChunks().
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  api: ['duplex', 'chunks'],
+  size: [16, 256],
+  n: [10000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ api, size, n }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const message = Buffer.alloc(size, 'x');
+  const chunks = api === 'chunks';
+
+  const server = createSocket({ port: 0 });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('session', (session) => {
+    session.on('stream', async (stream) => {
+      if (chunks) {
+        for await (const batch of stream.readChunks())
+          stream.writeChunks(batch);
+        stream.end();
+      } else {
+        stream.on('data', (chunk) => stream.write(chunk));
+        stream.on('end', () => stream.end());
+      }
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', async () => {
+      const stream = session.openStream();
+      stream.on('close', () => {
+        client.close();
+        server.close();
+      });
+
+      let sent = 1;
+      let received = 0;
+      function onData(length) {
+        received += length;
+        if (received < sent * size)
+          return false;
+        if (sent === n) {
+          bench.end(n);
+          stream.end();
+          return true;
+        }
+        sent++;
+        if (chunks)
+          stream.writeChunks(message);
+        else
+          stream.write(message);
+        return false;
+      }
+
+      bench.start();
+      if (chunks) {
+        stream.writeChunks(message);
+        for await (const batch of stream.readChunks()) {
+          let length = 0;
+          for (const chunk of batch)
+            length += chunk.length;
+          if (onData(length))
+            break;
+        }
+      } else {
+        stream.write(message);
+        stream.on('data', (chunk) => onData(chunk.length));
+      }
+    });
+  });
+}
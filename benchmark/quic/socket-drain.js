@@ -0,0 +1,83 @@
+'use strict';
+
+// Measures how long the event loop is blocked while a server QuicSocket
+// with many open sessions is shut down, either by closing all of the
+// sessions at once with close() or by spreading them out with drain().
+//
+// The reported rate is the reciprocal of the longest event loop stall
+// (in seconds) observed during the shutdown so that, as with the other
+// benchmarks, higher is better.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  drain: ['true', 'false'],
+  sessions: [1000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+const kWindow = 200;
+
+function main({ drain, sessions }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+  const server = createSocket({
+    port: 0,
+    maxConnectionsPerHost: sessions + 1
+  });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const options = {
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    };
+
+    let secure = 0;
+    for (let i = 0; i < sessions; i++) {
+      const session = client.connect(options);
+      session.on('secure', () => {
+        if (++secure === sessions)
+          shutdown();
+      });
+    }
+
+    function shutdown() {
+      let done = false;
+      let last = process.hrtime.bigint();
+      let longest = 0n;
+
+      function probe() {
+        const now = process.hrtime.bigint();
+        if (now - last > longest)
+          longest = now - last;
+        last = now;
+        if (!done)
+          setImmediate(probe);
+      }
+
+      function closed() {
+        done = true;
+        bench.end(1e9 / Number(longest || 1n));
+        client.destroy();
+      }
+
+      bench.start();
+      setImmediate(probe);
+      if (drain === 'true')
+        server.drain({ window: kWindow }, closed);
+      else
+        server.close(closed);
+    }
+  });
+}
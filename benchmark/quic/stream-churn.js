@@ -0,0 +1,78 @@
+'use strict';
+
+// Measures the rate at which QUIC streams can be opened and closed on a
+// single session when each stream carries a single byte in each
+// direction.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  concurrency: [1, 10],
+  halfOpen: ['true', 'false'],
+  transport: ['udp', 'loopback'],
+  n: [5000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ concurrency, halfOpen, n, transport }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  halfOpen = halfOpen === 'true';
+
+  const loopback = transport === 'loopback';
+  const server = createSocket({ port: 0, loopback });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      stream.resume();
+      if (halfOpen)
+        stream.on('end', () => stream.end('x'));
+      else
+        stream.end('x');
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      loopback,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', () => {
+      let started = 0;
+      let closed = 0;
+
+      function open() {
+        started++;
+        const stream = session.openStream();
+        stream.resume();
+        stream.on('close', () => {
+          if (++closed === n) {
+            bench.end(n);
+            client.close();
+            server.close();
+          } else if (started < n) {
+            open();
+          }
+        });
+        stream.end('x');
+      }
+
+      bench.start();
+      for (let i = 0; i < Math.min(concurrency, n); i++)
+        open();
+    });
+  });
+}
@@ -0,0 +1,86 @@
+'use strict';
+
+// Measures the throughput of a QUIC to TCP proxy that forwards each
+// QuicStream to a TCP echo server, using either QuicStream.proxy() or
+// stream.pipe() in both directions.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  method: ['proxy', 'pipe'],
+  length: [16 * 1024 * 1024],
+  chunk: [64 * 1024],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ method, length, chunk }) {
+  const net = require('net');
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const data = Buffer.alloc(chunk, 'x');
+
+  const backend = net.createServer((socket) => socket.pipe(socket));
+  const server = createSocket({ port: 0 });
+
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      const socket = net.connect(backend.address().port);
+      if (method === 'proxy') {
+        stream.proxy(socket);
+      } else {
+        stream.pipe(socket);
+        socket.pipe(stream);
+      }
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', () => {
+      const stream = session.openStream();
+      let received = 0;
+      stream.on('data', (buf) => received += buf.length);
+      stream.on('end', () => {
+        // Reports the throughput in MB/s of data sent through the proxy
+        // and echoed back.
+        bench.end(received / (1024 * 1024));
+        client.close();
+        server.close();
+        backend.close();
+      });
+
+      let written = 0;
+      function write() {
+        while (written < length) {
+          written += data.length;
+          if (!stream.write(data)) {
+            stream.once('drain', write);
+            return;
+          }
+        }
+        stream.end();
+      }
+
+      bench.start();
+      write();
+    });
+  });
+
+  backend.listen(0, () => {
+    server.listen({ key, cert, ca, alpn: kALPN });
+  });
+}
@@ -0,0 +1,76 @@
+'use strict';
+
+// Measures the request/response rate when many QUIC streams are in
+// flight concurrently on a single session. Each request opens a new
+// bidirectional stream, sends `size` bytes and waits for a response
+// of the same size.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  streams: [1, 10, 100],
+  size: [64, 4096],
+  transport: ['udp', 'loopback'],
+  n: [2000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ streams, size, n, transport }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const data = Buffer.alloc(size, 'x');
+
+  const loopback = transport === 'loopback';
+  const server = createSocket({ port: 0, loopback });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      stream.resume();
+      stream.on('end', () => stream.end(data));
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      loopback,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', () => {
+      let started = 0;
+      let completed = 0;
+
+      function request() {
+        started++;
+        const stream = session.openStream();
+        stream.resume();
+        stream.on('end', () => {
+          if (++completed === n) {
+            bench.end(n);
+            client.close();
+            server.close();
+          } else if (started < n) {
+            request();
+          }
+        });
+        stream.end(data);
+      }
+
+      bench.start();
+      for (let i = 0; i < Math.min(streams, n); i++)
+        request();
+    });
+  });
+}
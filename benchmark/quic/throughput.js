@@ -0,0 +1,85 @@
+'use strict';
+
+// Measures the goodput of a bulk transfer on a single QUIC stream
+// between a client and server QuicSocket, either through the kernel's
+// UDP stack or, with `transport` set to 'loopback', entirely in memory.
+// Set `rtt` (in milliseconds) and `loss` to measure goodput over an
+// emulated link; the emulation is seeded, so runs with the same
+// parameters see the same pattern of losses.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  chunk: [1024, 16384, 65536],
+  length: [64 * 1024 * 1024],
+  transport: ['udp', 'loopback'],
+  rtt: [0],
+  loss: [0],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ chunk, length, rtt, loss, transport }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const data = Buffer.alloc(chunk, 'x');
+
+  const loopback = transport === 'loopback';
+  const server = createSocket({ port: 0, loopback });
+  if (rtt > 0 || loss > 0) {
+    const profile = { delay: Math.floor(rtt / 2), loss };
+    server.setNetworkEmulation({ seed: 1, rx: profile, tx: profile });
+  }
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  let client;
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      let received = 0;
+      stream.on('data', (buf) => received += buf.length);
+      stream.on('end', () => {
+        bench.end((received * 8) / (1024 * 1024 * 1024));
+        stream.end();
+        client.close();
+        server.close();
+      });
+    });
+  });
+
+  server.on('ready', () => {
+    client = createSocket({
+      port: 0,
+      loopback,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', () => {
+      const stream = session.openStream();
+      stream.resume();
+      let remaining = length;
+
+      function write() {
+        while (remaining > 0) {
+          const n = Math.min(remaining, chunk);
+          remaining -= n;
+          const buf = n === chunk ? data : data.slice(0, n);
+          if (!stream.write(buf))
+            return stream.once('drain', write);
+        }
+        stream.end();
+      }
+
+      bench.start();
+      write();
+    });
+  });
+}
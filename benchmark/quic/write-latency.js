@@ -0,0 +1,73 @@
+'use strict';
+
+// Measures the round trip rate of small writes echoed back on a single
+// QUIC stream. Each write is only sent after the previous one has been
+// echoed back in full.
+
+const common = require('../common.js');
+const fixtures = require('../../test/common/fixtures');
+
+const bench = common.createBenchmark(main, {
+  size: [1, 64, 1024],
+  transport: ['udp', 'loopback'],
+  n: [10000],
+}, { flags: ['--no-warnings'] });
+
+const kALPN = 'bench';
+const kServerName = 'agent1';
+
+function main({ size, n, transport }) {
+  const { createSocket } = require('quic');
+  const key = fixtures.readKey('agent1-key.pem', 'binary');
+  const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+  const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+  const data = Buffer.alloc(size, 'x');
+
+  const loopback = transport === 'loopback';
+  const server = createSocket({ port: 0, loopback });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  server.on('session', (session) => {
+    session.on('stream', (stream) => {
+      stream.on('data', (chunk) => stream.write(chunk));
+      stream.on('end', () => stream.end());
+    });
+  });
+
+  server.on('ready', () => {
+    const client = createSocket({
+      port: 0,
+      loopback,
+      client: { key, cert, ca, alpn: kALPN }
+    });
+    const session = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    session.on('secure', () => {
+      const stream = session.openStream();
+      let count = 0;
+      let received = 0;
+
+      stream.on('data', (chunk) => {
+        received += chunk.length;
+        if (received < size)
+          return;
+        received = 0;
+        if (++count < n) {
+          stream.write(data);
+          return;
+        }
+        bench.end(n);
+        stream.end();
+        client.close();
+        server.close();
+      });
+
+      bench.start();
+      stream.write(data);
+    });
+  });
+}
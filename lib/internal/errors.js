@@ -1104,6 +1104,8 @@ E('ERR_OUT_OF_RANGE',
     msg += ` It must be ${range}. Received ${received}`;
     return msg;
   }, RangeError);
+E('ERR_QUICAGENT_CLOSED',
+  'Cannot call %s after a QuicAgent has been closed', Error);
 E('ERR_QUICCLIENTSESSION_FAILED',
   'Failed to create a new QuicClientSession: %s', Error);
 E('ERR_QUICCLIENTSESSION_FAILED_SETSOCKET',
@@ -1127,7 +1129,11 @@ E('ERR_QUICSOCKET_LISTENING',
   'This QuicSocket is already listening', Error);
 E('ERR_QUICSOCKET_UNBOUND',
   'Cannot call %s before a QuicSocket has been bound', Error);
+E('ERR_QUICSTREAM_HEADERS_FAILED',
+  'Submitting QuicStream headers failed: %s', Error);
 E('ERR_QUICSTREAM_OPEN_FAILED', 'Opening a new QuicStream failed', Error);
+E('ERR_QUICSTREAM_READ_STARTED',
+  'The QuicStream is already being read', Error);
 E('ERR_QUIC_ERROR', function(code, family) {
   const {
     constants: {
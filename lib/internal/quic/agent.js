@@ -0,0 +1,463 @@
+'use strict';
+
+const EventEmitter = require('events');
+const { setTimeout, clearTimeout } = require('timers');
+const { QuicSocket } = require('internal/quic/core');
+const { URL } = require('internal/url');
+const {
+  codes: {
+    ERR_INVALID_ARG_TYPE,
+    ERR_INVALID_CALLBACK,
+    ERR_QUICAGENT_CLOSED,
+    ERR_QUICSESSION_DESTROYED,
+  },
+} = require('internal/errors');
+const { validateInteger } = require('internal/validators');
+
+// The ALPN identifier used for connections made to Alt-Svc alternatives,
+// unless the agent is given another.
+const kDefaultAltSvcAlpn = 'h3-22';
+
+// RFC 7838 Section 3.1
+const kDefaultAltSvcMaxAge = 86400;
+
+// How long an alternative that could not be connected to is ignored.
+const kAltSvcBrokenTimeout = 5 * 60 * 1000;
+
+const kAltSvcProtocolId = /^[!#$%&'*+.^_`|~0-9A-Za-z-]+$/;
+
+// Splits a header value on the given separator, except where it appears
+// within a quoted-string.
+function splitUnquoted(value, separator) {
+  const parts = [];
+  let quoted = false;
+  let start = 0;
+  for (let n = 0; n < value.length; n++) {
+    const c = value[n];
+    if (c === '\\' && quoted) {
+      n++;
+    } else if (c === '"') {
+      quoted = !quoted;
+    } else if (c === separator && !quoted) {
+      parts.push(value.slice(start, n).trim());
+      start = n + 1;
+    }
+  }
+  parts.push(value.slice(start).trim());
+  return parts;
+}
+
+function unquote(value) {
+  if (value.length < 2 || value[0] !== '"' || value[value.length - 1] !== '"')
+    return value;
+  return value.slice(1, -1).replace(/\\([\s\S])/g, '$1');
+}
+
+// Parses the value of an Alt-Svc header field, or of an HTTP/2 ALTSVC
+// frame, as specified by RFC 7838. Alternatives that cannot be parsed are
+// ignored. Returns null if the value is 'clear'.
+function parseAltSvc(value, now = Date.now()) {
+  if (value.trim() === 'clear')
+    return null;
+  const alternatives = [];
+  for (const entry of splitUnquoted(value, ',')) {
+    const [alternative, ...params] = splitUnquoted(entry, ';');
+    const eq = alternative.indexOf('=');
+    if (eq <= 0)
+      continue;
+    let alpn = alternative.slice(0, eq).trim();
+    if (!kAltSvcProtocolId.test(alpn))
+      continue;
+    try {
+      alpn = decodeURIComponent(alpn);
+    } catch {
+      continue;
+    }
+    const authority = unquote(alternative.slice(eq + 1).trim());
+    const colon = authority.lastIndexOf(':');
+    if (colon < 0)
+      continue;
+    let host = authority.slice(0, colon);
+    if (host[0] === '[' && host[host.length - 1] === ']')
+      host = host.slice(1, -1);
+    const port = +authority.slice(colon + 1);
+    if (!Number.isInteger(port) || port <= 0 || port > 65535)
+      continue;
+
+    let maxAge = kDefaultAltSvcMaxAge;
+    for (const param of params) {
+      const peq = param.indexOf('=');
+      if (peq > 0 && param.slice(0, peq).trim().toLowerCase() === 'ma') {
+        const ma = +unquote(param.slice(peq + 1).trim());
+        if (Number.isInteger(ma) && ma >= 0)
+          maxAge = ma;
+      }
+    }
+    alternatives.push({ alpn, host, port, expires: now + maxAge * 1000 });
+  }
+  return alternatives;
+}
+
+function getOrigin(origin) {
+  if (typeof origin !== 'string' && !(origin instanceof URL))
+    throw new ERR_INVALID_ARG_TYPE('origin', ['string', 'URL'], origin);
+  return new URL(origin).origin;
+}
+
+const kCreateSession = Symbol('kCreateSession');
+const kDispatch = Symbol('kDispatch');
+const kFail = Symbol('kFail');
+
+// Returns the key used to pool sessions. Sessions are only shared by
+// requests that connect to the same endpoint for the same servername.
+function getPoolKey(options) {
+  const { address = 'localhost', port = 0, servername = address } = options;
+  return `${servername}@${address}:${port}`;
+}
+
+function hasCapacity(entry, halfOpen) {
+  const { session } = entry;
+  if (session.closing || session.destroyed)
+    return false;
+  if (!entry.ready)
+    return true;
+  const { bidi, uni } = session.maxStreams;
+  return halfOpen ? entry.uni < uni : entry.bidi < bidi;
+}
+
+function openPooledStream(entry, request) {
+  let stream;
+  try {
+    stream = entry.session.openStream(request.streamOptions);
+  } catch (err) {
+    process.nextTick(request.callback, err);
+    return;
+  }
+  if (request.halfOpen)
+    entry.uni++;
+  else
+    entry.bidi++;
+  process.nextTick(request.callback, null, stream);
+}
+
+// A QuicAgent pools QuicClientSessions by origin and opens new streams on
+// an existing session while it allows more streams to be opened. Session
+// tickets received on pooled sessions are reused to resume new sessions
+// to the same origin. The QuicAgent also tracks the alternative QUIC
+// endpoints that origins advertise using Alt-Svc.
+class QuicAgent extends EventEmitter {
+  #alpn = kDefaultAltSvcAlpn;
+  #altSvc = new Map();
+  #broken = new Map();
+  #closed = false;
+  #pools = new Map();
+  #resumption = new Map();
+  #socket = undefined;
+
+  constructor(options = {}) {
+    super();
+    if (options === null || typeof options !== 'object')
+      throw new ERR_INVALID_ARG_TYPE('options', 'Object', options);
+    const { socket, alpn = kDefaultAltSvcAlpn } = options;
+    if (!(socket instanceof QuicSocket))
+      throw new ERR_INVALID_ARG_TYPE('options.socket', 'QuicSocket', socket);
+    if (typeof alpn !== 'string')
+      throw new ERR_INVALID_ARG_TYPE('options.alpn', 'string', alpn);
+    this.#socket = socket;
+    this.#alpn = alpn;
+  }
+
+  get closed() {
+    return this.#closed;
+  }
+
+  get socket() {
+    return this.#socket;
+  }
+
+  [kCreateSession](key, options) {
+    const resumption = this.#resumption.get(key);
+    if (resumption !== undefined && options.sessionTicket === undefined) {
+      options = {
+        ...options,
+        sessionTicket: resumption.sessionTicket,
+        remoteTransportParams: resumption.remoteTransportParams,
+      };
+    }
+
+    const session = this.#socket.connect(options);
+    const entry = {
+      session,
+      ready: false,
+      pending: [],
+      bidi: 0,
+      uni: 0,
+    };
+
+    let pool = this.#pools.get(key);
+    if (pool === undefined) {
+      pool = [];
+      this.#pools.set(key, pool);
+    }
+    pool.push(entry);
+
+    session.on('sessionTicket', (id, sessionTicket, remoteTransportParams) => {
+      this.#resumption.set(key, { sessionTicket, remoteTransportParams });
+    });
+    session.once('secure', () => {
+      entry.ready = true;
+      const pending = entry.pending;
+      entry.pending = [];
+      for (const request of pending) {
+        // The first request always uses the session it was queued on.
+        if (hasCapacity(entry, request.halfOpen) ||
+            entry.bidi + entry.uni === 0) {
+          openPooledStream(entry, request);
+        } else {
+          this[kDispatch](key, options, request);
+        }
+      }
+    });
+    // Errors are passed on to the pending requests. Streams that have
+    // already been opened report them on their own.
+    session.on('error', (err) => {
+      // A session that fails before it is used may hold a stale ticket.
+      if (!entry.ready)
+        this.#resumption.delete(key);
+      this[kFail](entry, err);
+    });
+    session.once('close', () => {
+      const index = pool.indexOf(entry);
+      if (index !== -1)
+        pool.splice(index, 1);
+      if (pool.length === 0 && this.#pools.get(key) === pool)
+        this.#pools.delete(key);
+      this[kFail](entry, new ERR_QUICSESSION_DESTROYED('openStream'));
+    });
+    return entry;
+  }
+
+  [kFail](entry, err) {
+    const pending = entry.pending;
+    entry.pending = [];
+    for (const { callback } of pending)
+      process.nextTick(callback, err);
+  }
+
+  [kDispatch](key, options, request) {
+    const pool = this.#pools.get(key) || [];
+    let entry = pool.find((entry) => hasCapacity(entry, request.halfOpen));
+    if (entry === undefined)
+      entry = this[kCreateSession](key, options);
+    if (entry.ready)
+      openPooledStream(entry, request);
+    else
+      entry.pending.push(request);
+  }
+
+  // Opens a stream on a pooled QuicClientSession for the endpoint given in
+  // options, connecting a new session if none can open another stream.
+  openStream(options, streamOptions, callback) {
+    if (typeof streamOptions === 'function') {
+      callback = streamOptions;
+      streamOptions = undefined;
+    }
+    if (options === null || typeof options !== 'object')
+      throw new ERR_INVALID_ARG_TYPE('options', 'Object', options);
+    if (typeof callback !== 'function')
+      throw new ERR_INVALID_CALLBACK();
+    if (this.#closed)
+      throw new ERR_QUICAGENT_CLOSED('openStream');
+    streamOptions = { ...streamOptions };
+    this[kDispatch](getPoolKey(options), options, {
+      streamOptions,
+      halfOpen: !!streamOptions.halfOpen,
+      callback,
+    });
+  }
+
+  // Records the alternative services advertised for origin by an Alt-Svc
+  // header field or an HTTP/2 ALTSVC frame. Only alternatives using the
+  // ALPN identifier of the agent are kept.
+  setAltSvc(origin, value) {
+    origin = getOrigin(origin);
+    if (typeof value !== 'string')
+      throw new ERR_INVALID_ARG_TYPE('value', 'string', value);
+    const alternatives = parseAltSvc(value);
+    if (alternatives === null) {
+      this.#altSvc.delete(origin);
+      return;
+    }
+    const usable =
+      alternatives.filter((alternative) => alternative.alpn === this.#alpn);
+    if (usable.length > 0)
+      this.#altSvc.set(origin, usable);
+  }
+
+  // Returns the alternatives for origin that have neither expired nor
+  // recently failed.
+  getAltSvc(origin) {
+    origin = getOrigin(origin);
+    const alternatives = this.#altSvc.get(origin);
+    if (alternatives === undefined)
+      return [];
+    const now = Date.now();
+    const current = alternatives.filter(({ expires }) => expires > now);
+    if (current.length === 0) {
+      this.#altSvc.delete(origin);
+      return [];
+    }
+    this.#altSvc.set(origin, current);
+    return current
+      .filter(({ alpn, host, port }) => {
+        const until = this.#broken.get(`${alpn}:${host}:${port}`);
+        return until === undefined || until <= now;
+      })
+      .map(({ alpn, host, port }) => ({ alpn, host, port }));
+  }
+
+  // Records the alternatives advertised in the ALTSVC frames received on
+  // an Http2Session.
+  observe(http2session) {
+    http2session.on('altsvc', (alt, origin) => {
+      if (!origin) {
+        const originSet = http2session.originSet;
+        if (originSet === undefined || originSet.length === 0)
+          return;
+        origin = originSet[0];
+      }
+      try {
+        this.setAltSvc(origin, alt);
+      } catch {
+        // Invalid origins are ignored.
+      }
+    });
+  }
+
+  // Opens a stream to origin over QUIC, if origin has advertised a usable
+  // alternative, while connecting over TCP using createConnection, which
+  // is passed a callback to call with an error or a connection. The first
+  // to succeed is passed to callback as (null, stream) or
+  // (null, undefined, connection). A QUIC session that loses the race is
+  // kept in the pool; a TCP connection that loses is destroyed.
+  connect(origin, options, createConnection, callback) {
+    if (typeof options === 'function') {
+      callback = createConnection;
+      createConnection = options;
+      options = {};
+    }
+    if (options === null || typeof options !== 'object')
+      throw new ERR_INVALID_ARG_TYPE('options', 'Object', options);
+    if (typeof createConnection !== 'function') {
+      throw new ERR_INVALID_ARG_TYPE(
+        'createConnection', 'Function', createConnection);
+    }
+    if (typeof callback !== 'function')
+      throw new ERR_INVALID_CALLBACK();
+    const { tcpDelay = 0, ...connectOptions } = options;
+    validateInteger(tcpDelay, 'options.tcpDelay', 0);
+
+    const { hostname } = new URL(getOrigin(origin));
+    const [alternative] = this.getAltSvc(origin);
+    if (alternative === undefined) {
+      createConnection((err, connection) => {
+        callback(err, undefined, connection);
+      });
+      return;
+    }
+
+    let done = false;
+    let failures = 0;
+    let lastError;
+    let timer;
+    const fail = (err) => {
+      lastError = err;
+      if (++failures === 2 && !done) {
+        done = true;
+        callback(lastError);
+      }
+    };
+
+    const startTcp = () => {
+      timer = undefined;
+      createConnection((err, connection) => {
+        if (err)
+          return fail(err);
+        if (done) {
+          if (connection && typeof connection.destroy === 'function')
+            connection.destroy();
+          return;
+        }
+        done = true;
+        callback(null, undefined, connection);
+      });
+    };
+
+    const { alpn, host, port } = alternative;
+    this.openStream({
+      ...connectOptions,
+      alpn,
+      address: host || hostname,
+      port,
+      servername: hostname,
+    }, (err, stream) => {
+      if (err) {
+        this.#broken.set(`${alpn}:${host}:${port}`,
+                         Date.now() + kAltSvcBrokenTimeout);
+        if (timer !== undefined) {
+          clearTimeout(timer);
+          startTcp();
+        }
+        return fail(err);
+      }
+      if (done) {
+        stream.destroy();
+        return;
+      }
+      done = true;
+      if (timer !== undefined)
+        clearTimeout(timer);
+      callback(null, stream);
+    });
+
+    if (tcpDelay > 0)
+      timer = setTimeout(startTcp, tcpDelay);
+    else
+      startTcp();
+  }
+
+  // Gracefully closes all pooled sessions. No new streams can be opened
+  // using the QuicAgent afterwards.
+  close(callback) {
+    if (callback !== undefined) {
+      if (typeof callback !== 'function')
+        throw new ERR_INVALID_CALLBACK();
+      this.once('close', callback);
+    }
+    if (this.#closed)
+      return;
+    this.#closed = true;
+    let remaining = 0;
+    const onClose = () => {
+      if (--remaining === 0)
+        this.emit('close');
+    };
+    for (const pool of this.#pools.values()) {
+      for (const { session } of pool) {
+        if (session.destroyed)
+          continue;
+        remaining++;
+        session.once('close', onClose);
+        session.close();
+      }
+    }
+    this.#pools.clear();
+    if (remaining === 0)
+      process.nextTick(() => this.emit('close'));
+  }
+}
+
+module.exports = {
+  QuicAgent,
+  parseAltSvc,
+};
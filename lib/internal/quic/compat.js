@@ -0,0 +1,445 @@
+'use strict';
+
+const { Object, ObjectPrototype } = primordials;
+
+const Stream = require('stream');
+const { Readable } = Stream;
+const {
+  codes: {
+    ERR_HTTP_HEADERS_SENT,
+    ERR_HTTP_INVALID_HEADER_VALUE,
+    ERR_HTTP_INVALID_STATUS_CODE,
+    ERR_INVALID_HTTP_TOKEN,
+    ERR_STREAM_DESTROYED,
+  },
+  hideStackFrames
+} = require('internal/errors');
+const { validateString } = require('internal/validators');
+const { _checkIsHttpToken: checkIsHttpToken } = require('_http_common');
+const { utcDate } = require('internal/http');
+
+const kHeaders = Symbol('headers');
+const kRequest = Symbol('request');
+const kResponse = Symbol('response');
+const kSetHeader = Symbol('setHeader');
+const kState = Symbol('state');
+const kStream = Symbol('stream');
+const kTrailers = Symbol('trailers');
+
+const kStatusContinue = 100;
+const kStatusOk = 200;
+
+// Defines an API compatibility layer on top of the HTTP/3 support of
+// QuicStream, providing request and response objects that are as close
+// as possible to those of require('http') and of the http2 compatibility
+// layer. Header blocks are sent and received using the submit*Headers()
+// methods and the *Headers events of the QuicStream.
+
+const assertValidHeader = hideStackFrames((name, value) => {
+  if (name === '' || typeof name !== 'string' || !checkIsHttpToken(name))
+    throw new ERR_INVALID_HTTP_TOKEN('Header name', name);
+  if (value === undefined || value === null)
+    throw new ERR_HTTP_INVALID_HEADER_VALUE(value, name);
+});
+
+function onStreamData(chunk) {
+  const request = this[kRequest];
+  if (request !== undefined && !request.push(chunk))
+    this.pause();
+}
+
+function onStreamTrailers(trailers) {
+  const request = this[kRequest];
+  if (request !== undefined)
+    Object.assign(request[kTrailers], trailers);
+}
+
+function onStreamEnd() {
+  const request = this[kRequest];
+  if (request !== undefined)
+    request.push(null);
+}
+
+function onStreamError(error) {
+  // Errors in compatibility mode are not forwarded to the request and
+  // response objects. The stream emits 'close' afterwards.
+}
+
+function onStreamCloseRequest() {
+  const request = this[kRequest];
+  if (request === undefined)
+    return;
+  this[kRequest] = undefined;
+
+  const state = request[kState];
+  state.closed = true;
+  if (this.aborted || this.resetReceived !== undefined) {
+    state.aborted = true;
+    request.emit('aborted');
+  }
+
+  request.push(null);
+  // If the user did not interact with the incoming data, dump it, as
+  // the http module does.
+  if (!state.didRead && !request._readableState.resumeScheduled)
+    request.resume();
+  request.emit('close');
+}
+
+function onRequestPause() {
+  this[kStream].pause();
+}
+
+function onRequestResume() {
+  this[kStream].resume();
+}
+
+function resumeStream(stream) {
+  stream.resume();
+}
+
+class Http3ServerRequest extends Readable {
+  constructor(stream, headers) {
+    super();
+    this[kState] = {
+      aborted: false,
+      closed: false,
+      didRead: false,
+    };
+    this[kHeaders] = headers;
+    this[kTrailers] = {};
+    this[kStream] = stream;
+    stream[kRequest] = this;
+
+    stream.on('trailingHeaders', onStreamTrailers);
+    stream.on('end', onStreamEnd);
+    stream.on('error', onStreamError);
+    stream.on('close', onStreamCloseRequest);
+    this.on('pause', onRequestPause);
+    this.on('resume', onRequestResume);
+  }
+
+  get aborted() {
+    return this[kState].aborted;
+  }
+
+  get complete() {
+    return this[kState].aborted ||
+           this.readableEnded ||
+           this[kState].closed ||
+           this[kStream].destroyed;
+  }
+
+  get stream() {
+    return this[kStream];
+  }
+
+  get session() {
+    return this[kStream].session;
+  }
+
+  get headers() {
+    return this[kHeaders];
+  }
+
+  get trailers() {
+    return this[kTrailers];
+  }
+
+  get httpVersionMajor() {
+    return 3;
+  }
+
+  get httpVersionMinor() {
+    return 0;
+  }
+
+  get httpVersion() {
+    return '3.0';
+  }
+
+  get method() {
+    return this[kHeaders][':method'];
+  }
+
+  get authority() {
+    return this[kHeaders][':authority'];
+  }
+
+  get scheme() {
+    return this[kHeaders][':scheme'];
+  }
+
+  get url() {
+    return this[kHeaders][':path'];
+  }
+
+  _read(nread) {
+    const state = this[kState];
+    if (state.closed)
+      return;
+    if (!state.didRead) {
+      state.didRead = true;
+      this[kStream].on('data', onStreamData);
+    } else {
+      process.nextTick(resumeStream, this[kStream]);
+    }
+  }
+}
+
+function onStreamDrain() {
+  const response = this[kResponse];
+  if (response !== undefined)
+    response.emit('drain');
+}
+
+function onStreamCloseResponse() {
+  const response = this[kResponse];
+  if (response === undefined)
+    return;
+  this[kResponse] = undefined;
+  response[kState].closed = true;
+  response.emit('finish');
+  response.emit('close');
+}
+
+class Http3ServerResponse extends Stream {
+  constructor(stream) {
+    super();
+    this[kState] = {
+      closed: false,
+      ending: false,
+      headersSent: false,
+      sendDate: true,
+      statusCode: kStatusOk,
+    };
+    this[kHeaders] = Object.create(null);
+    this[kTrailers] = Object.create(null);
+    this[kStream] = stream;
+    stream[kResponse] = this;
+    this.writable = true;
+    stream.on('drain', onStreamDrain);
+    stream.on('close', onStreamCloseResponse);
+  }
+
+  get writableEnded() {
+    return this[kState].ending;
+  }
+
+  get finished() {
+    const stream = this[kStream];
+    return stream.destroyed ||
+           stream._writableState.ended ||
+           this[kState].closed;
+  }
+
+  get stream() {
+    return this[kStream];
+  }
+
+  get session() {
+    return this[kStream].session;
+  }
+
+  get headersSent() {
+    return this[kState].headersSent;
+  }
+
+  get sendDate() {
+    return this[kState].sendDate;
+  }
+
+  set sendDate(bool) {
+    this[kState].sendDate = Boolean(bool);
+  }
+
+  get statusCode() {
+    return this[kState].statusCode;
+  }
+
+  set statusCode(code) {
+    code |= 0;
+    // Informational responses are sent using writeContinue().
+    if (code < 200 || code > 599)
+      throw new ERR_HTTP_INVALID_STATUS_CODE(code);
+    this[kState].statusCode = code;
+  }
+
+  setTrailer(name, value) {
+    validateString(name, 'name');
+    name = name.trim().toLowerCase();
+    assertValidHeader(name, value);
+    this[kTrailers][name] = value;
+  }
+
+  addTrailers(headers) {
+    const keys = Object.keys(headers);
+    for (let i = 0; i < keys.length; i++)
+      this.setTrailer(keys[i], headers[keys[i]]);
+  }
+
+  getHeader(name) {
+    validateString(name, 'name');
+    name = name.trim().toLowerCase();
+    return this[kHeaders][name];
+  }
+
+  getHeaderNames() {
+    return Object.keys(this[kHeaders]);
+  }
+
+  getHeaders() {
+    return { ...this[kHeaders] };
+  }
+
+  hasHeader(name) {
+    validateString(name, 'name');
+    name = name.trim().toLowerCase();
+    return ObjectPrototype.hasOwnProperty(this[kHeaders], name);
+  }
+
+  removeHeader(name) {
+    validateString(name, 'name');
+    if (this[kState].headersSent)
+      throw new ERR_HTTP_HEADERS_SENT('remove');
+    name = name.trim().toLowerCase();
+    delete this[kHeaders][name];
+  }
+
+  setHeader(name, value) {
+    validateString(name, 'name');
+    if (this[kState].headersSent)
+      throw new ERR_HTTP_HEADERS_SENT('set');
+    this[kSetHeader](name, value);
+  }
+
+  [kSetHeader](name, value) {
+    name = name.trim().toLowerCase();
+    assertValidHeader(name, value);
+    this[kHeaders][name] = value;
+  }
+
+  flushHeaders() {
+    const state = this[kState];
+    if (!state.closed && !state.headersSent)
+      this.writeHead(state.statusCode);
+  }
+
+  writeHead(statusCode, headers) {
+    const state = this[kState];
+
+    if (state.closed || this[kStream].destroyed)
+      return this;
+    if (state.headersSent)
+      throw new ERR_HTTP_HEADERS_SENT('write');
+
+    if (Array.isArray(headers)) {
+      for (let i = 0; i < headers.length; i++)
+        this[kSetHeader](headers[i][0], headers[i][1]);
+    } else if (headers != null && typeof headers === 'object') {
+      const keys = Object.keys(headers);
+      for (let i = 0; i < keys.length; i++)
+        this[kSetHeader](keys[i], headers[keys[i]]);
+    }
+
+    this.statusCode = statusCode;
+    const block = { ...this[kHeaders], ':status': state.statusCode };
+    if (state.sendDate && block.date === undefined)
+      block.date = utcDate();
+    this[kStream].submitInitialHeaders(block);
+    state.headersSent = true;
+    return this;
+  }
+
+  write(chunk, encoding, cb) {
+    if (typeof encoding === 'function') {
+      cb = encoding;
+      encoding = 'utf8';
+    }
+
+    const state = this[kState];
+    if (state.closed) {
+      const err = new ERR_STREAM_DESTROYED('write');
+      if (typeof cb === 'function')
+        process.nextTick(cb, err);
+      else
+        throw err;
+      return false;
+    }
+
+    if (!state.headersSent)
+      this.writeHead(state.statusCode);
+    return this[kStream].write(chunk, encoding, cb);
+  }
+
+  end(chunk, encoding, cb) {
+    const stream = this[kStream];
+    const state = this[kState];
+
+    if (state.closed || state.ending)
+      return this;
+
+    if (typeof chunk === 'function') {
+      cb = chunk;
+      chunk = null;
+    } else if (typeof encoding === 'function') {
+      cb = encoding;
+      encoding = 'utf8';
+    }
+
+    if (chunk !== null && chunk !== undefined)
+      this.write(chunk, encoding);
+
+    state.ending = true;
+    if (typeof cb === 'function')
+      stream.once('finish', cb);
+
+    if (!state.headersSent)
+      this.writeHead(state.statusCode);
+
+    // Trailing headers must be submitted before the stream is ended.
+    if (!stream.destroyed && Object.keys(this[kTrailers]).length > 0)
+      stream.submitTrailingHeaders(this[kTrailers]);
+    stream.end();
+
+    return this;
+  }
+
+  destroy(err) {
+    if (this[kState].closed)
+      return;
+    this[kStream].destroy(err);
+  }
+
+  writeContinue() {
+    const state = this[kState];
+    if (state.headersSent || state.closed)
+      return false;
+    this[kStream].submitInformationalHeaders({ ':status': kStatusContinue });
+    return true;
+  }
+}
+
+// Called with the QuicSocket as this when the request headers of a
+// bidirectional QuicStream have been received on a server QuicSession
+// that is using HTTP/3.
+function onServerStream(stream, headers) {
+  const request = new Http3ServerRequest(stream, headers);
+  const response = new Http3ServerResponse(stream);
+
+  if (headers.expect === '100-continue') {
+    if (this.listenerCount('checkContinue') > 0) {
+      this.emit('checkContinue', request, response);
+      return;
+    }
+    response.writeContinue();
+  }
+
+  this.emit('request', request, response);
+}
+
+module.exports = {
+  onServerStream,
+  Http3ServerRequest,
+  Http3ServerResponse,
+};
@@ -2,6 +2,8 @@
 
 /* eslint-disable no-use-before-define */
 
+const { Math } = primordials;
+
 const {
   assertCrypto,
   customInspectSymbol: kInspect,
@@ -10,13 +12,19 @@ const {
 assertCrypto();
 
 const { Buffer } = require('buffer');
+const { FastBuffer } = require('internal/buffer');
+const fs = require('fs');
+const net = require('net');
 const { isArrayBufferView } = require('internal/util/types');
 const {
   getAllowUnauthorized,
   getSocketType,
   lookup4,
   lookup6,
+  validateAdmissionControlOptions,
+  validateDrainOptions,
   validateCloseCode,
+  validateNetworkEmulationOptions,
   validateTransportParams,
   validateQuicClientSessionOptions,
   validateQuicSocketOptions,
@@ -25,6 +33,7 @@ const util = require('util');
 const assert = require('internal/assert');
 const EventEmitter = require('events');
 const { Duplex } = require('stream');
+const { setTimeout } = require('timers');
 const {
   createSecureContext: _createSecureContext
 } = require('tls');
@@ -32,7 +41,7 @@ const {
   translatePeerCertificate
 } = require('_tls_common');
 const {
-  defaultTriggerAsyncIdScope, // eslint-disable-line no-unused-vars
+  defaultTriggerAsyncIdScope,
   symbols: {
     async_id_symbol,
     owner_symbol,
@@ -50,12 +59,31 @@ const {
   setStreamTimeout // eslint-disable-line no-unused-vars
 } = require('internal/stream_base_commons');
 
+const { onServerStream } = require('internal/quic/compat');
+
+const {
+  assertValidPseudoHeaderResponse,
+  assertValidPseudoHeaderTrailer,
+  mapToHeaders,
+  toHeaderObject,
+} = require('internal/http2/util');
+
 const {
   ShutdownWrap,
-  kReadBytesOrError, // eslint-disable-line no-unused-vars
-  streamBaseState // eslint-disable-line no-unused-vars
+  WriteWrap,
+  kArrayBufferOffset,
+  kLastWriteWasAsync,
+  kReadBytesOrError,
+  streamBaseState
 } = internalBinding('stream_wrap');
 
+const { FileHandle } = internalBinding('fs');
+const { Pipe } = internalBinding('pipe_wrap');
+const { StreamPipe } = internalBinding('stream_pipe');
+const { TCP } = internalBinding('tcp_wrap');
+const { UV_EOF } = internalBinding('uv');
+const { validateInteger } = require('internal/validators');
+
 const {
   codes: {
     ERR_INVALID_ARG_TYPE,
@@ -71,7 +99,11 @@ const {
     ERR_QUICCLIENTSESSION_FAILED,
     ERR_QUICCLIENTSESSION_FAILED_SETSOCKET,
     ERR_QUICSESSION_UPDATEKEY,
+    ERR_QUICSTREAM_HEADERS_FAILED,
     ERR_QUICSTREAM_OPEN_FAILED,
+    ERR_QUICSTREAM_READ_STARTED,
+    ERR_STREAM_DESTROYED,
+    ERR_STREAM_WRITE_AFTER_END,
     ERR_TLS_DH_PARAM_SIZE,
   },
   errnoException,
@@ -86,6 +118,7 @@ const {
   openBidirectionalStream: _openBidirectionalStream,
   openUnidirectionalStream: _openUnidirectionalStream,
   sessionConfig,
+  linkProfile,
   setCallbacks,
   constants: {
     AF_INET,
@@ -104,7 +137,20 @@ const {
     IDX_QUIC_SESSION_IDLE_TIMEOUT,
     IDX_QUIC_SESSION_MAX_PACKET_SIZE,
     IDX_QUIC_SESSION_MAX_CRYPTO_BUFFER,
+    IDX_QUIC_SESSION_MAX_MEMORY,
+    IDX_QUIC_SESSION_MAX_STREAM_WINDOW,
+    IDX_QUIC_SESSION_MAX_CONNECTION_WINDOW,
     IDX_QUIC_SESSION_CONFIG_COUNT,
+    IDX_QUIC_LINK_DELAY,
+    IDX_QUIC_LINK_JITTER,
+    IDX_QUIC_LINK_RATE,
+    IDX_QUIC_LINK_QUEUE_LIMIT,
+    IDX_QUIC_LINK_REORDER,
+    IDX_QUIC_LINK_DUPLICATE,
+    IDX_QUIC_LINK_LOSS,
+    IDX_QUIC_LINK_BURST_LOSS,
+    IDX_QUIC_LINK_BURST_ENTER,
+    IDX_QUIC_LINK_BURST_EXIT,
     IDX_QUIC_SESSION_MAX_PACKET_SIZE_DEFAULT,
     IDX_QUIC_SESSION_MAX_ACK_DELAY,
     IDX_QUIC_SESSION_STATE_CERT_ENABLED,
@@ -118,12 +164,20 @@ const {
     NGTCP2_PATH_VALIDATION_RESULT_FAILURE,
     NGTCP2_NO_ERROR,
     QUIC_ERROR_APPLICATION,
+    QUICSERVERSESSION_OPTION_ASYNC_SIGNING,
+    QUICSERVERSESSION_OPTION_LITE_STREAMS,
     QUICSERVERSESSION_OPTION_REJECT_UNAUTHORIZED,
     QUICSERVERSESSION_OPTION_REQUEST_CERT,
+    QUICCLIENTSESSION_OPTION_LITE_STREAMS,
     QUICCLIENTSESSION_OPTION_REQUEST_OCSP,
     QUICCLIENTSESSION_OPTION_VERIFY_HOSTNAME_IDENTITY,
     QUICSOCKET_OPTIONS_VALIDATE_ADDRESS,
     QUICSOCKET_OPTIONS_VALIDATE_ADDRESS_LRU,
+    QUICSOCKET_OPTIONS_LOOPBACK,
+    QUICSOCKET_OPTIONS_DISABLE_STATELESS_RESET,
+    QUICSTREAM_HEADERS_KIND_INFORMATIONAL,
+    QUICSTREAM_HEADERS_KIND_INITIAL,
+    QUICSTREAM_HEADERS_KIND_TRAILING,
   }
 } = internalBinding('quic');
 
@@ -138,21 +192,30 @@ const DEFAULT_GROUPS = 'P-256:X25519:P-384:P-521';
 
 const emit = EventEmitter.prototype.emit;
 
+const kAddContext = Symbol('kAddContext');
 const kAddSession = Symbol('kAddSession');
 const kAddStream = Symbol('kAddStream');
 const kClose = Symbol('kClose');
 const kCert = Symbol('kCert');
+const kChunkReader = Symbol('kChunkReader');
 const kClientHello = Symbol('kClientHello');
 const kContinueBind = Symbol('kContinueBind');
 const kContinueConnect = Symbol('kContinueConnect');
 const kContinueListen = Symbol('kContinueListen');
 const kDestroy = Symbol('kDestroy');
+const kEnd = Symbol('kEnd');
+const kGetContext = Symbol('kGetContext');
+const kGetStream = Symbol('kGetStream');
 const kHandshake = Symbol('kHandshake');
 const kHandshakePost = Symbol('kHandshakePost');
+const kHeaders = Symbol('kHeaders');
 const kInit = Symbol('kInit');
+const kLiteStreams = Symbol('kLiteStreams');
 const kMaybeBind = Symbol('kMaybeBind');
 const kMaybeReady = Symbol('kMaybeReady');
+const kProxy = Symbol('kProxy');
 const kReady = Symbol('kReady');
+const kReceive = Symbol('kReceive');
 const kReceiveStart = Symbol('kReceiveStart');
 const kReceiveStop = Symbol('kReceiveStop');
 const kRemoveSession = Symbol('kRemove');
@@ -161,7 +224,9 @@ const kServerBusy = Symbol('kServerBusy');
 const kSetHandle = Symbol('kSetHandle');
 const kSetSocket = Symbol('kSetSocket');
 const kStreamClose = Symbol('kStreamClose');
+const kSendFD = Symbol('kSendFD');
 const kStreamReset = Symbol('kStreamReset');
+const kSubmitHeaders = Symbol('kSubmitHeaders');
 const kTrackWriteState = Symbol('kTrackWriteState');
 const kVersionNegotiation = Symbol('kVersionNegotiation');
 const kWriteGeneric = Symbol('kWriteGeneric');
@@ -172,7 +237,7 @@ const kSocketBound = 2;
 const kSocketClosing = 3;
 const kSocketDestroyed = 4;
 
-let diagnosticPacketLossWarned = false;
+let networkEmulationWarned = false;
 
 function setConfigField(val, index) {
   if (typeof val === 'number') {
@@ -195,6 +260,9 @@ function setTransportParams(config) {
     maxPacketSize,
     maxAckDelay,
     maxCryptoBuffer,
+    maxMemory,
+    maxStreamWindow,
+    maxConnectionWindow,
   } = { ...config };
 
   const flags = setConfigField(activeConnectionIdLimit,
@@ -215,11 +283,46 @@ function setTransportParams(config) {
                 setConfigField(maxPacketSize,
                                IDX_QUIC_SESSION_MAX_PACKET_SIZE) |
                 setConfigField(maxCryptoBuffer,
-                               IDX_QUIC_SESSION_MAX_CRYPTO_BUFFER);
+                               IDX_QUIC_SESSION_MAX_CRYPTO_BUFFER) |
+                setConfigField(maxMemory, IDX_QUIC_SESSION_MAX_MEMORY) |
+                setConfigField(maxStreamWindow,
+                               IDX_QUIC_SESSION_MAX_STREAM_WINDOW) |
+                setConfigField(maxConnectionWindow,
+                               IDX_QUIC_SESSION_MAX_CONNECTION_WINDOW);
 
   sessionConfig[IDX_QUIC_SESSION_CONFIG_COUNT] = flags;
 }
 
+function setLinkProfile(handle, tx, profile, seed) {
+  linkProfile[IDX_QUIC_LINK_DELAY] = profile.delay;
+  linkProfile[IDX_QUIC_LINK_JITTER] = profile.jitter;
+  linkProfile[IDX_QUIC_LINK_RATE] = profile.rate;
+  linkProfile[IDX_QUIC_LINK_QUEUE_LIMIT] = profile.queueLimit;
+  linkProfile[IDX_QUIC_LINK_REORDER] = profile.reorder;
+  linkProfile[IDX_QUIC_LINK_DUPLICATE] = profile.duplicate;
+  linkProfile[IDX_QUIC_LINK_LOSS] = profile.loss;
+  linkProfile[IDX_QUIC_LINK_BURST_LOSS] = profile.burstLoss;
+  linkProfile[IDX_QUIC_LINK_BURST_ENTER] = profile.burstEnter;
+  linkProfile[IDX_QUIC_LINK_BURST_EXIT] = profile.burstExit;
+  handle.setLinkProfile(tx, seed);
+}
+
+function isLinkImpaired(profile) {
+  const { delay, jitter, rate, duplicate, loss, burstEnter } = profile;
+  return delay > 0 || jitter > 0 || rate > 0 ||
+         duplicate > 0 || loss > 0 || burstEnter > 0;
+}
+
+function warnOnNetworkEmulation() {
+  if (networkEmulationWarned)
+    return;
+  networkEmulationWarned = true;
+  process.emitWarning(
+    'QuicSocket network emulation is enabled. Received or ' +
+    'transmitted packets will be delayed, reordered, duplicated or ' +
+    'ignored to simulate network conditions.');
+}
+
 // Called when the socket has been bound and is ready for use
 function onSocketReady(fd) {
   this[owner_symbol][kReady](fd);
@@ -403,12 +506,29 @@ function onStreamReady(streamHandle, id) {
   // level.
   assert(!session.closing);
 
+  if (session[kLiteStreams] && session.alpnProtocol !== 'h3-22') {
+    session[kAddStream](id, new QuicLiteStream(session, id, streamHandle));
+    return;
+  }
+
   // TODO(@jasnell): Get default options from session
   const uni = id & 0b10;
   const stream = new QuicStream({ writable: !uni }, session, id, streamHandle);
   if (uni)
     stream.end();
   session[kAddStream](id, stream);
+
+  // When the QuicSocket has 'request' listeners, HTTP/3 requests are
+  // also surfaced through the compatibility layer.
+  if (!uni &&
+      session instanceof QuicServerSession &&
+      session.alpnProtocol === 'h3-22' &&
+      session.socket.listenerCount('request') > 0) {
+    stream.once(
+      'initialHeaders',
+      onServerStream.bind(session.socket, stream));
+  }
+
   process.nextTick(emit.bind(session, 'stream', stream));
 }
 
@@ -422,6 +542,12 @@ function onStreamReset(id, appErrorCode, finalSize) {
   this[owner_symbol][kStreamReset](id, appErrorCode, finalSize);
 }
 
+// Called when a complete block of headers has been received for a
+// QuicStream. This only happens when the session is using HTTP/3.
+function onStreamHeaders(headers, kind) {
+  this[owner_symbol][kHeaders](headers, kind);
+}
+
 // Called when an error occurs in a QuicStream
 function onStreamError(streamHandle, error) {
   streamHandle[owner_symbol].destroy(error);
@@ -431,7 +557,9 @@ function onSessionSilentClose(statelessReset, code, family) {
   // During a silent close, all currently open QuicStreams are abruptly
   // closed. If they are still writable or readable, an abort event will be
   // emitted, otherwise the stream is just destroyed. No RESET_STREAM or
-  // STOP_SENDING is transmitted to the peer.
+  // STOP_SENDING is transmitted to the peer. This is also called once a
+  // QuicServerSession has entered the closing period, as the QuicSocket
+  // repeats the CONNECTION_CLOSE on its behalf from then on.
   this[owner_symbol][kDestroy](statelessReset, family, code);
 }
 
@@ -455,6 +583,7 @@ setCallbacks({
   onStreamReady,
   onStreamClose,
   onStreamError,
+  onStreamHeaders,
   onStreamReset,
   onSessionPathValidation,
 });
@@ -600,6 +729,23 @@ function onRemoveListener(event) {
   }
 }
 
+// The default interval, in milliseconds, between the batches of sessions
+// destroyed by quicsocket.drain().
+const kDrainTick = 10;
+
+function drainBatch(socket, sessions, drained, size, delay) {
+  if (socket.destroyed)
+    return;
+  const end = Math.min(drained + size, sessions.length);
+  for (; drained < end; drained++)
+    sessions[drained].destroy();
+  socket.emit('draining', drained, sessions.length - drained);
+  if (drained < sessions.length)
+    setTimeout(drainBatch, delay, socket, sessions, drained, size, delay);
+  else
+    socket[kMaybeDestroy]();
+}
+
 // QuicSocket wraps a UDP socket plus the associated TLS context and QUIC
 // Protocol state. There may be *multiple* QUIC connections (QuicSession)
 // associated with a single QuicSocket.
@@ -609,6 +755,7 @@ class QuicSocket extends EventEmitter {
   #client = undefined;
   #fd = undefined;
   #ipv6Only = undefined;
+  #liteStreams = false;
   #lookup = undefined;
   #port = undefined;
   #reuseAddr = undefined;
@@ -617,10 +764,15 @@ class QuicSocket extends EventEmitter {
   #serverListening = false;
   #serverSecureContext = undefined;
   #sessions = new Set();
+  #sniContexts = new Map();
   #state = kSocketUnbound;
   #type = undefined;
   #alpn = undefined;
   #stats = undefined;
+  #handshakeDurationHistogram = undefined;
+  #rttHistogram = undefined;
+  #sessionLifetimeHistogram = undefined;
+  #streamTimeToFirstByteHistogram = undefined;
 
   constructor(options) {
     const {
@@ -635,18 +787,40 @@ class QuicSocket extends EventEmitter {
       // Default configuration for QuicClientSessions
       client,
 
+      // True if no stateless resets are to be sent for packets received
+      // for unknown connections
+      disableStatelessReset,
+
       // True if only IPv6 should be used
       ipv6Only,
 
       // A custom function used to resolve hostname to IP
       lookup,
 
-      // The maximum number of connections per host
+      // True if datagrams are exchanged in memory rather than over UDP
+      loopback,
+
+      // The maximum number of connections per source prefix
       maxConnectionsPerHost,
 
+      // The maximum number of Initial packets accepted in a burst from
+      // a single source prefix
+      maxInitialBurst,
+
+      // The sustained number of Initial packets accepted per second from
+      // a single source prefix
+      maxInitialRate,
+
+      // The maximum number of bytes of memory held by the QuicSocket
+      // and all of its QuicSessions
+      maxMemory,
+
       // The local IP port to bind to
       port,
 
+      // The directory qlog traces of every QuicSession are written to
+      qlog,
+
       reuseAddr,
 
       // The maximum number of seconds for retry token
@@ -655,6 +829,9 @@ class QuicSocket extends EventEmitter {
       // Default configuration for QuicServerSessions
       server,
 
+      // The secret stateless reset tokens are derived from
+      statelessResetSecret,
+
       // 'udp4' or 'udp6'
       type,
 
@@ -667,12 +844,20 @@ class QuicSocket extends EventEmitter {
     super();
     const socketOptions =
       (validateAddress ? QUICSOCKET_OPTIONS_VALIDATE_ADDRESS : 0) |
-      (validateAddressLRU ? QUICSOCKET_OPTIONS_VALIDATE_ADDRESS_LRU : 0);
+      (validateAddressLRU ? QUICSOCKET_OPTIONS_VALIDATE_ADDRESS_LRU : 0) |
+      (loopback ? QUICSOCKET_OPTIONS_LOOPBACK : 0) |
+      (disableStatelessReset ?
+        QUICSOCKET_OPTIONS_DISABLE_STATELESS_RESET : 0);
     const handle =
       new QuicSocketHandle(
         socketOptions,
         retryTokenTimeout,
-        maxConnectionsPerHost);
+        maxConnectionsPerHost,
+        qlog,
+        maxMemory,
+        maxInitialRate,
+        maxInitialBurst,
+        statelessResetSecret);
     handle[owner_symbol] = this;
     this[async_id_symbol] = handle.getAsyncId();
     this[kSetHandle](handle);
@@ -689,6 +874,24 @@ class QuicSocket extends EventEmitter {
 
   [kSetHandle](handle) {
     this[kHandle] = handle;
+    if (handle !== undefined) {
+      this.#handshakeDurationHistogram =
+        new Histogram(handle.handshake_duration);
+      this.#rttHistogram = new Histogram(handle.session_rtt);
+      this.#sessionLifetimeHistogram =
+        new Histogram(handle.session_lifetime);
+      this.#streamTimeToFirstByteHistogram =
+        new Histogram(handle.stream_ttfb);
+    } else {
+      if (this.#handshakeDurationHistogram)
+        this.#handshakeDurationHistogram[kDestroyHistogram]();
+      if (this.#rttHistogram)
+        this.#rttHistogram[kDestroyHistogram]();
+      if (this.#sessionLifetimeHistogram)
+        this.#sessionLifetimeHistogram[kDestroyHistogram]();
+      if (this.#streamTimeToFirstByteHistogram)
+        this.#streamTimeToFirstByteHistogram[kDestroyHistogram]();
+    }
   }
 
   [kInspect]() {
@@ -726,6 +929,9 @@ class QuicSocket extends EventEmitter {
   // Called by the afterLookup callback to continue the binding operation
   // after the DNS lookup of the address has been completed.
   [kContinueBind](ip, callback) {
+    // The QuicSocket may have been destroyed while the lookup was pending.
+    if (this.#state === kSocketDestroyed)
+      return;
     const flags =
       (this.#reuseAddr ? UV_UDP_REUSEADDR : 0) ||
       (this.#ipv6Only ? UV_UDP_IPV6ONLY : 0);
@@ -764,6 +970,38 @@ class QuicSocket extends EventEmitter {
     this[kHandle].receiveStop();
   }
 
+  // Registers a SecureContext to be used by all QuicServerSessions on
+  // this QuicSocket for clients requesting a matching servername. Exact
+  // and leftmost-label wildcard servernames are matched natively during
+  // the TLS handshake. Other patterns are only matched when emitting
+  // the 'OCSPRequest' event.
+  [kAddContext](servername, context) {
+    servername = servername.toLowerCase();
+    const re = new RegExp('^' +
+    servername.replace(/([.^$+?\-\\[\]{}])/g, '\\$1')
+              .replace(/\*/g, '[^.]*') +
+    '$');
+    const sc = _createSecureContext(context);
+    this.#sniContexts.set(servername, [re, sc]);
+    this[kHandle].addContext(servername, sc.context);
+  }
+
+  [kGetContext](servername) {
+    servername = servername.toLowerCase();
+    const exact = this.#sniContexts.get(servername);
+    if (exact !== undefined)
+      return exact[1];
+    for (const [re, sc] of this.#sniContexts.values()) {
+      if (re.test(servername))
+        return sc;
+    }
+    return this.#serverSecureContext;
+  }
+
+  get [kLiteStreams]() {
+    return this.#liteStreams;
+  }
+
   // The kContinueListen function is called after all of the necessary
   // DNS lookups have been performed and we're ready to let the C++
   // internals begin listening for new QuicServerSession instances.
@@ -774,6 +1012,8 @@ class QuicSocket extends EventEmitter {
       type = AF_INET,
     } = { ...preferredAddress };
     const {
+      asyncSigning = false,
+      liteStreams = false,
       rejectUnauthorized = !getAllowUnauthorized(),
       requestCert = false,
     } = transportParams;
@@ -783,7 +1023,10 @@ class QuicSocket extends EventEmitter {
 
     const options =
       (rejectUnauthorized ? QUICSERVERSESSION_OPTION_REJECT_UNAUTHORIZED : 0) |
-      (requestCert ? QUICSERVERSESSION_OPTION_REQUEST_CERT : 0);
+      (requestCert ? QUICSERVERSESSION_OPTION_REQUEST_CERT : 0) |
+      (asyncSigning ? QUICSERVERSESSION_OPTION_ASYNC_SIGNING : 0) |
+      (liteStreams ? QUICSERVERSESSION_OPTION_LITE_STREAMS : 0);
+    this.#liteStreams = liteStreams;
 
     // When the handle is told to listen, it will begin acting as a QUIC
     // server and will emit session events whenever a new QuicServerSession
@@ -835,6 +1078,9 @@ class QuicSocket extends EventEmitter {
     if (typeof alpn !== 'string')
       throw new ERR_INVALID_ARG_TYPE('options.alpn', 'string', alpn);
 
+    const transportParams =
+      validateTransportParams(options, NGTCP2_MAX_CIDLEN, NGTCP2_MIN_CIDLEN);
+
     // If the callback function is provided, it is registered as a
     // handler for the on('session') event and will be called whenever
     // there is a new QuicServerSession instance created.
@@ -849,10 +1095,7 @@ class QuicSocket extends EventEmitter {
     this.#serverListening = true;
     this.#alpn = alpn;
     const doListen =
-      continueListen.bind(
-        this,
-        validateTransportParams(options, NGTCP2_MAX_CIDLEN, NGTCP2_MIN_CIDLEN),
-        this.#lookup);
+      continueListen.bind(this, transportParams, this.#lookup);
 
     // If the QuicSocket is already bound, we'll begin listening
     // immediately. If we're still pending, however, wait until
@@ -896,13 +1139,28 @@ class QuicSocket extends EventEmitter {
     if (typeof callback === 'function')
       session.on('ready', callback);
 
-    this[kMaybeBind](
+    const doConnect =
       connectAfterBind.bind(
         this,
         session,
         this.#lookup,
         address,
-        getSocketType(type)));
+        getSocketType(type));
+
+    // Only the first connect() or listen() binds the QuicSocket. As with
+    // listen(), later sessions connect once the QuicSocket is ready, or
+    // right away if it already is.
+    switch (this.#state) {
+      case kSocketUnbound:
+        this[kMaybeBind](doConnect);
+        break;
+      case kSocketPending:
+        this.on('ready', doConnect);
+        break;
+      default:
+        session[kReady]();
+        doConnect();
+    }
 
     return session;
   }
@@ -1031,6 +1289,52 @@ class QuicSocket extends EventEmitter {
       session.close(maybeDestroy);
   }
 
+  // Drain the QuicSocket ahead of shutting it down. Like close(), no new
+  // QuicServerSession instances are accepted, but rather than waiting for
+  // the existing sessions to close on their own, they are destroyed in
+  // batches spread evenly over the given window, limiting the number of
+  // CONNECTION_CLOSE packets sent and 'close' events emitted at once.
+  // The 'draining' event reports the progress after each batch. Each
+  // destroyed QuicServerSession is freed immediately; the QuicSocket
+  // keeps only its CONNECTION_CLOSE packet, and is closed once the
+  // closing periods of all of the drained sessions have ended.
+  drain(options, callback) {
+    if (this.#state === kSocketDestroyed)
+      throw new ERR_QUICSOCKET_DESTROYED('drain');
+    if (typeof options === 'function') {
+      callback = options;
+      options = undefined;
+    }
+    const {
+      batchSize,
+      window,
+    } = validateDrainOptions(options);
+
+    if (callback) {
+      if (typeof callback !== 'function')
+        throw new ERR_INVALID_CALLBACK(callback);
+      this.once('close', callback);
+    }
+
+    if (this.#state !== kSocketBound) {
+      if (this.#state !== kSocketClosing)
+        this.destroy();
+      return;
+    }
+
+    this.#state = kSocketClosing;
+    this.#serverListening = false;
+    this[kHandle].drain();
+
+    const sessions = [...this.#sessions];
+    const batches = batchSize > 0 ?
+      Math.ceil(sessions.length / batchSize) :
+      Math.max(1, Math.min(sessions.length, Math.floor(window / kDrainTick)));
+    const size = Math.ceil(sessions.length / batches);
+    const delay = batches > 1 ? window / (batches - 1) : 0;
+    process.nextTick(drainBatch, this, sessions, 0, size, delay);
+  }
+
   // Initiate an abrupt close and destruction of the QuicSocket.
   // Existing QuicClientSession and QuicServerSession instances will be
   // immediately closed. If error is specified, it will be forwarded
@@ -1206,6 +1510,24 @@ class QuicSocket extends EventEmitter {
     this[kHandle].setServerBusy(on);
   }
 
+  // Admission control automatically refuses new connections while the
+  // event loop is running behind or too many sessions are open.
+  setAdmissionControl(options) {
+    if (this.#state === kSocketDestroyed)
+      throw new ERR_QUICSOCKET_DESTROYED('setAdmissionControl');
+    const {
+      maxEventLoopDelay,
+      maxSessions,
+      resolution,
+      retry,
+    } = validateAdmissionControlOptions(options);
+    this[kHandle].setAdmissionControl(
+      maxEventLoopDelay,
+      maxSessions,
+      resolution,
+      retry);
+  }
+
   get duration() {
     const now = process.hrtime.bigint();
     const stats = this.#stats || this[kHandle].stats;
@@ -1258,6 +1580,62 @@ class QuicSocket extends EventEmitter {
     return stats[8];
   }
 
+  get memoryUsage() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[10];
+  }
+
+  get handshakesAdmitted() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[11];
+  }
+
+  get handshakesRejected() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[12];
+  }
+
+  get handshakesRetried() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[13];
+  }
+
+  get eventLoopDelay() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[14];
+  }
+
+  get initialsConnectionLimited() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[15];
+  }
+
+  get initialsRateLimited() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[16];
+  }
+
+  get statelessResets() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[17];
+  }
+
+  get handshakeDurationHistogram() {
+    return this.#handshakeDurationHistogram;
+  }
+
+  get rttHistogram() {
+    return this.#rttHistogram;
+  }
+
+  get sessionLifetimeHistogram() {
+    return this.#sessionLifetimeHistogram;
+  }
+
+  get streamTimeToFirstByteHistogram() {
+    return this.#streamTimeToFirstByteHistogram;
+  }
+
   setDiagnosticPacketLoss(options) {
     if (this.#state === kSocketDestroyed)
       throw new ERR_QUICSOCKET_DESTROYED('setDiagnosticPacketLoss');
@@ -1268,19 +1646,27 @@ class QuicSocket extends EventEmitter {
     if (typeof rx !== 'number')
       throw new ERR_INVALID_ARG_TYPE('options.rx', 'number', rx);
     if (typeof tx !== 'number')
-      throw new ERR_INVALID_ARG_TYPE('options.tx', 'number', rx);
+      throw new ERR_INVALID_ARG_TYPE('options.tx', 'number', tx);
     if (rx < 0.0 || rx > 1.0)
       throw new ERR_OUT_OF_RANGE('options.rx', '0.0 <= n <= 1.0', rx);
     if (tx < 0.0 || tx > 1.0)
       throw new ERR_OUT_OF_RANGE('options.tx', '0.0 <= n <= 1.0', tx);
-    if (rx > 0.0 || tx > 0.0 && !diagnosticPacketLossWarned) {
-      diagnosticPacketLossWarned = true;
-      process.emitWarning(
-        'QuicSocket diagnostic packet loss is enabled. Received or ' +
-        'transmitted packets will be randomly ignored to simulate ' +
-        'network packet loss.');
-    }
-    this[kHandle].setDiagnosticPacketLoss(rx, tx);
+    this.setNetworkEmulation({ rx: { loss: rx }, tx: { loss: tx } });
+  }
+
+  setNetworkEmulation(options) {
+    if (this.#state === kSocketDestroyed)
+      throw new ERR_QUICSOCKET_DESTROYED('setNetworkEmulation');
+    const {
+      seed,
+      rx,
+      tx,
+    } = validateNetworkEmulationOptions(options);
+    const handle = this[kHandle];
+    setLinkProfile(handle, false, rx, seed);
+    setLinkProfile(handle, true, tx, seed);
+    if (isLinkImpaired(rx) || isLinkImpaired(tx))
+      warnOnNetworkEmulation();
   }
 }
 
@@ -1304,9 +1690,11 @@ class QuicSession extends EventEmitter {
   #verifyErrorCode = undefined;
   #handshakeAckHistogram = undefined;
   #handshakeContinuationHistogram = undefined;
+  #liteStreams = false;
 
-  constructor(socket, servername, alpn) {
+  constructor(socket, servername, alpn, liteStreams = false) {
     super();
+    this.#liteStreams = liteStreams;
     this.on('newListener', onNewListener);
     this.on('removeListener', onRemoveListener);
     this.#socket = socket;
@@ -1375,7 +1763,7 @@ class QuicSession extends EventEmitter {
     // STOP_SENDING frames ought to have been sent,
     // so now we just trigger sending of the
     // CONNECTION_CLOSE frame.
-    this[kHandle].close(family, code);
+    this[kHandle].close(code, family);
   }
 
   [kStreamClose](id, code) {
@@ -1451,8 +1839,14 @@ class QuicSession extends EventEmitter {
     this.#streams.delete(stream.id);
   }
 
+  get [kLiteStreams]() {
+    return this.#liteStreams;
+  }
+
   [kAddStream](id, stream) {
-    stream.once('close', this[kMaybeDestroy].bind(this));
+    // A QuicLiteStream calls kMaybeDestroy itself when it is destroyed.
+    if (stream instanceof QuicStream)
+      stream.once('close', this[kMaybeDestroy].bind(this));
     this.#streams.set(id, stream);
   }
 
@@ -1683,6 +2077,48 @@ class QuicSession extends EventEmitter {
     return stream;
   }
 
+  // Returns the QuicStream with the given id. When the liteStreams option
+  // is used, this creates the QuicStream for a peer-initiated stream.
+  getStream(id) {
+    validateInteger(id, 'id', 0);
+    let stream = this.#streams.get(id);
+    if (stream instanceof QuicLiteStream) {
+      stream = stream[kGetStream]();
+      this[kAddStream](id, stream);
+    }
+    return stream;
+  }
+
+  // Writes the given data to the stream with the given id and ends it,
+  // without creating a QuicStream for it when liteStreams is used.
+  endStream(id, data) {
+    validateInteger(id, 'id', 0);
+    let buffers = [];
+    if (data !== undefined) {
+      buffers = Array.isArray(data) ? data : [data];
+      for (const buffer of buffers) {
+        if (!isArrayBufferView(buffer)) {
+          throw new ERR_INVALID_ARG_TYPE(
+            'data', ['Buffer', 'TypedArray', 'DataView', 'Array'], buffer);
+        }
+      }
+    }
+    const stream = this.#streams.get(id);
+    if (stream === undefined)
+      throw new ERR_INVALID_ARG_VALUE('id', id, 'is not an open stream');
+    if (stream instanceof QuicLiteStream) {
+      if (id & 0b10) {
+        throw new ERR_INVALID_ARG_VALUE(
+          'id', id, 'is not a writable stream');
+      }
+      stream[kEnd](buffers);
+      return;
+    }
+    for (const buffer of buffers)
+      stream.write(buffer);
+    stream.end();
+  }
+
   get duration() {
     const now = process.hrtime.bigint();
     const stats = this.#stats || this[kHandle].stats;
@@ -1732,6 +2168,36 @@ class QuicSession extends EventEmitter {
     return stats[14];
   }
 
+  get certificateBytesSent() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[21];
+  }
+
+  get certificateBytesReceived() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[22];
+  }
+
+  get memoryUsage() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[23];
+  }
+
+  get maxMemoryUsage() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[24];
+  }
+
+  get receiveWindow() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[25];
+  }
+
+  get asyncSigningCount() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[26];
+  }
+
   get minRTT() {
     const stats = this.#recoveryStats || this[kHandle].recoveryStats;
     return stats[0];
@@ -1766,9 +2232,8 @@ class QuicSession extends EventEmitter {
 }
 
 class QuicServerSession extends QuicSession {
-  #contexts = [];
   constructor(socket, handle) {
-    super(socket);
+    super(socket, undefined, undefined, socket[kLiteStreams]);
     this[kSetHandle](handle);
     handle[owner_symbol] = this;
   }
@@ -1787,16 +2252,7 @@ class QuicServerSession extends QuicSession {
   }
 
   [kCert](servername, callback) {
-    const { serverSecureContext } = this.socket;
-    let { context } = serverSecureContext;
-
-    for (var i = 0; i < this.#contexts.length; i++) {
-      const elem = this.#contexts[i];
-      if (elem[0].test(servername)) {
-        context = elem[1];
-        break;
-      }
-    }
+    const { context } = this.socket[kGetContext](servername);
 
     this.emit(
       'OCSPRequest',
@@ -1812,11 +2268,7 @@ class QuicServerSession extends QuicSession {
     if (context == null || typeof context !== 'object')
       throw new ERR_INVALID_ARG_TYPE('context', 'Object', context);
 
-    const re = new RegExp('^' +
-    servername.replace(/([.^$+?\-\\[\]{}])/g, '\\$1')
-              .replace(/\*/g, '[^.]*') +
-    '$');
-    this.#contexts.push([re, _createSecureContext(context)]);
+    this.socket[kAddContext](servername, context);
   }
 }
 
@@ -1886,7 +2338,8 @@ class QuicClientSession extends QuicSession {
       );
     }
 
-    super(socket, servername, alpn);
+    const transportParams = validateTransportParams(options);
+    super(socket, servername, alpn, !!transportParams.liteStreams);
     this.#dcid = dcid;
     this.#ipv6Only = ipv6Only;
     this.#minDHSize = minDHSize;
@@ -1899,7 +2352,7 @@ class QuicClientSession extends QuicSession {
         sc_options,
         initSecureContextClient);
     this.#sessionTicket = sessionTicket;
-    this.#transportParams = validateTransportParams(options);
+    this.#transportParams = transportParams;
     this.#verifyHostnameIdentity = verifyHostnameIdentity;
   }
 
@@ -1933,7 +2386,9 @@ class QuicClientSession extends QuicSession {
       (this.#verifyHostnameIdentity ?
         QUICCLIENTSESSION_OPTION_VERIFY_HOSTNAME_IDENTITY : 0) |
       (this.#requestOCSP ?
-        QUICCLIENTSESSION_OPTION_REQUEST_OCSP : 0);
+        QUICCLIENTSESSION_OPTION_REQUEST_OCSP : 0) |
+      (this.#transportParams.liteStreams ?
+        QUICCLIENTSESSION_OPTION_LITE_STREAMS : 0);
 
     const handle =
       _createClientSession(
@@ -2019,6 +2474,386 @@ function afterShutdown() {
   this.callback();
 }
 
+function onFileUnpipe() {
+  const handle = this.source;
+  if (handle.ownsFd)
+    handle.close().catch((err) => handle.stream.destroy(err));
+  else
+    handle.releaseFD();
+}
+
+// This is only called once the pipe has returned back control, so
+// it only has to handle errors and End-of-File.
+function onPipedFileHandleRead() {
+  const err = streamBaseState[kReadBytesOrError];
+  if (err < 0 && err !== UV_EOF)
+    this.stream.destroy(errnoException(err, 'read'));
+}
+
+function startFilePipe(stream, fd, offset, length, ownsFd) {
+  const handle = new FileHandle(fd, offset, length);
+  handle.onread = onPipedFileHandleRead;
+  handle.ownsFd = ownsFd;
+  handle.stream = stream;
+
+  const pipe = new StreamPipe(handle, stream[kHandle]);
+  pipe.onunpipe = onFileUnpipe;
+  pipe.start();
+
+  // Asks the pipe for the first chunk of data.
+  stream[kHandle].flush();
+}
+
+// The amount of data a QuicStream piped to a net.Socket reads first.
+const kProxyReadSize = 64 * 1024;
+
+// Used in place of onStreamRead while the QuicStream is piped to a
+// net.Socket. The pipe only passes on End-of-File and errors.
+function onProxyStreamRead() {
+  const nread = streamBaseState[kReadBytesOrError];
+  const stream = this[owner_symbol];
+  if (nread === UV_EOF) {
+    stream.push(null);
+    stream.read();
+  } else if (nread < 0) {
+    stream.destroy(errnoException(nread, 'read'));
+  }
+}
+
+function onProxyWriteComplete(status) {
+  if (status < 0)
+    this.stream.destroy(errnoException(status, 'write', this.error));
+}
+
+// Writes data that was buffered before the pipes were started directly to
+// the handle, ahead of anything the pipe writes.
+function writeProxyChunks(stream, handle, chunks) {
+  const req = new WriteWrap();
+  req.handle = handle;
+  req.oncomplete = onProxyWriteComplete;
+  req.stream = stream;
+  req.chunks = chunks;
+  const err = handle.writev(req, chunks, true);
+  if (err !== 0)
+    stream.destroy(errnoException(err, 'write', req.error));
+}
+
+function takeReadableBuffer(readable) {
+  const state = readable._readableState;
+  const chunks = [];
+  while (state.buffer.length > 0)
+    chunks.push(state.buffer.shift());
+  state.length = 0;
+  return chunks;
+}
+
+// Replaces net.Socket.prototype._final once the pipe has shut down the
+// writable side of the socket. See afterShutdown() in lib/net.js.
+function proxySocketFinal(callback) {
+  callback();
+  if (!this.readable || this._readableState.ended)
+    this.destroy();
+}
+
+function onProxyToSocketUnpipe() {
+  const socket = this.socket;
+  if (!socket.destroyed) {
+    socket._final = proxySocketFinal;
+    socket.end();
+  }
+}
+
+function startProxy(stream, socket) {
+  const handle = stream[kHandle];
+  const socketHandle = socket._handle;
+
+  // QuicStream to net.Socket.
+  const chunks = takeReadableBuffer(stream);
+  if (chunks.length > 0)
+    writeProxyChunks(stream, socketHandle, chunks);
+  if (stream._readableState.ended) {
+    socket.end();
+  } else {
+    stream.pause();
+    handle.onread = onProxyStreamRead;
+    const pipe = new StreamPipe(handle, socketHandle);
+    pipe.onunpipe = onProxyToSocketUnpipe;
+    pipe.socket = socket;
+    pipe.start(kProxyReadSize);
+  }
+
+  // net.Socket to QuicStream. A unidirectional stream opened by the peer
+  // cannot be written to, in which case the socket is simply not read.
+  socket.pause();
+  socketHandle.reading = false;
+  socketHandle.readStop();
+  if (!stream.writable)
+    return;
+  const socketChunks = takeReadableBuffer(socket);
+  if (socketChunks.length > 0)
+    writeProxyChunks(stream, handle, socketChunks);
+  if (socket._readableState.ended) {
+    stream.end();
+  } else {
+    // Close the writable side of the stream, but only as far as the
+    // writable stream implementation is concerned. The native side is
+    // shut down by the pipe once the socket has ended.
+    stream._final = null;
+    stream.end();
+    const pipe = new StreamPipe(socketHandle, handle);
+    pipe.start();
+    // Asks the pipe for the first chunk of data.
+    handle.flush();
+  }
+}
+
+// Used in place of onStreamRead once QuicStream.readChunks() has been
+// called.
+function onStreamReadChunks(arrayBuffer) {
+  this[kChunkReader][kReceive](streamBaseState[kReadBytesOrError], arrayBuffer);
+}
+
+function onChunksWriteComplete(status) {
+  if (status < 0)
+    this.reject(errnoException(status, 'write', this.error));
+  else
+    this.resolve();
+}
+
+// The QuicStreamChunkReader is the async iterator returned by
+// QuicStream.readChunks(). It collects the chunks received by the native
+// handle and hands them out in batches, bypassing the Readable side of
+// the QuicStream. Once more than highWaterMark bytes are waiting to be
+// collected, reading is paused so that no more flow control credit is
+// extended to the peer.
+class QuicStreamChunkReader {
+  #stream = undefined;
+  #handle = undefined;
+  #chunks = [];
+  #length = 0;
+  #paused = false;
+  #ended = false;
+  #error = undefined;
+  #pending = undefined;
+
+  constructor(stream, handle, chunks, ended) {
+    this.#stream = stream;
+    this.#handle = handle;
+    for (const chunk of chunks)
+      this.#push(chunk);
+    this.#ended = ended;
+  }
+
+  #push = (chunk) => {
+    this.#chunks.push(chunk);
+    this.#length += chunk.length;
+  };
+
+  #pause = () => {
+    if (this.#paused || this.#ended || this.#stream.destroyed)
+      return;
+    this.#paused = true;
+    this.#handle.readStop();
+  };
+
+  #resume = () => {
+    if (!this.#paused || this.#ended || this.#stream.destroyed)
+      return;
+    this.#paused = false;
+    this.#handle.readStart();
+  };
+
+  #take = () => {
+    const chunks = this.#chunks;
+    this.#chunks = [];
+    this.#length = 0;
+    this.#resume();
+    return { value: chunks, done: false };
+  };
+
+  #settle = () => {
+    const { resolve, reject } = this.#pending;
+    this.#pending = undefined;
+    if (this.#chunks.length > 0)
+      resolve(this.#take());
+    else if (this.#error !== undefined)
+      reject(this.#error);
+    else
+      resolve({ value: undefined, done: true });
+  };
+
+  [kReceive](nread, arrayBuffer) {
+    if (nread > 0) {
+      const offset = streamBaseState[kArrayBufferOffset];
+      this.#push(new FastBuffer(arrayBuffer, offset, nread));
+    } else if (nread === UV_EOF) {
+      this.#end();
+      // Keeps the Readable side of the QuicStream consistent.
+      this.#stream.push(null);
+      this.#stream.read(0);
+      return;
+    } else if (nread < 0) {
+      this.#stream.destroy(errnoException(nread, 'read'));
+      return;
+    } else {
+      return;
+    }
+
+    if (this.#pending !== undefined)
+      this.#settle();
+    else if (this.#length >= this.#stream.readableHighWaterMark)
+      this.#pause();
+  }
+
+  #end = (error) => {
+    if (this.#ended)
+      return;
+    this.#ended = true;
+    this.#error = error;
+    if (this.#pending !== undefined)
+      this.#settle();
+  };
+
+  [kDestroy](error) {
+    this.#end(error);
+  }
+
+  next() {
+    if (this.#chunks.length > 0)
+      return Promise.resolve(this.#take());
+    if (this.#ended) {
+      return this.#error !== undefined ?
+        Promise.reject(this.#error) :
+        Promise.resolve({ value: undefined, done: true });
+    }
+    if (this.#pending !== undefined)
+      return Promise.reject(new ERR_QUICSTREAM_READ_STARTED());
+    this.#resume();
+    return new Promise((resolve, reject) => {
+      this.#pending = { resolve, reject };
+    });
+  }
+
+  return() {
+    this.#stream.destroy();
+    return Promise.resolve({ value: undefined, done: true });
+  }
+
+  [Symbol.asyncIterator]() {
+    return this;
+  }
+}
+
+function onLiteStreamRead(arrayBuffer) {
+  const nread = streamBaseState[kReadBytesOrError];
+  this[owner_symbol][kReceive](nread, arrayBuffer);
+}
+
+function onLiteStreamWriteComplete(status) {
+  if (status < 0)
+    this.handle[owner_symbol].destroy();
+}
+
+function onLiteStreamShutdownComplete() {}
+
+// A QuicLiteStream stands in for the QuicStream of a peer-initiated stream
+// when the QuicSession uses the liteStreams option. Received data is
+// emitted from the QuicSession using the 'streamData' event without
+// creating a stream.Duplex for it. A full QuicStream is created only once
+// the application calls quicsession.getStream().
+class QuicLiteStream {
+  #session = undefined;
+  #handle = undefined;
+  #id = undefined;
+  #ended = false;
+  #destroyed = false;
+
+  constructor(session, id, handle) {
+    this.#session = session;
+    this.#id = id;
+    this.#handle = handle;
+    handle[owner_symbol] = this;
+    handle.onread = onLiteStreamRead;
+  }
+
+  get id() {
+    return this.#id;
+  }
+
+  [kReceive](nread, arrayBuffer) {
+    if (nread > 0) {
+      const offset = streamBaseState[kArrayBufferOffset];
+      const chunk = new FastBuffer(arrayBuffer, offset, nread);
+      this.#session.emit('streamData', this.#id, chunk, false);
+    } else if (nread === UV_EOF) {
+      this.#ended = true;
+      this.#session.emit('streamData', this.#id, Buffer.alloc(0), true);
+    } else if (nread < 0) {
+      this.destroy();
+    }
+  }
+
+  // Creates the QuicStream that replaces this QuicLiteStream. Data that has
+  // already been emitted using 'streamData' is not pushed into it again.
+  [kGetStream]() {
+    const handle = this.#handle;
+    const uni = this.#id & 0b10;
+    const stream =
+      new QuicStream({ writable: !uni }, this.#session, this.#id, handle);
+    if (uni)
+      stream.end();
+    if (this.#ended) {
+      stream.push(null);
+      stream.read();
+    }
+    this.#handle = undefined;
+    return stream;
+  }
+
+  [kEnd](buffers) {
+    const handle = this.#handle;
+    if (buffers.length > 0) {
+      const req = new WriteWrap();
+      req.handle = handle;
+      req.oncomplete = onLiteStreamWriteComplete;
+      req.chunks = buffers;
+      const err = handle.writev(req, buffers, true);
+      if (err !== 0) {
+        this.destroy();
+        return;
+      }
+    }
+    const req = new ShutdownWrap();
+    req.oncomplete = onLiteStreamShutdownComplete;
+    req.handle = handle;
+    handle.shutdown(req);
+  }
+
+  [kStreamReset]() {
+    this.#ended = true;
+  }
+
+  [kClose](family, code) {
+    if (this.#destroyed)
+      return;
+    this.#handle.shutdownStream(code, family);
+  }
+
+  destroy() {
+    if (this.#destroyed)
+      return;
+    this.#destroyed = true;
+    const session = this.#session;
+    session[kRemoveStream](this);
+    if (this.#handle !== undefined)
+      this.#handle.destroy();
+    this.#handle = undefined;
+    // Deferred like the 'close' event of a QuicStream, as this may be
+    // called from within the native callback that closed the stream.
+    process.nextTick(() => session[kMaybeDestroy]());
+  }
+}
+
 function streamOnResume() {
   if (!this.destroyed)
     this[kHandle].readStart();
@@ -2040,6 +2875,9 @@ class QuicStream extends Duplex {
   #dataRateHistogram = undefined;
   #dataSizeHistogram = undefined;
   #dataAckHistogram = undefined;
+  #stats = undefined;
+  #chunkReader = undefined;
+  #proxySocket = undefined;
 
   constructor(options, session, id, handle) {
     super({
@@ -2082,6 +2920,9 @@ class QuicStream extends Duplex {
   [kSetHandle](handle) {
     this[kHandle] = handle;
     if (handle !== undefined) {
+      // For liteStreams sessions, the stats and histograms of the handle
+      // are only created once a QuicStream is created for it.
+      handle.attachStats();
       this.#dataRateHistogram = new Histogram(handle.data_rx_rate);
       this.#dataSizeHistogram = new Histogram(handle.data_rx_size);
       this.#dataAckHistogram = new Histogram(handle.data_rx_ack);
@@ -2098,10 +2939,228 @@ class QuicStream extends Duplex {
   [kStreamReset](code, finalSize) {
     this.#resetCode = code | 0;
     this.#resetFinalSize = finalSize | 0;
+    if (this.#chunkReader !== undefined)
+      this.#chunkReader[kDestroy]();
     this.push(null);
     this.read();
   }
 
+  [kHeaders](headers, kind) {
+    let name;
+    switch (kind) {
+      case QUICSTREAM_HEADERS_KIND_INFORMATIONAL:
+        name = 'informationalHeaders';
+        break;
+      case QUICSTREAM_HEADERS_KIND_INITIAL:
+        name = 'initialHeaders';
+        break;
+      case QUICSTREAM_HEADERS_KIND_TRAILING:
+        name = 'trailingHeaders';
+        break;
+      default:
+        assert.fail('Invalid headers kind');
+    }
+    process.nextTick(emit.bind(this, name, toHeaderObject(headers)));
+  }
+
+  [kSubmitHeaders](kind, headers, validator) {
+    if (headers == null || typeof headers !== 'object')
+      throw new ERR_INVALID_ARG_TYPE('headers', 'Object', headers);
+    if (this.destroyed)
+      throw new ERR_QUICSTREAM_HEADERS_FAILED('The stream has been destroyed');
+    if (!this[kHandle].submitHeaders(kind, mapToHeaders(headers, validator))) {
+      throw new ERR_QUICSTREAM_HEADERS_FAILED(
+        'The session does not support headers or they could not be sent');
+    }
+  }
+
+  // The submit*Headers methods are only supported when the session is
+  // using HTTP/3. Trailing headers must be submitted before end() is
+  // called on the stream.
+  submitInformationalHeaders(headers) {
+    this[kSubmitHeaders](
+      QUICSTREAM_HEADERS_KIND_INFORMATIONAL,
+      headers,
+      assertValidPseudoHeaderResponse);
+  }
+
+  submitInitialHeaders(headers) {
+    this[kSubmitHeaders](QUICSTREAM_HEADERS_KIND_INITIAL, headers);
+  }
+
+  submitTrailingHeaders(headers) {
+    this[kSubmitHeaders](
+      QUICSTREAM_HEADERS_KIND_TRAILING,
+      headers,
+      assertValidPseudoHeaderTrailer);
+  }
+
+  // Returns an async iterator that yields arrays of the chunks received
+  // since the previous iteration, as an alternative to consuming the
+  // Readable side of the QuicStream. It cannot be used once data has
+  // been read from the Readable side.
+  readChunks() {
+    if (this.#didRead ||
+        this.#chunkReader !== undefined ||
+        this.#proxySocket !== undefined) {
+      throw new ERR_QUICSTREAM_READ_STARTED();
+    }
+
+    // Data received before readChunks() was called has already been
+    // pushed into the Readable side, so it is moved over.
+    const state = this._readableState;
+    const chunks = [];
+    while (state.buffer.length > 0)
+      chunks.push(state.buffer.shift());
+    state.length = 0;
+
+    const handle = this[kHandle];
+    this.#chunkReader =
+      new QuicStreamChunkReader(this, handle, chunks, state.ended);
+    if (handle !== undefined) {
+      handle[kChunkReader] = this.#chunkReader;
+      handle.onread = onStreamReadChunks;
+    }
+    if (this.destroyed)
+      this.#chunkReader[kDestroy]();
+    else if (state.ended)
+      this.read(0);
+    return this.#chunkReader;
+  }
+
+  // Queues the given buffers to be sent without passing them through the
+  // Writable side of the QuicStream. The returned Promise is resolved once
+  // the peer has acknowledged the data. It must not be combined with
+  // write(); call end() once all of the data has been queued.
+  writeChunks(buffers) {
+    if (!Array.isArray(buffers))
+      buffers = [buffers];
+    for (const buffer of buffers) {
+      if (!isArrayBufferView(buffer)) {
+        throw new ERR_INVALID_ARG_TYPE(
+          'buffers', ['Buffer', 'TypedArray', 'DataView', 'Array'], buffer);
+      }
+    }
+    if (this.destroyed)
+      return Promise.reject(new ERR_STREAM_DESTROYED('writeChunks'));
+    if (this._writableState.ending)
+      return Promise.reject(new ERR_STREAM_WRITE_AFTER_END());
+
+    this[kUpdateTimer]();
+    return new Promise((resolve, reject) => {
+      const req = new WriteWrap();
+      req.handle = this[kHandle];
+      req.oncomplete = onChunksWriteComplete;
+      req.resolve = resolve;
+      req.reject = reject;
+      req.chunks = buffers;
+      const err = req.handle.writev(req, buffers, true);
+      if (err !== 0)
+        reject(errnoException(err, 'write', req.error));
+      else if (!streamBaseState[kLastWriteWasAsync])
+        resolve();
+    });
+  }
+
+  [kSendFD](fd, offset, length, ownsFd) {
+    if (this.destroyed || this.#closed) {
+      if (ownsFd)
+        fs.close(fd, () => {});
+      return;
+    }
+
+    this[kUpdateTimer]();
+
+    // Close the writable side of the stream, but only as far as the
+    // writable stream implementation is concerned. The native side is
+    // shut down by the pipe once the end of the file has been reached.
+    this._final = null;
+    this.end();
+
+    defaultTriggerAsyncIdScope(this[async_id_symbol], startFilePipe,
+                               this, fd, offset, length, ownsFd);
+  }
+
+  // Sends length bytes of the file referenced by fd, starting at offset,
+  // then ends the stream. The file is read on the threadpool directly
+  // into the outbound queue of the QuicStream, without passing through
+  // JavaScript. An offset of -1 reads from the current file position and
+  // a length of -1 reads until the end of the file.
+  sendFD(fd, options = {}) {
+    if (options === null || typeof options !== 'object')
+      throw new ERR_INVALID_ARG_TYPE('options', 'Object', options);
+    const { offset = 0, length = -1 } = options;
+    validateInteger(fd, 'fd', 0);
+    validateInteger(offset, 'options.offset', -1);
+    validateInteger(length, 'options.length', -1);
+    this[kSendFD](fd, offset, length, false);
+  }
+
+  // Like sendFD(), except that the file is opened, and closed once it
+  // has been sent, by the QuicStream.
+  sendFile(path, options = {}) {
+    if (options === null || typeof options !== 'object')
+      throw new ERR_INVALID_ARG_TYPE('options', 'Object', options);
+    const { offset = 0, length = -1 } = options;
+    validateInteger(offset, 'options.offset', -1);
+    validateInteger(length, 'options.length', -1);
+    fs.open(path, 'r', (err, fd) => {
+      if (err) {
+        this.destroy(err);
+        return;
+      }
+      this[kSendFD](fd, offset, length, true);
+    });
+  }
+
+  [kProxy](socket) {
+    if (this.destroyed)
+      return;
+    if (socket.destroyed) {
+      this.destroy();
+      return;
+    }
+    this[kUpdateTimer]();
+    defaultTriggerAsyncIdScope(this[async_id_symbol], startProxy, this, socket);
+  }
+
+  // Pipes the data received on the QuicStream to the given net.Socket, and
+  // the data received on the socket to the QuicStream, without passing it
+  // through JavaScript. Reading from each side is paused while the other
+  // side cannot accept more data, so QUIC flow control applies to the
+  // socket and TCP flow control applies to the QuicStream. When either
+  // side is destroyed before both directions have ended, so is the other.
+  proxy(socket) {
+    if (!(socket instanceof net.Socket))
+      throw new ERR_INVALID_ARG_TYPE('socket', 'net.Socket', socket);
+    const socketHandle = socket._handle;
+    if (!(socketHandle instanceof TCP) && !(socketHandle instanceof Pipe)) {
+      throw new ERR_INVALID_ARG_VALUE(
+        'socket', socket, 'must be a connected TCP or pipe socket');
+    }
+    if (this.#didRead ||
+        this.#chunkReader !== undefined ||
+        this.#proxySocket !== undefined) {
+      throw new ERR_QUICSTREAM_READ_STARTED();
+    }
+    if (this.destroyed)
+      throw new ERR_STREAM_DESTROYED('proxy');
+
+    this.#proxySocket = socket;
+    // Both directions are ended independently.
+    socket.allowHalfOpen = true;
+    socket.on('error', (err) => this.destroy(err));
+    socket.once('close', () => {
+      if (!this._readableState.ended || !socket._readableState.ended)
+        this.destroy();
+    });
+
+    if (socket.connecting)
+      socket.once('connect', () => this[kProxy](socket));
+    else
+      this[kProxy](socket);
+  }
+
   [kClose](family, code) {
     // Trigger the abrupt shutdown of the stream. If the stream is
     // already no-longer readable or writable, this does nothing. If
@@ -2271,13 +3330,29 @@ class QuicStream extends Duplex {
   }
 
   _destroy(error, callback) {
+    if (this.#chunkReader !== undefined)
+      this.#chunkReader[kDestroy](error || undefined);
+    // The socket is left to finish on its own only if both directions
+    // ended normally.
+    const socket = this.#proxySocket;
+    if (socket !== undefined &&
+        (error ||
+         this.#aborted ||
+         this.#resetCode !== undefined ||
+         !this._readableState.ended ||
+         !socket._readableState.ended)) {
+      socket.destroy();
+    }
     this.#session[kRemoveStream](this);
     const handle = this[kHandle];
     // Do not use handle after this point as the underlying C++
     // object has been destroyed. Any attempt to use the object
     // will segfault and crash the process.
-    if (handle !== undefined)
+    if (handle !== undefined) {
+      // Copy the stats for use after destruction
+      this.#stats = new BigInt64Array(handle.stats);
       handle.destroy();
+    }
     callback(error);
   }
 
@@ -2300,6 +3375,11 @@ class QuicStream extends Duplex {
   get dataAckHistogram() {
     return this.#dataAckHistogram;
   }
+
+  get receiveWindow() {
+    const stats = this.#stats || this[kHandle].stats;
+    return stats[7];
+  }
 }
 
 function createSocket(options = {}) {
@@ -2309,7 +3389,8 @@ function createSocket(options = {}) {
 }
 
 module.exports = {
-  createSocket
+  createSocket,
+  QuicSocket,
 };
 
 /* eslint-enable no-use-before-define */
@@ -10,6 +10,7 @@ const {
 } = require('internal/errors');
 
 const { Buffer } = require('buffer');
+const path = require('path');
 const { isArrayBufferView } = require('internal/util/types');
 const {
   isLegalPort,
@@ -25,12 +26,14 @@ const {
     MAX_RETRYTOKEN_EXPIRATION,
     MIN_RETRYTOKEN_EXPIRATION,
     MINIMUM_MAX_CRYPTO_BUFFER,
+    MIN_MAX_SESSION_MEMORY,
     NGTCP2_NO_ERROR,
     NGTCP2_MAX_CIDLEN,
     NGTCP2_MIN_CIDLEN,
     QUIC_PREFERRED_ADDRESS_IGNORE,
     QUIC_PREFERRED_ADDRESS_ACCEPT,
     QUIC_ERROR_APPLICATION,
+    RESET_SECRETLEN,
   }
 } = internalBinding('quic');
 
@@ -120,9 +123,121 @@ function validateNumberInBoundedRange(val, name, min, max) {
     throw new ERR_OUT_OF_RANGE(name, `${min} <= ${name} <= ${max}`, val);
 }
 
+function validateProbability(val, name) {
+  if (typeof val !== 'number')
+    throw new ERR_INVALID_ARG_TYPE(name, 'number', val);
+  if (!(val >= 0.0 && val <= 1.0))
+    throw new ERR_OUT_OF_RANGE(name, '0.0 <= n <= 1.0', val);
+}
+
+function validateLinkProfile(profile, name) {
+  if (profile !== undefined &&
+      (profile === null || typeof profile !== 'object')) {
+    throw new ERR_INVALID_ARG_TYPE(name, 'Object', profile);
+  }
+  const {
+    delay = 0,
+    jitter = 0,
+    rate = 0,
+    queueLimit = 0,
+    reorder = 0.0,
+    duplicate = 0.0,
+    loss = 0.0,
+    burstLoss = 1.0,
+    burstEnter = 0.0,
+    burstExit = 1.0,
+  } = { ...profile };
+  validateNumberInRange(delay, `${name}.delay`, '>=0');
+  validateNumberInRange(jitter, `${name}.jitter`, '>=0');
+  validateNumberInRange(rate, `${name}.rate`, '>=0');
+  validateNumberInRange(queueLimit, `${name}.queueLimit`, '>=0');
+  validateProbability(reorder, `${name}.reorder`);
+  validateProbability(duplicate, `${name}.duplicate`);
+  validateProbability(loss, `${name}.loss`);
+  validateProbability(burstLoss, `${name}.burstLoss`);
+  validateProbability(burstEnter, `${name}.burstEnter`);
+  validateProbability(burstExit, `${name}.burstExit`);
+  return {
+    delay,
+    jitter,
+    rate,
+    queueLimit,
+    reorder,
+    duplicate,
+    loss,
+    burstLoss,
+    burstEnter,
+    burstExit,
+  };
+}
+
+function validateNetworkEmulationOptions(options) {
+  const {
+    seed = 0,
+    rx,
+    tx,
+  } = { ...options };
+  validateNumberInBoundedRange(seed, 'options.seed', 0, 2 ** 32 - 1);
+  return {
+    seed,
+    rx: validateLinkProfile(rx, 'options.rx'),
+    tx: validateLinkProfile(tx, 'options.tx'),
+  };
+}
+
+function validateAdmissionControlOptions(options) {
+  const {
+    maxEventLoopDelay = 0,
+    maxSessions = 0,
+    resolution = 10,
+    retry = false,
+  } = { ...options };
+  validateNumberInRange(
+    maxEventLoopDelay,
+    'options.maxEventLoopDelay',
+    '>=0');
+  validateNumberInRange(
+    maxSessions,
+    'options.maxSessions',
+    '>=0');
+  validateNumberInBoundedRange(
+    resolution,
+    'options.resolution',
+    1, 2 ** 32 - 1);
+  if (typeof retry !== 'boolean')
+    throw new ERR_INVALID_ARG_TYPE('options.retry', 'boolean', retry);
+  return {
+    maxEventLoopDelay,
+    maxSessions,
+    resolution,
+    retry,
+  };
+}
+
+function validateDrainOptions(options) {
+  const {
+    batchSize = 0,
+    window = 1000,
+  } = { ...options };
+  validateNumberInRange(
+    batchSize,
+    'options.batchSize',
+    '>=0');
+  validateNumberInRange(
+    window,
+    'options.window',
+    '>=0');
+  return {
+    batchSize,
+    window,
+  };
+}
+
 function validateTransportParams(params) {
   const {
     activeConnectionIdLimit,
+    asyncSigning,
+    liteStreams,
     maxStreamDataBidiLocal,
     maxStreamDataBidiRemote,
     maxStreamDataUni,
@@ -133,6 +248,9 @@ function validateTransportParams(params) {
     maxPacketSize,
     maxAckDelay,
     maxCryptoBuffer,
+    maxMemory,
+    maxStreamWindow,
+    maxConnectionWindow,
     preferredAddress,
     rejectUnauthorized,
     requestCert,
@@ -183,8 +301,35 @@ function validateTransportParams(params) {
     'options.maxCryptoBuffer',
     MINIMUM_MAX_CRYPTO_BUFFER,
     Number.MAX_SAFE_INTEGER);
+  validateNumberInBoundedRange(
+    maxMemory,
+    'options.maxMemory',
+    MIN_MAX_SESSION_MEMORY,
+    Number.MAX_SAFE_INTEGER);
+  validateNumberInRange(
+    maxStreamWindow,
+    'options.maxStreamWindow',
+    '>=0');
+  validateNumberInRange(
+    maxConnectionWindow,
+    'options.maxConnectionWindow',
+    '>=0');
+  if (asyncSigning !== undefined && typeof asyncSigning !== 'boolean') {
+    throw new ERR_INVALID_ARG_TYPE(
+      'options.asyncSigning',
+      'boolean',
+      asyncSigning);
+  }
+  if (liteStreams !== undefined && typeof liteStreams !== 'boolean') {
+    throw new ERR_INVALID_ARG_TYPE(
+      'options.liteStreams',
+      'boolean',
+      liteStreams);
+  }
   return {
     activeConnectionIdLimit,
+    asyncSigning,
+    liteStreams,
     maxStreamDataBidiLocal,
     maxStreamDataBidiRemote,
     maxStreamDataUni,
@@ -195,6 +340,9 @@ function validateTransportParams(params) {
     maxPacketSize,
     maxAckDelay,
     maxCryptoBuffer,
+    maxMemory,
+    maxStreamWindow,
+    maxConnectionWindow,
     preferredAddress,
     rejectUnauthorized,
     requestCert,
@@ -321,12 +469,19 @@ function validateQuicSocketOptions(options) {
     address,
     autoClose = false,
     client,
+    disableStatelessReset = false,
     ipv6Only = false,
     lookup,
+    loopback = false,
     maxConnectionsPerHost = DEFAULT_MAX_CONNECTIONS_PER_HOST,
+    maxInitialBurst = 0,
+    maxInitialRate = 0,
+    maxMemory,
     port = 0,
+    qlog,
     reuseAddr = false,
     server,
+    statelessResetSecret,
     type = 'udp4',
     validateAddress = false,
     validateAddressLRU = false,
@@ -359,6 +514,34 @@ function validateQuicSocketOptions(options) {
       'boolean',
       autoClose);
   }
+  if (typeof loopback !== 'boolean') {
+    throw new ERR_INVALID_ARG_TYPE(
+      'options.loopback',
+      'boolean',
+      loopback);
+  }
+  if (typeof disableStatelessReset !== 'boolean') {
+    throw new ERR_INVALID_ARG_TYPE(
+      'options.disableStatelessReset',
+      'boolean',
+      disableStatelessReset);
+  }
+  if (statelessResetSecret !== undefined) {
+    if (!isArrayBufferView(statelessResetSecret)) {
+      throw new ERR_INVALID_ARG_TYPE(
+        'options.statelessResetSecret',
+        ['Buffer', 'TypedArray', 'DataView'],
+        statelessResetSecret);
+    }
+    if (statelessResetSecret.byteLength !== RESET_SECRETLEN) {
+      throw new ERR_INVALID_ARG_VALUE(
+        'options.statelessResetSecret',
+        statelessResetSecret,
+        `must be exactly ${RESET_SECRETLEN} bytes long`);
+    }
+  }
+  if (qlog !== undefined && typeof qlog !== 'string')
+    throw new ERR_INVALID_ARG_TYPE('options.qlog', 'string', qlog);
   validateNumberInBoundedRange(
     retryTokenTimeout,
     'options.retryTokenTimeout',
@@ -368,17 +551,36 @@ function validateQuicSocketOptions(options) {
     maxConnectionsPerHost,
     'options.maxConnectionsPerHost',
     1, Number.MAX_SAFE_INTEGER);
+  validateNumberInRange(
+    maxInitialRate,
+    'options.maxInitialRate',
+    '>= 0');
+  validateNumberInRange(
+    maxInitialBurst,
+    'options.maxInitialBurst',
+    '>= 0');
+  validateNumberInBoundedRange(
+    maxMemory,
+    'options.maxMemory',
+    1, Number.MAX_SAFE_INTEGER);
   return {
     address,
     autoClose,
     client,
+    disableStatelessReset,
     ipv6Only,
     lookup,
+    loopback,
     maxConnectionsPerHost,
+    maxInitialBurst,
+    maxInitialRate,
+    maxMemory,
     port,
+    qlog: qlog !== undefined ? path.resolve(qlog) : undefined,
     retryTokenTimeout,
     reuseAddr,
     server,
+    statelessResetSecret,
     type: getSocketType(type),
     validateAddress: validateAddress || validateAddressLRU,
     validateAddressLRU,
@@ -391,8 +593,11 @@ module.exports = {
   getSocketType,
   lookup4,
   lookup6,
+  validateAdmissionControlOptions,
   validateBindOptions,
   validateCloseCode,
+  validateDrainOptions,
+  validateNetworkEmulationOptions,
   validateNumberInRange,
   validateTransportParams,
   validateQuicClientSessionOptions,
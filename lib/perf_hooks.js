@@ -26,6 +26,7 @@ const {
   NODE_PERFORMANCE_ENTRY_TYPE_FUNCTION,
   NODE_PERFORMANCE_ENTRY_TYPE_HTTP2,
   NODE_PERFORMANCE_ENTRY_TYPE_HTTP,
+  NODE_PERFORMANCE_ENTRY_TYPE_QUIC,
 
   NODE_PERFORMANCE_MILESTONE_NODE_START,
   NODE_PERFORMANCE_MILESTONE_V8_START,
@@ -72,7 +73,8 @@ const observerableTypes = [
   'gc',
   'function',
   'http2',
-  'http'
+  'http',
+  'quic'
 ];
 
 const IDX_STREAM_STATS_ID = 0;
@@ -139,6 +141,45 @@ function collectHttp2Stats(entry) {
   }
 }
 
+const IDX_QUIC_SESSION_PERF_TYPE = 0;
+const IDX_QUIC_SESSION_PERF_HANDSHAKE_DURATION = 1;
+const IDX_QUIC_SESSION_PERF_SMOOTHED_RTT = 2;
+const IDX_QUIC_SESSION_PERF_MIN_RTT = 3;
+const IDX_QUIC_SESSION_PERF_BYTES_SENT = 4;
+const IDX_QUIC_SESSION_PERF_BYTES_RECEIVED = 5;
+const IDX_QUIC_SESSION_PERF_STREAMS_IN = 6;
+const IDX_QUIC_SESSION_PERF_STREAMS_OUT = 7;
+const IDX_QUIC_SESSION_PERF_KEYUPDATES = 8;
+const IDX_QUIC_SESSION_PERF_LOSS_RETRANSMITS = 9;
+
+let quicSessionStats;
+
+function collectQuicStats(entry) {
+  if (quicSessionStats === undefined)
+    quicSessionStats = internalBinding('quic').sessionPerformanceStats;
+  // The type is the ngtcp2_crypto_side of the session, where 1 is server
+  entry.type =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_TYPE] === 1 ? 'server' : 'client';
+  entry.handshakeDuration =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_HANDSHAKE_DURATION];
+  entry.smoothedRTT =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_SMOOTHED_RTT];
+  entry.minRTT =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_MIN_RTT];
+  entry.bytesSent =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_BYTES_SENT];
+  entry.bytesReceived =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_BYTES_RECEIVED];
+  entry.streamsIn =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_STREAMS_IN];
+  entry.streamsOut =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_STREAMS_OUT];
+  entry.keyUpdates =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_KEYUPDATES];
+  entry.lossRetransmits =
+    quicSessionStats[IDX_QUIC_SESSION_PERF_LOSS_RETRANSMITS];
+}
+
 function now() {
   const hr = process.hrtime();
   return hr[0] * 1000 + hr[1] / 1e6;
@@ -470,6 +511,8 @@ function observersCallback(entry) {
 
   if (type === NODE_PERFORMANCE_ENTRY_TYPE_HTTP2)
     collectHttp2Stats(entry);
+  else if (type === NODE_PERFORMANCE_ENTRY_TYPE_QUIC)
+    collectQuicStats(entry);
 
   const list = getObserversList(type);
 
@@ -511,6 +554,7 @@ function mapTypes(i) {
     case 'function': return NODE_PERFORMANCE_ENTRY_TYPE_FUNCTION;
     case 'http2': return NODE_PERFORMANCE_ENTRY_TYPE_HTTP2;
     case 'http': return NODE_PERFORMANCE_ENTRY_TYPE_HTTP;
+    case 'quic': return NODE_PERFORMANCE_ENTRY_TYPE_QUIC;
   }
 }
 
@@ -3,8 +3,18 @@
 const {
   createSocket
 } = require('internal/quic/core');
+const { QuicAgent } = require('internal/quic/agent');
+const {
+  Http3ServerRequest,
+  Http3ServerResponse,
+} = require('internal/quic/compat');
 
-module.exports = { createSocket };
+module.exports = {
+  Agent: QuicAgent,
+  createSocket,
+  Http3ServerRequest,
+  Http3ServerResponse,
+};
 
 process.emitWarning(
   'QUIC protocol support is experimental and not yet ' +
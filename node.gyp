@@ -174,6 +174,8 @@
       'lib/internal/process/task_queues.js',
       'lib/internal/querystring.js',
       'lib/internal/readline/utils.js',
+      'lib/internal/quic/agent.js',
+      'lib/internal/quic/compat.js',
       'lib/internal/quic/core.js',
       'lib/internal/quic/util.js',
       'lib/internal/repl.js',
@@ -829,6 +831,8 @@
           'sources': [
             'src/node_quic_buffer.h',
             'src/node_quic_crypto.h',
+            'src/node_quic_http3_application.h',
+            'src/node_quic_qlog.h',
             'src/node_quic_session.h',
             'src/node_quic_session-inl.h',
             'src/node_quic_socket.h',
@@ -836,6 +840,8 @@
             'src/node_quic_util.h',
             'src/node_quic_state.h',
             'src/node_quic_crypto.cc',
+            'src/node_quic_http3_application.cc',
+            'src/node_quic_qlog.cc',
             'src/node_quic_session.cc',
             'src/node_quic_socket.cc',
             'src/node_quic_stream.cc',
@@ -1147,7 +1153,14 @@
             'NODE_EXPERIMENTAL_QUIC=1',
           ],
           'sources': [
+            'test/cctest/test_quic_admission_control.cc',
             'test/cctest/test_quic_buffer.cc',
+            'test/cctest/test_quic_debug.cc',
+            'test/cctest/test_quic_network_emulator.cc',
+            'test/cctest/test_quic_qlog.cc',
+            'test/cctest/test_quic_random_pool.cc',
+            'test/cctest/test_quic_receive_window.cc',
+            'test/cctest/test_quic_source_prefix.cc',
             'test/cctest/test-quic-verifyhostnameidentity.cc'
           ]
         }],
@@ -440,6 +440,7 @@ constexpr size_t kFsStatsBufferLength =
   V(quic_on_session_version_negotiation_function, v8::Function)                \
   V(quic_on_stream_close_function, v8::Function)                               \
   V(quic_on_stream_error_function, v8::Function)                               \
+  V(quic_on_stream_headers_function, v8::Function)                             \
   V(quic_on_stream_ready_function, v8::Function)                               \
   V(quic_on_stream_reset_function, v8::Function)
 #else
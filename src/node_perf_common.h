@@ -36,7 +36,8 @@ extern uint64_t performance_v8_start;
   V(GC, "gc")                                                                 \
   V(FUNCTION, "function")                                                     \
   V(HTTP2, "http2")                                                           \
-  V(HTTP, "http")
+  V(HTTP, "http")                                                             \
+  V(QUIC, "quic")
 
 enum PerformanceMilestone {
 #define V(name, _) NODE_PERFORMANCE_MILESTONE_##name,
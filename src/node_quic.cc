@@ -63,6 +63,7 @@ void QuicSetCallbacks(const FunctionCallbackInfo<Value>& args) {
   SETFUNCTION("onStreamReady", stream_ready);
   SETFUNCTION("onStreamClose", stream_close);
   SETFUNCTION("onStreamError", stream_error);
+  SETFUNCTION("onStreamHeaders", stream_headers);
   SETFUNCTION("onStreamReset", stream_reset);
   SETFUNCTION("onSocketServerBusy", socket_server_busy);
 
@@ -183,6 +184,11 @@ void Initialize(Local<Object> target,
               (field)).FromJust()
   SET_STATE_TYPEDARRAY(
     "sessionConfig", state->quicsessionconfig_buffer.GetJSArray());
+  SET_STATE_TYPEDARRAY(
+    "linkProfile", state->quiclinkprofile_buffer.GetJSArray());
+  SET_STATE_TYPEDARRAY(
+    "sessionPerformanceStats",
+    state->quicsessionperformance_buffer.GetJSArray());
 #undef SET_STATE_TYPEDARRAY
 
   env->set_quic_state(std::move(state));
@@ -231,6 +237,10 @@ void Initialize(Local<Object> target,
   NODE_DEFINE_CONSTANT(constants, QUIC_ERROR_SESSION);
   NODE_DEFINE_CONSTANT(constants, QUIC_PREFERRED_ADDRESS_ACCEPT);
   NODE_DEFINE_CONSTANT(constants, QUIC_PREFERRED_ADDRESS_IGNORE);
+  NODE_DEFINE_CONSTANT(constants, RESET_SECRETLEN);
+  NODE_DEFINE_CONSTANT(constants, QUICSTREAM_HEADERS_KIND_INFORMATIONAL);
+  NODE_DEFINE_CONSTANT(constants, QUICSTREAM_HEADERS_KIND_INITIAL);
+  NODE_DEFINE_CONSTANT(constants, QUICSTREAM_HEADERS_KIND_TRAILING);
   NODE_DEFINE_CONSTANT(constants, NGTCP2_DEFAULT_MAX_ACK_DELAY);
   NODE_DEFINE_CONSTANT(constants, NGTCP2_PATH_VALIDATION_RESULT_FAILURE);
   NODE_DEFINE_CONSTANT(constants, NGTCP2_PATH_VALIDATION_RESULT_SUCCESS);
@@ -257,16 +267,40 @@ void Initialize(Local<Object> target,
   NODE_DEFINE_CONSTANT(constants, IDX_QUIC_SESSION_DISABLE_MIGRATION);
   NODE_DEFINE_CONSTANT(constants, IDX_QUIC_SESSION_MAX_ACK_DELAY);
   NODE_DEFINE_CONSTANT(constants, IDX_QUIC_SESSION_MAX_CRYPTO_BUFFER);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_SESSION_MAX_MEMORY);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_SESSION_MAX_STREAM_WINDOW);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_SESSION_MAX_CONNECTION_WINDOW);
   NODE_DEFINE_CONSTANT(constants, IDX_QUIC_SESSION_CONFIG_COUNT);
 
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_DELAY);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_JITTER);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_RATE);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_QUEUE_LIMIT);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_REORDER);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_DUPLICATE);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_LOSS);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_BURST_LOSS);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_BURST_ENTER);
+  NODE_DEFINE_CONSTANT(constants, IDX_QUIC_LINK_BURST_EXIT);
+
   NODE_DEFINE_CONSTANT(constants, MIN_MAX_CRYPTO_BUFFER);
+  NODE_DEFINE_CONSTANT(constants, MIN_MAX_SESSION_MEMORY);
 
+  NODE_DEFINE_CONSTANT(
+      constants,
+      QUICSERVERSESSION_OPTION_ASYNC_SIGNING);
+  NODE_DEFINE_CONSTANT(
+      constants,
+      QUICSERVERSESSION_OPTION_LITE_STREAMS);
   NODE_DEFINE_CONSTANT(
       constants,
       QUICSERVERSESSION_OPTION_REJECT_UNAUTHORIZED);
   NODE_DEFINE_CONSTANT(
       constants,
       QUICSERVERSESSION_OPTION_REQUEST_CERT);
+  NODE_DEFINE_CONSTANT(
+      constants,
+      QUICCLIENTSESSION_OPTION_LITE_STREAMS);
   NODE_DEFINE_CONSTANT(
       constants,
       QUICCLIENTSESSION_OPTION_REQUEST_OCSP);
@@ -279,6 +313,12 @@ void Initialize(Local<Object> target,
   NODE_DEFINE_CONSTANT(
       constants,
       QUICSOCKET_OPTIONS_VALIDATE_ADDRESS_LRU);
+  NODE_DEFINE_CONSTANT(
+      constants,
+      QUICSOCKET_OPTIONS_LOOPBACK);
+  NODE_DEFINE_CONSTANT(
+      constants,
+      QUICSOCKET_OPTIONS_DISABLE_STATELESS_RESET);
 
   target->Set(context,
               env->constants_string(),
@@ -263,8 +263,9 @@ class QuicBuffer : public MemoryRetainer {
 
   // Consume the given number of bytes within the buffer. If amount is
   // negative, all buffered bytes that are available to be consumed are
-  // consumed.
-  inline void Consume(ssize_t amount = -1) { Consume(0, amount); }
+  // consumed. Returns the number of bytes consumed, which does not
+  // include any bytes pushed or canceled by the Done callbacks.
+  inline size_t Consume(ssize_t amount = -1) { return Consume(0, amount); }
 
   // Cancels the remaining bytes within the buffer
   inline size_t Cancel(int status = UV_ECANCELED) {
@@ -435,8 +436,9 @@ class QuicBuffer : public MemoryRetainer {
     return true;
   }
 
-  inline void Consume(int status, ssize_t amount) {
+  inline size_t Consume(int status, ssize_t amount) {
     size_t amt = std::min(amount < 0 ? length_ : amount, length_);
+    size_t consumed = 0;
     while (root_ && amt > 0) {
       auto root = root_.get();
       // Never allow for partial consumption of head when using a
@@ -446,13 +448,16 @@ class QuicBuffer : public MemoryRetainer {
       size_t len = root->buf.len - root->offset;
       if (len > amt) {
         length_ -= amt;
+        consumed += amt;
         root->offset += amt;
         break;
       }
       length_ -= len;
+      consumed += len;
       amt -= len;
       Pop(status);
     }
+    return consumed;
   }
 
   std::unique_ptr<quic_buffer_chunk> root_;
@@ -5,6 +5,7 @@
 #include "node_quic_util.h"
 #include "node_url.h"
 #include "string_bytes.h"
+#include "threadpoolwork-inl.h"
 #include "v8.h"
 
 #include <ngtcp2/ngtcp2.h>
@@ -12,9 +13,13 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/kdf.h>
+#include <openssl/ocsp.h>
 #include <openssl/ssl.h>
 #include <openssl/x509v3.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iterator>
 #include <numeric>
 #include <unordered_map>
@@ -27,6 +32,7 @@ using v8::Array;
 using v8::Local;
 using v8::Object;
 using v8::String;
+using v8::Undefined;
 using v8::Value;
 
 namespace quic {
@@ -708,6 +714,53 @@ bool MessageDigest(
   return EVP_DigestFinal_ex(ctx.get(), dest->data(), &mdlen) == 1;
 }
 
+namespace {
+// Incremented in the child process after a fork so that the child
+// never hands out bytes that were buffered by the parent.
+std::atomic<uint32_t> random_pool_generation{0};
+
+thread_local RandomPool random_pool;
+}  // namespace
+
+RandomPool::RandomPool(Source source) : source_(source) {
+#ifdef __POSIX__
+  static const int registered = pthread_atfork(nullptr, nullptr, []() {
+    random_pool_generation++;
+  });
+  USE(registered);
+#endif
+}
+
+RandomPool::~RandomPool() {
+  OPENSSL_cleanse(pool_.data(), pool_.size());
+}
+
+void RandomPool::Fill(uint8_t* buffer, size_t length, uint64_t now) {
+  if (length > kRandomPoolSize / 4) {
+    CHECK(source_(buffer, length));
+    return;
+  }
+
+  const uint32_t generation = random_pool_generation.load();
+  if (remaining_ < length ||
+      generation != generation_ ||
+      now - refilled_at_ > kRandomPoolMaxAge) {
+    CHECK(source_(pool_.data(), pool_.size()));
+    remaining_ = pool_.size();
+    refilled_at_ = now;
+    generation_ = generation;
+  }
+
+  uint8_t* data = pool_.data() + (pool_.size() - remaining_);
+  memcpy(buffer, data, length);
+  OPENSSL_cleanse(data, length);
+  remaining_ -= length;
+}
+
+void PooledRandomBytes(uint8_t* buffer, size_t length) {
+  random_pool.Fill(buffer, length, uv_hrtime());
+}
+
 bool GenerateRandData(uint8_t* buf, size_t len) {
   std::array<uint8_t, 16> rand;
   std::array<uint8_t, 32> md;
@@ -820,8 +873,9 @@ void InstallTXKeys(
 }
 
 // MessageCB provides a hook into the TLS handshake dataflow. Currently, it
-// is used to capture TLS alert codes (errors) and to collect the TLS handshake
-// data that is to be sent.
+// is used to capture TLS alert codes (errors), to collect the TLS handshake
+// data that is to be sent, and to account for the size of the certificate
+// messages that are sent and received.
 void MessageCB(
     int write_p,
     int version,
@@ -830,14 +884,20 @@ void MessageCB(
     size_t len,
     SSL* ssl,
     void* arg) {
-  if (!write_p)
-    return;
-
   QuicSession* session = static_cast<QuicSession*>(arg);
 
+  if (!write_p) {
+    if (content_type == SSL3_RT_HANDSHAKE)
+      session->RecordCertificateBytes(
+          reinterpret_cast<const uint8_t*>(buf), len, false);
+    return;
+  }
+
   switch (content_type) {
     case SSL3_RT_HANDSHAKE: {
-      session->WriteHandshake(reinterpret_cast<const uint8_t*>(buf), len);
+      const uint8_t* msg = reinterpret_cast<const uint8_t*>(buf);
+      session->RecordCertificateBytes(msg, len, true);
+      session->WriteHandshake(msg, len);
       break;
     }
     case SSL3_RT_ALERT: {
@@ -949,6 +1009,11 @@ int DoTLSHandshake(SSL* ssl) {
         // things on our side.
       case SSL_ERROR_WANT_CLIENT_HELLO_CB:
       case SSL_ERROR_WANT_X509_LOOKUP:
+        // The handshake is also suspended while a private key
+        // operation is running on the threadpool (see
+        // EnableAsyncSigning). It is resumed once the signature
+        // has been computed.
+      case SSL_ERROR_WANT_ASYNC:
         return 0;
       case SSL_ERROR_SSL:
         return NGTCP2_ERR_CRYPTO;
@@ -975,6 +1040,7 @@ int DoTLSReadEarlyData(SSL* ssl) {
         // things on our side.
         case SSL_ERROR_WANT_CLIENT_HELLO_CB:
         case SSL_ERROR_WANT_X509_LOOKUP:
+        case SSL_ERROR_WANT_ASYNC:
           return 0;
         case SSL_ERROR_SSL:
           return NGTCP2_ERR_CRYPTO;
@@ -1081,6 +1147,252 @@ int UseSNIContext(SSL* ssl, crypto::SecureContext* context) {
   return err;
 }
 
+namespace {
+// A private key operation performed on the libuv threadpool on behalf
+// of a suspended TLS handshake. Instances live on the stack of the
+// OpenSSL async job that requested the operation and are released
+// when that job is resumed by QuicSession::OnAsyncSigningDone().
+class AsyncSigningWork : public ThreadPoolWork {
+ public:
+  AsyncSigningWork(QuicSession* session, std::function<int()> fn) :
+      ThreadPoolWork(session->env()),
+      session_(session->shared_from_this()),
+      fn_(std::move(fn)) {}
+
+  void DoThreadPoolWork() override {
+    result_ = fn_();
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    if (status != 0)
+      result_ = -1;
+    // Resuming the handshake finishes the async job that owns this
+    // object, so it must not be touched after OnAsyncSigningDone().
+    std::shared_ptr<QuicSession> session = std::move(session_);
+    done_ = true;
+    session->OnAsyncSigningDone();
+  }
+
+  bool IsDone() const { return done_; }
+  int result() const { return result_; }
+
+ private:
+  std::shared_ptr<QuicSession> session_;
+  std::function<int()> fn_;
+  int result_ = -1;
+  bool done_ = false;
+};
+
+// Runs fn on the threadpool if called from within an OpenSSL async job
+// started by an AsyncSigningScope, pausing the job until the result is
+// available. Otherwise, fn is run synchronously.
+int RunAsyncSigning(std::function<int()> fn) {
+  QuicSession* session = QuicSession::AsyncSigningScope::Current();
+  if (session == nullptr || ASYNC_get_current_job() == nullptr)
+    return fn();
+
+  AsyncSigningWork work(session, std::move(fn));
+  work.ScheduleWork();
+  session->OnAsyncSigningStart();
+
+  // Every call to SSL_do_handshake while the job is paused resumes it
+  // here, so keep pausing until the threadpool work has completed.
+  while (!work.IsDone())
+    CHECK_EQ(ASYNC_pause_job(), 1);
+  return work.result();
+}
+
+int AsyncRSAPrivEnc(
+    int flen,
+    const unsigned char* from,
+    unsigned char* to,
+    RSA* rsa,
+    int padding) {
+  static const auto priv_enc = RSA_meth_get_priv_enc(RSA_PKCS1_OpenSSL());
+  return RunAsyncSigning([&]() {
+    return priv_enc(flen, from, to, rsa, padding);
+  });
+}
+
+int AsyncECDSASign(
+    int type,
+    const unsigned char* dgst,
+    int dlen,
+    unsigned char* sig,
+    unsigned int* siglen,
+    const BIGNUM* kinv,
+    const BIGNUM* r,
+    EC_KEY* eckey) {
+  int (*sign)(int, const unsigned char*, int, unsigned char*,
+              unsigned int*, const BIGNUM*, const BIGNUM*, EC_KEY*);
+  EC_KEY_METHOD_get_sign(EC_KEY_OpenSSL(), &sign, nullptr, nullptr);
+  return RunAsyncSigning([&]() {
+    return sign(type, dgst, dlen, sig, siglen, kinv, r, eckey);
+  });
+}
+
+RSA_METHOD* GetAsyncRSAMethod() {
+  static RSA_METHOD* method = []() {
+    RSA_METHOD* method = RSA_meth_dup(RSA_PKCS1_OpenSSL());
+    CHECK_NOT_NULL(method);
+    CHECK_EQ(RSA_meth_set_priv_enc(method, AsyncRSAPrivEnc), 1);
+    return method;
+  }();
+  return method;
+}
+
+EC_KEY_METHOD* GetAsyncECKeyMethod() {
+  static EC_KEY_METHOD* method = []() {
+    EC_KEY_METHOD* method = EC_KEY_METHOD_new(EC_KEY_OpenSSL());
+    CHECK_NOT_NULL(method);
+    int (*sign_setup)(EC_KEY*, BN_CTX*, BIGNUM**, BIGNUM**);
+    ECDSA_SIG* (*sign_sig)(const unsigned char*, int, const BIGNUM*,
+                           const BIGNUM*, EC_KEY*);
+    EC_KEY_METHOD_get_sign(EC_KEY_OpenSSL(), nullptr, &sign_setup, &sign_sig);
+    EC_KEY_METHOD_set_sign(method, AsyncECDSASign, sign_setup, sign_sig);
+    return method;
+  }();
+  return method;
+}
+}  // namespace
+
+void EnableAsyncSigning(SSL* ssl) {
+  // The keys configured on the SSL are shared with the SecureContext
+  // and every other SSL created from it, so the async methods are set
+  // on private copies that are then installed on this SSL only.
+  if (!SSL_set_current_cert(ssl, SSL_CERT_SET_FIRST))
+    return;
+  do {
+    EVP_PKEY* pkey = SSL_get_privatekey(ssl);
+    if (pkey == nullptr)
+      continue;
+    crypto::EVPKeyPointer copy;
+    switch (EVP_PKEY_base_id(pkey)) {
+      case EVP_PKEY_RSA: {
+        RSA* rsa = EVP_PKEY_get0_RSA(pkey);
+        if (rsa == nullptr || RSA_get_method(rsa) == GetAsyncRSAMethod())
+          break;
+        crypto::RSAPointer dup(RSAPrivateKey_dup(rsa));
+        if (!dup || !RSA_set_method(dup.get(), GetAsyncRSAMethod()))
+          break;
+        copy.reset(EVP_PKEY_new());
+        if (copy && EVP_PKEY_assign_RSA(copy.get(), dup.get()))
+          dup.release();
+        else
+          copy.reset();
+        break;
+      }
+      case EVP_PKEY_EC: {
+        EC_KEY* ec = EVP_PKEY_get0_EC_KEY(pkey);
+        if (ec == nullptr || EC_KEY_get_method(ec) == GetAsyncECKeyMethod())
+          break;
+        crypto::ECKeyPointer dup(EC_KEY_dup(ec));
+        if (!dup || !EC_KEY_set_method(dup.get(), GetAsyncECKeyMethod()))
+          break;
+        copy.reset(EVP_PKEY_new());
+        if (copy && EVP_PKEY_assign_EC_KEY(copy.get(), dup.get()))
+          dup.release();
+        else
+          copy.reset();
+        break;
+      }
+      // Other key types (e.g. Ed25519) are always signed synchronously.
+    }
+    // Replacing the key of the current certificate leaves it current,
+    // so iteration continues with the next one. If the copy could not
+    // be made, that key is simply used synchronously.
+    if (!copy || !SSL_use_PrivateKey(ssl, copy.get()))
+      ERR_clear_error();
+  } while (SSL_set_current_cert(ssl, SSL_CERT_SET_NEXT));
+}
+
+std::shared_ptr<OCSPStaple> NewOCSPStaple(
+    const unsigned char* data,
+    size_t len) {
+  auto staple = std::make_shared<OCSPStaple>();
+  staple->response.assign(data, data + len);
+
+  const unsigned char* p = data;
+  DeleteFnPtr<OCSP_RESPONSE, OCSP_RESPONSE_free> resp(
+      d2i_OCSP_RESPONSE(nullptr, &p, len));
+  if (!resp ||
+      OCSP_response_status(resp.get()) != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+    ERR_clear_error();
+    return staple;
+  }
+
+  DeleteFnPtr<OCSP_BASICRESP, OCSP_BASICRESP_free> basic(
+      OCSP_response_get1_basic(resp.get()));
+  OCSP_SINGLERESP* single =
+      basic ? OCSP_resp_get0(basic.get(), 0) : nullptr;
+  ASN1_GENERALIZEDTIME* next_update = nullptr;
+  int days;
+  int seconds;
+  if (single == nullptr ||
+      OCSP_single_get0_status(
+          single, nullptr, nullptr, nullptr, &next_update) == -1 ||
+      next_update == nullptr ||
+      !ASN1_TIME_diff(&days, &seconds, nullptr, next_update)) {
+    ERR_clear_error();
+    return staple;
+  }
+
+  const int64_t remaining = static_cast<int64_t>(days) * 86400 + seconds;
+  if (remaining > 0)
+    staple->expires_at = uv_hrtime() + remaining * 1000000000ULL;
+  return staple;
+}
+
+bool SNIContextIndex::Add(
+    const std::string& servername,
+    crypto::SecureContext* context) {
+  std::string name(servername);
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+  auto entry = std::make_shared<Entry>(context);
+  const size_t wildcard = name.find('*');
+  if (wildcard == std::string::npos) {
+    exact_[name] = std::move(entry);
+    return true;
+  }
+
+  // Only a wildcard that replaces the entire leftmost label is indexed.
+  if (wildcard != 0 ||
+      name.size() < 3 ||
+      name[1] != '.' ||
+      name.find('*', 1) != std::string::npos) {
+    return false;
+  }
+  wildcard_[name.substr(1)] = std::move(entry);
+  return true;
+}
+
+void SNIContextIndex::SetDefault(crypto::SecureContext* context) {
+  default_ = std::make_shared<Entry>(context);
+}
+
+std::shared_ptr<SNIContextIndex::Entry> SNIContextIndex::Find(
+    const char* servername) const {
+  if (servername == nullptr || size() == 0)
+    return default_;
+
+  std::string name(servername);
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+  auto exact = exact_.find(name);
+  if (exact != exact_.end())
+    return exact->second;
+
+  const size_t dot = name.find('.');
+  if (dot != std::string::npos) {
+    auto wildcard = wildcard_.find(name.substr(dot));
+    if (wildcard != wildcard_.end())
+      return wildcard->second;
+  }
+
+  return default_;
+}
+
 int Client_Hello_CB(
     SSL* ssl,
     int* tls_alert,
@@ -1417,6 +1729,36 @@ bool InvalidRetryToken(
   return false;
 }
 
+// The bundled ngtcp2 does not provide a helper for deriving stateless
+// reset tokens, so the HKDF-SHA256 derivation is done here.
+bool GenerateResetToken(
+    uint8_t* token,
+    const std::array<uint8_t, RESET_SECRETLEN>& secret,
+    const ngtcp2_cid* cid) {
+  static const uint8_t RESET_LABEL[] = "stateless reset";
+  std::array<uint8_t, 32> prk;
+  CryptoContext ctx;
+  SetupInitialCryptoContext(&ctx);
+
+  return
+      HKDF_Extract(
+          prk.data(),
+          prk.size(),
+          &ctx,
+          secret.data(),
+          secret.size(),
+          cid->data,
+          cid->datalen) &&
+      HKDF_Expand(
+          token,
+          NGTCP2_STATELESS_RESET_TOKENLEN,
+          &ctx,
+          prk.data(),
+          prk.size(),
+          RESET_LABEL,
+          sizeof(RESET_LABEL) - 1);
+}
+
 int VerifyPeerCertificate(SSL* ssl) {
   int err = X509_V_ERR_UNSPECIFIED;
   if (X509* peer_cert = SSL_get_peer_certificate(ssl)) {
@@ -1757,7 +2099,7 @@ Local<Value> GetServerName(
     Environment* env,
     SSL* ssl,
     const char* host_name) {
-  Local<Value> servername;
+  Local<Value> servername = Undefined(env->isolate());
   if (host_name != nullptr) {
     servername = String::NewFromUtf8(
         env->isolate(),
@@ -1784,7 +2126,7 @@ Local<Value> GetALPNProtocol(Environment* env, SSL* ssl) {
 }
 
 Local<Value> GetCipherName(Environment* env, SSL* ssl) {
-  Local<Value> cipher;
+  Local<Value> cipher = Undefined(env->isolate());
   const SSL_CIPHER* c = SSL_get_current_cipher(ssl);
   if (c != nullptr) {
     const char* cipher_name = SSL_CIPHER_get_name(c);
@@ -1794,7 +2136,7 @@ Local<Value> GetCipherName(Environment* env, SSL* ssl) {
 }
 
 Local<Value> GetCipherVersion(Environment* env, SSL* ssl) {
-  Local<Value> version;
+  Local<Value> version = Undefined(env->isolate());
   // Get the cipher and version
   const SSL_CIPHER* c = SSL_get_current_cipher(ssl);
   if (c != nullptr) {
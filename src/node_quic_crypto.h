@@ -9,6 +9,7 @@
 #include "v8.h"
 
 #include <ngtcp2/ngtcp2.h>
+#include <openssl/async.h>
 #include <openssl/bio.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
@@ -16,11 +17,14 @@
 #include <openssl/ssl.h>
 #include <openssl/x509v3.h>
 
+#include <array>
 #include <iterator>
+#include <memory>
 #include <numeric>
 #include <unordered_map>
 #include <string>
 #include <sstream>
+#include <vector>
 
 namespace node {
 
@@ -209,8 +213,9 @@ void InstallTXKeys(
     const SessionKey& hp);
 
 // MessageCB provides a hook into the TLS handshake dataflow. Currently, it
-// is used to capture TLS alert codes (errors) and to collect the TLS handshake
-// data that is to be sent.
+// is used to capture TLS alert codes (errors), to collect the TLS handshake
+// data that is to be sent, and to account for the size of the certificate
+// messages that are sent and received.
 void MessageCB(
     int write_p,
     int version,
@@ -247,6 +252,74 @@ const char* GetClientHelloALPN(SSL* ssl);
 
 int UseSNIContext(SSL* ssl, crypto::SecureContext* context);
 
+// Replaces the RSA and ECDSA methods of the private keys currently
+// configured for the SSL so that the signature computed for the
+// server's CertificateVerify message is performed on the libuv
+// threadpool rather than the event loop thread. The offload only
+// happens while the TLS handshake is running within an OpenSSL async
+// job (SSL_MODE_ASYNC) inside a QuicSession::AsyncSigningScope.
+// In every other case the default OpenSSL implementation is used
+// synchronously, so the keys remain usable by other SSL instances.
+void EnableAsyncSigning(SSL* ssl);
+
+// An OCSP response to be stapled to the TLS handshake. Once created, a
+// staple is immutable and may be shared by any number of QuicSessions.
+struct OCSPStaple {
+  std::vector<unsigned char> response;
+  // The uv_hrtime() timestamp after which the response is considered
+  // stale, or 0 if the response may not be cached (e.g. because it
+  // does not specify a nextUpdate time).
+  uint64_t expires_at = 0;
+
+  bool IsFresh(uint64_t now) const { return expires_at > now; }
+};
+
+// Creates an OCSPStaple for the given DER-encoded OCSP response. The
+// expiration is derived from the nextUpdate time of the first
+// SingleResponse.
+std::shared_ptr<OCSPStaple> NewOCSPStaple(
+    const unsigned char* data,
+    size_t len);
+
+// The SNIContextIndex maps the servernames requested by clients to the
+// SecureContext to be used for the TLS handshake, so that the selection
+// can happen without calling into JavaScript. Servernames are either
+// exact (e.g. "example.com") or wildcards that replace the leftmost
+// label (e.g. "*.example.com"). Exact matches take precedence. When no
+// servername matches, the default entry is used.
+//
+// Each entry caches the OCSP staple most recently provided for its
+// SecureContext until that staple expires.
+//
+// The SecureContext instances are not owned by the index. Like the
+// default server SecureContext, they are kept alive by the JavaScript
+// QuicSocket object.
+class SNIContextIndex {
+ public:
+  struct Entry {
+    explicit Entry(crypto::SecureContext* sc) : context(sc) {}
+    crypto::SecureContext* context;
+    std::shared_ptr<OCSPStaple> staple;
+  };
+
+  // Returns false if the servername pattern cannot be indexed.
+  bool Add(const std::string& servername, crypto::SecureContext* context);
+
+  void SetDefault(crypto::SecureContext* context);
+
+  // Returns nullptr only if there is no default entry.
+  std::shared_ptr<Entry> Find(const char* servername) const;
+
+  size_t size() const { return exact_.size() + wildcard_.size(); }
+
+ private:
+  std::unordered_map<std::string, std::shared_ptr<Entry>> exact_;
+  // Wildcard entries are keyed by the servername with the leading
+  // "*" removed (e.g. ".example.com")
+  std::unordered_map<std::string, std::shared_ptr<Entry>> wildcard_;
+  std::shared_ptr<Entry> default_;
+};
+
 int Client_Hello_CB(
     SSL* ssl,
     int* tls_alert,
@@ -313,6 +386,39 @@ int Server_Transport_Params_Parse_CB(
     int* al,
     void* parse_arg);
 
+constexpr size_t kRandomPoolSize = 1024;
+constexpr uint64_t kRandomPoolMaxAge = 1000000000;  // 1 second, in ns
+
+// A buffer of random bytes that is refilled from the source (by
+// default, OpenSSL's CSPRNG) in bulk. Bytes are handed out at most once
+// and are cleansed from the pool as they are. The pool is discarded
+// after a fork and whenever it is older than kRandomPoolMaxAge. Requests
+// that are larger than a quarter of the pool bypass it.
+class RandomPool {
+ public:
+  typedef bool (*Source)(unsigned char* buffer, size_t length);
+
+  explicit RandomPool(Source source = EntropySource);
+  ~RandomPool();
+
+  // Copies length random bytes into buffer. now is the current
+  // uv_hrtime(), used to determine the age of the pool.
+  void Fill(uint8_t* buffer, size_t length, uint64_t now);
+
+ private:
+  Source source_;
+  std::array<uint8_t, kRandomPoolSize> pool_;
+  size_t remaining_ = 0;
+  uint64_t refilled_at_ = 0;
+  uint32_t generation_ = 0;
+};
+
+// Fills the buffer with cryptographically strong random data taken
+// from a per-thread RandomPool. This avoids the cost of going through
+// RAND_bytes() (and its locking) for the many small random values
+// needed when creating connections.
+void PooledRandomBytes(uint8_t* buffer, size_t length);
+
 bool GenerateRetryToken(
     uint8_t* token,
     size_t* tokenlen,
@@ -328,6 +434,15 @@ bool InvalidRetryToken(
     std::array<uint8_t, TOKEN_SECRETLEN>* token_secret,
     uint64_t verification_expiration);
 
+// Derives the stateless reset token for the given CID from secret. As the
+// token can be derived again at any time, including by another process
+// that shares the secret, a QuicSocket that no longer knows the CID can
+// still send a stateless reset for it.
+bool GenerateResetToken(
+    uint8_t* token,
+    const std::array<uint8_t, RESET_SECRETLEN>& secret,
+    const ngtcp2_cid* cid);
+
 int VerifyPeerCertificate(SSL* ssl);
 
 std::string GetCertificateCN(X509* cert);
@@ -0,0 +1,700 @@
+#include "debug_utils.h"
+#include "env-inl.h"
+#include "node_quic_http3_application.h"
+#include "node_quic_session-inl.h"
+#include "node_quic_stream.h"
+#include "node_quic_util.h"
+#include "v8.h"
+
+#include <ngtcp2/ngtcp2.h>
+#include <nghttp3/nghttp3.h>
+
+#include <array>
+
+namespace node {
+
+using v8::Array;
+using v8::Context;
+using v8::Isolate;
+using v8::Local;
+using v8::String;
+using v8::Uint32;
+using v8::Value;
+
+namespace quic {
+
+namespace {
+// HTTP/3 needs a control stream and a QPACK encoder and decoder
+// stream in each direction.
+constexpr uint64_t kHttp3UniStreamCount = 3;
+
+inline bool IsClientBidiStream(int64_t stream_id) {
+  return (stream_id & 0b11) == 0;
+}
+}  // namespace
+
+Http3Headers::Http3Headers(
+    Isolate* isolate,
+    Local<Context> context,
+    Local<Array> headers) {
+  Local<Value> header_string = headers->Get(context, 0).ToLocalChecked();
+  Local<Value> header_count = headers->Get(context, 1).ToLocalChecked();
+  count_ = header_count.As<Uint32>()->Value();
+  int header_string_len = header_string.As<String>()->Length();
+
+  if (count_ == 0) {
+    CHECK_EQ(header_string_len, 0);
+    return;
+  }
+
+  // Allocate a single buffer with count_ nghttp3_nv structs, followed
+  // by the raw header data as passed from JS. This looks like:
+  // | possible padding | nghttp3_nv | nghttp3_nv | ... | header contents |
+  buf_.AllocateSufficientStorage((alignof(nghttp3_nv) - 1) +
+                                 count_ * sizeof(nghttp3_nv) +
+                                 header_string_len);
+  // Make sure the start address is aligned appropriately for an nghttp3_nv*.
+  char* start = reinterpret_cast<char*>(
+      RoundUp(reinterpret_cast<uintptr_t>(*buf_), alignof(nghttp3_nv)));
+  char* header_contents = start + (count_ * sizeof(nghttp3_nv));
+  nva_ = reinterpret_cast<nghttp3_nv*>(start);
+
+  CHECK_LE(header_contents + header_string_len, *buf_ + buf_.length());
+  CHECK_EQ(header_string.As<String>()->WriteOneByte(
+               isolate,
+               reinterpret_cast<uint8_t*>(header_contents),
+               0,
+               header_string_len,
+               String::NO_NULL_TERMINATION),
+           header_string_len);
+
+  size_t n = 0;
+  char* p;
+  for (p = header_contents; p < header_contents + header_string_len; n++) {
+    if (n >= count_) {
+      // This can happen if a passed header contained a null byte. In that
+      // case, just provide nghttp3 with an invalid header to make it reject
+      // the headers list.
+      static uint8_t zero = '\0';
+      nva_[0].name = nva_[0].value = &zero;
+      nva_[0].namelen = nva_[0].valuelen = 1;
+      count_ = 1;
+      return;
+    }
+
+    nva_[n].flags = NGHTTP3_NV_FLAG_NONE;
+    nva_[n].name = reinterpret_cast<uint8_t*>(p);
+    nva_[n].namelen = strlen(p);
+    p += nva_[n].namelen + 1;
+    nva_[n].value = reinterpret_cast<uint8_t*>(p);
+    nva_[n].valuelen = strlen(p);
+    p += nva_[n].valuelen + 1;
+  }
+}
+
+const nghttp3_conn_callbacks Http3Application::callbacks_ = {
+  OnAckedStreamData,
+  nullptr,  // stream_close: streams are closed by ngtcp2
+  OnReceiveData,
+  OnDeferredConsume,
+  OnBeginHeaders,
+  OnReceiveHeader,
+  OnEndHeaders,
+  OnBeginTrailers,
+  OnReceiveHeader,
+  OnEndHeaders,
+  nullptr,  // begin_push_promise
+  nullptr,  // recv_push_promise
+  nullptr,  // end_push_promise
+  nullptr,  // cancel_push
+  OnSendStopSending,
+  nullptr,  // push_stream
+  OnEndStream
+};
+
+Http3Application::Http3Application(QuicSession* session) :
+    QuicApplication(session),
+    allocator_(session) {}
+
+bool Http3Application::Initialize() {
+  QuicSession* session = Session();
+  CHECK(!connection_);
+
+  // The peer must permit enough unidirectional streams for the control
+  // and QPACK streams to be opened.
+  if (ngtcp2_conn_get_max_local_streams_uni(session->Connection()) <
+      kHttp3UniStreamCount) {
+    QUIC_DEBUG(session, "Too few unidirectional streams for HTTP/3");
+    session->SetLastError(
+        QUIC_ERROR_APPLICATION,
+        static_cast<uint64_t>(NGHTTP3_HTTP_STREAM_CREATION_ERROR));
+    return false;
+  }
+
+  nghttp3_conn_settings settings;
+  nghttp3_conn_settings_default(&settings);
+  settings.max_header_list_size = DEFAULT_MAX_HEADER_LIST_SIZE;
+
+  nghttp3_conn* conn;
+  auto conn_new = session->Side() == NGTCP2_CRYPTO_SIDE_SERVER ?
+      nghttp3_conn_server_new :
+      nghttp3_conn_client_new;
+  int rv = conn_new(&conn, &callbacks_, &settings, *allocator_, this);
+  if (rv != 0) {
+    session->SetLastError(
+        QUIC_ERROR_APPLICATION,
+        static_cast<uint64_t>(NGHTTP3_HTTP_INTERNAL_ERROR));
+    return false;
+  }
+  connection_.reset(conn);
+
+  if (session->Side() == NGTCP2_CRYPTO_SIDE_SERVER) {
+    ngtcp2_transport_params params;
+    session->GetLocalTransportParams(&params);
+    nghttp3_conn_set_max_client_streams_bidi(
+        Connection(),
+        params.initial_max_streams_bidi);
+  }
+
+  if (!CreateAndBindControlStream() || !CreateAndBindQPackStreams()) {
+    session->SetLastError(
+        QUIC_ERROR_APPLICATION,
+        static_cast<uint64_t>(NGHTTP3_HTTP_INTERNAL_ERROR));
+    return false;
+  }
+
+  return true;
+}
+
+bool Http3Application::CreateAndBindControlStream() {
+  ngtcp2_conn* conn = Session()->Connection();
+  if (ngtcp2_conn_open_uni_stream(conn, &control_stream_id_, nullptr) != 0)
+    return false;
+  QUIC_DEBUG(Session(), "Opened HTTP/3 control stream %" PRId64,
+             control_stream_id_);
+  return nghttp3_conn_bind_control_stream(
+      Connection(),
+      control_stream_id_) == 0;
+}
+
+bool Http3Application::CreateAndBindQPackStreams() {
+  ngtcp2_conn* conn = Session()->Connection();
+  if (ngtcp2_conn_open_uni_stream(conn, &qpack_enc_stream_id_, nullptr) != 0 ||
+      ngtcp2_conn_open_uni_stream(conn, &qpack_dec_stream_id_, nullptr) != 0) {
+    return false;
+  }
+  QUIC_DEBUG(Session(), "Opened QPACK streams %" PRId64 " and %" PRId64,
+             qpack_enc_stream_id_,
+             qpack_dec_stream_id_);
+  return nghttp3_conn_bind_qpack_streams(
+      Connection(),
+      qpack_enc_stream_id_,
+      qpack_dec_stream_id_) == 0;
+}
+
+// All received stream data, including the control and QPACK streams,
+// is passed through nghttp3. Only the message bodies will make it on
+// to the QuicStreams. The flow control credit for the framing consumed
+// by nghttp3 is returned to the peer right away, the credit for the
+// bodies is returned as they are read on the JavaScript side.
+bool Http3Application::ReceiveStreamData(
+    int64_t stream_id,
+    int fin,
+    const uint8_t* data,
+    size_t datalen,
+    uint64_t offset) {
+  QuicSession* session = Session();
+
+  // New requests are refused once the QuicSession is closing.
+  if (session->IsGracefullyClosing() &&
+      session->Side() == NGTCP2_CRYPTO_SIDE_SERVER &&
+      IsClientBidiStream(stream_id) &&
+      !session->HasStream(stream_id)) {
+    ngtcp2_conn_shutdown_stream(
+        session->Connection(),
+        stream_id,
+        NGHTTP3_HTTP_REQUEST_REJECTED);
+    return true;
+  }
+
+  ssize_t nread =
+      nghttp3_conn_read_stream(Connection(), stream_id, data, datalen, fin);
+  if (nread < 0) {
+    QUIC_DEBUG(session, "Failure reading HTTP/3 stream %" PRId64 ": %s",
+               stream_id,
+               nghttp3_strerror(static_cast<int>(nread)));
+    // When one of the callbacks failed, it has already set the error.
+    if (nread != NGHTTP3_ERR_CALLBACK_FAILURE) {
+      session->SetLastError(
+          QUIC_ERROR_APPLICATION,
+          nghttp3_err_infer_quic_app_error_code(static_cast<int>(nread)));
+    }
+    return false;
+  }
+
+  session->ExtendStreamOffset(stream_id, nread);
+  return true;
+}
+
+void Http3Application::AcknowledgeStreamData(
+    int64_t stream_id,
+    uint64_t offset,
+    size_t datalen) {
+  // The stream may already have been closed, in which case there is
+  // nothing left to acknowledge.
+  USE(nghttp3_conn_add_ack_offset(Connection(), stream_id, datalen));
+}
+
+void Http3Application::ExtendMaxStreamData(
+    int64_t stream_id,
+    uint64_t max_data) {
+  USE(nghttp3_conn_unblock_stream(Connection(), stream_id));
+}
+
+bool Http3Application::StreamClose(
+    int64_t stream_id,
+    uint64_t app_error_code) {
+  int rv = nghttp3_conn_close_stream(Connection(), stream_id, app_error_code);
+  switch (rv) {
+    case 0:
+    // The stream is not known to nghttp3 or has already been closed.
+    case NGHTTP3_ERR_INVALID_ARGUMENT:
+      return true;
+    default:
+      // The peer closed one of the critical streams.
+      QUIC_DEBUG(Session(), "Failure closing HTTP/3 stream %" PRId64 ": %s",
+                 stream_id,
+                 nghttp3_strerror(rv));
+      Session()->SetLastError(
+          QUIC_ERROR_APPLICATION,
+          nghttp3_err_infer_quic_app_error_code(rv));
+      return false;
+  }
+}
+
+void Http3Application::StreamReset(
+    int64_t stream_id,
+    uint64_t final_size,
+    uint64_t app_error_code) {
+  USE(nghttp3_conn_reset_stream(Connection(), stream_id));
+}
+
+void Http3Application::ResumeStream(int64_t stream_id) {
+  // Fails if the headers have not yet been submitted for the stream. The
+  // data remains queued on the QuicStream until they are.
+  USE(nghttp3_conn_resume_stream(Connection(), stream_id));
+}
+
+// Serializes the data for the control, QPACK and request streams, in the
+// order determined by nghttp3, into as many packets as congestion and
+// flow control permit.
+bool Http3Application::SendPendingData() {
+  QuicSession* session = Session();
+  ngtcp2_conn* conn = session->Connection();
+  std::array<nghttp3_vec, 16> vec;
+  QuicPathStorage path;
+
+  for (;;) {
+    int64_t stream_id = -1;
+    int fin = 0;
+    ssize_t sveccnt = nghttp3_conn_writev_stream(
+        Connection(),
+        &stream_id,
+        &fin,
+        vec.data(),
+        vec.size());
+    if (sveccnt < 0) {
+      QUIC_DEBUG(session, "Failure serializing HTTP/3 data: %s",
+                 nghttp3_strerror(static_cast<int>(sveccnt)));
+      session->SetLastError(
+          QUIC_ERROR_APPLICATION,
+          nghttp3_err_infer_quic_app_error_code(static_cast<int>(sveccnt)));
+      return false;
+    }
+
+    // Nothing is pending.
+    if (stream_id < 0)
+      return true;
+
+    ssize_t ndatalen = -1;
+    MallocedBuffer<uint8_t> dest(session->max_pktlen_);
+    ssize_t nwrite =
+        ngtcp2_conn_writev_stream(
+            conn,
+            &path.path,
+            dest.data,
+            session->max_pktlen_,
+            &ndatalen,
+            NGTCP2_WRITE_STREAM_FLAG_NONE,
+            stream_id,
+            fin,
+            reinterpret_cast<const ngtcp2_vec*>(vec.data()),
+            sveccnt,
+            uv_hrtime());
+
+    if (nwrite <= 0) {
+      switch (nwrite) {
+        case 0:
+          // Congestion limited. The remaining data is sent once the
+          // congestion window has expanded.
+          return true;
+        case NGTCP2_ERR_PKT_NUM_EXHAUSTED:
+          // See QuicSession::SendStreamData
+          session->SilentClose();
+          return false;
+        case NGTCP2_ERR_STREAM_DATA_BLOCKED:
+          if (ngtcp2_conn_get_max_data_left(conn) == 0)
+            return true;
+          // Only this stream is blocked, the others can still be sent.
+          // The stream is unblocked in ExtendMaxStreamData.
+          USE(nghttp3_conn_block_stream(Connection(), stream_id));
+          continue;
+        case NGTCP2_ERR_EARLY_DATA_REJECTED:
+          return true;
+        case NGTCP2_ERR_STREAM_SHUT_WR:
+        case NGTCP2_ERR_STREAM_NOT_FOUND:
+          // Nothing more can be sent on the stream. nghttp3 discards its
+          // state for the stream once the stream has been closed.
+          USE(nghttp3_conn_block_stream(Connection(), stream_id));
+          continue;
+        default:
+          session->SetLastError(QUIC_ERROR_SESSION, static_cast<int>(nwrite));
+          return false;
+      }
+    }
+
+    if (ndatalen >= 0) {
+      int rv = nghttp3_conn_add_write_offset(
+          Connection(),
+          stream_id,
+          ndatalen);
+      if (rv != 0) {
+        session->SetLastError(
+            QUIC_ERROR_APPLICATION,
+            nghttp3_err_infer_quic_app_error_code(rv));
+        return false;
+      }
+
+      if (fin &&
+          static_cast<size_t>(ndatalen) ==
+              nghttp3_vec_len(vec.data(), sveccnt)) {
+        QuicStream* stream = session->FindStream(stream_id);
+        if (stream != nullptr && !stream->IsWritable())
+          stream->SetFinSent();
+      }
+    }
+
+    dest.Realloc(nwrite);
+    session->sendbuf_.Push(std::move(dest));
+    session->remote_address_.Update(&path.path.remote);
+
+    if (!session->SendPacket("http/3 stream data"))
+      return false;
+  }
+}
+
+bool Http3Application::SubmitHeaders(
+    int64_t stream_id,
+    QuicStreamHeadersKind kind,
+    Local<Array> headers) {
+  static constexpr nghttp3_data_reader reader = { OnReadData };
+  QuicSession* session = Session();
+  Environment* env = session->env();
+  Http3Headers nva(env->isolate(), env->context(), headers);
+  bool server = session->Side() == NGTCP2_CRYPTO_SIDE_SERVER;
+
+  int rv;
+  switch (kind) {
+    case QUICSTREAM_HEADERS_KIND_INFORMATIONAL:
+      if (!server)
+        return false;
+      rv = nghttp3_conn_submit_info(
+          Connection(),
+          stream_id,
+          *nva,
+          nva.length());
+      break;
+    case QUICSTREAM_HEADERS_KIND_INITIAL:
+      // The body of the message is read from the QuicStream.
+      rv = server ?
+          nghttp3_conn_submit_response(
+              Connection(),
+              stream_id,
+              *nva,
+              nva.length(),
+              &reader) :
+          nghttp3_conn_submit_request(
+              Connection(),
+              stream_id,
+              *nva,
+              nva.length(),
+              &reader,
+              nullptr);
+      break;
+    case QUICSTREAM_HEADERS_KIND_TRAILING:
+      rv = nghttp3_conn_submit_trailers(
+          Connection(),
+          stream_id,
+          *nva,
+          nva.length());
+      break;
+    default:
+      return false;
+  }
+
+  if (rv != 0) {
+    QUIC_DEBUG(session, "Failure submitting headers on stream %" PRId64 ": %s",
+               stream_id,
+               nghttp3_strerror(rv));
+    return false;
+  }
+
+  session->SendPendingData();
+  return true;
+}
+
+// Only peer initiated requests create a new QuicStream. Locally
+// initiated streams are always created by the JavaScript side.
+QuicStream* Http3Application::FindOrCreateStream(int64_t stream_id) {
+  QuicSession* session = Session();
+  QuicStream* stream = session->FindStream(stream_id);
+  if (stream != nullptr)
+    return stream;
+  if (session->Side() != NGTCP2_CRYPTO_SIDE_SERVER ||
+      !IsClientBidiStream(stream_id) ||
+      session->IsGracefullyClosing() ||
+      session->IsFlagSet(QuicSession::QUICSESSION_FLAG_CLOSING) ||
+      session->IsFlagSet(QuicSession::QUICSESSION_FLAG_DESTROYED)) {
+    return nullptr;
+  }
+  return session->CreateStream(stream_id);
+}
+
+void Http3Application::AckedStreamData(int64_t stream_id, size_t datalen) {
+  QuicStream* stream = Session()->FindStream(stream_id);
+  if (stream != nullptr)
+    stream->Acknowledge(datalen);
+}
+
+void Http3Application::ReceiveData(
+    int64_t stream_id,
+    const uint8_t* data,
+    size_t datalen) {
+  QuicStream* stream = Session()->FindStream(stream_id);
+  // Data that cannot be delivered is discarded, but the peer still
+  // gets the flow control credit back.
+  if (stream == nullptr || !stream->IsReadable()) {
+    Session()->ExtendStreamOffset(stream_id, datalen);
+    return;
+  }
+  stream->ReceiveData(0, data, datalen, stream->GetReceivedBytes());
+}
+
+void Http3Application::DeferredConsume(int64_t stream_id, size_t consumed) {
+  // Data that was held back while the QPACK decoder was blocked is
+  // accounted for once it has been processed.
+  Session()->ExtendStreamOffset(stream_id, consumed);
+}
+
+void Http3Application::BeginHeaders(
+    int64_t stream_id,
+    QuicStreamHeadersKind kind) {
+  QuicStream* stream = FindOrCreateStream(stream_id);
+  if (stream != nullptr)
+    stream->BeginHeaders(kind);
+}
+
+bool Http3Application::ReceiveHeader(
+    int64_t stream_id,
+    nghttp3_rcbuf* name,
+    nghttp3_rcbuf* value) {
+  QuicStream* stream = Session()->FindStream(stream_id);
+  if (stream == nullptr)
+    return true;
+
+  nghttp3_vec n = nghttp3_rcbuf_get_buf(name);
+  nghttp3_vec v = nghttp3_rcbuf_get_buf(value);
+
+  // A client may receive any number of informational (1xx) responses
+  // before the final response.
+  if (Session()->Side() == NGTCP2_CRYPTO_SIDE_CLIENT &&
+      n.len == 7 && memcmp(n.base, ":status", 7) == 0 &&
+      v.len == 3 && v.base[0] == '1') {
+    stream->SetHeadersKind(QUICSTREAM_HEADERS_KIND_INFORMATIONAL);
+  }
+
+  if (!stream->AddHeader(n.base, n.len, v.base, v.len)) {
+    Session()->SetLastError(
+        QUIC_ERROR_APPLICATION,
+        static_cast<uint64_t>(NGHTTP3_HTTP_EXCESSIVE_LOAD));
+    return false;
+  }
+  return true;
+}
+
+void Http3Application::EndHeaders(int64_t stream_id) {
+  QuicStream* stream = Session()->FindStream(stream_id);
+  if (stream != nullptr)
+    stream->EndHeaders();
+}
+
+void Http3Application::SendStopSending(
+    int64_t stream_id,
+    uint64_t app_error_code) {
+  ngtcp2_conn_shutdown_stream_read(
+      Session()->Connection(),
+      stream_id,
+      app_error_code);
+}
+
+void Http3Application::EndStream(int64_t stream_id) {
+  QuicStream* stream = Session()->FindStream(stream_id);
+  if (stream != nullptr && stream->IsReadable())
+    stream->ReceiveData(1, nullptr, 0, stream->GetReceivedBytes());
+}
+
+// Provides the next chunk of the message body. The data is retained by
+// the QuicStream until it has been acknowledged.
+int Http3Application::ReadData(
+    int64_t stream_id,
+    const uint8_t** pdata,
+    size_t* pdatalen,
+    uint32_t* pflags) {
+  QuicStream* stream = Session()->FindStream(stream_id);
+  if (stream == nullptr) {
+    *pdatalen = 0;
+    *pflags |= NGHTTP3_DATA_FLAG_EOF;
+    return 0;
+  }
+
+  *pdatalen = stream->DrainChunk(pdata);
+  if (*pdatalen > 0)
+    return 0;
+
+  // The writable side has been shut down and all of the data has been
+  // passed on to nghttp3.
+  if (!stream->IsWritable()) {
+    *pflags |= NGHTTP3_DATA_FLAG_EOF;
+    return 0;
+  }
+
+  // Resumed by ResumeStream() once more data has been written. If the
+  // QuicStream is the sink of a StreamPipe, this asks the source for
+  // the next chunk.
+  stream->WantsWrite();
+  return NGHTTP3_ERR_WOULDBLOCK;
+}
+
+int Http3Application::OnAckedStreamData(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    size_t datalen,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->AckedStreamData(stream_id, datalen);
+  return 0;
+}
+
+int Http3Application::OnReceiveData(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    const uint8_t* data,
+    size_t datalen,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->ReceiveData(stream_id, data, datalen);
+  return 0;
+}
+
+int Http3Application::OnDeferredConsume(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    size_t consumed,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->DeferredConsume(stream_id, consumed);
+  return 0;
+}
+
+int Http3Application::OnBeginHeaders(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->BeginHeaders(stream_id, QUICSTREAM_HEADERS_KIND_INITIAL);
+  return 0;
+}
+
+int Http3Application::OnBeginTrailers(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->BeginHeaders(stream_id, QUICSTREAM_HEADERS_KIND_TRAILING);
+  return 0;
+}
+
+int Http3Application::OnReceiveHeader(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    int32_t token,
+    nghttp3_rcbuf* name,
+    nghttp3_rcbuf* value,
+    uint8_t flags,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  return app->ReceiveHeader(stream_id, name, value) ?
+      0 : NGHTTP3_ERR_CALLBACK_FAILURE;
+}
+
+int Http3Application::OnEndHeaders(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->EndHeaders(stream_id);
+  return 0;
+}
+
+int Http3Application::OnSendStopSending(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    uint64_t app_error_code,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->SendStopSending(stream_id, app_error_code);
+  return 0;
+}
+
+int Http3Application::OnEndStream(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  app->EndStream(stream_id);
+  return 0;
+}
+
+int Http3Application::OnReadData(
+    nghttp3_conn* conn,
+    int64_t stream_id,
+    const uint8_t** pdata,
+    size_t* pdatalen,
+    uint32_t* pflags,
+    void* conn_user_data,
+    void* stream_user_data) {
+  Http3Application* app = static_cast<Http3Application*>(conn_user_data);
+  return app->ReadData(stream_id, pdata, pdatalen, pflags);
+}
+
+}  // namespace quic
+}  // namespace node
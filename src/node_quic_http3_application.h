@@ -0,0 +1,181 @@
+#ifndef SRC_NODE_QUIC_HTTP3_APPLICATION_H_
+#define SRC_NODE_QUIC_HTTP3_APPLICATION_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "node_mem.h"
+#include "node_quic_session.h"
+#include "node_quic_util.h"
+#include "util.h"
+#include "v8.h"
+
+#include <ngtcp2/ngtcp2.h>
+#include <nghttp3/nghttp3.h>
+
+namespace node {
+namespace quic {
+
+using Http3ConnectionPointer = DeleteFnPtr<nghttp3_conn, nghttp3_conn_del>;
+
+// The Http3Headers class converts a block of headers passed from the
+// JavaScript side as a [string, count] pair into an array of nghttp3_nv
+// structs. See the Headers class in node_http2.h.
+class Http3Headers {
+ public:
+  Http3Headers(
+      v8::Isolate* isolate,
+      v8::Local<v8::Context> context,
+      v8::Local<v8::Array> headers);
+  ~Http3Headers() = default;
+
+  const nghttp3_nv* operator*() const { return nva_; }
+
+  size_t length() const { return count_; }
+
+ private:
+  size_t count_;
+  nghttp3_nv* nva_ = nullptr;
+  MaybeStackBuffer<char, 3000> buf_;
+};
+
+// The Http3Application maps HTTP/3 request streams on to
+// QuicStreams using nghttp3. The control and QPACK streams are handled
+// entirely at the native layer and are never exposed to JavaScript.
+// The body of each message is read from, and written to, the QuicStream
+// as with any other stream; headers are received and submitted as
+// separate blocks.
+//
+// Server push is not supported.
+class Http3Application : public QuicApplication {
+ public:
+  explicit Http3Application(QuicSession* session);
+
+  bool Initialize() override;
+  bool ReceiveStreamData(
+      int64_t stream_id,
+      int fin,
+      const uint8_t* data,
+      size_t datalen,
+      uint64_t offset) override;
+  void AcknowledgeStreamData(
+      int64_t stream_id,
+      uint64_t offset,
+      size_t datalen) override;
+  void ExtendMaxStreamData(int64_t stream_id, uint64_t max_data) override;
+  bool StreamClose(int64_t stream_id, uint64_t app_error_code) override;
+  void StreamReset(
+      int64_t stream_id,
+      uint64_t final_size,
+      uint64_t app_error_code) override;
+  void ResumeStream(int64_t stream_id) override;
+  bool SendPendingData() override;
+  bool SubmitHeaders(
+      int64_t stream_id,
+      QuicStreamHeadersKind kind,
+      v8::Local<v8::Array> headers) override;
+
+ private:
+  nghttp3_conn* Connection() { return connection_.get(); }
+
+  bool CreateAndBindControlStream();
+  bool CreateAndBindQPackStreams();
+
+  QuicStream* FindOrCreateStream(int64_t stream_id);
+  void AckedStreamData(int64_t stream_id, size_t datalen);
+  void ReceiveData(int64_t stream_id, const uint8_t* data, size_t datalen);
+  void DeferredConsume(int64_t stream_id, size_t consumed);
+  void BeginHeaders(int64_t stream_id, QuicStreamHeadersKind kind);
+  bool ReceiveHeader(
+      int64_t stream_id,
+      nghttp3_rcbuf* name,
+      nghttp3_rcbuf* value);
+  void EndHeaders(int64_t stream_id);
+  void SendStopSending(int64_t stream_id, uint64_t app_error_code);
+  void EndStream(int64_t stream_id);
+  int ReadData(
+      int64_t stream_id,
+      const uint8_t** pdata,
+      size_t* pdatalen,
+      uint32_t* pflags);
+
+  // static nghttp3 callbacks
+  static int OnAckedStreamData(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      size_t datalen,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnReceiveData(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      const uint8_t* data,
+      size_t datalen,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnDeferredConsume(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      size_t consumed,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnBeginHeaders(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnBeginTrailers(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnReceiveHeader(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      int32_t token,
+      nghttp3_rcbuf* name,
+      nghttp3_rcbuf* value,
+      uint8_t flags,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnEndHeaders(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnSendStopSending(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      uint64_t app_error_code,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnEndStream(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      void* conn_user_data,
+      void* stream_user_data);
+  static int OnReadData(
+      nghttp3_conn* conn,
+      int64_t stream_id,
+      const uint8_t** pdata,
+      size_t* pdatalen,
+      uint32_t* pflags,
+      void* conn_user_data,
+      void* stream_user_data);
+
+  static const nghttp3_conn_callbacks callbacks_;
+
+  // The allocator must outlive the nghttp3_conn.
+  mem::Allocator<nghttp3_mem> allocator_;
+  Http3ConnectionPointer connection_;
+
+  int64_t control_stream_id_ = -1;
+  int64_t qpack_enc_stream_id_ = -1;
+  int64_t qpack_dec_stream_id_ = -1;
+};
+
+}  // namespace quic
+}  // namespace node
+
+#endif  // NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_QUIC_HTTP3_APPLICATION_H_
@@ -0,0 +1,598 @@
+#include "node_quic_qlog.h"
+#include "env-inl.h"
+#include "node_internals.h"
+#include "string_bytes.h"
+#include "util-inl.h"
+#include "uv.h"
+
+#include <fcntl.h>
+
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace node {
+
+namespace quic {
+
+namespace {
+
+void AppendJsonString(std::string* out, const char* str, size_t len) {
+  static const char hex[] = "0123456789abcdef";
+  out->push_back('"');
+  for (size_t n = 0; n < len; n++) {
+    unsigned char c = static_cast<unsigned char>(str[n]);
+    switch (c) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default:
+        if (c < 0x20) {
+          out->append("\\u00");
+          out->push_back(hex[c >> 4]);
+          out->push_back(hex[c & 0xf]);
+        } else {
+          out->push_back(static_cast<char>(c));
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendJsonString(std::string* out, const std::string& str) {
+  AppendJsonString(out, str.data(), str.length());
+}
+
+void AppendMilliseconds(std::string* out, double ms) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.3f", ms);
+  out->append(buf);
+}
+
+void AppendMilliseconds(std::string* out, uint64_t ns) {
+  AppendMilliseconds(out, static_cast<double>(ns) / 1e6);
+}
+
+bool IsInteger(const std::string& value) {
+  size_t n = value[0] == '-' ? 1 : 0;
+  if (n == value.length())
+    return false;
+  for (; n < value.length(); n++) {
+    if (!isdigit(static_cast<unsigned char>(value[n])))
+      return false;
+  }
+  return true;
+}
+
+std::vector<std::string> Split(const std::string& message) {
+  std::vector<std::string> tokens;
+  size_t pos = 0;
+  while (pos < message.length()) {
+    size_t end = message.find(' ', pos);
+    if (end == std::string::npos)
+      end = message.length();
+    if (end > pos)
+      tokens.emplace_back(message, pos, end - pos);
+    pos = end + 1;
+  }
+  return tokens;
+}
+
+// Strips the "(0x..)" suffix ngtcp2 appends to packet and frame types.
+std::string TypeName(const std::string& token) {
+  return token.substr(0, token.find('('));
+}
+
+// Maps the packet type names used by ngtcp2 to those used by qlog.
+std::string PacketType(const std::string& token) {
+  std::string name = TypeName(token);
+  if (name == "Short")
+    return "1RTT";
+  if (name == "0RTT")
+    return name;
+  if (name == "VN")
+    return "version_negotiation";
+  if (name == "(unknown)")
+    return "unknown";
+  for (char& c : name)
+    c = tolower(static_cast<unsigned char>(c));
+  return name;
+}
+
+// Splits a "key=value" token.
+bool Field(const std::string& token, std::string* key, std::string* value) {
+  size_t pos = token.find('=');
+  if (pos == std::string::npos || pos == 0)
+    return false;
+  *key = token.substr(0, pos);
+  *value = token.substr(pos + 1);
+  return true;
+}
+
+// Appends "key":value, using a JSON number for integer values and a
+// JSON string for anything else.
+void AppendField(
+    std::string* out,
+    const std::string& key,
+    const std::string& value) {
+  if (!out->empty())
+    out->push_back(',');
+  AppendJsonString(out, key);
+  out->push_back(':');
+  if (IsInteger(value))
+    out->append(value);
+  else
+    AppendJsonString(out, value);
+}
+
+}  // namespace
+
+QlogWriter* QlogWriter::Open(uv_loop_t* loop, const std::string& path) {
+  QlogWriter* writer = new QlogWriter(loop);
+  writer->busy_ = true;
+  int err = uv_fs_open(
+      loop,
+      &writer->req_,
+      path.c_str(),
+      O_WRONLY | O_CREAT | O_TRUNC,
+      0666,
+      OnOpen);
+  if (err != 0) {
+    delete writer;
+    return nullptr;
+  }
+  return writer;
+}
+
+QlogWriter::QlogWriter(uv_loop_t* loop) : loop_(loop) {
+  req_.data = this;
+}
+
+void QlogWriter::Write(std::string&& data) {
+  if (failed_)
+    return;
+  if (pending_.size() + data.size() > kQlogMaxPending) {
+    dropped_ += data.size();
+    return;
+  }
+  if (pending_.empty())
+    pending_ = std::move(data);
+  else
+    pending_.append(data);
+  MaybeWrite();
+}
+
+void QlogWriter::Close() {
+  CHECK(!closing_);
+  closing_ = true;
+  if (!busy_)
+    Finish();
+}
+
+void QlogWriter::MaybeWrite() {
+  if (busy_ || failed_)
+    return;
+  if (inflight_.empty()) {
+    if (pending_.empty())
+      return;
+    inflight_.swap(pending_);
+    pending_.clear();
+    written_ = 0;
+  }
+  uv_buf_t buf =
+      uv_buf_init(&inflight_[written_], inflight_.size() - written_);
+  busy_ = true;
+  int err = uv_fs_write(loop_, &req_, fd_, &buf, 1, offset_, OnWrite);
+  if (err != 0) {
+    busy_ = false;
+    failed_ = true;
+  }
+}
+
+// Called once there is no request in flight. Writes whatever is still
+// pending, then closes the file and frees the QlogWriter.
+void QlogWriter::Finish() {
+  if (!failed_ && (!inflight_.empty() || !pending_.empty()))
+    return MaybeWrite();
+  if (fd_ >= 0) {
+    busy_ = true;
+    if (uv_fs_close(loop_, &req_, fd_, OnClose) == 0)
+      return;
+  }
+  delete this;
+}
+
+void QlogWriter::OnOpen(uv_fs_t* req) {
+  QlogWriter* writer = static_cast<QlogWriter*>(req->data);
+  ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+  writer->busy_ = false;
+  if (result < 0) {
+    writer->failed_ = true;
+    writer->pending_.clear();
+  } else {
+    writer->fd_ = static_cast<uv_file>(result);
+  }
+  if (writer->closing_)
+    return writer->Finish();
+  writer->MaybeWrite();
+}
+
+void QlogWriter::OnWrite(uv_fs_t* req) {
+  QlogWriter* writer = static_cast<QlogWriter*>(req->data);
+  ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+  writer->busy_ = false;
+  if (result <= 0) {
+    writer->failed_ = true;
+    writer->inflight_.clear();
+    writer->pending_.clear();
+  } else {
+    // After a short write, the rest of inflight_ is written by the next
+    // MaybeWrite() at the advanced offset, ahead of anything pending.
+    writer->offset_ += result;
+    writer->written_ += result;
+    if (writer->written_ == writer->inflight_.size())
+      writer->inflight_.clear();
+  }
+  if (writer->closing_)
+    return writer->Finish();
+  writer->MaybeWrite();
+}
+
+void QlogWriter::OnClose(uv_fs_t* req) {
+  QlogWriter* writer = static_cast<QlogWriter*>(req->data);
+  uv_fs_req_cleanup(req);
+  delete writer;
+}
+
+QlogTrace::QlogTrace(
+    bool server,
+    const ngtcp2_cid* odcid,
+    uint64_t start,
+    QlogWriter* writer) :
+    start_(start),
+    writer_(writer) {
+  buffer_.append("\x1e{\"qlog_version\":\"0.3\","
+                 "\"qlog_format\":\"JSON-SEQ\","
+                 "\"title\":\"Node.js QUIC\","
+                 "\"trace\":{\"vantage_point\":{\"name\":\"node\",\"type\":");
+  buffer_.append(server ? "\"server\"" : "\"client\"");
+  buffer_.append("},\"common_fields\":{\"ODCID\":");
+  std::string odcid_hex;
+  if (odcid != nullptr) {
+    odcid_hex = StringBytes::hex_encode(
+        reinterpret_cast<const char*>(odcid->data), odcid->datalen);
+  }
+  AppendJsonString(&buffer_, odcid_hex);
+  buffer_.append(",\"time_format\":\"relative\",\"reference_time\":");
+  AppendMilliseconds(&buffer_, GetCurrentTimeInMicroseconds() / 1e3);
+  buffer_.append("}}}\n");
+}
+
+QlogTrace::~QlogTrace() {
+  Flush();
+  if (writer_ != nullptr)
+    writer_->Close();
+}
+
+void QlogTrace::BeginEvent(uint64_t now, const char* name) {
+  buffer_.append("\x1e{\"time\":");
+  AppendMilliseconds(&buffer_, now > start_ ? now - start_ : 0);
+  buffer_.append(",\"name\":\"");
+  buffer_.append(name);
+  buffer_.append("\",\"data\":{");
+}
+
+void QlogTrace::EndEvent() {
+  buffer_.append("}}\n");
+  MaybeFlush();
+}
+
+void QlogTrace::MaybeFlush() {
+  if (writer_ != nullptr && buffer_.size() >= kQlogFlushThreshold) {
+    writer_->Write(std::move(buffer_));
+    buffer_.clear();
+  }
+}
+
+void QlogTrace::Flush() {
+  EmitPacket();
+  if (writer_ != nullptr && !buffer_.empty()) {
+    writer_->Write(std::move(buffer_));
+    buffer_.clear();
+  }
+}
+
+std::string QlogTrace::Drain() {
+  EmitPacket();
+  std::string ret;
+  ret.swap(buffer_);
+  return ret;
+}
+
+// ngtcp2 logs each packet as a header line and one line per frame (or
+// per ACK block). Received packets are logged header first, sent
+// packets frames first, so lines are collected until one arrives that
+// belongs to a different packet.
+QlogTrace::Packet* QlogTrace::GetPacket(
+    uint64_t now,
+    bool tx,
+    int64_t packet_number) {
+  if (packet_.active &&
+      (packet_.tx != tx || packet_.packet_number != packet_number)) {
+    EmitPacket();
+  }
+  if (!packet_.active) {
+    packet_.active = true;
+    packet_.tx = tx;
+    packet_.packet_number = packet_number;
+    packet_.time = now;
+  }
+  return &packet_;
+}
+
+void QlogTrace::EmitPacket() {
+  if (!packet_.active)
+    return;
+  BeginEvent(
+      packet_.time,
+      packet_.tx ? "transport:packet_sent" : "transport:packet_received");
+  buffer_.append("\"header\":{\"packet_type\":");
+  AppendJsonString(&buffer_, packet_.packet_type);
+  buffer_.append(",\"packet_number\":");
+  buffer_.append(std::to_string(packet_.packet_number));
+  if (!packet_.header.empty()) {
+    buffer_.push_back(',');
+    buffer_.append(packet_.header);
+  }
+  buffer_.append("},\"frames\":[");
+  for (size_t n = 0; n < packet_.frames.size(); n++) {
+    const Frame& frame = packet_.frames[n];
+    if (n > 0)
+      buffer_.push_back(',');
+    buffer_.append("{\"frame_type\":");
+    AppendJsonString(&buffer_, frame.type);
+    if (!frame.fields.empty()) {
+      buffer_.push_back(',');
+      buffer_.append(frame.fields);
+    }
+    if (frame.type == "ack") {
+      buffer_.append(",\"acked_ranges\":[");
+      buffer_.append(frame.acked_ranges);
+      buffer_.push_back(']');
+    }
+    buffer_.push_back('}');
+  }
+  buffer_.push_back(']');
+  packet_ = Packet();
+  EndEvent();
+}
+
+void QlogTrace::OnNgtcp2Log(uint64_t now, const char* line) {
+  // Every line starts with "I<timestamp> 0x<scid> <event> ". The
+  // timestamp has millisecond resolution, so the caller's is used.
+  std::string message(line);
+  while (!message.empty() &&
+         (message.back() == '\n' || message.back() == '\r')) {
+    message.pop_back();
+  }
+  size_t pos = 0;
+  for (int n = 0; n < 2 && pos != std::string::npos; n++) {
+    pos = message.find(' ', pos);
+    if (pos != std::string::npos)
+      pos++;
+  }
+  if (pos == std::string::npos)
+    return Info(now, message.c_str());
+  size_t end = message.find(' ', pos);
+  if (end == std::string::npos)
+    return Info(now, message.c_str() + pos);
+  std::string event = message.substr(pos, end - pos);
+  std::string rest = message.substr(end + 1);
+
+  if (event == "pkt")
+    OnPacketLog(now, rest);
+  else if (event == "frm")
+    OnFrameLog(now, rest);
+  else if (event == "rcv")
+    OnRecoveryLog(now, rest);
+  else
+    Info(now, message.c_str() + pos);
+}
+
+// "rx pkn=1 dcid=0x.. scid=0x.. type=Short(0x40) len=0 k=0"
+void QlogTrace::OnPacketLog(uint64_t now, const std::string& message) {
+  std::vector<std::string> tokens = Split(message);
+  std::string key;
+  std::string value;
+  if (tokens.size() < 2 ||
+      (tokens[0] != "rx" && tokens[0] != "tx") ||
+      !Field(tokens[1], &key, &value) ||
+      key != "pkn" ||
+      !IsInteger(value)) {
+    return Info(now, ("pkt " + message).c_str());
+  }
+
+  Packet* packet = GetPacket(now, tokens[0] == "tx", strtoll(value.c_str(),
+                                                             nullptr, 10));
+  if (packet->has_header) {
+    EmitPacket();
+    packet = GetPacket(now, tokens[0] == "tx", strtoll(value.c_str(),
+                                                       nullptr, 10));
+  }
+  packet->has_header = true;
+  for (size_t n = 2; n < tokens.size(); n++) {
+    if (!Field(tokens[n], &key, &value))
+      continue;
+    if (key == "type") {
+      packet->packet_type = PacketType(value);
+    } else if (key == "dcid" || key == "scid") {
+      AppendField(&packet->header, key, value.substr(value.find('x') + 1));
+    } else if (key == "k") {
+      AppendField(&packet->header, "key_phase", value);
+    } else if (key == "len" && value != "0") {
+      AppendField(&packet->header, "payload_length", value);
+    }
+  }
+}
+
+// "tx 3 Short(0x40) STREAM(0x0e) id=0x0 fin=0 offset=0 len=100 uni=0"
+void QlogTrace::OnFrameLog(uint64_t now, const std::string& message) {
+  std::vector<std::string> tokens = Split(message);
+  if (tokens.size() < 4 ||
+      (tokens[0] != "rx" && tokens[0] != "tx") ||
+      !IsInteger(tokens[1]) ||
+      tokens[3].find('(') == std::string::npos) {
+    return Info(now, ("frm " + message).c_str());
+  }
+
+  Packet* packet =
+      GetPacket(now, tokens[0] == "tx", strtoll(tokens[1].c_str(),
+                                                nullptr, 10));
+  if (packet->packet_type.empty())
+    packet->packet_type = PacketType(tokens[2]);
+
+  std::string type = TypeName(tokens[3]);
+  for (char& c : type)
+    c = tolower(static_cast<unsigned char>(c));
+
+  std::string key;
+  std::string value;
+
+  // Each ACK block is logged on its own line after the ACK frame.
+  if (type == "ack" &&
+      tokens.size() > 4 &&
+      tokens[4].compare(0, 7, "block=[") == 0 &&
+      !packet->frames.empty() &&
+      packet->frames.back().type == "ack") {
+    Frame* frame = &packet->frames.back();
+    int64_t largest = 0;
+    int64_t smallest = 0;
+    if (sscanf(tokens[4].c_str(), "block=[%" SCNd64 "..%" SCNd64 "]",
+               &largest, &smallest) == 2) {
+      if (!frame->acked_ranges.empty())
+        frame->acked_ranges.push_back(',');
+      frame->acked_ranges.append(
+          "[" + std::to_string(smallest) + "," + std::to_string(largest) + "]");
+    }
+    return;
+  }
+
+  Frame frame;
+  frame.type = type;
+  for (size_t n = 4; n < tokens.size(); n++) {
+    if (!Field(tokens[n], &key, &value))
+      continue;
+    if (key == "id") {
+      key = "stream_id";
+      value = std::to_string(strtoull(value.c_str(), nullptr, 16));
+    } else if (key == "len") {
+      key = "length";
+    } else if (key == "fin") {
+      if (!frame.fields.empty())
+        frame.fields.push_back(',');
+      frame.fields.append(value == "1" ? "\"fin\":true" : "\"fin\":false");
+      continue;
+    } else if (key == "ack_delay") {
+      // ack_delay=<milliseconds>(<encoded value>)
+      value = value.substr(0, value.find('('));
+    }
+    AppendField(&frame.fields, key, value);
+  }
+  packet->frames.emplace_back(std::move(frame));
+}
+
+// "pkn=12 lost type=Short(0x40) sent_ts=..." and the congestion
+// controller's "... cwnd=<bytes>" lines.
+void QlogTrace::OnRecoveryLog(uint64_t now, const std::string& message) {
+  std::vector<std::string> tokens = Split(message);
+  std::string key;
+  std::string value;
+
+  if (tokens.size() >= 3 &&
+      tokens[1] == "lost" &&
+      Field(tokens[0], &key, &value) &&
+      key == "pkn" &&
+      IsInteger(value)) {
+    std::string packet_number = value;
+    std::string packet_type = "unknown";
+    if (Field(tokens[2], &key, &value) && key == "type")
+      packet_type = PacketType(value);
+    EmitPacket();
+    BeginEvent(now, "recovery:packet_lost");
+    buffer_.append("\"header\":{\"packet_type\":");
+    AppendJsonString(&buffer_, packet_type);
+    buffer_.append(",\"packet_number\":");
+    buffer_.append(packet_number);
+    buffer_.push_back('}');
+    EndEvent();
+    return;
+  }
+
+  for (const std::string& token : tokens) {
+    if (Field(token, &key, &value) && key == "cwnd" && IsInteger(value)) {
+      uint64_t cwnd = strtoull(value.c_str(), nullptr, 10);
+      if (cwnd == cwnd_)
+        return;
+      cwnd_ = cwnd;
+      EmitPacket();
+      BeginEvent(now, "recovery:metrics_updated");
+      buffer_.append("\"congestion_window\":");
+      buffer_.append(value);
+      EndEvent();
+      return;
+    }
+  }
+
+  Info(now, ("rcv " + message).c_str());
+}
+
+void QlogTrace::MetricsUpdated(
+    uint64_t now,
+    const ngtcp2_rcvry_stat* stat,
+    size_t bytes_in_flight) {
+  // Only record a new RTT sample.
+  if (stat->latest_rtt == 0 || stat->latest_rtt == latest_rtt_)
+    return;
+  latest_rtt_ = stat->latest_rtt;
+  EmitPacket();
+  BeginEvent(now, "recovery:metrics_updated");
+  buffer_.append("\"min_rtt\":");
+  AppendMilliseconds(&buffer_, stat->min_rtt);
+  buffer_.append(",\"smoothed_rtt\":");
+  AppendMilliseconds(&buffer_, stat->smoothed_rtt / 1e6);
+  buffer_.append(",\"latest_rtt\":");
+  AppendMilliseconds(&buffer_, stat->latest_rtt);
+  buffer_.append(",\"rtt_variance\":");
+  AppendMilliseconds(&buffer_, stat->rttvar / 1e6);
+  buffer_.append(",\"bytes_in_flight\":");
+  buffer_.append(std::to_string(bytes_in_flight));
+  EndEvent();
+}
+
+void QlogTrace::KeyUpdated(uint64_t now, bool local) {
+  EmitPacket();
+  BeginEvent(now, "security:key_updated");
+  buffer_.append("\"key_type\":\"1rtt\",\"trigger\":");
+  buffer_.append(local ? "\"local_update\"" : "\"remote_update\"");
+  EndEvent();
+}
+
+void QlogTrace::Info(uint64_t now, const char* message) {
+  EmitPacket();
+  BeginEvent(now, "generic:info");
+  buffer_.append("\"message\":");
+  AppendJsonString(&buffer_, message, strlen(message));
+  EndEvent();
+}
+
+}  // namespace quic
+}  // namespace node
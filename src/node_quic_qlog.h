@@ -0,0 +1,148 @@
+#ifndef SRC_NODE_QUIC_QLOG_H_
+#define SRC_NODE_QUIC_QLOG_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "uv.h"
+
+#include <ngtcp2/ngtcp2.h>
+
+#include <string>
+#include <vector>
+
+namespace node {
+
+namespace quic {
+
+// Buffered events are handed to the QlogWriter once at least this
+// many bytes have accumulated, and when the trace is closed.
+constexpr size_t kQlogFlushThreshold = 16 * 1024;
+
+// If the file system cannot keep up, at most this many bytes are held
+// in memory by a QlogWriter. Anything beyond that is dropped.
+constexpr size_t kQlogMaxPending = 8 * 1024 * 1024;
+
+// A QlogWriter appends data to a file using the libuv threadpool so
+// that the event loop never blocks on disk I/O. At most one file system
+// request is in flight at any time; data written while a request is
+// pending is coalesced into the next write. The QlogWriter deletes
+// itself once Close() has been called and all buffered data has been
+// written, so it may outlive the QuicSession that created it. If the
+// file cannot be opened or written, the remaining data is discarded.
+class QlogWriter {
+ public:
+  static QlogWriter* Open(uv_loop_t* loop, const std::string& path);
+
+  void Write(std::string&& data);
+  void Close();
+
+  size_t dropped() const { return dropped_; }
+
+ private:
+  explicit QlogWriter(uv_loop_t* loop);
+
+  void MaybeWrite();
+  void Finish();
+
+  static void OnOpen(uv_fs_t* req);
+  static void OnWrite(uv_fs_t* req);
+  static void OnClose(uv_fs_t* req);
+
+  uv_loop_t* loop_;
+  uv_fs_t req_;
+  uv_file fd_ = -1;
+  bool busy_ = false;
+  bool closing_ = false;
+  bool failed_ = false;
+  size_t dropped_ = 0;
+  // The file offset at which the next write starts.
+  int64_t offset_ = 0;
+  std::string pending_;
+  // The data being written, of which the first written_ bytes are
+  // already in the file.
+  std::string inflight_;
+  size_t written_ = 0;
+};
+
+// QlogTrace records the events of a single QuicSession as a qlog trace
+// (draft-ietf-quic-qlog-main-schema) using the JSON-SEQ serialization:
+// every record is an RS (0x1e) character followed by a JSON text and a
+// line feed. The first record is the header, every following record is
+// one event with a time relative to the start of the trace in
+// milliseconds. The resulting files can be loaded directly into qvis.
+//
+// Packets, frames, packet loss and congestion window changes are taken
+// from the log output of ngtcp2, which QuicSession only enables while
+// a trace is active. RTT samples and key updates are recorded by the
+// QuicSession itself.
+//
+// QlogTrace only produces text. When constructed with a QlogWriter the
+// buffered records are passed on to it, otherwise they are left in the
+// buffer until Drain() is called.
+class QlogTrace {
+ public:
+  QlogTrace(
+      bool server,
+      const ngtcp2_cid* odcid,
+      uint64_t start,
+      QlogWriter* writer = nullptr);
+  ~QlogTrace();
+
+  // Translates a single line of ngtcp2 log output.
+  void OnNgtcp2Log(uint64_t now, const char* line);
+
+  void MetricsUpdated(
+      uint64_t now,
+      const ngtcp2_rcvry_stat* stat,
+      size_t bytes_in_flight);
+  void KeyUpdated(uint64_t now, bool local);
+  void Info(uint64_t now, const char* message);
+
+  // Completes any packet that is still waiting for frames and passes
+  // the buffered records to the QlogWriter, if there is one.
+  void Flush();
+
+  std::string Drain();
+
+ private:
+  struct Frame {
+    std::string type;
+    std::string fields;
+    std::string acked_ranges;
+  };
+
+  struct Packet {
+    bool active = false;
+    bool tx = false;
+    bool has_header = false;
+    int64_t packet_number = 0;
+    uint64_t time = 0;
+    std::string packet_type;
+    std::string header;
+    std::vector<Frame> frames;
+  };
+
+  void BeginEvent(uint64_t now, const char* name);
+  void EndEvent();
+  void EmitPacket();
+  void MaybeFlush();
+  Packet* GetPacket(uint64_t now, bool tx, int64_t packet_number);
+
+  void OnPacketLog(uint64_t now, const std::string& message);
+  void OnFrameLog(uint64_t now, const std::string& message);
+  void OnRecoveryLog(uint64_t now, const std::string& message);
+
+  uint64_t start_;
+  QlogWriter* writer_;
+  std::string buffer_;
+  Packet packet_;
+  uint64_t cwnd_ = 0;
+  ngtcp2_duration latest_rtt_ = 0;
+};
+
+}  // namespace quic
+}  // namespace node
+
+#endif  // NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_QUIC_QLOG_H_
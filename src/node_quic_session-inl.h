@@ -14,8 +14,6 @@
 
 namespace node {
 
-using crypto::EntropySource;
-
 namespace quic {
 
 inline void SetConfig(Environment* env, int idx, uint64_t* val) {
@@ -35,10 +33,28 @@ inline void DebugLog(void* user_data, const char* fmt, ...) {
   va_end(ap);
 }
 
+// Forwards the ngtcp2 log output to the QuicSession's qlog trace, and
+// to the NGTCP2_DEBUG category if that is also enabled.
+inline void QlogLog(void* user_data, const char* fmt, ...) {
+  QuicSession* session = static_cast<QuicSession*>(user_data);
+  char line[4096];
+  va_list ap;
+  va_start(ap, fmt);
+  int len = vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  if (len <= 0)
+    return;
+  if (NODE_QUIC_DEBUG &&
+      session->env()->debug_enabled(DebugCategory::NGTCP2_DEBUG)) {
+    Debug(session->env(), DebugCategory::NGTCP2_DEBUG, "%s\n", line);
+  }
+  if (session->qlog() != nullptr)
+    session->qlog()->OnNgtcp2Log(uv_hrtime(), line);
+}
+
 inline void QuicSessionConfig::ResetToDefaults() {
   ngtcp2_settings_default(&settings_);
   settings_.initial_ts = uv_hrtime();
-  settings_.log_printf = DebugLog;
   settings_.active_connection_id_limit = DEFAULT_ACTIVE_CONNECTION_ID_LIMIT;
   settings_.max_stream_data_bidi_local = DEFAULT_MAX_STREAM_DATA_BIDI_LOCAL;
   settings_.max_stream_data_bidi_remote = DEFAULT_MAX_STREAM_DATA_BIDI_REMOTE;
@@ -53,6 +69,15 @@ inline void QuicSessionConfig::ResetToDefaults() {
   settings_.preferred_address_present = 0;
   settings_.stateless_reset_token_present = 0;
   max_crypto_buffer_ = DEFAULT_MAX_CRYPTO_BUFFER;
+  max_memory_ = DEFAULT_MAX_SESSION_MEMORY;
+  max_stream_window_ = DEFAULT_MAX_STREAM_WINDOW;
+  max_connection_window_ = DEFAULT_MAX_CONNECTION_WINDOW;
+}
+
+// The qlog trace is built from the ngtcp2 log output. Like the debug
+// output, this is only ever enabled when it is wanted.
+inline void QuicSessionConfig::EnableQlog() {
+  settings_.log_printf = QlogLog;
 }
 
 // Sets the QuicSessionConfig using an AliasedBuffer for efficiency.
@@ -61,6 +86,12 @@ inline void QuicSessionConfig::Set(
     const sockaddr* preferred_addr) {
   ResetToDefaults();
 
+  // ngtcp2 formats its log messages (e.g. hex encoding connection IDs)
+  // whenever a log_printf callback is set, so only set one when the
+  // output is actually wanted.
+  if (NODE_QUIC_DEBUG && env->debug_enabled(DebugCategory::NGTCP2_DEBUG))
+    settings_.log_printf = DebugLog;
+
   SetConfig(env, IDX_QUIC_SESSION_ACTIVE_CONNECTION_ID_LIMIT,
             &settings_.active_connection_id_limit);
   SetConfig(env, IDX_QUIC_SESSION_MAX_STREAM_DATA_BIDI_LOCAL,
@@ -86,6 +117,15 @@ inline void QuicSessionConfig::Set(
             &max_crypto_buffer_);
   max_crypto_buffer_ = std::max(max_crypto_buffer_, MIN_MAX_CRYPTO_BUFFER);
 
+  SetConfig(env, IDX_QUIC_SESSION_MAX_MEMORY, &max_memory_);
+  max_memory_ = std::max(max_memory_, MIN_MAX_SESSION_MEMORY);
+
+  // A maximum below the initial flow control limit disables receive
+  // window auto-tuning.
+  SetConfig(env, IDX_QUIC_SESSION_MAX_STREAM_WINDOW, &max_stream_window_);
+  SetConfig(env, IDX_QUIC_SESSION_MAX_CONNECTION_WINDOW,
+            &max_connection_window_);
+
   if (preferred_addr != nullptr) {
     settings_.preferred_address_present = 1;
     switch (preferred_addr->sa_family) {
@@ -115,24 +155,26 @@ inline void QuicSessionConfig::Set(
   }
 }
 
-inline void QuicSessionConfig::GenerateStatelessResetToken() {
+inline bool QuicSessionConfig::GenerateStatelessResetToken(
+    const std::array<uint8_t, RESET_SECRETLEN>& secret,
+    const ngtcp2_cid* scid) {
   settings_.stateless_reset_token_present = 1;
-  EntropySource(
-      settings_.stateless_reset_token,
-      arraysize(settings_.stateless_reset_token));
+  return GenerateResetToken(settings_.stateless_reset_token, secret, scid);
 }
 
-inline void QuicSessionConfig::GeneratePreferredAddressToken(
+inline bool QuicSessionConfig::GeneratePreferredAddressToken(
+    const std::array<uint8_t, RESET_SECRETLEN>& secret,
     ngtcp2_cid* pscid) {
   if (!settings_.preferred_address_present)
-    return;
-  EntropySource(
-      settings_.preferred_address.stateless_reset_token,
-      arraysize(settings_.preferred_address.stateless_reset_token));
-
+    return true;
   pscid->datalen = NGTCP2_SV_SCIDLEN;
-  EntropySource(pscid->data, pscid->datalen);
+  PooledRandomBytes(pscid->data, pscid->datalen);
   settings_.preferred_address.cid = *pscid;
+
+  return GenerateResetToken(
+      settings_.preferred_address.stateless_reset_token,
+      secret,
+      pscid);
 }
 
 
@@ -148,6 +190,24 @@ inline void QuicSession::DecrementAllocatedSize(size_t size) {
   current_ngtcp2_memory_ -= size;
 }
 
+inline uint64_t QuicSession::GetMemoryUsage() {
+  return current_ngtcp2_memory_ +
+         current_stream_memory_ +
+         peer_handshake_.capacity() +
+         handshake_.Length() +
+         sendbuf_.Length() +
+         txbuf_.Length();
+}
+
+inline void QuicSession::IncrementStreamMemory(size_t amount) {
+  current_stream_memory_ += amount;
+}
+
+inline void QuicSession::DecrementStreamMemory(size_t amount) {
+  CHECK_GE(current_stream_memory_, amount);
+  current_stream_memory_ -= amount;
+}
+
 
 inline void QuicSession::OnIdleTimeout(uv_timer_t* timer) {
   QuicSession* session = static_cast<QuicSession*>(timer->data);
@@ -254,8 +314,7 @@ inline int QuicSession::OnHandshakeCompleted(
     void* user_data) {
   QuicSession* session = static_cast<QuicSession*>(user_data);
   QuicSession::Ngtcp2CallbackScope callback_scope(session);
-  session->HandshakeCompleted();
-  return 0;
+  return session->HandshakeCompleted() ? 0 : NGTCP2_ERR_CALLBACK_FAILURE;
 }
 
 // Called by ngtcp2 when TLS handshake data needs to be
@@ -404,8 +463,8 @@ inline int QuicSession::OnReceiveStreamData(
     void* stream_user_data) {
   QuicSession* session = static_cast<QuicSession*>(user_data);
   QuicSession::Ngtcp2CallbackScope callback_scope(session);
-  session->ReceiveStreamData(stream_id, fin, data, datalen, offset);
-  return 0;
+  return session->ReceiveStreamData(stream_id, fin, data, datalen, offset) ?
+      0 : NGTCP2_ERR_CALLBACK_FAILURE;
 }
 
 // Called by ngtcp2 when a new stream has been opened
@@ -474,8 +533,8 @@ inline int QuicSession::OnStreamClose(
     void* stream_user_data) {
   QuicSession* session = static_cast<QuicSession*>(user_data);
   QuicSession::Ngtcp2CallbackScope callback_scope(session);
-  session->StreamClose(stream_id, app_error_code);
-  return 0;
+  return session->StreamClose(stream_id, app_error_code) ?
+      0 : NGTCP2_ERR_CALLBACK_FAILURE;
 }
 
 inline int QuicSession::OnStreamReset(
@@ -498,7 +557,7 @@ inline int QuicSession::OnRand(
     size_t destlen,
     ngtcp2_rand_ctx ctx,
     void* user_data) {
-  EntropySource(dest, destlen);
+  PooledRandomBytes(dest, destlen);
   return 0;
 }
 
@@ -512,8 +571,7 @@ inline int QuicSession::OnGetNewConnectionID(
     void* user_data) {
   QuicSession* session = static_cast<QuicSession*>(user_data);
   QuicSession::Ngtcp2CallbackScope callback_scope(session);
-  session->GetNewConnectionID(cid, token, cidlen);
-  return 0;
+  return session->GetNewConnectionID(cid, token, cidlen);
 }
 
 // Called by ngtcp2 to trigger a key update for the connection.
@@ -522,6 +580,8 @@ inline int QuicSession::OnUpdateKey(
     void* user_data) {
   QuicSession* session = static_cast<QuicSession*>(user_data);
   QuicSession::Ngtcp2CallbackScope callback_scope(session);
+  if (session->qlog_)
+    session->qlog_->KeyUpdated(uv_hrtime(), false);
   return session->UpdateKey() ? 0 : NGTCP2_ERR_CALLBACK_FAILURE;
 }
 
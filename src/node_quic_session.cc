@@ -7,6 +7,7 @@
 #include "node_crypto.h"
 #include "node_internals.h"
 #include "node_quic_crypto.h"
+#include "node_quic_http3_application.h"
 #include "node_quic_session.h"  // NOLINT(build/include_inline)
 #include "node_quic_session-inl.h"
 #include "node_quic_socket.h"
@@ -25,7 +26,6 @@
 
 namespace node {
 
-using crypto::EntropySource;
 using crypto::SecureContext;
 
 using v8::Array;
@@ -132,35 +132,38 @@ QuicSession::~QuicSession() {
   uint64_t handshake_length = handshake_.Cancel();
   uint64_t txbuf_length = txbuf_.Cancel();
 
+  // The application state may refer to the ngtcp2_conn, so it has
+  // to be released first.
+  application_.reset();
   ssl_.reset();
   connection_.reset();
 
-  Debug(this,
-        "Destroyed.\n"
-        "  Duration: %" PRIu64 "\n"
-        "  Handshake Started: %" PRIu64 "\n"
-        "  Handshake Completed: %" PRIu64 "\n"
-        "  Bytes Received: %" PRIu64 "\n"
-        "  Bytes Sent: %" PRIu64 "\n"
-        "  Bidi Stream Count: %" PRIu64 "\n"
-        "  Uni Stream Count: %" PRIu64 "\n"
-        "  Streams In Count: %" PRIu64 "\n"
-        "  Streams Out Count: %" PRIu64 "\n"
-        "  Remaining sendbuf_: %" PRIu64 "\n"
-        "  Remaining handshake_: %" PRIu64 "\n"
-        "  Remaining txbuf_: %" PRIu64 "\n",
-        uv_hrtime() - session_stats_.created_at,
-        session_stats_.handshake_start_at,
-        session_stats_.handshake_completed_at,
-        session_stats_.bytes_received,
-        session_stats_.bytes_sent,
-        session_stats_.bidi_stream_count,
-        session_stats_.uni_stream_count,
-        session_stats_.streams_in_count,
-        session_stats_.streams_out_count,
-        sendbuf_length,
-        handshake_length,
-        txbuf_length);
+  QUIC_DEBUG(this,
+             "Destroyed.\n"
+             "  Duration: %" PRIu64 "\n"
+             "  Handshake Started: %" PRIu64 "\n"
+             "  Handshake Completed: %" PRIu64 "\n"
+             "  Bytes Received: %" PRIu64 "\n"
+             "  Bytes Sent: %" PRIu64 "\n"
+             "  Bidi Stream Count: %" PRIu64 "\n"
+             "  Uni Stream Count: %" PRIu64 "\n"
+             "  Streams In Count: %" PRIu64 "\n"
+             "  Streams Out Count: %" PRIu64 "\n"
+             "  Remaining sendbuf_: %" PRIu64 "\n"
+             "  Remaining handshake_: %" PRIu64 "\n"
+             "  Remaining txbuf_: %" PRIu64 "\n",
+             uv_hrtime() - session_stats_.created_at,
+             session_stats_.handshake_start_at,
+             session_stats_.handshake_completed_at,
+             session_stats_.bytes_received,
+             session_stats_.bytes_sent,
+             session_stats_.bidi_stream_count,
+             session_stats_.uni_stream_count,
+             session_stats_.streams_in_count,
+             session_stats_.streams_out_count,
+             sendbuf_length,
+             handshake_length,
+             txbuf_length);
 }
 
 std::string QuicSession::diagnostic_name() const {
@@ -175,7 +178,7 @@ void QuicSession::AckedCryptoOffset(size_t datalen) {
   // is nothing to do but wait for further cleanup to happen.
   if (UNLIKELY(IsFlagSet(QUICSESSION_FLAG_DESTROYED)))
     return;
-  Debug(this, "Acknowledging %d crypto bytes", datalen);
+  QUIC_DEBUG(this, "Acknowledging %d crypto bytes", datalen);
 
   // Consumes (frees) the given number of bytes in the handshake buffer.
   handshake_.Consume(datalen);
@@ -201,10 +204,18 @@ void QuicSession::AckedStreamDataOffset(
   // is nothing to do but wait for further cleanup to happen.
   if (UNLIKELY(IsFlagSet(QUICSESSION_FLAG_DESTROYED)))
     return;
-  Debug(this,
-        "Received acknowledgement for %" PRIu64
-        " bytes of stream %" PRId64 " data",
-        datalen, stream_id);
+  QUIC_DEBUG(this,
+             "Received acknowledgement for %" PRIu64
+             " bytes of stream %" PRId64 " data",
+             datalen, stream_id);
+
+  // The acknowledged data includes the framing of the application,
+  // so the application determines how much of the stream data has
+  // actually been acknowledged.
+  if (application_) {
+    application_->AcknowledgeStreamData(stream_id, offset, datalen);
+    return;
+  }
 
   QuicStream* stream = FindStream(stream_id);
   // It is possible that the QuicStream has already been destroyed and
@@ -218,7 +229,7 @@ void QuicSession::AckedStreamDataOffset(
 // streams added must be removed before the QuicSession instance is freed.
 void QuicSession::AddStream(QuicStream* stream) {
   DCHECK(!IsFlagSet(QUICSESSION_FLAG_GRACEFUL_CLOSING));
-  Debug(this, "Adding stream %" PRId64 " to session.", stream->GetID());
+  QUIC_DEBUG(this, "Adding stream %" PRId64 " to session.", stream->GetID());
   streams_.emplace(stream->GetID(), stream);
 
   // Update tracking statistics for the number of streams associated with
@@ -236,7 +247,6 @@ void QuicSession::AddStream(QuicStream* stream) {
       else
         IncrementStat(1, &session_stats_, &session_stats::streams_in_count);
   }
-  IncrementStat(1, &session_stats_, &session_stats::streams_out_count);
   switch (stream->GetDirection()) {
     case QuicStream::QuicStreamDirection::QUIC_STREAM_BIRECTIONAL:
       IncrementStat(1, &session_stats_, &session_stats::bidi_stream_count);
@@ -271,9 +281,9 @@ void QuicSession::ImmediateClose() {
   SetFlag(QUICSESSION_FLAG_CLOSING);
 
   QuicError last_error = GetLastError();
-  Debug(this, "Immediate close with code %" PRIu64 " (%s)",
-        last_error.code,
-        ErrorFamilyName(last_error.family));
+  QUIC_DEBUG(this, "Immediate close with code %" PRIu64 " (%s)",
+             last_error.code,
+             ErrorFamilyName(last_error.family));
 
   HandleScope scope(env()->isolate());
   Context::Scope context_scope(env()->context());
@@ -316,7 +326,7 @@ QuicStream* QuicSession::CreateStream(int64_t stream_id) {
 void QuicSession::Destroy() {
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
     return;
-  Debug(this, "Destroying");
+  QUIC_DEBUG(this, "Destroying");
 
   // If we're not in the closing or draining periods,
   // then we should at least attempt to send a connection
@@ -329,7 +339,7 @@ void QuicSession::Destroy() {
   if (!Ngtcp2CallbackScope::InNgtcp2CallbackScope(this) &&
       !IsInClosingPeriod() &&
       !IsInDrainingPeriod()) {
-    Debug(this, "Making attempt to send a connection close");
+    QUIC_DEBUG(this, "Making attempt to send a connection close");
     SetLastError(QUIC_ERROR_SESSION, NGTCP2_NO_ERROR);
     SendConnectionClose();
   }
@@ -346,6 +356,16 @@ void QuicSession::Destroy() {
   StopIdleTimer();
   StopRetransmitTimer();
 
+  // Completes the qlog trace. The remaining output is written and the
+  // file closed in the background.
+  qlog_.reset();
+
+  EmitStatistics();
+
+  // The memory still held by the QuicSession is released along with
+  // it and no longer counts against the QuicSocket's ceiling.
+  socket_->UpdateSessionMemory(session_stats_.memory, 0);
+
   // The QuicSession instances are kept alive using
   // std::shared_ptr. The only persistent shared_ptr
   // is the map in the associated QuicSocket. Removing
@@ -501,29 +521,39 @@ ssize_t QuicSession::DoInHPMask(
 }
 
 void QuicSession::ExtendMaxStreamData(int64_t stream_id, uint64_t max_data) {
-  Debug(this,
-        "Extending max stream %" PRId64 " data to %" PRIu64,
-        stream_id, max_data);
+  QUIC_DEBUG(this,
+             "Extending max stream %" PRId64 " data to %" PRIu64,
+             stream_id, max_data);
+  if (application_)
+    application_->ExtendMaxStreamData(stream_id, max_data);
 }
 
 void QuicSession::ExtendMaxStreamsUni(uint64_t max_streams) {
-  Debug(this, "Setting max unidirectional streams to %" PRIu64, max_streams);
+  QUIC_DEBUG(this,
+             "Setting max unidirectional streams to %" PRIu64,
+             max_streams);
   state_[IDX_QUIC_SESSION_STATE_MAX_STREAMS_UNI] =
       static_cast<double>(max_streams);
 }
 
 void QuicSession::ExtendMaxStreamsBidi(uint64_t max_streams) {
-  Debug(this, "Setting max bidirectional streams to %" PRIu64, max_streams);
+  QUIC_DEBUG(this,
+             "Setting max bidirectional streams to %" PRIu64,
+             max_streams);
   state_[IDX_QUIC_SESSION_STATE_MAX_STREAMS_BIDI] =
       static_cast<double>(max_streams);
 }
 
 void QuicSession::ExtendStreamOffset(QuicStream* stream, size_t amount) {
-  Debug(this, "Extending max stream %" PRId64 " offset by %d bytes",
-        stream->GetID(), amount);
+  ExtendStreamOffset(stream->GetID(), amount);
+}
+
+void QuicSession::ExtendStreamOffset(int64_t stream_id, size_t amount) {
+  QUIC_DEBUG(this, "Extending max stream %" PRId64 " offset by %d bytes",
+             stream_id, amount);
   ngtcp2_conn_extend_max_stream_offset(
       Connection(),
-      stream->GetID(),
+      stream_id,
       amount);
 }
 
@@ -541,7 +571,9 @@ uint32_t QuicSession::GetNegotiatedVersion() {
 
 // Generates and associates a new connection ID for this QuicSession.
 // ngtcp2 will call this multiple times at the start of a new connection
-// in order to build a pool of available CIDs.
+// in order to build a pool of available CIDs. The stateless reset token
+// is derived from the CID so that the QuicSocket does not need to keep
+// track of it.
 int QuicSession::GetNewConnectionID(
     ngtcp2_cid* cid,
     uint8_t* token,
@@ -551,8 +583,9 @@ int QuicSession::GetNewConnectionID(
   // cidlen shouldn't ever be zero here but just in case that
   // behavior changes in ngtcp2 in the future...
   if (cidlen > 0)
-    EntropySource(cid->data, cidlen);
-  EntropySource(token, NGTCP2_STATELESS_RESET_TOKENLEN);
+    PooledRandomBytes(cid->data, cidlen);
+  if (!GenerateResetToken(token, Socket()->GetResetSecret(), cid))
+    return NGTCP2_ERR_CALLBACK_FAILURE;
   AssociateCID(cid);
   return 0;
 }
@@ -566,12 +599,21 @@ void QuicSession::HandleError() {
 }
 
 // The HandshakeCompleted function is called by ngtcp2 once it
-// determines that the TLS Handshake is done. The only thing we
-// need to do at this point is let the javascript side know.
-void QuicSession::HandshakeCompleted() {
+// determines that the TLS Handshake is done. At this point the
+// application protocol, if any, is started and the javascript
+// side is notified.
+bool QuicSession::HandshakeCompleted() {
   session_stats_.handshake_completed_at = uv_hrtime();
+  socket_->RecordHandshakeDuration(
+      session_stats_.handshake_completed_at - session_stats_.created_at);
 
   SetLocalCryptoLevel(NGTCP2_CRYPTO_LEVEL_APP);
+
+  // The application is started before the javascript side is notified
+  // so that headers may be submitted as soon as the session is secure.
+  if (!StartApplication())
+    return false;
+
   HandleScope scope(env()->isolate());
   Context::Scope context_scope(env()->context());
 
@@ -615,13 +657,16 @@ void QuicSession::HandshakeCompleted() {
   MakeCallback(env()->quic_on_session_handshake_function(),
                arraysize(argv),
                argv);
+  return true;
 }
 
 bool QuicSession::InitiateUpdateKey() {
   DCHECK(!IsFlagSet(QUICSESSION_FLAG_DESTROYED));
   DCHECK(!IsFlagSet(QUICSESSION_FLAG_CLOSING));
   DCHECK(!IsFlagSet(QUICSESSION_FLAG_KEYUPDATE));
-  Debug(this, "Initiating a key update");
+  QUIC_DEBUG(this, "Initiating a key update");
+  if (qlog_)
+    qlog_->KeyUpdated(uv_hrtime(), true);
   return UpdateKey() && ngtcp2_conn_initiate_key_update(Connection()) == 0;
   // TODO(@jasnell): If we're not within a ngtcp2 callback when this is
   // called, we likely need to manually trigger a send operation. Need
@@ -632,7 +677,7 @@ bool QuicSession::InitiateUpdateKey() {
 // is called exactly once during the construction and
 // initialization of the QuicSession
 void QuicSession::InitTLS() {
-  Debug(this, "Initializing TLS.");
+  QUIC_DEBUG(this, "Initializing TLS.");
   BIO* bio = BIO_new(CreateBIOMethod());
   BIO_set_data(bio, this);
   SSL_set_bio(ssl(), bio, bio);
@@ -665,6 +710,13 @@ void QuicSession::Keylog(const char* line) {
   if (LIKELY(state_[IDX_QUIC_SESSION_STATE_KEYLOG_ENABLED] == 0))
     return;
 
+  // JavaScript cannot be entered from the stack of an OpenSSL async job,
+  // so hold on to the line until the handshake step has yielded.
+  if (ASYNC_get_current_job() != nullptr) {
+    keylog_backlog_.emplace_back(line);
+    return;
+  }
+
   HandleScope handle_scope(env()->isolate());
   Context::Scope context_scope(env()->context());
   const size_t size = strlen(line);
@@ -684,7 +736,7 @@ void QuicSession::Keylog(const char* line) {
 void QuicSession::OnIdleTimeout() {
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
     return;
-  Debug(this, "Idle timeout");
+  QUIC_DEBUG(this, "Idle timeout");
   return SilentClose();
 }
 
@@ -781,22 +833,26 @@ void QuicSession::MaybeTimeout() {
   uint64_t now = uv_hrtime();
   bool transmit = false;
   if (ngtcp2_conn_loss_detection_expiry(Connection()) <= now) {
-    Debug(this, "Retransmitting due to loss detection");
+    QUIC_DEBUG(this, "Retransmitting due to loss detection");
     CHECK_EQ(ngtcp2_conn_on_loss_detection_timer(Connection(), now), 0);
     IncrementStat(
         1, &session_stats_,
         &session_stats::loss_retransmit_count);
     transmit = true;
   } else if (ngtcp2_conn_ack_delay_expiry(Connection()) <= now) {
-    Debug(this, "Retransmitting due to ack delay");
+    QUIC_DEBUG(this, "Retransmitting due to ack delay");
     ngtcp2_conn_cancel_expired_ack_delay_timer(Connection(), now);
     IncrementStat(
         1, &session_stats_,
         &session_stats::ack_delay_retransmit_count);
     transmit = true;
   }
+  // The timer may fire before ngtcp2's expiry, as libuv measures it from
+  // the cached loop time. It is then scheduled again.
   if (transmit)
     SendPendingData();
+  else
+    ScheduleRetransmit();
 }
 
 bool QuicSession::OpenBidirectionalStream(int64_t* stream_id) {
@@ -820,8 +876,9 @@ void QuicSession::PathValidation(
     const ngtcp2_path* path,
     ngtcp2_path_validation_result res) {
   if (res == NGTCP2_PATH_VALIDATION_RESULT_SUCCESS) {
-    Debug(this,
-          "Path validation succeeded. Updating local and remote addresses");
+    QUIC_DEBUG(
+        this,
+        "Path validation succeeded. Updating local and remote addresses");
     SetLocalAddress(&path->local);
     remote_address_.Update(&path->remote);
     IncrementStat(
@@ -895,11 +952,11 @@ bool QuicSession::Receive(
     const struct sockaddr* addr,
     unsigned int flags) {
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED)) {
-    Debug(this, "Ignoring packet because session is destroyed");
+    QUIC_DEBUG(this, "Ignoring packet because session is destroyed");
     return false;
   }
 
-  Debug(this, "Receiving QUIC packet.");
+  QUIC_DEBUG(this, "Receiving QUIC packet.");
   IncrementStat(nread, &session_stats_, &session_stats::bytes_received);
 
   // Closing period starts once ngtcp2 has detected that the session
@@ -912,13 +969,13 @@ bool QuicSession::Receive(
   // at this point is either ignore the packet or send another
   // CONNECTION_CLOSE.
   if (IsInClosingPeriod()) {
-    Debug(this, "QUIC packet received while in closing period.");
+    QUIC_DEBUG(this, "QUIC packet received while in closing period.");
     IncrementConnectionCloseAttempts();
     if (!ShouldAttemptConnectionClose()) {
-      Debug(this, "Not sending connection close");
+      QUIC_DEBUG(this, "Not sending connection close");
       return false;
     }
-    Debug(this, "Sending connection close");
+    QUIC_DEBUG(this, "Sending connection close");
     return SendConnectionClose();
   }
 
@@ -928,7 +985,7 @@ bool QuicSession::Receive(
   // the packet was correctly processed, even tho it is being
   // ignored.
   if (IsInDrainingPeriod()) {
-    Debug(this, "QUIC packet received while in draining period.");
+    QUIC_DEBUG(this, "QUIC packet received while in draining period.");
     return true;
   }
 
@@ -943,13 +1000,14 @@ bool QuicSession::Receive(
     // and HandleScope are both exited before continuing on with the
     // function. This allows any nextTicks and queued tasks to be processed
     // before we continue.
-    Debug(this, "Processing received packet");
+    QUIC_DEBUG(this, "Processing received packet");
     HandleScope handle_scope(env()->isolate());
     InternalCallbackScope callback_scope(this);
     if (!ReceivePacket(&path, data, nread)) {
       if (initial_connection_close_ == NGTCP2_NO_ERROR) {
-        Debug(this, "Failure processing received packet (code %" PRIu64 ")",
-              GetLastError().code);
+        QUIC_DEBUG(this,
+                   "Failure processing received packet (code %" PRIu64 ")",
+                   GetLastError().code);
         HandleError();
         return false;
       } else {
@@ -957,8 +1015,8 @@ bool QuicSession::Receive(
         // NGTCP2_NO_ERROR, then the QuicSession is going to be
         // immediately responded to with a CONNECTION_CLOSE and
         // no additional processing will be performed.
-        Debug(this, "Initial connection close with code %" PRIu64,
-              initial_connection_close_);
+        QUIC_DEBUG(this, "Initial connection close with code %" PRIu64,
+                   initial_connection_close_);
         SetLastError(QUIC_ERROR_SESSION, initial_connection_close_);
         SendConnectionClose();
         return true;
@@ -967,12 +1025,13 @@ bool QuicSession::Receive(
   }
 
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED)) {
-    Debug(this, "Session was destroyed while processing the received packet");
+    QUIC_DEBUG(this,
+               "Session was destroyed while processing the received packet");
     // If the QuicSession has been destroyed but it is not
     // in the closing period, a CONNECTION_CLOSE has not yet
     // been sent to the peer. Let's attempt to send one.
     if (!IsInClosingPeriod() && !IsInDrainingPeriod()) {
-      Debug(this, "Attempting to send connection close");
+      QUIC_DEBUG(this, "Attempting to send connection close");
       SetLastError(QUIC_ERROR_SESSION, NGTCP2_NO_ERROR);
       SendConnectionClose();
     }
@@ -983,20 +1042,31 @@ bool QuicSession::Receive(
   // We enter the draining period when a CONNECTION_CLOSE has been
   // received from the remote peer.
   if (IsInDrainingPeriod()) {
-    Debug(this, "In draining period after processing packet");
+    QUIC_DEBUG(this, "In draining period after processing packet");
     // If processing the packet puts us into draining period, there's
     // absolutely nothing left for us to do except silently close
     // and destroy this QuicSession.
     SilentClose();
     return true;
-  } else {
-    Debug(this, "Sending pending data after processing packet");
-    SendPendingData();
   }
 
+  if (!UpdateMemoryUsage() && !IsFlagSet(QUICSESSION_FLAG_CLOSING)) {
+    QUIC_DEBUG(this, "Memory limit exceeded");
+    SetLastError(
+        QUIC_ERROR_SESSION,
+        static_cast<uint64_t>(NGTCP2_INTERNAL_ERROR));
+    ImmediateClose();
+    return true;
+  }
+
+  QUIC_DEBUG(this, "Sending pending data after processing packet");
+  SendPendingData();
+  if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
+    return true;
+
   UpdateIdleTimer();
   UpdateRecoveryStats();
-  Debug(this, "Successfully processed received packet");
+  QUIC_DEBUG(this, "Successfully processed received packet");
   return true;
 }
 
@@ -1010,7 +1080,7 @@ int QuicSession::ReceiveCryptoData(
     size_t datalen) {
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
     return NGTCP2_ERR_CALLBACK_FAILURE;
-  Debug(this, "Receiving %d bytes of crypto data.", datalen);
+  QUIC_DEBUG(this, "Receiving %d bytes of crypto data.", datalen);
 
   int err = WritePeerHandshake(crypto_level, data, datalen);
   if (err < 0)
@@ -1033,7 +1103,7 @@ int QuicSession::ReceiveCryptoData(
 bool QuicSession::ReceiveClientInitial(const ngtcp2_cid* dcid) {
   if (UNLIKELY(IsFlagSet(QUICSESSION_FLAG_DESTROYED)))
     return false;
-  Debug(this, "Receiving client initial parameters.");
+  QUIC_DEBUG(this, "Receiving client initial parameters.");
   return DeriveAndInstallInitialKey(
     Connection(),
     dcid,
@@ -1060,6 +1130,12 @@ bool QuicSession::ReceivePacket(
       case NGTCP2_ERR_DRAINING:
       case NGTCP2_ERR_RECV_VERSION_NEGOTIATION:
         break;
+      case NGTCP2_ERR_CALLBACK_FAILURE:
+        // When the QuicApplication rejects the received data, it sets
+        // the application error the QuicSession is to be closed with.
+        if (GetLastError().family != QUIC_ERROR_APPLICATION)
+          SetLastError(QUIC_ERROR_SESSION, err);
+        return false;
       default:
         SetLastError(QUIC_ERROR_SESSION, err);
         return false;
@@ -1069,9 +1145,11 @@ bool QuicSession::ReceivePacket(
 }
 
 // Called by ngtcp2 when a chunk of stream data has been received. If
-// the stream does not yet exist, it is created, then the data is
-// forwarded on.
-void QuicSession::ReceiveStreamData(
+// the QuicSession uses an application protocol, the data is passed on
+// to the QuicApplication. Otherwise, if the stream does not yet exist,
+// it is created, then the data is forwarded on. Returns false if the
+// data could not be processed and the QuicSession must be closed.
+bool QuicSession::ReceiveStreamData(
     int64_t stream_id,
     int fin,
     const uint8_t* data,
@@ -1083,27 +1161,44 @@ void QuicSession::ReceiveStreamData(
   // let's double check and simply ignore such packets
   // so we do not commit any resources.
   if (UNLIKELY(fin == 0 && datalen == 0))
-    return;
+    return true;
 
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
-    return;
+    return true;
 
   OnScopeLeave leave([&]() {
     // This extends the flow control window for the entire session
     // but not for the individual Stream. Stream flow control is
     // only expanded as data is read on the JavaScript side.
-    ngtcp2_conn_extend_max_offset(Connection(), datalen);
+    if (IsMemoryConstrained())
+      withheld_offset_ += datalen;
+    else
+      ExtendMaxOffset(datalen, GetSmoothedRTT());
   });
 
   HandleScope scope(env()->isolate());
   Context::Scope context_scope(env()->context());
 
+  // A server may receive stream data in 0RTT packets, before the
+  // handshake has completed, so the application is started on demand.
+  if (Side() == NGTCP2_CRYPTO_SIDE_SERVER && !StartApplication())
+    return false;
+
+  if (application_) {
+    return application_->ReceiveStreamData(
+        stream_id,
+        fin,
+        data,
+        datalen,
+        offset);
+  }
+
   QuicStream* stream = FindStream(stream_id);
   if (stream == nullptr) {
     // Shutdown the stream explicitly if the session is being closed.
     if (IsFlagSet(QUICSESSION_FLAG_GRACEFUL_CLOSING)) {
       ngtcp2_conn_shutdown_stream(Connection(), stream_id, NGTCP2_ERR_CLOSING);
-      return;
+      return true;
     }
 
     // One potential DOS attack vector is to send a bunch of
@@ -1112,12 +1207,13 @@ void QuicSession::ReceiveStreamData(
     // if the datalen is greater than 0, otherwise, we ignore
     // the packet.
     if (datalen == 0)
-      return;
+      return true;
 
     stream = CreateStream(stream_id);
   }
   CHECK_NOT_NULL(stream);
   stream->ReceiveData(fin, data, datalen, offset);
+  return true;
 }
 
 // Removes the given connection id from the QuicSession.
@@ -1141,16 +1237,22 @@ void QuicSession::RemoveFromSocket() {
     socket_->DisassociateCID(&id);
   }
 
-  Debug(this, "Removed from the QuicSocket.");
+  QUIC_DEBUG(this, "Removed from the QuicSocket.");
   QuicCID scid(scid_);
-  socket_->RemoveSession(&scid, **GetRemoteAddress());
+  socket_->RemoveSession(&scid, source_prefix_);
   socket_ = nullptr;
 }
 
 // Removes the given stream from the QuicSession. All streams must
 // be removed before the QuicSession is destroyed.
 void QuicSession::RemoveStream(int64_t stream_id) {
-  Debug(this, "Removing stream %" PRId64, stream_id);
+  QUIC_DEBUG(this, "Removing stream %" PRId64, stream_id);
+
+  // The application may still hold references to the outbound data
+  // of the stream, so its state for the stream is discarded first.
+  // The stream may already have been closed by the application.
+  if (application_)
+    application_->StreamClose(stream_id, NGTCP2_APP_NOERROR);
 
   // This will have the side effect of destroying the QuicStream
   // instance.
@@ -1164,12 +1266,19 @@ void QuicSession::RemoveStream(int64_t stream_id) {
   ngtcp2_conn_shutdown_stream(Connection(), stream_id, NGTCP2_NO_ERROR);
 }
 
+void QuicSession::ResumeStream(int64_t stream_id) {
+  if (application_)
+    application_->ResumeStream(stream_id);
+}
+
 // Schedule the retransmission timer
 void QuicSession::ScheduleRetransmit() {
   uint64_t now = uv_hrtime();
   uint64_t expiry = ngtcp2_conn_get_expiry(Connection());
-  uint64_t interval = (expiry < now) ? 1 : ((expiry - now) / 1000000UL);
-  Debug(this, "Scheduling the retransmit timer for %" PRIu64, interval);
+  // Rounded up, so that the timer does not fire before the expiry.
+  uint64_t interval =
+      (expiry < now) ? 1 : ((expiry - now + 999999UL) / 1000000UL);
+  QUIC_DEBUG(this, "Scheduling the retransmit timer for %" PRIu64, interval);
   UpdateRetransmitTimer(interval);
 }
 
@@ -1185,6 +1294,13 @@ bool QuicSession::SendStreamData(QuicStream* stream) {
   // an ngtcp2 callback function.
   CHECK(!Ngtcp2CallbackScope::InNgtcp2CallbackScope(this));
 
+  // The QuicApplication, if any, frames the stream data itself and
+  // serializes it together with the data of the other streams.
+  if (application_) {
+    SendPendingData();
+    return true;
+  }
+
   // No stream data may be serialized and sent if:
   //   - the QuicSession is destroyed
   //   - the QuicStream was never writable,
@@ -1209,9 +1325,9 @@ bool QuicSession::SendStreamData(QuicStream* stream) {
   // remaining is the total number of bytes stored in the vector
   // that are remaining to be serialized.
   size_t remaining = stream->DrainInto(&vec);
-  Debug(stream, "Sending %d bytes of stream data. Still writable? %s",
-        remaining,
-        stream->IsWritable()?"yes":"no");
+  QUIC_DEBUG(stream, "Sending %d bytes of stream data. Still writable? %s",
+             remaining,
+             stream->IsWritable()?"yes":"no");
 
   // c and v are used to track the current serialization position
   // for each iteration of the for(;;) loop below.
@@ -1221,12 +1337,15 @@ bool QuicSession::SendStreamData(QuicStream* stream) {
   // If there is no stream data and we're not sending fin,
   // Just return without doing anything.
   if (c == 0 && stream->IsWritable()) {
-    Debug(stream, "There is no stream data to send");
+    QUIC_DEBUG(stream, "There is no stream data to send");
+    stream->WantsWrite();
     return true;
   }
 
   for (;;) {
-    Debug(stream, "Starting packet serialization. Remaining? %d", remaining);
+    QUIC_DEBUG(stream,
+               "Starting packet serialization. Remaining? %d",
+               remaining);
     MallocedBuffer<uint8_t> dest(max_pktlen_);
     ssize_t nwrite =
         ngtcp2_conn_writev_stream(
@@ -1248,7 +1367,7 @@ bool QuicSession::SendStreamData(QuicStream* stream) {
           // If zero is returned, we've hit congestion limits. We need to stop
           // serializing data and try again later to empty the queue once the
           // congestion window has expanded.
-          Debug(stream, "Congestion limit reached");
+          QUIC_DEBUG(stream, "Congestion limit reached");
           return true;
         case NGTCP2_ERR_PKT_NUM_EXHAUSTED:
           // There is a finite number of packets that can be sent
@@ -1261,19 +1380,19 @@ bool QuicSession::SendStreamData(QuicStream* stream) {
           SilentClose();
           return false;
         case NGTCP2_ERR_STREAM_DATA_BLOCKED:
-          Debug(stream, "Stream data blocked");
+          QUIC_DEBUG(stream, "Stream data blocked");
           return true;
         case NGTCP2_ERR_EARLY_DATA_REJECTED:
-          Debug(stream, "Early data rejected");
+          QUIC_DEBUG(stream, "Early data rejected");
           return true;
         case NGTCP2_ERR_STREAM_SHUT_WR:
-          Debug(stream, "Stream writable side is closed");
+          QUIC_DEBUG(stream, "Stream writable side is closed");
           return true;
         case NGTCP2_ERR_STREAM_NOT_FOUND:
-          Debug(stream, "Stream does not exist");
+          QUIC_DEBUG(stream, "Stream does not exist");
           return true;
         default:
-          Debug(stream, "Error writing packet. Code %" PRIu64, nwrite);
+          QUIC_DEBUG(stream, "Error writing packet. Code %" PRIu64, nwrite);
           SetLastError(QUIC_ERROR_SESSION, static_cast<int>(nwrite));
           return false;
       }
@@ -1281,15 +1400,18 @@ bool QuicSession::SendStreamData(QuicStream* stream) {
 
     if (ndatalen > 0) {
       remaining -= ndatalen;
-      Debug(stream,
-            "%" PRIu64 " stream bytes serialized into packet. %d remaining",
-            ndatalen,
-            remaining);
+      QUIC_DEBUG(
+          stream,
+          "%" PRIu64 " stream bytes serialized into packet. %d remaining",
+                 ndatalen,
+                 remaining);
       Consume(&v, &c, ndatalen);
       stream->Commit(ndatalen);
     }
 
-    Debug(stream, "Sending %" PRIu64 " bytes in serialized packet", nwrite);
+    QUIC_DEBUG(stream,
+               "Sending %" PRIu64 " bytes in serialized packet",
+               nwrite);
     dest.Realloc(nwrite);
     sendbuf_.Push(std::move(dest));
     remote_address_.Update(&path.path.remote);
@@ -1301,8 +1423,12 @@ bool QuicSession::SendStreamData(QuicStream* stream) {
       // fin will have been set if all of the data has been
       // encoded in the packet and IsWritable() returns false.
       if (!stream->IsWritable()) {
-        Debug(stream, "Final stream has been sent");
+        QUIC_DEBUG(stream, "Final stream has been sent");
         stream->SetFinSent();
+      } else {
+        // Everything queued so far has been serialized, so ask a
+        // StreamPipe source, if any, to read ahead the next chunk.
+        stream->WantsWrite();
       }
       break;
     }
@@ -1326,7 +1452,9 @@ bool QuicSession::SendPacket(const char* diagnostic_label) {
   // There's nothing to send, so let's not try
   if (txbuf_.Length() == 0)
     return true;
-  Debug(this, "There are %" PRIu64 " bytes in txbuf_ to send", txbuf_.Length());
+  QUIC_DEBUG(this,
+             "There are %" PRIu64 " bytes in txbuf_ to send",
+             txbuf_.Length());
   session_stats_.session_sent_at = uv_hrtime();
   ScheduleRetransmit();
   int err = Socket()->SendPacket(
@@ -1355,27 +1483,50 @@ void QuicSession::SendPendingData() {
     return;
   }
 
+  // The javascript side is notified of events raised while packets are
+  // serialized (such as the handshake completing) on the next tick. The
+  // scope holds those ticks until the packets have been sent so that a
+  // listener may close or destroy the QuicSession outside of the ngtcp2
+  // callbacks, where the final handshake packet and a CONNECTION_CLOSE
+  // can still be sent to the peer.
+  std::shared_ptr<QuicSession> ptr(this->shared_from_this());
+  HandleScope handle_scope(env()->isolate());
+  InternalCallbackScope callback_scope(this);
+
   // If there's anything currently in the sendbuf_, send it before
   // serializing anything else.
   if (!SendPacket("pending session data"))
     return HandleError();
 
-  // Try purging any pending stream data
-  // TODO(@jasnell): Right now this iterates through the streams
-  // in the order they were created. Later, we'll want to implement
-  // a prioritization scheme to allow higher priority streams to
-  // be serialized first.
-  for (const auto& stream : streams_) {
-    if (!SendStreamData(stream.second.get()))
+  if (application_) {
+    // The QuicApplication determines the order in which the pending
+    // stream data is serialized.
+    if (!application_->SendPendingData())
       return HandleError();
 
-    // Check to make sure QuicSession state did not change in this
-    // iteration
     if (IsInDrainingPeriod() ||
         IsInClosingPeriod() ||
         IsFlagSet(QUICSESSION_FLAG_DESTROYED)) {
       return;
     }
+  } else {
+    // Try purging any pending stream data
+    // TODO(@jasnell): Right now this iterates through the streams
+    // in the order they were created. Later, we'll want to implement
+    // a prioritization scheme to allow higher priority streams to
+    // be serialized first.
+    for (const auto& stream : streams_) {
+      if (!SendStreamData(stream.second.get()))
+        return HandleError();
+
+      // Check to make sure QuicSession state did not change in this
+      // iteration
+      if (IsInDrainingPeriod() ||
+          IsInClosingPeriod() ||
+          IsFlagSet(QUICSESSION_FLAG_DESTROYED)) {
+        return;
+      }
+    }
   }
 
   // Otherwise, serialize and send any packets waiting in the queue.
@@ -1394,6 +1545,21 @@ void QuicSession::SetLocalAddress(const ngtcp2_addr* addr) {
   ngtcp2_conn_set_local_addr(Connection(), addr);
 }
 
+// Starts the application protocol identified by the ALPN, if it is
+// one that is implemented natively. For now, that is only HTTP/3.
+// Returns false if the application could not be started.
+bool QuicSession::StartApplication() {
+  if (application_ || GetALPN() != NGTCP2_ALPN_H3)
+    return true;
+  QUIC_DEBUG(this, "Starting the HTTP/3 application");
+  application_.reset(new Http3Application(this));
+  if (!application_->Initialize()) {
+    application_.reset();
+    return false;
+  }
+  return true;
+}
+
 // Set the transport parameters received from the remote peer
 int QuicSession::SetRemoteTransportParams(ngtcp2_transport_params* params) {
   DCHECK(!IsFlagSet(QUICSESSION_FLAG_DESTROYED));
@@ -1401,6 +1567,15 @@ int QuicSession::SetRemoteTransportParams(ngtcp2_transport_params* params) {
   return ngtcp2_conn_set_remote_transport_params(Connection(), params);
 }
 
+bool QuicSession::SubmitHeaders(
+    int64_t stream_id,
+    QuicStreamHeadersKind kind,
+    Local<Array> headers) {
+  if (!application_ || IsFlagSet(QUICSESSION_FLAG_DESTROYED))
+    return false;
+  return application_->SubmitHeaders(stream_id, kind, headers);
+}
+
 int QuicSession::ShutdownStream(int64_t stream_id, uint64_t code) {
   // First, update the internal ngtcp2 state of the given stream
   // and schedule the STOP_SENDING and RESET_STREAM frames as
@@ -1440,11 +1615,11 @@ void QuicSession::SilentClose(bool stateless_reset) {
   SetFlag(QUICSESSION_FLAG_CLOSING);
 
   QuicError last_error = GetLastError();
-  Debug(this,
-        "Silent close with %s code %" PRIu64 " (stateless reset? %s)",
-        ErrorFamilyName(last_error.family),
-        last_error.code,
-        stateless_reset ? "yes" : "no");
+  QUIC_DEBUG(this,
+             "Silent close with %s code %" PRIu64 " (stateless reset? %s)",
+             ErrorFamilyName(last_error.family),
+             last_error.code,
+             stateless_reset ? "yes" : "no");
 
   HandleScope scope(env()->isolate());
   Context::Scope context_scope(env()->context());
@@ -1462,18 +1637,23 @@ void QuicSession::SilentClose(bool stateless_reset) {
       env()->quic_on_session_silent_close_function(), arraysize(argv), argv);
 }
 
-// Called by ngtcp2 when a stream has been closed. If the stream does
-// not exist, the close is ignored.
-void QuicSession::StreamClose(int64_t stream_id, uint64_t app_error_code) {
+// Called by ngtcp2 when a stream has been closed. The application, if
+// any, is notified first. If the stream does not exist, the close is
+// otherwise ignored. Returns false if the application does not permit
+// the stream to be closed.
+bool QuicSession::StreamClose(int64_t stream_id, uint64_t app_error_code) {
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
-    return;
+    return true;
+
+  if (application_ && !application_->StreamClose(stream_id, app_error_code))
+    return false;
 
   if (!HasStream(stream_id))
-    return;
+    return true;
 
-  Debug(this, "Closing stream %" PRId64 " with code %" PRIu64,
-        stream_id,
-        app_error_code);
+  QUIC_DEBUG(this, "Closing stream %" PRId64 " with code %" PRIu64,
+             stream_id,
+             app_error_code);
 
   HandleScope scope(env()->isolate());
   Context::Scope context_scope(env()->context());
@@ -1487,6 +1667,7 @@ void QuicSession::StreamClose(int64_t stream_id, uint64_t app_error_code) {
   // from being freed while the MakeCallback is running.
   std::shared_ptr<QuicSession> ptr(this->shared_from_this());
   MakeCallback(env()->quic_on_stream_close_function(), arraysize(argv), argv);
+  return true;
 }
 
 void QuicSession::StopIdleTimer() {
@@ -1511,7 +1692,7 @@ void QuicSession::StreamOpen(int64_t stream_id) {
         stream_id,
         NGTCP2_ERR_CLOSING);
   }
-  Debug(this, "Stream %" PRId64 " opened but not yet created.", stream_id);
+  QUIC_DEBUG(this, "Stream %" PRId64 " opened but not yet created.", stream_id);
 }
 
 // Called when the QuicSession has received a RESET_STREAM frame from the
@@ -1539,15 +1720,18 @@ void QuicSession::StreamReset(
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
     return;
 
+  if (application_)
+    application_->StreamReset(stream_id, final_size, app_error_code);
+
   if (!HasStream(stream_id))
     return;
 
-  Debug(this,
-        "Reset stream %" PRId64 " with code %" PRIu64
-        " and final size %" PRIu64,
-        stream_id,
-        app_error_code,
-        final_size);
+  QUIC_DEBUG(this,
+             "Reset stream %" PRId64 " with code %" PRIu64
+             " and final size %" PRIu64,
+             stream_id,
+             app_error_code,
+             final_size);
 
   HandleScope scope(env()->isolate());
   Context::Scope context_scope(env()->context());
@@ -1575,13 +1759,16 @@ int QuicSession::TLSHandshake() {
   int err;
   uint64_t now = uv_hrtime();
   if (!IsFlagSet(QUICSESSION_FLAG_INITIAL)) {
-    Debug(this, "TLS handshake starting");
+    QUIC_DEBUG(this, "TLS handshake starting");
     session_stats_.handshake_start_at = now;
-    err = TLSHandshake_Initial();
+    {
+      AsyncSigningScope signing_scope(this);
+      err = TLSHandshake_Initial();
+    }
     if (err != 0)
       return err;
   } else {
-    Debug(this, "TLS handshake continuing");
+    QUIC_DEBUG(this, "TLS handshake continuing");
     uint64_t ts =
         session_stats_.handshake_continue_at > 0 ?
             session_stats_.handshake_continue_at :
@@ -1592,7 +1779,10 @@ int QuicSession::TLSHandshake() {
 
   // If DoTLSHandshake returns 0 or negative, the handshake
   // is not yet complete.
-  err = DoTLSHandshake(ssl());
+  {
+    AsyncSigningScope signing_scope(this);
+    err = DoTLSHandshake(ssl());
+  }
   if (err <= 0)
     return err;
 
@@ -1600,7 +1790,7 @@ int QuicSession::TLSHandshake() {
   if (err != 0)
     return err;
 
-  Debug(this, "TLS Handshake completed.");
+  QUIC_DEBUG(this, "TLS Handshake completed.");
   SetHandshakeCompleted();
   return 0;
 }
@@ -1613,17 +1803,82 @@ int QuicSession::TLSRead() {
   return ClearTLS(ssl(), Side() != NGTCP2_CRYPTO_SIDE_SERVER);
 }
 
+namespace {
+thread_local QuicSession* current_async_signing_session = nullptr;
+}  // namespace
+
+QuicSession::AsyncSigningScope::AsyncSigningScope(QuicSession* session) :
+    session_(session) {
+  SSL* ssl = session_->ssl();
+  // A paused async job must be resumed in async mode. Otherwise, only
+  // start a new one if neither the clientHello nor the OCSPRequest
+  // handlers could be invoked during this step of the handshake.
+  enabled_ =
+      SSL_waiting_for_async(ssl) ||
+      (session_->AllowAsyncSigning() &&
+       session_->state_[IDX_QUIC_SESSION_STATE_CLIENT_HELLO_ENABLED] == 0 &&
+       session_->state_[IDX_QUIC_SESSION_STATE_CERT_ENABLED] == 0);
+  if (!enabled_)
+    return;
+  SSL_set_mode(ssl, SSL_MODE_ASYNC);
+  previous_ = current_async_signing_session;
+  current_async_signing_session = session_;
+}
+
+QuicSession::AsyncSigningScope::~AsyncSigningScope() {
+  if (!enabled_)
+    return;
+  current_async_signing_session = previous_;
+  // SSL_MODE_ASYNC is cleared between steps so that post-handshake
+  // reads do not pay for starting an async job each time.
+  SSL_clear_mode(session_->ssl(), SSL_MODE_ASYNC);
+
+  if (!session_->keylog_backlog_.empty() &&
+      !session_->IsFlagSet(QUICSESSION_FLAG_DESTROYED)) {
+    std::vector<std::string> lines;
+    lines.swap(session_->keylog_backlog_);
+    for (const std::string& line : lines)
+      session_->Keylog(line.c_str());
+  }
+}
+
+QuicSession* QuicSession::AsyncSigningScope::Current() {
+  return current_async_signing_session;
+}
+
+void QuicSession::OnAsyncSigningStart() {
+  QUIC_DEBUG(this, "Handshake signature offloaded to the threadpool.");
+  SetFlag(QUICSESSION_FLAG_ASYNC_SIGNING);
+}
+
+void QuicSession::OnAsyncSigningDone() {
+  QUIC_DEBUG(this, "Handshake signature completed.");
+  session_stats_.async_signing_count++;
+  if (IsFlagSet(QUICSESSION_FLAG_DESTROYED)) {
+    // The QuicSession is gone but the paused async job still has to
+    // run to completion, otherwise it is leaked along with the SSL.
+    SetFlag(QUICSESSION_FLAG_ASYNC_SIGNING, false);
+    AsyncSigningScope signing_scope(this);
+    DoTLSHandshake(ssl());
+    return;
+  }
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+  // Continue the TLS handshake when this function exits
+  TLSHandshakeScope handshake_scope(this, QUICSESSION_FLAG_ASYNC_SIGNING);
+}
+
 void QuicSession::UpdateIdleTimer() {
   CHECK_NOT_NULL(idle_);
   uint64_t timeout = ngtcp2_conn_get_idle_timeout(Connection()) / 1000000UL;
-  Debug(this, "Updating idle timeout to %" PRIu64, timeout);
+  QUIC_DEBUG(this, "Updating idle timeout to %" PRIu64, timeout);
   idle_->Update(timeout);
 }
 
 void QuicSession::WriteHandshake(const uint8_t* data, size_t datalen) {
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
     return;
-  Debug(this, "Writing %d bytes of handshake data.", datalen);
+  QUIC_DEBUG(this, "Writing %d bytes of handshake data.", datalen);
   MallocedBuffer<uint8_t> buffer(datalen);
   memcpy(buffer.data, data, datalen);
   CHECK_EQ(
@@ -1634,6 +1889,22 @@ void QuicSession::WriteHandshake(const uint8_t* data, size_t datalen) {
   handshake_.Push(std::move(buffer));
 }
 
+void QuicSession::RecordCertificateBytes(
+    const uint8_t* data,
+    size_t datalen,
+    bool sent) {
+  if (datalen < 4 || data[0] != SSL3_MT_CERTIFICATE)
+    return;
+
+  QUIC_DEBUG(this, "%s %" PRIu64 " bytes of certificate data.",
+             sent ? "Sent" : "Received", static_cast<uint64_t>(datalen));
+
+  if (sent)
+    session_stats_.cert_bytes_sent += datalen;
+  else
+    session_stats_.cert_bytes_received += datalen;
+}
+
 // Write any packets current pending for the ngtcp2 connection based on
 // the current state of the QuicSession. If the QuicSession is in the
 // closing period, only CONNECTION_CLOSE packets may be written. If the
@@ -1690,6 +1961,12 @@ bool QuicSession::WritePackets(const char* diagnostic_label) {
       }
     }
 
+    // The javascript side may have destroyed the QuicSession from
+    // within one of the ngtcp2 callbacks (for instance, once the
+    // handshake has completed), in which case the packet is dropped.
+    if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
+      return true;
+
     data.Realloc(nwrite);
     remote_address_.Update(&path.path.remote);
     sendbuf_.Push(std::move(data));
@@ -1707,7 +1984,7 @@ int QuicSession::WritePeerHandshake(
     return NGTCP2_ERR_CRYPTO;
   if (peer_handshake_.size() + datalen > max_crypto_buffer_)
     return NGTCP2_ERR_CRYPTO_BUFFER_EXCEEDED;
-  Debug(this, "Writing %d bytes of peer handshake data.", datalen);
+  QUIC_DEBUG(this, "Writing %d bytes of peer handshake data.", datalen);
   std::copy_n(data, datalen, std::back_inserter(peer_handshake_));
   return 0;
 }
@@ -1723,7 +2000,7 @@ bool QuicSession::UpdateKey() {
   OnScopeLeave leave([&]() { SetFlag(QUICSESSION_FLAG_KEYUPDATE, false); });
   CHECK(!IsFlagSet(QUICSESSION_FLAG_KEYUPDATE));
   SetFlag(QUICSESSION_FLAG_KEYUPDATE);
-  Debug(this, "Updating keys.");
+  QUIC_DEBUG(this, "Updating keys.");
 
   IncrementStat(1, &session_stats_, &session_stats::keyupdate_count);
 
@@ -1851,17 +2128,28 @@ void QuicServerSession::Init(
   this->ExtendMaxStreamsUni(config->max_streams_uni());
 
   remote_address_.Copy(addr);
+  source_prefix_ = SourcePrefix::From(addr);
   max_pktlen_ = SocketAddress::GetMaxPktLen(addr);
 
   InitTLS();
 
+  PooledRandomBytes(scid_.data, NGTCP2_SV_SCIDLEN);
+  scid_.datalen = NGTCP2_SV_SCIDLEN;
+
   QuicSessionConfig cfg = *config;
-  cfg.GenerateStatelessResetToken();
-  cfg.GeneratePreferredAddressToken(this->pscid());
+  CHECK(cfg.GenerateStatelessResetToken(Socket()->GetResetSecret(), &scid_));
+  CHECK(cfg.GeneratePreferredAddressToken(
+      Socket()->GetResetSecret(),
+      this->pscid()));
   max_crypto_buffer_ = cfg.GetMaxCryptoBuffer();
+  max_memory_ = cfg.GetMaxMemory();
+  max_stream_window_ = cfg.GetMaxStreamWindow();
+  receive_window_.Initialize(cfg.max_data(), cfg.GetMaxConnectionWindow());
+  session_stats_.receive_window = receive_window_.size();
 
-  EntropySource(scid_.data, NGTCP2_SV_SCIDLEN);
-  scid_.datalen = NGTCP2_SV_SCIDLEN;
+  StartQlog(ocid != nullptr ? ocid : &rcid_);
+  if (qlog_)
+    cfg.EnableQlog();
 
   QuicPath path(Socket()->GetLocalAddress(), &remote_address_);
 
@@ -1888,6 +2176,9 @@ void QuicServerSession::Init(
 void QuicServerSession::InitTLS_Post() {
   SSL_set_accept_state(ssl());
 
+  if (IsOptionSet(QUICSERVERSESSION_OPTION_ASYNC_SIGNING))
+    EnableAsyncSigning(ssl());
+
   if (IsOptionSet(QUICSERVERSESSION_OPTION_REQUEST_CERT)) {
     int verify_mode = SSL_VERIFY_PEER;
     if (IsOptionSet(QUICSERVERSESSION_OPTION_REJECT_UNAUTHORIZED))
@@ -2023,9 +2314,10 @@ void OnServerCertCB(const FunctionCallbackInfo<Value>& args) {
 void QuicServerSession::OnCertDone(
     crypto::SecureContext* context,
     Local<Value> ocsp_response) {
-  Debug(this, "OCSPRequest completed. Context Provided? %s, OCSP Provided? %s",
-        context != nullptr ? "Yes" : "No",
-        ocsp_response->IsArrayBufferView() ? "Yes" : "No");
+  QUIC_DEBUG(this,
+             "OCSPRequest completed. Context Provided? %s, OCSP Provided? %s",
+             context != nullptr ? "Yes" : "No",
+             ocsp_response->IsArrayBufferView() ? "Yes" : "No");
   // Continue the TLS handshake when this function exits
   // otherwise it will stall and fail.
   TLSHandshakeScope handshake_scope(this, QUICSESSION_FLAG_CERT_CB_RUNNING);
@@ -2040,23 +2332,82 @@ void QuicServerSession::OnCertDone(
         return env()->ThrowError("CertCbDone");  // TODO(@jasnell): revisit
       return crypto::ThrowCryptoError(env(), err);
     }
+    if (IsOptionSet(QUICSERVERSESSION_OPTION_ASYNC_SIGNING))
+      EnableAsyncSigning(ssl());
+  }
+
+  if (ocsp_response->IsArrayBufferView()) {
+    Local<ArrayBufferView> view = ocsp_response.As<ArrayBufferView>();
+    MaybeStackBuffer<unsigned char> buf(view->ByteLength());
+    view->CopyContents(*buf, buf.length());
+    ocsp_staple_ = NewOCSPStaple(*buf, buf.length());
+
+    // Cache the response for subsequent handshakes using the same
+    // SecureContext so that the 'OCSPRequest' event is not emitted
+    // again until the response expires.
+    if (sni_context_ &&
+        ocsp_staple_->expires_at > 0 &&
+        (context == nullptr || context == sni_context_->context)) {
+      QUIC_DEBUG(this, "Caching OCSP response.");
+      sni_context_->staple = ocsp_staple_;
+    }
+  }
+}
+
+bool QuicServerSession::SelectSNIContext() {
+  if (Socket() == nullptr)
+    return true;
+  const char* servername = SSL_get_servername(ssl(), TLSEXT_NAMETYPE_host_name);
+  sni_context_ = Socket()->FindSNIContext(servername);
+  if (!sni_context_ ||
+      sni_context_->context == Socket()->GetServerSecureContext()) {
+    return true;
   }
 
-  if (ocsp_response->IsArrayBufferView())
-    ocsp_response_.Reset(env()->isolate(), ocsp_response.As<ArrayBufferView>());
+  QUIC_DEBUG(this,
+             "Using SecureContext registered for servername %s.",
+             servername);
+  if (!UseSNIContext(ssl(), sni_context_->context))
+    return false;
+  if (IsOptionSet(QUICSERVERSESSION_OPTION_ASYNC_SIGNING))
+    EnableAsyncSigning(ssl());
+  return true;
 }
 
-// The OnCert callback provides an opportunity to prompt the server to
-// perform on OCSP request on behalf of the client (when the client
-// requests it). If there is a listener for the 'OCSPRequest' event
-// on the JavaScript side, the IDX_QUIC_SESSION_STATE_CERT_ENABLED
-// session state slot will equal 1, which will cause the callback to
-// be invoked. The callback will be given a reference to a JavaScript
-// function that must be called in order for the TLS handshake to
-// continue.
+// The OnCert callback first selects the SecureContext registered for the
+// requested servername, then provides an opportunity to prompt the server
+// to perform on OCSP request on behalf of the client (when the client
+// requests it). If a cached OCSP response for the selected SecureContext
+// is still fresh, it is used without calling into JavaScript. Otherwise,
+// if there is a listener for the 'OCSPRequest' event on the JavaScript
+// side, the IDX_QUIC_SESSION_STATE_CERT_ENABLED session state slot will
+// equal 1, which will cause the callback to be invoked. The callback will
+// be given a reference to a JavaScript function that must be called in
+// order for the TLS handshake to continue.
 int QuicServerSession::OnCert() {
-  Debug(this, "Is there an OCSPRequest handler registered? %s",
-        state_[IDX_QUIC_SESSION_STATE_CERT_ENABLED] == 0 ? "No" : "Yes");
+  if (!sni_context_ && !SelectSNIContext())
+    return 0;
+
+  const bool ocsp =
+      (SSL_get_tlsext_status_type(ssl()) == TLSEXT_STATUSTYPE_ocsp);
+  QUIC_DEBUG(this, "Is the client requesting OCSP? %s", ocsp ? "Yes" : "No");
+
+  // If status type is not ocsp, there's nothing further to do here.
+  // Save ourselves the callback into JavaScript and continue the
+  // handshake.
+  if (!ocsp)
+    return 1;
+
+  if (sni_context_ &&
+      sni_context_->staple &&
+      sni_context_->staple->IsFresh(uv_hrtime())) {
+    QUIC_DEBUG(this, "Using cached OCSP response.");
+    ocsp_staple_ = sni_context_->staple;
+    return 1;
+  }
+
+  QUIC_DEBUG(this, "Is there an OCSPRequest handler registered? %s",
+             state_[IDX_QUIC_SESSION_STATE_CERT_ENABLED] == 0 ? "No" : "Yes");
   if (LIKELY(state_[IDX_QUIC_SESSION_STATE_CERT_ENABLED] == 0))
     return 1;
 
@@ -2070,17 +2421,6 @@ int QuicServerSession::OnCert() {
   HandleScope handle_scope(env()->isolate());
   Context::Scope context_scope(env()->context());
 
-  Local<Value> servername_str;
-  const bool ocsp =
-      (SSL_get_tlsext_status_type(ssl()) == TLSEXT_STATUSTYPE_ocsp);
-  Debug(this, "Is the client requesting OCSP? %s", ocsp ? "Yes" : "No");
-
-  // If status type is not ocsp, there's nothing further to do here.
-  // Save ourselves the callback into JavaScript and continue the
-  // handshake.
-  if (!ocsp)
-    return 1;
-
   const char* servername = SSL_get_servername(ssl(), TLSEXT_NAMETYPE_host_name);
 
   SetFlag(QUICSESSION_FLAG_CERT_CB_RUNNING);
@@ -2109,41 +2449,179 @@ int QuicServerSession::OnCert() {
 
 // When the client has requested OSCP, this function will be called to provide
 // the OSCP response. The OnCert() callback should have already been called
-// by this point if any data is to be provided. If it hasn't, and ocsp_response_
+// by this point if any data is to be provided. If it hasn't, and ocsp_staple_
 // is empty, no OCSP response will be sent.
 int QuicServerSession::OnTLSStatus() {
-  Debug(this, "Asking for OCSP status to send. Is there a response? %s",
-        ocsp_response_.IsEmpty() ? "No" : "Yes");
+  QUIC_DEBUG(this, "Asking for OCSP status to send. Is there a response? %s",
+             ocsp_staple_ ? "Yes" : "No");
 
-  if (ocsp_response_.IsEmpty())
+  if (!ocsp_staple_)
     return SSL_TLSEXT_ERR_NOACK;
 
-  HandleScope scope(env()->isolate());
-
-  Local<ArrayBufferView> obj =
-      PersistentToLocal::Default(
-        env()->isolate(),
-        ocsp_response_);
-  size_t len = obj->ByteLength();
-
+  const std::vector<unsigned char>& response = ocsp_staple_->response;
+  size_t len = response.size();
   unsigned char* data = crypto::MallocOpenSSL<unsigned char>(len);
-  obj->CopyContents(data, len);
+  memcpy(data, response.data(), len);
 
-  Debug(this, "The OCSP Response is %d bytes in length.", len);
+  QUIC_DEBUG(this, "The OCSP Response is %d bytes in length.", len);
 
   if (!SSL_set_tlsext_status_ocsp_resp(ssl(), data, len))
     OPENSSL_free(data);
-  ocsp_response_.Reset();
+  ocsp_staple_.reset();
 
   return SSL_TLSEXT_ERR_OK;
 }
 
+inline bool HasQuicObserver(Environment* env) {
+  AliasedUint32Array& observers = env->performance_state()->observers;
+  return observers[performance::NODE_PERFORMANCE_ENTRY_TYPE_QUIC] != 0;
+}
+
+// Called when the QuicSession is destroyed. Records the session in the
+// QuicSocket's histograms, which aggregate all of the sessions of the
+// QuicSocket, and reports it to 'quic' PerformanceObservers, if any.
+void QuicSession::EmitStatistics() {
+  uint64_t now = uv_hrtime();
+  uint64_t handshake_duration =
+      session_stats_.handshake_completed_at > 0 ?
+          session_stats_.handshake_completed_at - session_stats_.created_at :
+          0;
+
+  // Until the first RTT sample is taken, ngtcp2 reports the initial
+  // RTT estimate, which says nothing about the path.
+  bool has_rtt = recovery_stats_.latest_rtt > 0;
+  socket_->RecordSessionClosed(
+      now - session_stats_.created_at,
+      has_rtt ? static_cast<uint64_t>(recovery_stats_.smoothed_rtt) : 0);
+
+  if (!HasQuicObserver(env()))
+    return;
+  auto entry = std::make_unique<QuicSessionPerformanceEntry>(
+      env(),
+      Side(),
+      session_stats_.created_at,
+      now,
+      handshake_duration,
+      has_rtt ? recovery_stats_.smoothed_rtt : 0,
+      has_rtt ? recovery_stats_.min_rtt : 0,
+      session_stats_.bytes_sent,
+      session_stats_.bytes_received,
+      session_stats_.streams_in_count,
+      session_stats_.streams_out_count,
+      session_stats_.keyupdate_count,
+      session_stats_.loss_retransmit_count);
+  env()->SetImmediate([entry = std::move(entry)](Environment* env) {
+    if (!HasQuicObserver(env))
+      return;
+    HandleScope handle_scope(env->isolate());
+    AliasedFloat64Array& buffer =
+        env->quic_state()->quicsessionperformance_buffer;
+    buffer[IDX_QUIC_SESSION_PERF_TYPE] = entry->side();
+    buffer[IDX_QUIC_SESSION_PERF_HANDSHAKE_DURATION] =
+        entry->handshake_duration() / 1e6;
+    buffer[IDX_QUIC_SESSION_PERF_SMOOTHED_RTT] = entry->smoothed_rtt() / 1e6;
+    buffer[IDX_QUIC_SESSION_PERF_MIN_RTT] = entry->min_rtt() / 1e6;
+    buffer[IDX_QUIC_SESSION_PERF_BYTES_SENT] = entry->bytes_sent();
+    buffer[IDX_QUIC_SESSION_PERF_BYTES_RECEIVED] = entry->bytes_received();
+    buffer[IDX_QUIC_SESSION_PERF_STREAMS_IN] = entry->streams_in();
+    buffer[IDX_QUIC_SESSION_PERF_STREAMS_OUT] = entry->streams_out();
+    buffer[IDX_QUIC_SESSION_PERF_KEYUPDATES] = entry->keyupdates();
+    buffer[IDX_QUIC_SESSION_PERF_LOSS_RETRANSMITS] =
+        entry->loss_retransmits();
+    Local<Object> obj;
+    if (entry->ToObject().ToLocal(&obj)) entry->Notify(obj);
+  });
+}
+
+// When the QuicSocket was created with the qlog option, every
+// QuicSession writes a qlog trace to a file named after the original
+// destination connection ID and the vantage point, e.g.
+// <dir>/0a1b..._server.sqlog.
+void QuicSession::StartQlog(const ngtcp2_cid* odcid) {
+  const std::string& dir = Socket()->GetQlogDir();
+  if (dir.empty())
+    return;
+  std::string path =
+      dir + kPathSeparator +
+      StringBytes::hex_encode(
+          reinterpret_cast<const char*>(odcid->data), odcid->datalen) +
+      (Side() == NGTCP2_CRYPTO_SIDE_SERVER ? "_server" : "_client") +
+      ".sqlog";
+  QlogWriter* writer = QlogWriter::Open(env()->event_loop(), path);
+  if (writer == nullptr) {
+    QUIC_DEBUG(this, "Could not open qlog file %s", path.c_str());
+    return;
+  }
+  qlog_.reset(
+      new QlogTrace(
+          Side() == NGTCP2_CRYPTO_SIDE_SERVER,
+          odcid,
+          session_stats_.created_at,
+          writer));
+}
+
 void QuicSession::UpdateRecoveryStats() {
   ngtcp2_rcvry_stat stat;
   ngtcp2_conn_get_rcvry_stat(Connection(), &stat);
   recovery_stats_.min_rtt = static_cast<double>(stat.min_rtt);
   recovery_stats_.latest_rtt = static_cast<double>(stat.latest_rtt);
   recovery_stats_.smoothed_rtt = static_cast<double>(stat.smoothed_rtt);
+  if (qlog_) {
+    qlog_->MetricsUpdated(
+        uv_hrtime(),
+        &stat,
+        ngtcp2_conn_get_bytes_in_flight(Connection()));
+  }
+}
+
+// Flow control credit cannot be taken back from the peer once it has
+// been granted. Instead, while memory is constrained, the credit for
+// received data is withheld so that the windows available to the peer
+// shrink as it sends. Once enough memory has been released, the
+// withheld credit is returned.
+bool QuicSession::UpdateMemoryUsage() {
+  if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
+    return true;
+
+  uint64_t usage = GetMemoryUsage();
+  socket_->UpdateSessionMemory(session_stats_.memory, usage);
+  session_stats_.memory = usage;
+  if (usage > session_stats_.max_memory)
+    session_stats_.max_memory = usage;
+
+  bool constrained =
+      IsNearMemoryLimit(usage, max_memory_) ||
+      socket_->IsMemoryConstrained();
+  if (constrained != IsMemoryConstrained()) {
+    QUIC_DEBUG(this, "%s backpressure at %" PRIu64 " bytes of memory",
+               constrained ? "Applying" : "Lifting", usage);
+    SetFlag(QUICSESSION_FLAG_MEMORY_CONSTRAINED, constrained);
+    if (!constrained)
+      ReleaseWithheldOffset();
+  }
+
+  return usage <= max_memory_ && !socket_->IsMemoryExceeded();
+}
+
+// Credit that was withheld says nothing about how quickly data is
+// being consumed, so returning it never grows the receive window.
+void QuicSession::ReleaseWithheldOffset() {
+  if (withheld_offset_ > 0) {
+    ExtendMaxOffset(withheld_offset_, 0);
+    withheld_offset_ = 0;
+  }
+  for (const auto& stream : streams_)
+    stream.second->ReleaseWithheldOffset();
+}
+
+void QuicSession::ExtendMaxOffset(size_t amount, uint64_t rtt) {
+  uint64_t extend = receive_window_.Consume(amount, uv_hrtime(), rtt);
+  if (receive_window_.size() != session_stats_.receive_window) {
+    QUIC_DEBUG(this, "Growing the receive window to %" PRIu64 " bytes",
+               receive_window_.size());
+    session_stats_.receive_window = receive_window_.size();
+  }
+  ngtcp2_conn_extend_max_offset(Connection(), extend);
 }
 
 // The QuicSocket maintains a map of std::shared_ptr's that keep
@@ -2151,6 +2629,24 @@ void QuicSession::UpdateRecoveryStats() {
 // is called, the QuicSession instance will be freed if there are
 // no other references being held.
 void QuicServerSession::RemoveFromSocket() {
+  // Of a session destroyed in its closing period, the QuicSocket keeps
+  // only the CONNECTION_CLOSE packet, for the three PTOs the closing
+  // period lasts.
+  if (IsFlagSet(QUICSESSION_FLAG_DESTROYED) && conn_closebuf_.size > 0) {
+    std::vector<ngtcp2_cid> cids(ngtcp2_conn_get_num_scid(Connection()));
+    ngtcp2_conn_get_scid(Connection(), cids.data());
+    std::vector<std::string> closed_cids;
+    closed_cids.reserve(cids.size() + 1);
+    for (const ngtcp2_cid& cid : cids)
+      closed_cids.push_back(QuicCID(&cid).ToStr());
+    closed_cids.push_back(QuicCID(rcid_).ToStr());
+    socket_->AddClosedConnection(
+        std::move(closed_cids),
+        conn_closebuf_.data,
+        conn_closebuf_.size,
+        3 * ngtcp2_conn_get_pto(Connection()));
+  }
+
   QuicCID rcid(rcid_);
   socket_->DisassociateCID(&rcid);
 
@@ -2208,7 +2704,7 @@ bool QuicServerSession::StartClosingPeriod() {
   sendbuf_.Cancel();
 
   QuicError error = GetLastError();
-  Debug(this, "Closing period has started. Error %d", error.code);
+  QUIC_DEBUG(this, "Closing period has started. Error %d", error.code);
 
   // Once the CONNECTION_CLOSE packet is written,
   // IsInClosingPeriod will return true.
@@ -2229,9 +2725,40 @@ bool QuicServerSession::StartClosingPeriod() {
     return false;
   }
   conn_closebuf_.Realloc(nwrite);
+
+  // All that remains to be done in the closing period is to repeat the
+  // CONNECTION_CLOSE, which the QuicSocket does by itself once the
+  // session has been destroyed (see RemoveFromSocket()). Rather than
+  // keeping the session, with its ngtcp2_conn, TLS state and JavaScript
+  // object, alive until the idle timeout, it is released as soon as the
+  // stack has unwound.
+  env()->SetImmediate([session = shared_from_this()](Environment* env) {
+    static_cast<QuicServerSession*>(session.get())->ReleaseClosingPeriod();
+  });
   return true;
 }
 
+// Lets the JavaScript side know that the QuicServerSession has nothing
+// left to do, the same way as for a silent close, so that it is
+// destroyed. No further frames are sent for the streams that remain.
+void QuicServerSession::ReleaseClosingPeriod() {
+  if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
+    return;
+  QUIC_DEBUG(this, "Releasing the session in its closing period");
+
+  HandleScope scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+
+  QuicError last_error = GetLastError();
+  Local<Value> argv[] = {
+    v8::False(env()->isolate()),
+    Number::New(env()->isolate(), static_cast<double>(last_error.code)),
+    Integer::New(env()->isolate(), last_error.family)
+  };
+  MakeCallback(
+      env()->quic_on_session_silent_close_function(), arraysize(argv), argv);
+}
+
 int QuicServerSession::TLSHandshake_Initial() {
   SetFlag(QUICSESSION_FLAG_INITIAL);
   return DoTLSReadEarlyData(ssl());
@@ -2332,6 +2859,16 @@ void QuicClientSession::AddToSocket(QuicSocket* socket) {
     QuicCID id(&cid);
     socket->AssociateCID(&id, &scid);
   }
+
+  if (has_reset_token_)
+    socket->AssociateStatelessResetToken(reset_token_, &scid);
+}
+
+void QuicClientSession::RemoveFromSocket() {
+  if (has_reset_token_)
+    socket_->DisassociateStatelessResetToken(reset_token_);
+
+  QuicSession::RemoveFromSocket();
 }
 
 void QuicClientSession::VersionNegotiation(
@@ -2392,11 +2929,17 @@ bool QuicClientSession::Init(
 
   QuicSessionConfig config(env());
   max_crypto_buffer_ = config.GetMaxCryptoBuffer();
+  max_memory_ = config.GetMaxMemory();
+  max_stream_window_ = config.GetMaxStreamWindow();
+  receive_window_.Initialize(
+      config.max_data(),
+      config.GetMaxConnectionWindow());
+  session_stats_.receive_window = receive_window_.size();
   this->ExtendMaxStreamsBidi(config.max_streams_bidi());
   this->ExtendMaxStreamsUni(config.max_streams_uni());
 
   scid_.datalen = NGTCP2_MAX_CIDLEN;
-  EntropySource(scid_.data, scid_.datalen);
+  PooledRandomBytes(scid_.data, scid_.datalen);
 
   ngtcp2_cid dcid;
   if (dcid_value->IsArrayBufferView()) {
@@ -2408,9 +2951,13 @@ bool QuicClientSession::Init(
     dcid.datalen = sbuf.length();
   } else {
     dcid.datalen = NGTCP2_MAX_CIDLEN;
-    EntropySource(dcid.data, dcid.datalen);
+    PooledRandomBytes(dcid.data, dcid.datalen);
   }
 
+  StartQlog(&dcid);
+  if (qlog_)
+    config.EnableQlog();
+
   QuicPath path(Socket()->GetLocalAddress(), &remote_address_);
 
   ngtcp2_conn* conn;
@@ -2433,20 +2980,20 @@ bool QuicClientSession::Init(
   // Remote Transport Params
   if (early_transport_params->IsArrayBufferView()) {
     if (SetEarlyTransportParams(early_transport_params)) {
-      Debug(this, "Using provided early transport params.");
+      QUIC_DEBUG(this, "Using provided early transport params.");
       SetOption(QUICCLIENTSESSION_OPTION_RESUME);
     } else {
-      Debug(this, "Ignoring invalid early transport params.");
+      QUIC_DEBUG(this, "Ignoring invalid early transport params.");
     }
   }
 
   // Session Ticket
   if (session_ticket->IsArrayBufferView()) {
     if (SetSession(session_ticket)) {
-      Debug(this, "Using provided session ticket.");
+      QUIC_DEBUG(this, "Using provided session ticket.");
       SetOption(QUICCLIENTSESSION_OPTION_RESUME);
     } else {
-      Debug(this, "Ignoring provided session ticket.");
+      QUIC_DEBUG(this, "Ignoring provided session ticket.");
     }
   }
 
@@ -2538,9 +3085,13 @@ bool QuicClientSession::SetSocket(QuicSocket* socket, bool nat_rebinding) {
   AddToSocket(socket);
 
   // Step 2: Remove this Session from the current Socket
+  QuicSocket* previous = socket_;
   RemoveFromSocket();
 
-  // Step 3: Update the internal references
+  // Step 3: Update the internal references, moving the memory held
+  // by this Session over to the new Socket
+  previous->UpdateSessionMemory(session_stats_.memory, 0);
+  socket->UpdateSessionMemory(0, session_stats_.memory);
   socket_ = socket;
   socket->ReceiveStart();
 
@@ -2568,12 +3119,22 @@ void QuicClientSession::StoreRemoteTransportParams(
   CHECK(!IsFlagSet(QUICSESSION_FLAG_DESTROYED));
   transportParams_.AllocateSufficientStorage(sizeof(ngtcp2_transport_params));
   memcpy(*transportParams_, params, sizeof(ngtcp2_transport_params));
+
+  // Lets the QuicSocket recognize a stateless reset from the server.
+  if (params->stateless_reset_token_present && !has_reset_token_) {
+    memcpy(reset_token_,
+           params->stateless_reset_token,
+           NGTCP2_STATELESS_RESET_TOKENLEN);
+    has_reset_token_ = true;
+    QuicCID scid(scid_);
+    Socket()->AssociateStatelessResetToken(reset_token_, &scid);
+  }
 }
 
 void QuicClientSession::InitTLS_Post() {
   SSL_set_connect_state(ssl());
 
-  Debug(this, "Using %s as the ALPN protocol.", GetALPN().c_str() + 1);
+  QUIC_DEBUG(this, "Using %s as the ALPN protocol.", GetALPN().c_str() + 1);
   const uint8_t* alpn = reinterpret_cast<const uint8_t*>(GetALPN().c_str());
   size_t alpnlen = GetALPN().length();
   SSL_set_alpn_protos(ssl(), alpn, alpnlen);
@@ -2584,7 +3145,7 @@ void QuicClientSession::InitTLS_Post() {
   if (SocketAddress::numeric_host(hostname_.c_str())) {
     // TODO(@jasnell): Should we do this at all? If the host is numeric,
     // the we likely shouldn't set the SNI at all.
-    Debug(this, "Using localhost as fallback hostname.");
+    QUIC_DEBUG(this, "Using localhost as fallback hostname.");
     SSL_set_tlsext_host_name(ssl(), "localhost");
   } else {
     SSL_set_tlsext_host_name(ssl(), hostname_.c_str());
@@ -2592,7 +3153,7 @@ void QuicClientSession::InitTLS_Post() {
 
   // Are we going to request OCSP status?
   if (IsOptionSet(QUICCLIENTSESSION_OPTION_REQUEST_OCSP)) {
-    Debug(this, "Request OCSP status from the server.");
+    QUIC_DEBUG(this, "Request OCSP status from the server.");
     SSL_set_tlsext_status_type(ssl(), TLSEXT_STATUSTYPE_ocsp);
   }
 }
@@ -2607,7 +3168,7 @@ int QuicClientSession::OnTLSStatus() {
 
   const unsigned char* resp;
   int len = SSL_get_tlsext_status_ocsp_resp(ssl(), &resp);
-  Debug(this, "An OCSP Response of %d bytes has been received.", len);
+  QUIC_DEBUG(this, "An OCSP Response of %d bytes has been received.", len);
   Local<Value> arg;
   if (resp == nullptr) {
     arg = Undefined(env()->isolate());
@@ -2627,7 +3188,7 @@ int QuicClientSession::OnTLSStatus() {
 bool QuicClientSession::ReceiveRetry() {
   if (IsFlagSet(QUICSESSION_FLAG_DESTROYED))
     return false;
-  Debug(this, "A retry packet was received. Restarting the handshake.");
+  QUIC_DEBUG(this, "A retry packet was received. Restarting the handshake.");
   IncrementStat(1, &session_stats_, &session_stats::retry_count);
   return SetupInitialCryptoContext();
 }
@@ -2660,7 +3221,7 @@ bool QuicClientSession::SendConnectionClose() {
         error.code,
         uv_hrtime());
   if (nwrite < 0) {
-    Debug(this, "Error writing connection close: %d", nwrite);
+    QUIC_DEBUG(this, "Error writing connection close: %d", nwrite);
     SetLastError(QUIC_ERROR_SESSION, static_cast<int>(nwrite));
     return false;
   }
@@ -2696,7 +3257,7 @@ bool QuicClientSession::SetSession(Local<Value> buffer) {
 // The very first step is to setup the initial crypto context on the
 // client side by creating the initial keying material.
 bool QuicClientSession::SetupInitialCryptoContext() {
-  Debug(this, "Setting up initial crypto context");
+  QUIC_DEBUG(this, "Setting up initial crypto context");
   return DeriveAndInstallInitialKey(
       Connection(),
       ngtcp2_conn_get_dcid(Connection()),
@@ -2706,12 +3267,13 @@ bool QuicClientSession::SetupInitialCryptoContext() {
 int QuicClientSession::TLSHandshake_Complete() {
   if (IsOptionSet(QUICCLIENTSESSION_OPTION_RESUME) &&
       SSL_get_early_data_status(ssl()) != SSL_EARLY_DATA_ACCEPTED) {
-    Debug(this, "Early data was rejected.");
+    QUIC_DEBUG(this, "Early data was rejected.");
     int err = ngtcp2_conn_early_data_rejected(Connection());
     if (err != 0) {
-      Debug(this,
-            "Failure notifying ngtcp2 about early data rejection. Error %d",
-            err);
+      QUIC_DEBUG(
+          this,
+          "Failure notifying ngtcp2 about early data rejection. Error %d",
+          err);
     }
     return err;
   }
@@ -2727,11 +3289,11 @@ int QuicClientSession::TLSHandshake_Initial() {
       err = SSL_get_error(ssl(), err);
       switch (err) {
         case SSL_ERROR_SSL:
-          Debug(this, "TLS Handshake Error: %s",
-                ERR_error_string(ERR_get_error(), nullptr));
+          QUIC_DEBUG(this, "TLS Handshake Error: %s",
+                     ERR_error_string(ERR_get_error(), nullptr));
           break;
         default:
-          Debug(this, "TLS Handshake Error: %d", err);
+          QUIC_DEBUG(this, "TLS Handshake Error: %d", err);
       }
       return -1;
     }
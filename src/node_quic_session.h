@@ -11,7 +11,9 @@
 #include "node.h"
 #include "node_crypto.h"
 #include "node_mem.h"
+#include "node_perf.h"
 #include "node_quic_crypto.h"
+#include "node_quic_qlog.h"
 #include "node_quic_util.h"
 #include "v8.h"
 #include "uv.h"
@@ -30,9 +32,67 @@ using ConnectionPointer = DeleteFnPtr<ngtcp2_conn, ngtcp2_conn_del>;
 
 class QuicClientSession;
 class QuicServerSession;
+class QuicSession;
 class QuicSocket;
 class QuicStream;
 
+// A QuicApplication implements the application protocol that is layered
+// on top of a QuicSession, as identified by the negotiated ALPN. Once a
+// QuicSession has started an application, the application takes over the
+// framing of stream data in both directions. QuicSessions that do not use
+// a known application protocol pass stream data through to the QuicStreams
+// as is.
+class QuicApplication {
+ public:
+  explicit QuicApplication(QuicSession* session) : session_(session) {}
+  virtual ~QuicApplication() = default;
+
+  // Called once the handshake has completed. Returns false if the
+  // application could not be started.
+  virtual bool Initialize() = 0;
+
+  // Returns false if the received data violates the application protocol.
+  // The application error to close the QuicSession with will have been
+  // set using QuicSession::SetLastError().
+  virtual bool ReceiveStreamData(
+      int64_t stream_id,
+      int fin,
+      const uint8_t* data,
+      size_t datalen,
+      uint64_t offset) = 0;
+  virtual void AcknowledgeStreamData(
+      int64_t stream_id,
+      uint64_t offset,
+      size_t datalen) = 0;
+  virtual void ExtendMaxStreamData(int64_t stream_id, uint64_t max_data) = 0;
+  virtual bool StreamClose(int64_t stream_id, uint64_t app_error_code) = 0;
+  virtual void StreamReset(
+      int64_t stream_id,
+      uint64_t final_size,
+      uint64_t app_error_code) = 0;
+
+  // Called when data has been written to, or the writable side has been
+  // shut down on, the QuicStream with the given id.
+  virtual void ResumeStream(int64_t stream_id) = 0;
+
+  // Serializes and sends all pending stream data. Returns false if the
+  // QuicSession must be closed.
+  virtual bool SendPendingData() = 0;
+
+  // Queues a block of headers on the given stream. The headers are passed
+  // from the JavaScript side as a [string, count] pair.
+  virtual bool SubmitHeaders(
+      int64_t stream_id,
+      QuicStreamHeadersKind kind,
+      v8::Local<v8::Array> headers) = 0;
+
+ protected:
+  QuicSession* Session() const { return session_; }
+
+ private:
+  QuicSession* session_;
+};
+
 // The QuicSessionConfig class holds the initial transport parameters and
 // configuration options set by the JavaScript side when either a
 // QuicClientSession or QuicServerSession is created. Instances are
@@ -53,6 +113,9 @@ class QuicSessionConfig {
   inline QuicSessionConfig(const QuicSessionConfig& config) {
     memcpy(&settings_, &config.settings_, sizeof(ngtcp2_settings));
     max_crypto_buffer_ = config.max_crypto_buffer_;
+    max_memory_ = config.max_memory_;
+    max_stream_window_ = config.max_stream_window_;
+    max_connection_window_ = config.max_connection_window_;
     settings_.initial_ts = uv_hrtime();
   }
 
@@ -64,6 +127,10 @@ class QuicSessionConfig {
     return settings_.max_streams_uni;
   }
 
+  inline uint64_t max_data() const {
+    return settings_.max_data;
+  }
+
   inline void ResetToDefaults();
 
   // QuicSessionConfig::Set() pulls values out of the AliasedBuffer
@@ -74,18 +141,32 @@ class QuicSessionConfig {
       Environment* env,
       const struct sockaddr* preferred_addr = nullptr);
 
-  // Generates the stateless reset token for the settings_
-  inline void GenerateStatelessResetToken();
+  inline void EnableQlog();
 
-  // If the preferred address is set, generates the associated tokens
-  inline void GeneratePreferredAddressToken(ngtcp2_cid* pscid);
+  // Derives the stateless reset token for the settings_ from the
+  // given secret and the server's initial CID.
+  inline bool GenerateStatelessResetToken(
+      const std::array<uint8_t, RESET_SECRETLEN>& secret,
+      const ngtcp2_cid* scid);
+
+  // If the preferred address is set, generates the associated CID and
+  // derives its stateless reset token from the given secret.
+  inline bool GeneratePreferredAddressToken(
+      const std::array<uint8_t, RESET_SECRETLEN>& secret,
+      ngtcp2_cid* pscid);
 
   uint64_t GetMaxCryptoBuffer() const { return max_crypto_buffer_; }
+  uint64_t GetMaxMemory() const { return max_memory_; }
+  uint64_t GetMaxStreamWindow() const { return max_stream_window_; }
+  uint64_t GetMaxConnectionWindow() const { return max_connection_window_; }
 
   const ngtcp2_settings* operator*() const { return &settings_; }
 
  private:
   uint64_t max_crypto_buffer_ = DEFAULT_MAX_CRYPTO_BUFFER;
+  uint64_t max_memory_ = DEFAULT_MAX_SESSION_MEMORY;
+  uint64_t max_stream_window_ = DEFAULT_MAX_STREAM_WINDOW;
+  uint64_t max_connection_window_ = DEFAULT_MAX_CONNECTION_WINDOW;
   ngtcp2_settings settings_;
 };
 
@@ -100,7 +181,16 @@ typedef enum QuicServerSessionOptions : uint32_t {
 
   // When set, instructs the QuicServerSession to request
   // a client authentication cert
-  QUICSERVERSESSION_OPTION_REQUEST_CERT = 0x2
+  QUICSERVERSESSION_OPTION_REQUEST_CERT = 0x2,
+
+  // When set, instructs the QuicServerSession to compute the
+  // handshake signature on the libuv threadpool, suspending
+  // the TLS handshake until the signature is available.
+  QUICSERVERSESSION_OPTION_ASYNC_SIGNING = 0x4,
+
+  // When set, the QuicStreams of the QuicServerSession are created
+  // without their per-stream data histograms.
+  QUICSERVERSESSION_OPTION_LITE_STREAMS = 0x8
 } QuicServerSessionOptions;
 
 // Options to alter the behavior of various functions on the
@@ -119,9 +209,19 @@ typedef enum QuicClientSessionOptions : uint32_t {
 
   // When set, instructs the QuicClientSession to perform
   // additional checks on TLS session resumption.
-  QUICCLIENTSESSION_OPTION_RESUME = 0x4
+  QUICCLIENTSESSION_OPTION_RESUME = 0x4,
+
+  // When set, the QuicStreams of the QuicClientSession are created
+  // without their per-stream data histograms.
+  QUICCLIENTSESSION_OPTION_LITE_STREAMS = 0x8
 } QuicClientSessionOptions;
 
+// HasLiteStreams() checks the option without knowing the side.
+static_assert(
+    static_cast<uint32_t>(QUICSERVERSESSION_OPTION_LITE_STREAMS) ==
+        static_cast<uint32_t>(QUICCLIENTSESSION_OPTION_LITE_STREAMS),
+    "The lite streams options must match");
+
 
 // The QuicSessionState enums are used with the QuicSession's
 // private state_ array. This is exposed to JavaScript via an
@@ -240,6 +340,11 @@ class QuicSession : public AsyncWrap,
   // a single address is one of the benefits of QUIC.
   const SocketAddress* GetRemoteAddress() const { return &remote_address_; }
 
+  // The source prefix a QuicServerSession is counted under by its
+  // QuicSocket. It is taken from the address the client first connected
+  // from, so it does not change when the client migrates.
+  const SourcePrefix& GetSourcePrefix() const { return source_prefix_; }
+
   const ngtcp2_cid* scid() const { return &scid_; }
 
   QuicSocket* Socket() { return socket_; }
@@ -248,13 +353,53 @@ class QuicSession : public AsyncWrap,
 
   ngtcp2_conn* Connection() { return connection_.get(); }
 
+  // Returns nullptr unless qlog output was enabled for the QuicSocket.
+  QlogTrace* qlog() { return qlog_.get(); }
+
   void AddStream(QuicStream* stream);
 
+  // The memory held on behalf of the QuicSession: the memory allocated
+  // by ngtcp2, buffered TLS handshake data, packets waiting to be sent
+  // and stream data waiting to be acknowledged by the peer.
+  inline uint64_t GetMemoryUsage();
+
+  // Stream data is counted from the time it is written until the peer
+  // has acknowledged it or the stream has been destroyed.
+  inline void IncrementStreamMemory(size_t amount);
+  inline void DecrementStreamMemory(size_t amount);
+
+  // True while flow control credit is being withheld from the peer
+  // because either the QuicSession or its QuicSocket is close to its
+  // memory ceiling.
+  bool IsMemoryConstrained() {
+    return IsFlagSet(QUICSESSION_FLAG_MEMORY_CONSTRAINED);
+  }
+
+  // Refreshes the memory statistics and applies or lifts backpressure.
+  // Returns false if the memory ceiling of either the QuicSession or
+  // the QuicSocket has been exceeded.
+  bool UpdateMemoryUsage();
+
+  // The smoothed RTT in nanoseconds, or zero if there is no RTT sample
+  // yet. Receive windows are only grown once the RTT is known.
+  uint64_t GetSmoothedRTT() const {
+    return recovery_stats_.latest_rtt > 0 ?
+        static_cast<uint64_t>(recovery_stats_.smoothed_rtt) : 0;
+  }
+
+  // The largest size the receive window of a stream may grow to.
+  uint64_t GetMaxStreamWindow() const { return max_stream_window_; }
+
+  bool HasLiteStreams() {
+    return IsOptionSet(QUICSERVERSESSION_OPTION_LITE_STREAMS);
+  }
+
   // Immediately discards the state of the QuicSession
   // and renders the QuicSession instance completely
   // unusable.
   void Destroy();
   void ExtendStreamOffset(QuicStream* stream, size_t amount);
+  void ExtendStreamOffset(int64_t stream_id, size_t amount);
   void GetLocalTransportParams(ngtcp2_transport_params* params);
   uint32_t GetNegotiatedVersion();
   bool InitiateUpdateKey();
@@ -271,13 +416,14 @@ class QuicSession : public AsyncWrap,
       const uint8_t* data,
       const struct sockaddr* addr,
       unsigned int flags);
-  void ReceiveStreamData(
+  bool ReceiveStreamData(
       int64_t stream_id,
       int fin,
       const uint8_t* data,
       size_t datalen,
       uint64_t offset);
   void RemoveStream(int64_t stream_id);
+  void ResumeStream(int64_t stream_id);
   void SendPendingData();
   bool SendStreamData(QuicStream* stream);
   inline void SetLastError(
@@ -289,6 +435,14 @@ class QuicSession : public AsyncWrap,
   inline void SetLastError(QuicErrorFamily family, int error_code);
   int SetRemoteTransportParams(ngtcp2_transport_params* params);
 
+  // Submits a block of headers on the given stream. Returns false if the
+  // QuicSession does not use an application protocol that supports
+  // headers, or if the headers could not be submitted.
+  bool SubmitHeaders(
+      int64_t stream_id,
+      QuicStreamHeadersKind kind,
+      v8::Local<v8::Array> headers);
+
   // ShutdownStream will cause ngtcp2 to queue a
   // RESET_STREAM and STOP_SENDING frame, as appropriate,
   // for the given stream_id. For a locally-initiated
@@ -323,6 +477,19 @@ class QuicSession : public AsyncWrap,
   ngtcp2_crypto_side Side() const { return side_; }
   void WriteHandshake(const uint8_t* data, size_t datalen);
 
+  // Updates the certificate size statistics if the given TLS handshake
+  // message is a Certificate message.
+  void RecordCertificateBytes(
+      const uint8_t* data,
+      size_t datalen,
+      bool sent);
+
+  // Called when the private key operation for the TLS handshake has
+  // been moved to the threadpool and, later, when it has completed.
+  // The handshake is suspended in between.
+  void OnAsyncSigningStart();
+  void OnAsyncSigningDone();
+
   // These may be implemented by QuicSession types
   virtual void HandleError();
   virtual int OnClientHello() { return 0; }
@@ -367,6 +534,27 @@ class QuicSession : public AsyncWrap,
     QuicSession* session_;
   };
 
+  // While an AsyncSigningScope is active, and the QuicSession permits
+  // it, OpenSSL runs the TLS handshake within an async job so that the
+  // private key operation can be moved off the event loop thread (see
+  // EnableAsyncSigning). Because the async job runs on its own small
+  // stack, the scope is only enabled for handshake steps that will
+  // not call into JavaScript.
+  class AsyncSigningScope {
+   public:
+    explicit AsyncSigningScope(QuicSession* session);
+    ~AsyncSigningScope();
+
+    // Returns the QuicSession whose handshake is currently running
+    // within an enabled AsyncSigningScope on this thread, if any.
+    static QuicSession* Current();
+
+   private:
+    QuicSession* session_;
+    QuicSession* previous_ = nullptr;
+    bool enabled_ = false;
+  };
+
  private:
   // Returns true if the QuicSession has entered the
   // closing period following a call to ImmediateClose.
@@ -389,7 +577,8 @@ class QuicSession : public AsyncWrap,
 
   bool IsHandshakeSuspended() {
     return IsFlagSet(QUICSESSION_FLAG_CERT_CB_RUNNING) ||
-           IsFlagSet(QUICSESSION_FLAG_CLIENT_HELLO_CB_RUNNING);
+           IsFlagSet(QUICSESSION_FLAG_CLIENT_HELLO_CB_RUNNING) ||
+           IsFlagSet(QUICSESSION_FLAG_ASYNC_SIGNING);
   }
 
   void AckedCryptoOffset(size_t datalen);
@@ -495,7 +684,7 @@ class QuicSession : public AsyncWrap,
   void ExtendMaxStreamsUni(uint64_t max_streams);
   void ExtendMaxStreamsBidi(uint64_t max_streams);
   int GetNewConnectionID(ngtcp2_cid* cid, uint8_t* token, size_t cidlen);
-  void HandshakeCompleted();
+  bool HandshakeCompleted();
   void InitTLS();
   void Keylog(const char* line);
   void PathValidation(
@@ -513,7 +702,9 @@ class QuicSession : public AsyncWrap,
   bool SendPacket(const char* diagnostic_label = nullptr);
   void SetHandshakeCompleted();
   void SetLocalAddress(const ngtcp2_addr* addr);
-  void StreamClose(int64_t stream_id, uint64_t app_error_code);
+  bool StartApplication();
+  void StartQlog(const ngtcp2_cid* odcid);
+  bool StreamClose(int64_t stream_id, uint64_t app_error_code);
   void StreamOpen(int64_t stream_id);
   void StreamReset(
       int64_t stream_id,
@@ -527,6 +718,9 @@ class QuicSession : public AsyncWrap,
       const uint8_t* data,
       size_t datalen);
   void UpdateRecoveryStats();
+  void ReleaseWithheldOffset();
+  void ExtendMaxOffset(size_t amount, uint64_t rtt);
+  void EmitStatistics();
 
   virtual void DisassociateCID(const ngtcp2_cid* cid) {}
   virtual bool ReceiveRetry() { return true; }
@@ -539,6 +733,7 @@ class QuicSession : public AsyncWrap,
       const uint32_t* sv,
       size_t nsv) {}
 
+  virtual bool AllowAsyncSigning() { return false; }
   virtual void InitTLS_Post() = 0;
   virtual ngtcp2_crypto_level GetServerCryptoLevel() = 0;
   virtual ngtcp2_crypto_level GetClientCryptoLevel() = 0;
@@ -776,7 +971,15 @@ class QuicSession : public AsyncWrap,
 
     // Set if the QuicSession is in the middle of a silent close
     // (that is, a CONNECTION_CLOSE should not be sent)
-    QUICSESSION_FLAG_SILENT_CLOSE = 0x200
+    QUICSESSION_FLAG_SILENT_CLOSE = 0x200,
+
+    // Set while the handshake signature is being computed on the
+    // threadpool
+    QUICSESSION_FLAG_ASYNC_SIGNING = 0x400,
+
+    // Set while flow control credit is withheld from the peer because
+    // the QuicSession or QuicSocket is close to its memory ceiling
+    QUICSESSION_FLAG_MEMORY_CONSTRAINED = 0x800
   } QuicSessionFlags;
 
   void SetFlag(QuicSessionFlags flag, bool on = true) {
@@ -842,6 +1045,7 @@ class QuicSession : public AsyncWrap,
   crypto::SSLPointer ssl_;
   ConnectionPointer connection_;
   SocketAddress remote_address_;
+  SourcePrefix source_prefix_;
 
   uint32_t flags_ = 0;
   uint32_t options_;
@@ -850,6 +1054,13 @@ class QuicSession : public AsyncWrap,
   size_t ncread_ = 0;
   size_t max_crypto_buffer_ = DEFAULT_MAX_CRYPTO_BUFFER;
   size_t current_ngtcp2_memory_ = 0;
+  size_t current_stream_memory_ = 0;
+  uint64_t max_memory_ = DEFAULT_MAX_SESSION_MEMORY;
+  uint64_t max_stream_window_ = DEFAULT_MAX_STREAM_WINDOW;
+  // Connection level flow control credit for received data that has
+  // not been returned to the peer while memory is constrained.
+  size_t withheld_offset_ = 0;
+  ReceiveWindow receive_window_;
   size_t connection_close_attempts_ = 0;
   size_t connection_close_limit_ = 1;
 
@@ -879,12 +1090,20 @@ class QuicSession : public AsyncWrap,
   // Temporary holding for inbound TLS handshake data.
   std::vector<uint8_t> peer_handshake_;
 
+  // Keylog lines produced while the handshake is running within an
+  // OpenSSL async job. These are emitted once the job yields.
+  std::vector<std::string> keylog_backlog_;
+
   std::map<int64_t, std::shared_ptr<QuicStream>> streams_;
 
   AliasedFloat64Array state_;
 
   mem::Allocator<ngtcp2_mem> allocator_;
 
+  // Set once the handshake has completed if the negotiated ALPN
+  // identifies a supported application protocol.
+  std::unique_ptr<QuicApplication> application_;
+
   struct session_stats {
     // The timestamp at which the session was created
     uint64_t created_at;
@@ -933,6 +1152,18 @@ class QuicSession : public AsyncWrap,
     uint64_t path_validation_success_count;
     // The total number of failed path validations
     uint64_t path_validation_failure_count;
+    // The total size of the certificate messages sent
+    uint64_t cert_bytes_sent;
+    // The total size of the certificate messages received
+    uint64_t cert_bytes_received;
+    // The memory currently held by this QuicSession
+    uint64_t memory;
+    // The most memory held by this QuicSession at any one time
+    uint64_t max_memory;
+    // The current size of the connection level receive window
+    uint64_t receive_window;
+    // The total number of handshake signatures computed on the threadpool
+    uint64_t async_signing_count;
   };
   session_stats session_stats_{};
 
@@ -957,6 +1188,8 @@ class QuicSession : public AsyncWrap,
   AliasedBigUint64Array stats_buffer_;
   AliasedFloat64Array recovery_stats_buffer_;
 
+  std::unique_ptr<QlogTrace> qlog_;
+
   template <typename... Members>
   void IncrementSocketStat(
       uint64_t amount,
@@ -1018,6 +1251,7 @@ class QuicSession : public AsyncWrap,
 
   friend class QuicServerSession;
   friend class QuicClientSession;
+  friend class Http3Application;
 };
 
 class QuicServerSession : public QuicSession {
@@ -1089,6 +1323,9 @@ class QuicServerSession : public QuicSession {
       uint32_t options,
       uint64_t initial_connection_close);
 
+  bool AllowAsyncSigning() override {
+    return IsOptionSet(QUICSERVERSESSION_OPTION_ASYNC_SIGNING);
+  }
   void DisassociateCID(const ngtcp2_cid* cid) override;
   void InitTLS_Post() override;
   void RemoveFromSocket() override;
@@ -1096,7 +1333,13 @@ class QuicServerSession : public QuicSession {
   int TLSHandshake_Initial() override;
   int VerifyPeerIdentity(const char* hostname) override;
 
+  // Selects the SecureContext for the requested servername from the
+  // QuicSocket's SNIContextIndex. Returns false if the selected
+  // SecureContext could not be applied.
+  bool SelectSNIContext();
+
   bool StartClosingPeriod();
+  void ReleaseClosingPeriod();
 
   ngtcp2_crypto_level GetServerCryptoLevel() override {
     return tx_crypto_level_;
@@ -1122,7 +1365,8 @@ class QuicServerSession : public QuicSession {
   ngtcp2_cid rcid_;
 
   MallocedBuffer<uint8_t> conn_closebuf_;
-  v8::Global<v8::ArrayBufferView> ocsp_response_;
+  std::shared_ptr<SNIContextIndex::Entry> sni_context_;
+  std::shared_ptr<OCSPStaple> ocsp_staple_;
 
   const ngtcp2_conn_callbacks callbacks_ = {
     nullptr,
@@ -1198,6 +1442,7 @@ class QuicClientSession : public QuicSession {
       uint32_t options);
 
   void AddToSocket(QuicSocket* socket) override;
+  void RemoveFromSocket() override;
   int OnTLSStatus() override;
 
   bool SetEarlyTransportParams(v8::Local<v8::Value> buffer);
@@ -1262,6 +1507,10 @@ class QuicClientSession : public QuicSession {
 
   MaybeStackBuffer<char> transportParams_;
 
+  // The stateless reset token of the server, if it sent one.
+  bool has_reset_token_ = false;
+  uint8_t reset_token_[NGTCP2_STATELESS_RESET_TOKENLEN];
+
 
   const ngtcp2_conn_callbacks callbacks_ = {
     OnClientInitial,
@@ -1299,6 +1548,65 @@ class QuicClientSession : public QuicSession {
   friend class QuicSession;
 };
 
+// Reported to 'quic' PerformanceObservers when a QuicSession is
+// destroyed. Durations are captured in nanoseconds.
+class QuicSessionPerformanceEntry : public performance::PerformanceEntry {
+ public:
+  QuicSessionPerformanceEntry(
+      Environment* env,
+      ngtcp2_crypto_side side,
+      uint64_t start_time,
+      uint64_t end_time,
+      uint64_t handshake_duration,
+      double smoothed_rtt,
+      double min_rtt,
+      uint64_t bytes_sent,
+      uint64_t bytes_received,
+      uint64_t streams_in,
+      uint64_t streams_out,
+      uint64_t keyupdates,
+      uint64_t loss_retransmits) :
+          performance::PerformanceEntry(
+              env, "QuicSession", "quic", start_time, end_time),
+          side_(side),
+          handshake_duration_(handshake_duration),
+          smoothed_rtt_(smoothed_rtt),
+          min_rtt_(min_rtt),
+          bytes_sent_(bytes_sent),
+          bytes_received_(bytes_received),
+          streams_in_(streams_in),
+          streams_out_(streams_out),
+          keyupdates_(keyupdates),
+          loss_retransmits_(loss_retransmits) { }
+
+  ngtcp2_crypto_side side() const { return side_; }
+  uint64_t handshake_duration() const { return handshake_duration_; }
+  double smoothed_rtt() const { return smoothed_rtt_; }
+  double min_rtt() const { return min_rtt_; }
+  uint64_t bytes_sent() const { return bytes_sent_; }
+  uint64_t bytes_received() const { return bytes_received_; }
+  uint64_t streams_in() const { return streams_in_; }
+  uint64_t streams_out() const { return streams_out_; }
+  uint64_t keyupdates() const { return keyupdates_; }
+  uint64_t loss_retransmits() const { return loss_retransmits_; }
+
+  void Notify(v8::Local<v8::Value> obj) {
+    performance::PerformanceEntry::Notify(env(), kind(), obj);
+  }
+
+ private:
+  ngtcp2_crypto_side side_;
+  uint64_t handshake_duration_;
+  double smoothed_rtt_;
+  double min_rtt_;
+  uint64_t bytes_sent_;
+  uint64_t bytes_received_;
+  uint64_t streams_in_;
+  uint64_t streams_out_;
+  uint64_t keyupdates_;
+  uint64_t loss_retransmits_;
+};
+
 }  // namespace quic
 }  // namespace node
 
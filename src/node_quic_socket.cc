@@ -8,18 +8,23 @@
 #include "node_quic_crypto.h"
 #include "node_quic_session-inl.h"
 #include "node_quic_socket.h"
+#include "node_quic_state.h"
 #include "node_quic_util.h"
 #include "util.h"
 #include "uv.h"
 #include "v8.h"
 
+#include <algorithm>
+#include <limits>
 #include <random>
+#include <unordered_map>
 
 namespace node {
 
 using crypto::EntropySource;
 using crypto::SecureContext;
 
+using v8::ArrayBufferView;
 using v8::Boolean;
 using v8::Context;
 using v8::FunctionCallbackInfo;
@@ -59,70 +64,328 @@ inline uint32_t GenerateReservedVersion(
   h |= 0x0a0a0a0au;
   return h;
 }
+
+// The maximum number of datagrams waiting in a LoopbackEndpoint's queue.
+// Like a full UDP receive buffer, additional datagrams are dropped.
+constexpr size_t kMaxLoopbackQueue = 4096;
+
+constexpr uint16_t kMinLoopbackEphemeralPort = 49152;
+
+Mutex loopback_mutex;
+std::unordered_map<uint32_t, std::weak_ptr<LoopbackEndpoint>>
+    loopback_endpoints;
+uint16_t loopback_next_port = kMinLoopbackEphemeralPort;
+
+inline uint32_t LoopbackKey(int family, uint16_t port) {
+  return (family == AF_INET6 ? 0x10000 : 0) | port;
+}
+
+inline void SetPort(sockaddr_storage* addr, uint16_t port) {
+  if (addr->ss_family == AF_INET6)
+    reinterpret_cast<sockaddr_in6*>(addr)->sin6_port = htons(port);
+  else
+    reinterpret_cast<sockaddr_in*>(addr)->sin_port = htons(port);
+}
+
+// Endpoints are keyed only by family and port, so whatever address was
+// given, datagrams are sent from, and to, the loopback address. Peers
+// that connected to it would otherwise discard the datagrams as coming
+// from an unexpected address.
+inline void SetLoopbackAddress(sockaddr_storage* addr) {
+  if (addr->ss_family == AF_INET6) {
+    reinterpret_cast<sockaddr_in6*>(addr)->sin6_addr = in6addr_loopback;
+  } else {
+    reinterpret_cast<sockaddr_in*>(addr)->sin_addr.s_addr =
+        htonl(INADDR_LOOPBACK);
+  }
+}
 }  // namespace
 
+LoopbackEndpoint::LoopbackEndpoint(
+    QuicSocket* socket,
+    const sockaddr* addr) :
+    env_(socket->env()),
+    socket_(socket),
+    head_(&stub_),
+    tail_(&stub_) {
+  address_.Copy(addr);
+  CHECK_EQ(uv_async_init(env_->event_loop(), &async_, OnAsync), 0);
+  async_.data = this;
+}
+
+LoopbackEndpoint::~LoopbackEndpoint() {
+  while (Datagram* datagram = Pop())
+    delete datagram;
+}
+
+std::shared_ptr<LoopbackEndpoint> LoopbackEndpoint::Bind(
+    QuicSocket* socket,
+    sockaddr_storage* addr,
+    int* err) {
+  const sockaddr* address = reinterpret_cast<const sockaddr*>(addr);
+  int family = addr->ss_family;
+  uint16_t port = SocketAddress::GetPort(address);
+
+  Mutex::ScopedLock lock(loopback_mutex);
+  auto in_use = [&](uint16_t port) {
+    auto it = loopback_endpoints.find(LoopbackKey(family, port));
+    return it != loopback_endpoints.end() && !it->second.expired();
+  };
+
+  if (port == 0) {
+    size_t count = 65536 - kMinLoopbackEphemeralPort;
+    for (; count > 0 && in_use(loopback_next_port); count--) {
+      loopback_next_port =
+          loopback_next_port == 65535 ?
+              kMinLoopbackEphemeralPort :
+              loopback_next_port + 1;
+    }
+    if (count == 0) {
+      *err = UV_EADDRINUSE;
+      return nullptr;
+    }
+    port = loopback_next_port;
+    SetPort(addr, port);
+  } else if (in_use(port)) {
+    *err = UV_EADDRINUSE;
+    return nullptr;
+  }
+
+  SetLoopbackAddress(addr);
+  std::shared_ptr<LoopbackEndpoint> endpoint(
+      new LoopbackEndpoint(socket, address));
+  endpoint->self_ = endpoint;
+  loopback_endpoints[LoopbackKey(family, port)] = endpoint;
+  *err = 0;
+  return endpoint;
+}
+
+std::shared_ptr<LoopbackEndpoint> LoopbackEndpoint::Find(
+    const sockaddr* addr) {
+  Mutex::ScopedLock lock(loopback_mutex);
+  auto it = loopback_endpoints.find(
+      LoopbackKey(addr->sa_family, SocketAddress::GetPort(addr)));
+  if (it == loopback_endpoints.end())
+    return nullptr;
+  return it->second.lock();
+}
+
+bool LoopbackEndpoint::Send(
+    const sockaddr* from,
+    const uv_buf_t* bufs,
+    size_t nbufs) {
+  if (closed_)
+    return false;
+  if (queued_++ >= kMaxLoopbackQueue) {
+    queued_--;
+    return false;
+  }
+
+  std::unique_ptr<Datagram> datagram(new Datagram());
+  datagram->remote.Copy(from);
+  for (size_t n = 0; n < nbufs; n++) {
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(bufs[n].base);
+    datagram->data.insert(datagram->data.end(), base, base + bufs[n].len);
+  }
+
+  // async_ remains valid for as long as closed_ is seen as false while
+  // holding async_mutex_.
+  Mutex::ScopedLock lock(async_mutex_);
+  if (closed_) {
+    queued_--;
+    return false;
+  }
+  Push(datagram.release());
+  uv_async_send(&async_);
+  return true;
+}
+
+void LoopbackEndpoint::Close() {
+  {
+    // Past this block, no sender can still be using async_.
+    Mutex::ScopedLock lock(async_mutex_);
+    if (closed_.exchange(true))
+      return;
+  }
+
+  {
+    Mutex::ScopedLock lock(loopback_mutex);
+    auto it = loopback_endpoints.find(
+        LoopbackKey((*address_)->sa_family,
+                    SocketAddress::GetPort(*address_)));
+    if (it != loopback_endpoints.end() && it->second.lock().get() == this)
+      loopback_endpoints.erase(it);
+  }
+
+  socket_ = nullptr;
+  env_->CloseHandle(&async_, [](uv_async_t* handle) {
+    LoopbackEndpoint* endpoint = static_cast<LoopbackEndpoint*>(handle->data);
+    std::shared_ptr<LoopbackEndpoint> self = std::move(endpoint->self_);
+  });
+}
+
+// Push and Pop implement Dmitry Vyukov's intrusive multiple producer,
+// single consumer queue. Pop may transiently return nullptr while a
+// producer is between its two steps in Push; that producer's subsequent
+// uv_async_send() guarantees another Drain().
+void LoopbackEndpoint::Push(Datagram* datagram) {
+  datagram->next.store(nullptr, std::memory_order_relaxed);
+  Datagram* prev = head_.exchange(datagram, std::memory_order_acq_rel);
+  prev->next.store(datagram, std::memory_order_release);
+}
+
+LoopbackEndpoint::Datagram* LoopbackEndpoint::Pop() {
+  Datagram* tail = tail_;
+  Datagram* next = tail->next.load(std::memory_order_acquire);
+  if (tail == &stub_) {
+    if (next == nullptr)
+      return nullptr;
+    tail_ = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  if (tail != head_.load(std::memory_order_acquire))
+    return nullptr;
+  Push(&stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+void LoopbackEndpoint::OnAsync(uv_async_t* handle) {
+  static_cast<LoopbackEndpoint*>(handle->data)->Drain();
+}
+
+void LoopbackEndpoint::Drain() {
+  while (Datagram* datagram = Pop()) {
+    std::unique_ptr<Datagram> ptr(datagram);
+    queued_--;
+    // The QuicSocket may close while processing a datagram, in which
+    // case the remaining datagrams are discarded.
+    if (socket_ == nullptr || datagram->data.empty())
+      continue;
+    uv_buf_t buf =
+        uv_buf_init(
+            reinterpret_cast<char*>(datagram->data.data()),
+            datagram->data.size());
+    socket_->Receive(datagram->data.size(), &buf, *datagram->remote, 0);
+  }
+}
+
 QuicSocket::QuicSocket(
     Environment* env,
     Local<Object> wrap,
     uint64_t retry_token_expiration,
     size_t max_connections_per_host,
-    uint32_t options) :
+    double max_initial_rate,
+    double max_initial_burst,
+    uint64_t max_memory,
+    uint32_t options,
+    const std::string& qlog_dir,
+    const uint8_t* reset_secret) :
     HandleWrap(env, wrap,
                reinterpret_cast<uv_handle_t*>(&handle_),
                AsyncWrap::PROVIDER_QUICSOCKET),
     flags_(QUICSOCKET_FLAGS_NONE),
     options_(options),
     pending_callbacks_(0),
-    max_connections_per_host_(max_connections_per_host),
     current_ngtcp2_memory_(0),
+    max_memory_(max_memory),
     retry_token_expiration_(retry_token_expiration),
-    rx_loss_(0.0),
-    tx_loss_(0.0),
+    qlog_dir_(qlog_dir),
     server_secure_context_(nullptr),
     server_alpn_(NGTCP2_ALPN_H3),
     stats_buffer_(
       env->isolate(),
       sizeof(socket_stats_) / sizeof(uint64_t),
-      reinterpret_cast<uint64_t*>(&socket_stats_)) {
+      reinterpret_cast<uint64_t*>(&socket_stats_)),
+    handshake_duration_(
+      HistogramBase::New(env, 1, std::numeric_limits<int64_t>::max())),
+    session_rtt_(
+      HistogramBase::New(env, 1, std::numeric_limits<int64_t>::max())),
+    session_lifetime_(
+      HistogramBase::New(env, 1, std::numeric_limits<int64_t>::max())),
+    stream_ttfb_(
+      HistogramBase::New(env, 1, std::numeric_limits<int64_t>::max())) {
   CHECK_EQ(uv_udp_init(env->event_loop(), &handle_), 0);
-  Debug(this, "New QuicSocket created.");
+  QUIC_DEBUG(this, "New QuicSocket created.");
 
   EntropySource(token_secret_.data(), token_secret_.size());
+  if (reset_secret != nullptr)
+    std::copy_n(reset_secret, reset_secret_.size(), reset_secret_.data());
+  else
+    EntropySource(reset_secret_.data(), reset_secret_.size());
   socket_stats_.created_at = uv_hrtime();
+  prefix_limiter_.Configure(
+      max_connections_per_host,
+      max_initial_rate,
+      max_initial_burst);
 
   USE(wrap->DefineOwnProperty(
       env->context(),
       env->stats_string(),
       stats_buffer_.GetJSArray(),
       PropertyAttribute::ReadOnly));
+
+  USE(wrap->DefineOwnProperty(
+      env->context(),
+      FIXED_ONE_BYTE_STRING(env->isolate(), "handshake_duration"),
+      handshake_duration_->object(),
+      PropertyAttribute::ReadOnly));
+
+  USE(wrap->DefineOwnProperty(
+      env->context(),
+      FIXED_ONE_BYTE_STRING(env->isolate(), "session_rtt"),
+      session_rtt_->object(),
+      PropertyAttribute::ReadOnly));
+
+  USE(wrap->DefineOwnProperty(
+      env->context(),
+      FIXED_ONE_BYTE_STRING(env->isolate(), "session_lifetime"),
+      session_lifetime_->object(),
+      PropertyAttribute::ReadOnly));
+
+  USE(wrap->DefineOwnProperty(
+      env->context(),
+      FIXED_ONE_BYTE_STRING(env->isolate(), "stream_ttfb"),
+      stream_ttfb_->object(),
+      PropertyAttribute::ReadOnly));
 }
 
 QuicSocket::~QuicSocket() {
   CHECK(sessions_.empty());
   CHECK(dcid_to_scid_.empty());
+  CHECK(token_to_scid_.empty());
   uint64_t now = uv_hrtime();
-  Debug(this,
-        "QuicSocket destroyed.\n"
-        "  Duration: %" PRIu64 "\n"
-        "  Bound Duration: %" PRIu64 "\n"
-        "  Listen Duration: %" PRIu64 "\n"
-        "  Bytes Received: %" PRIu64 "\n"
-        "  Bytes Sent: %" PRIu64 "\n"
-        "  Packets Received: %" PRIu64 "\n"
-        "  Packets Sent: %" PRIu64 "\n"
-        "  Packets Ignored: %" PRIu64 "\n"
-        "  Server Sessions: %" PRIu64 "\n"
-        "  Client Sessions: %" PRIu64 "\n",
-        now - socket_stats_.created_at,
-        socket_stats_.bound_at > 0 ? now - socket_stats_.bound_at : 0,
-        socket_stats_.listen_at > 0 ? now - socket_stats_.listen_at : 0,
-        socket_stats_.bytes_received,
-        socket_stats_.bytes_sent,
-        socket_stats_.packets_received,
-        socket_stats_.packets_sent,
-        socket_stats_.packets_ignored,
-        socket_stats_.server_sessions,
-        socket_stats_.client_sessions);
+  QUIC_DEBUG(this,
+             "QuicSocket destroyed.\n"
+             "  Duration: %" PRIu64 "\n"
+             "  Bound Duration: %" PRIu64 "\n"
+             "  Listen Duration: %" PRIu64 "\n"
+             "  Bytes Received: %" PRIu64 "\n"
+             "  Bytes Sent: %" PRIu64 "\n"
+             "  Packets Received: %" PRIu64 "\n"
+             "  Packets Sent: %" PRIu64 "\n"
+             "  Packets Ignored: %" PRIu64 "\n"
+             "  Server Sessions: %" PRIu64 "\n"
+             "  Client Sessions: %" PRIu64 "\n",
+             now - socket_stats_.created_at,
+             socket_stats_.bound_at > 0 ? now - socket_stats_.bound_at : 0,
+             socket_stats_.listen_at > 0 ? now - socket_stats_.listen_at : 0,
+             socket_stats_.bytes_received,
+             socket_stats_.bytes_sent,
+             socket_stats_.packets_received,
+             socket_stats_.packets_sent,
+             socket_stats_.packets_ignored,
+             socket_stats_.server_sessions,
+             socket_stats_.client_sessions);
 }
 
 void QuicSocket::MemoryInfo(MemoryTracker* tracker) const {
@@ -133,7 +396,7 @@ void QuicSocket::AddSession(
     QuicCID* cid,
     std::shared_ptr<QuicSession> session) {
   sessions_[cid->ToStr()] = session;
-  IncrementSocketAddressCounter(**session->GetRemoteAddress());
+  prefix_limiter_.AddConnection(session->GetSourcePrefix());
   IncrementSocketStat(
       1, &socket_stats_,
       session->Side() == NGTCP2_CRYPTO_SIDE_SERVER ?
@@ -147,14 +410,23 @@ void QuicSocket::AssociateCID(
   dcid_to_scid_.emplace(cid->ToStr(), scid->ToStr());
 }
 
+void QuicSocket::AssociateStatelessResetToken(
+    const uint8_t* token,
+    QuicCID* scid) {
+  token_to_scid_.emplace(
+      std::string(reinterpret_cast<const char*>(token),
+                  NGTCP2_STATELESS_RESET_TOKENLEN),
+      scid->ToStr());
+}
+
 int QuicSocket::Bind(
     const char* address,
     uint32_t port,
     uint32_t flags,
     int family) {
-  Debug(this,
-        "Binding to address %s, port %d, with flags %d, and family %d",
-        address, port, flags, family);
+  QUIC_DEBUG(this,
+             "Binding to address %s, port %d, with flags %d, and family %d",
+             address, port, flags, family);
 
   HandleScope scope(env()->isolate());
   Context::Scope context_scope(env()->context());
@@ -166,19 +438,26 @@ int QuicSocket::Bind(
 
   Local<Value> arg = Undefined(env()->isolate());
 
-  err =
-      uv_udp_bind(
-          &handle_,
-          reinterpret_cast<const sockaddr*>(&addr),
-          flags);
+  if (IsLoopback()) {
+    loopback_ = LoopbackEndpoint::Bind(this, &addr, &err);
+  } else {
+    err =
+        uv_udp_bind(
+            &handle_,
+            reinterpret_cast<const sockaddr*>(&addr),
+            flags);
+  }
   if (err != 0) {
-    Debug(this, "Bind failed. Error %d", err);
+    QUIC_DEBUG(this, "Bind failed. Error %d", err);
     arg = Integer::New(env()->isolate(), err);
     MakeCallback(env()->quic_on_socket_error_function(), 1, &arg);
     return 0;
   }
 
-  local_address_.Set(&handle_);
+  if (IsLoopback())
+    local_address_.Copy(reinterpret_cast<const sockaddr*>(&addr));
+  else
+    local_address_.Set(&handle_);
 
 #if !defined(_WIN32)
   int fd = UV_EBADF;
@@ -207,7 +486,15 @@ void QuicSocket::Close(Local<Value> close_callback) {
   if (!IsInitialized() || IsFlagSet(QUICSOCKET_FLAGS_PENDING_CLOSE))
     return;
   SetFlag(QUICSOCKET_FLAGS_PENDING_CLOSE);
-  Debug(this, "Closing");
+  QUIC_DEBUG(this, "Closing");
+
+  // Packets still held by the network emulator are lost in flight.
+  emulated_packets_.clear();
+
+  // Only a draining QuicSocket waits for the closing periods of its
+  // closed connections to end.
+  if (!IsDraining())
+    ClearClosedConnections();
 
   CHECK_EQ(false, persistent().IsEmpty());
   if (!close_callback.IsEmpty() && close_callback->IsFunction()) {
@@ -221,16 +508,25 @@ void QuicSocket::Close(Local<Value> close_callback) {
 }
 
 // A QuicSocket can close if there are no pending udp send
-// callbacks and QuicSocket::Close() has been called.
+// callbacks and QuicSocket::Close() has been called. Closed
+// connections only remain if the QuicSocket is draining, in
+// which case it waits for their closing periods to end.
 void QuicSocket::MaybeClose() {
   if (!IsInitialized() ||
       !IsFlagSet(QUICSOCKET_FLAGS_PENDING_CLOSE) ||
-      HasPendingCallbacks())
+      HasPendingCallbacks() ||
+      !closed_connection_expiry_.empty())
     return;
 
   CHECK_EQ(false, persistent().IsEmpty());
 
-  Debug(this, "Closing the libuv handle");
+  QUIC_DEBUG(this, "Closing the libuv handle");
+
+  if (loopback_) {
+    loopback_->Close();
+    loopback_.reset();
+  }
+  loopback_peer_.reset();
 
   // Close the libuv handle first. The OnClose handler
   // will free the QuicSocket instance after it invokes
@@ -242,10 +538,38 @@ void QuicSocket::MaybeClose() {
 
 
 void QuicSocket::DisassociateCID(QuicCID* cid) {
-  Debug(this, "Removing associations for cid %s", cid->ToHex().c_str());
+  QUIC_DEBUG(this, "Removing associations for cid %s", cid->ToHex().c_str());
   dcid_to_scid_.erase(cid->ToStr());
 }
 
+void QuicSocket::DisassociateStatelessResetToken(const uint8_t* token) {
+  token_to_scid_.erase(
+      std::string(reinterpret_cast<const char*>(token),
+                  NGTCP2_STATELESS_RESET_TOKENLEN));
+}
+
+// Returns the client session that received the given stateless reset
+// token in the transport parameters of the server, if any.
+std::shared_ptr<QuicSession> QuicSocket::FindStatelessResetSession(
+    ssize_t nread,
+    const uint8_t* data) {
+  if (token_to_scid_.empty() ||
+      static_cast<size_t>(nread) < NGTCP2_MIN_STATELESS_RESET_RANDLEN +
+                                   NGTCP2_STATELESS_RESET_TOKENLEN) {
+    return {};
+  }
+  auto token_it = token_to_scid_.find(
+      std::string(
+          reinterpret_cast<const char*>(data) + nread -
+              NGTCP2_STATELESS_RESET_TOKENLEN,
+          NGTCP2_STATELESS_RESET_TOKENLEN));
+  if (token_it == std::end(token_to_scid_))
+    return {};
+  auto session_it = sessions_.find((*token_it).second);
+  CHECK_NE(session_it, std::end(sessions_));
+  return (*session_it).second;
+}
+
 void QuicSocket::Listen(
     SecureContext* sc,
     const sockaddr* preferred_address,
@@ -254,9 +578,10 @@ void QuicSocket::Listen(
   CHECK_NOT_NULL(sc);
   CHECK_NULL(server_secure_context_);
   CHECK(!IsFlagSet(QUICSOCKET_FLAGS_SERVER_LISTENING));
-  Debug(this, "Starting to listen.");
+  QUIC_DEBUG(this, "Starting to listen.");
   server_session_config_.Set(env(), preferred_address);
   server_secure_context_ = sc;
+  sni_contexts_.SetDefault(sc);
   server_alpn_ = alpn;
   server_options_ = options;
   SetFlag(QUICSOCKET_FLAGS_SERVER_LISTENING);
@@ -264,6 +589,15 @@ void QuicSocket::Listen(
   ReceiveStart();
 }
 
+bool QuicSocket::AddSNIContext(
+    const std::string& servername,
+    SecureContext* context) {
+  QUIC_DEBUG(this,
+             "Adding SecureContext for servername %s.",
+             servername.c_str());
+  return sni_contexts_.Add(servername, context);
+}
+
 // StopListening is called when the QuicSocket is no longer
 // accepting new server connections. Typically, this is called
 // when the QuicSocket enters a graceful closing state where
@@ -272,7 +606,7 @@ void QuicSocket::Listen(
 void QuicSocket::StopListening() {
   if (!IsFlagSet(QUICSOCKET_FLAGS_SERVER_LISTENING))
     return;
-  Debug(this, "Stop listening.");
+  QUIC_DEBUG(this, "Stop listening.");
   SetFlag(QUICSOCKET_FLAGS_SERVER_LISTENING, false);
 }
 
@@ -298,11 +632,16 @@ void QuicSocket::OnRecv(
   QuicSocket* socket = static_cast<QuicSocket*>(handle->data);
   CHECK_NOT_NULL(socket);
 
+  // Explicit Congestion Notification is not used. It requires the ECN
+  // codepoint of each received datagram, which uv_udp_recv_start() does
+  // not expose, as well as ECN count reporting and CE mark handling in
+  // ngtcp2, so packets are sent as Not-ECT.
+
   if (nread == 0)
     return;
 
   if (nread < 0) {
-    Debug(socket, "Reading data from UDP socket failed. Error %d", nread);
+    QUIC_DEBUG(socket, "Reading data from UDP socket failed. Error %d", nread);
     Environment* env = socket->env();
     HandleScope scope(env->isolate());
     Context::Scope context_scope(env->context());
@@ -319,18 +658,27 @@ void QuicSocket::Receive(
     const uv_buf_t* buf,
     const struct sockaddr* addr,
     unsigned int flags) {
-  Debug(this, "Receiving %d bytes from the UDP socket.", nread);
+  QUIC_DEBUG(this, "Receiving %d bytes from the UDP socket.", nread);
 
-  // When diagnostic packet loss is enabled, the packet will be randomly
-  // dropped based on the rx_loss_ probability.
-  if (UNLIKELY(IsDiagnosticPacketLoss(rx_loss_))) {
-    Debug(this, "Simulating received packet loss.");
+  // When a network emulation profile is set, the packet may be dropped
+  // or held and processed later by OnEmulatorTimeout.
+  uv_buf_t packet = uv_buf_init(buf->base, nread);
+  if (UNLIKELY(Emulate(false, &packet, 1, addr, flags)))
     return;
-  }
 
-  IncrementSocketStat(nread, &socket_stats_, &socket_stats::bytes_received);
+  ProcessReceivedPacket(
+      nread,
+      reinterpret_cast<const uint8_t*>(buf->base),
+      addr,
+      flags);
+}
 
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buf->base);
+void QuicSocket::ProcessReceivedPacket(
+    ssize_t nread,
+    const uint8_t* data,
+    const struct sockaddr* addr,
+    unsigned int flags) {
+  IncrementSocketStat(nread, &socket_stats_, &socket_stats::bytes_received);
 
   uint32_t pversion;
   const uint8_t* pdcid;
@@ -363,9 +711,8 @@ void QuicSocket::Receive(
   QuicCID dcid(pdcid, pdcidlen);
   QuicCID scid(pscid, pscidlen);
 
-  auto dcid_hex = dcid.ToHex();
   auto dcid_str = dcid.ToStr();
-  Debug(this, "Received a QUIC packet for dcid %s", dcid_hex.c_str());
+  QUIC_DEBUG(this, "Received a QUIC packet for dcid %s", dcid.ToHex().c_str());
 
   // Grabbing a shared pointer to prevent the QuicSession from
   // desconstructing while we're still using it. The session may
@@ -378,45 +725,73 @@ void QuicSocket::Receive(
   if (session_it == std::end(sessions_)) {
     auto scid_it = dcid_to_scid_.find(dcid_str);
     if (scid_it == std::end(dcid_to_scid_)) {
-      Debug(this, "There is no existing session for dcid %s", dcid_hex.c_str());
-
-      // TODO(@jasnell): If the DCID was previously known, and there is a
-      // known stateless reset token, then we should we ought to be able
-      // to send a stateless reset at this point. It's likely that the
-      // endpoint crashed and the peer is still trying to send data.
-      // Currently, however, we don't keep track of previously used CID's
-      // and their reset tokens so we can't implement this yet. A proper
-      // implementation will track CIDs and reset tokens but only across
-      // a single restart. These will be associated with the local address
-      // (that is, a QuicSocket bound to one local port should never use
-      // the CIDs and reset tokens from a QuicSocket bound to another).
-      // It's not entirely clear how this should be implemented.
-
-      // AcceptInitialPacket will first validate that the packet can be
-      // accepted, then create a new QuicServerSession instance if able
-      // to do so. If a new instance cannot be created (for any reason),
-      // the session shared_ptr will be empty on return.
-      session = AcceptInitialPacket(
-          pversion,
-          &dcid,
-          &scid,
-          nread,
-          data,
-          addr,
-          flags);
-
-      // There are many reasons why a QuicServerSession could not be
-      // created. The most common will be invalid packets or incorrect
-      // QUIC version. In any of these cases, however, to prevent a
-      // potential attacker from causing us to consume resources,
-      // we're just going to ignore the packet. It is possible that
-      // the AcceptInitialPacket sent a version negotiation packet,
-      // or (in the future) a CONNECTION_CLOSE packet.
-      if (!session) {
-        Debug(this, "Could not initialize a new QuicServerSession.");
-        IncrementSocketStat(1, &socket_stats_, &socket_stats::packets_ignored);
+      QUIC_DEBUG(this,
+                 "There is no existing session for dcid %s",
+                 dcid.ToHex().c_str());
+
+      if (UNLIKELY(!closed_connections_.empty()) &&
+          SendClosedConnection(dcid_str, addr)) {
+        IncrementSocketStat(1, &socket_stats_, &socket_stats::packets_received);
         return;
       }
+
+      // A packet with a short header can only belong to an established
+      // connection. If the DCID is not known, the connection was most
+      // likely lost when this process restarted and the peer is still
+      // trying to send data. As stateless reset tokens are derived from
+      // the CID, a stateless reset can be sent without having to keep
+      // track of CIDs that were used in the past, so long as the same
+      // reset secret is used across restarts.
+      //
+      // The packet may also be a stateless reset sent by a server that
+      // lost the state of one of our client sessions. Its DCID is random,
+      // so it is routed by the token in its last bytes instead, leaving
+      // ngtcp2 to verify it. Only the token from the server's transport
+      // parameters is known, as ngtcp2 does not surface the tokens of
+      // NEW_CONNECTION_ID frames.
+      if ((data[0] & 0x80) == 0) {
+        session = FindStatelessResetSession(nread, data);
+        if (!session) {
+          if (SendStatelessReset(&dcid, addr, nread)) {
+            IncrementSocketStat(
+                1, &socket_stats_,
+                &socket_stats::stateless_resets);
+          }
+          IncrementSocketStat(
+              1, &socket_stats_,
+              &socket_stats::packets_ignored);
+          return;
+        }
+        QUIC_DEBUG(this, "Received a possible stateless reset.");
+      } else {
+        // AcceptInitialPacket will first validate that the packet can be
+        // accepted, then create a new QuicServerSession instance if able
+        // to do so. If a new instance cannot be created (for any reason),
+        // the session shared_ptr will be empty on return.
+        session = AcceptInitialPacket(
+            pversion,
+            &dcid,
+            &scid,
+            nread,
+            data,
+            addr,
+            flags);
+
+        // There are many reasons why a QuicServerSession could not be
+        // created. The most common will be invalid packets or incorrect
+        // QUIC version. In any of these cases, however, to prevent a
+        // potential attacker from causing us to consume resources,
+        // we're just going to ignore the packet. It is possible that
+        // the AcceptInitialPacket sent a version negotiation packet,
+        // or (in the future) a CONNECTION_CLOSE packet.
+        if (!session) {
+          QUIC_DEBUG(this, "Could not initialize a new QuicServerSession.");
+          IncrementSocketStat(
+              1, &socket_stats_,
+              &socket_stats::packets_ignored);
+          return;
+        }
+      }
     } else {
       session_it = sessions_.find((*scid_it).second);
       session = (*session_it).second;
@@ -439,6 +814,9 @@ void QuicSocket::Receive(
 }
 
 int QuicSocket::ReceiveStart() {
+  // Loopback endpoints receive for as long as they are bound.
+  if (IsLoopback())
+    return 0;
   int err = uv_udp_recv_start(&handle_, OnAlloc, OnRecv);
   if (err == UV_EALREADY)
     err = 0;
@@ -446,12 +824,14 @@ int QuicSocket::ReceiveStart() {
 }
 
 int QuicSocket::ReceiveStop() {
+  if (IsLoopback())
+    return 0;
   return uv_udp_recv_stop(&handle_);
 }
 
-void QuicSocket::RemoveSession(QuicCID* cid, const sockaddr* addr) {
+void QuicSocket::RemoveSession(QuicCID* cid, const SourcePrefix& prefix) {
   sessions_.erase(cid->ToStr());
-  DecrementSocketAddressCounter(addr);
+  prefix_limiter_.RemoveConnection(prefix);
 }
 
 void QuicSocket::ReportSendError(int error) {
@@ -561,6 +941,70 @@ void QuicSocket::SendVersionNegotiation(
   req->Send();
 }
 
+// A stateless reset is always smaller than the packet that triggered
+// it so that two endpoints that have both lost the connection state
+// cannot keep resetting each other indefinitely.
+bool QuicSocket::SendStatelessReset(
+    QuicCID* dcid,
+    const sockaddr* addr,
+    size_t pktlen) {
+  if (UNLIKELY(IsOptionSet(QUICSOCKET_OPTIONS_DISABLE_STATELESS_RESET)))
+    return false;
+
+  constexpr size_t kMinStatelessResetLen =
+      NGTCP2_MIN_STATELESS_RESET_RANDLEN + NGTCP2_STATELESS_RESET_TOKENLEN;
+  if (pktlen <= kMinStatelessResetLen)
+    return false;
+
+  uint64_t now = uv_hrtime();
+  if (now > stateless_reset_updated_at_) {
+    stateless_reset_tokens_ =
+        std::min(MAX_STATELESS_RESET_RATE,
+                 stateless_reset_tokens_ +
+                     (now - stateless_reset_updated_at_) *
+                         MAX_STATELESS_RESET_RATE / 1e9);
+    stateless_reset_updated_at_ = now;
+  }
+  if (stateless_reset_tokens_ < 1) {
+    QUIC_DEBUG(this, "Stateless reset rate exceeded");
+    return false;
+  }
+  stateless_reset_tokens_ -= 1;
+
+  uint8_t token[NGTCP2_STATELESS_RESET_TOKENLEN];
+  if (!GenerateResetToken(token, reset_secret_, **dcid))
+    return false;
+
+  const size_t pktlen_max =
+      std::min(pktlen - 1, static_cast<size_t>(NGTCP2_MAX_PKTLEN_IPV6));
+  std::array<uint8_t, NGTCP2_MAX_PKTLEN_IPV6> random;
+  const size_t randlen = pktlen_max - NGTCP2_STATELESS_RESET_TOKENLEN;
+  PooledRandomBytes(random.data(), randlen);
+
+  SendWrapStack* req =
+      new SendWrapStack(
+          this,
+          addr,
+          pktlen_max,
+          "stateless reset");
+
+  ssize_t nwrite =
+      ngtcp2_pkt_write_stateless_reset(
+          req->buffer(),
+          pktlen_max,
+          token,
+          random.data(),
+          randlen);
+  if (nwrite < 0) {
+    delete req;
+    return false;
+  }
+  QUIC_DEBUG(this, "Sending stateless reset for dcid %s",
+             dcid->ToHex().c_str());
+  req->SetLength(nwrite);
+  return req->Send() == 0;
+}
+
 ssize_t QuicSocket::SendRetry(
     uint32_t version,
     QuicCID* dcid,
@@ -608,6 +1052,7 @@ ssize_t QuicSocket::SendRetry(
   if (nwrite <= 0)
     return nwrite;
   req->SetLength(nwrite);
+  IncrementSocketStat(1, &socket_stats_, &socket_stats::handshakes_retried);
 
   return req->Send();
 }
@@ -652,7 +1097,7 @@ std::shared_ptr<QuicSession> QuicSocket::AcceptInitialPacket(
   uint64_t initial_connection_close = NGTCP2_NO_ERROR;
 
   if (!IsFlagSet(QUICSOCKET_FLAGS_SERVER_LISTENING)) {
-    Debug(this, "QuicSocket is not listening");
+    QUIC_DEBUG(this, "QuicSocket is not listening");
     return session;
   }
 
@@ -669,18 +1114,50 @@ std::shared_ptr<QuicSession> QuicSocket::AcceptInitialPacket(
       break;
   }
 
+  // Floods of Initial packets from a single source prefix are dropped
+  // here, before any keys are derived or retry tokens are validated.
+  switch (prefix_limiter_.AcceptInitial(SourcePrefix::From(addr),
+                                        uv_hrtime())) {
+    case SourcePrefixLimiter::Result::CONNECTION_LIMIT:
+      QUIC_DEBUG(this, "Connection count for source prefix exceeded");
+      IncrementSocketStat(
+          1, &socket_stats_,
+          &socket_stats::initials_connection_limited);
+      return session;
+    case SourcePrefixLimiter::Result::RATE_LIMIT:
+      QUIC_DEBUG(this, "Initial rate for source prefix exceeded");
+      IncrementSocketStat(
+          1, &socket_stats_,
+          &socket_stats::initials_rate_limited);
+      return session;
+    case SourcePrefixLimiter::Result::OK:
+      break;
+  }
+
   // If the server is busy, new connections will be shut down immediately
   // after the initial keys are installed.
   if (IsFlagSet(QUICSOCKET_FLAGS_SERVER_BUSY)) {
-    Debug(this, "QuicSocket is busy");
+    QUIC_DEBUG(this, "QuicSocket is busy");
     initial_connection_close = NGTCP2_SERVER_BUSY;
   }
 
-  // Check to see if the number of connections for this peer has been exceeded.
-  // If the count has been exceeded, shutdown the connection immediately
-  // after the initial keys are installed.
-  if (GetCurrentSocketAddressCounter(addr) >= max_connections_per_host_) {
-    Debug(this, "Connection count for address exceeded");
+  // New connections are refused while the QuicSocket is close to its
+  // memory ceiling.
+  if (IsMemoryConstrained()) {
+    QUIC_DEBUG(this, "QuicSocket memory limit reached");
+    initial_connection_close = NGTCP2_SERVER_BUSY;
+  }
+
+  // With admission control in retry mode, an overloaded QuicSocket first
+  // answers with a Retry, which costs no per-connection state and delays
+  // the client by a round trip. Clients that return with a valid token
+  // while the QuicSocket is still overloaded are refused.
+  bool overloaded =
+      admission_.IsEnabled() && admission_.IsOverloaded(sessions_.size());
+  bool admission_retry =
+      overloaded && IsFlagSet(QUICSOCKET_FLAGS_ADMISSION_RETRY);
+  if (overloaded && !admission_retry) {
+    QUIC_DEBUG(this, "QuicSocket is overloaded");
     initial_connection_close = NGTCP2_SERVER_BUSY;
   }
 
@@ -694,14 +1171,14 @@ std::shared_ptr<QuicSession> QuicSocket::AcceptInitialPacket(
   // If initial_connection_close is not NGTCP2_NO_ERROR, skip address
   // validation since we're going to reject the connection anyway.
   if (initial_connection_close == NGTCP2_NO_ERROR &&
-      IsOptionSet(QUICSOCKET_OPTIONS_VALIDATE_ADDRESS) &&
+      (IsOptionSet(QUICSOCKET_OPTIONS_VALIDATE_ADDRESS) || admission_retry) &&
       hd.type == NGTCP2_PKT_INITIAL) {
       // If the VALIDATE_ADDRESS_LRU option is set, IsValidatedAddress
       // will check to see if the given address is in the validated_addrs_
       // LRU cache. If it is, we'll skip the validation step entirely.
       // The VALIDATE_ADDRESS_LRU option is disable by default.
-    if (!IsValidatedAddress(addr)) {
-      Debug(this, "Performing explicit address validation.");
+    if (admission_retry || !IsValidatedAddress(addr)) {
+      QUIC_DEBUG(this, "Performing explicit address validation.");
       if (InvalidRetryToken(
               env(),
               &ocid,
@@ -709,18 +1186,28 @@ std::shared_ptr<QuicSession> QuicSocket::AcceptInitialPacket(
               addr,
               &token_secret_,
               retry_token_expiration_)) {
-        Debug(this, "A valid retry token was not found. Sending retry.");
+        QUIC_DEBUG(this, "A valid retry token was not found. Sending retry.");
         SendRetry(version, dcid, scid, addr);
         return session;
       }
-      Debug(this, "A valid retry token was found. Continuing.");
+      QUIC_DEBUG(this, "A valid retry token was found. Continuing.");
       SetValidatedAddress(addr);
       ocid_ptr = &ocid;
+      if (admission_retry) {
+        QUIC_DEBUG(this, "QuicSocket is still overloaded");
+        initial_connection_close = NGTCP2_SERVER_BUSY;
+      }
     } else {
-      Debug(this, "Skipping validation for recently validated address.");
+      QUIC_DEBUG(this, "Skipping validation for recently validated address.");
     }
   }
 
+  IncrementSocketStat(
+      1, &socket_stats_,
+      initial_connection_close == NGTCP2_NO_ERROR ?
+          &socket_stats::handshakes_admitted :
+          &socket_stats::handshakes_rejected);
+
   session =
       QuicServerSession::New(
           this,
@@ -744,69 +1231,211 @@ std::shared_ptr<QuicSession> QuicSocket::AcceptInitialPacket(
   return session;
 }
 
-void QuicSocket::IncrementSocketAddressCounter(const sockaddr* addr) {
-  addr_counts_[addr]++;
+void QuicSocket::SetServerBusy(bool on) {
+  QUIC_DEBUG(this, "Turning Server Busy Response %s", on ? "on" : "off");
+  SetFlag(QUICSOCKET_FLAGS_SERVER_BUSY, on);
+
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+  Local<Value> arg = Boolean::New(env()->isolate(), on);
+  MakeCallback(env()->quic_on_socket_server_busy_function(), 1, &arg);
+}
+
+void QuicSocket::StartDraining() {
+  QUIC_DEBUG(this, "Draining");
+  StopListening();
+  SetFlag(QUICSOCKET_FLAGS_DRAINING);
 }
 
-void QuicSocket::DecrementSocketAddressCounter(const sockaddr* addr) {
-  auto it = addr_counts_.find(addr);
-  if (it == std::end(addr_counts_))
+void QuicSocket::AddClosedConnection(
+    std::vector<std::string>&& cids,
+    const uint8_t* packet,
+    size_t packetlen,
+    uint64_t duration) {
+  if (IsFlagSet(QUICSOCKET_FLAGS_PENDING_CLOSE) && !IsDraining())
     return;
-  it->second--;
-  // Remove the address if the counter reaches zero again.
-  if (it->second == 0)
-    addr_counts_.erase(addr);
+  auto closed = std::make_shared<ClosedConnection>();
+  closed->cids = std::move(cids);
+  closed->packet.assign(packet, packet + packetlen);
+  closed->memory = sizeof(ClosedConnection) + packetlen;
+  for (const std::string& cid : closed->cids) {
+    closed_connections_[cid] = closed;
+    closed->memory += sizeof(std::string) + cid.size();
+  }
+  closed_connection_memory_ += closed->memory;
+  socket_stats_.memory = GetMemoryUsage();
+
+  uint64_t now = uv_hrtime();
+  closed_connection_expiry_.emplace(now + duration, std::move(closed));
+  if (!closed_connection_timer_) {
+    closed_connection_timer_.reset(
+        new Timer(env(), OnClosedConnectionTimeoutCB, this));
+  }
+  ScheduleClosedConnectionTimer(now);
 }
 
-size_t QuicSocket::GetCurrentSocketAddressCounter(const sockaddr* addr) {
-  auto it = addr_counts_.find(addr);
-  if (it == std::end(addr_counts_))
-    return 0;
-  return (*it).second;
+bool QuicSocket::SendClosedConnection(
+    const std::string& dcid,
+    const sockaddr* addr) {
+  auto closed_it = closed_connections_.find(dcid);
+  if (closed_it == std::end(closed_connections_))
+    return false;
+
+  ClosedConnection* closed = (*closed_it).second.get();
+  if (closed->attempts < kMaxSizeT)
+    closed->attempts++;
+  if (closed->attempts != closed->limit)
+    return true;
+  closed->limit =
+      closed->limit * 2 <= kMaxSizeT ? closed->limit * 2 : kMaxSizeT;
+
+  QUIC_DEBUG(this, "Sending connection close for a closed connection");
+  SendWrapStack* req =
+      new SendWrapStack(
+          this,
+          addr,
+          closed->packet.size(),
+          "closed connection");
+  memcpy(req->buffer(), closed->packet.data(), closed->packet.size());
+  req->SetLength(closed->packet.size());
+  req->Send();
+  return true;
 }
 
-void QuicSocket::SetServerBusy(bool on) {
-  Debug(this, "Turning Server Busy Response %s", on ? "on" : "off");
-  SetFlag(QUICSOCKET_FLAGS_SERVER_BUSY, on);
+void QuicSocket::ScheduleClosedConnectionTimer(uint64_t now) {
+  if (closed_connection_expiry_.empty())
+    return;
+  uint64_t expires_at = closed_connection_expiry_.begin()->first;
+  uint64_t timeout = 0;
+  if (expires_at > now)
+    timeout = (expires_at - now + 999999) / 1000000;
+  closed_connection_timer_->Once(timeout);
+}
 
-  HandleScope handle_scope(env()->isolate());
-  Context::Scope context_scope(env()->context());
-  Local<Value> arg = Boolean::New(env()->isolate(), on);
-  MakeCallback(env()->quic_on_socket_server_busy_function(), 1, &arg);
+void QuicSocket::OnClosedConnectionTimeoutCB(void* data) {
+  static_cast<QuicSocket*>(data)->OnClosedConnectionTimeout();
+}
+
+void QuicSocket::OnClosedConnectionTimeout() {
+  uint64_t now = uv_hrtime();
+  auto it = closed_connection_expiry_.begin();
+  while (it != std::end(closed_connection_expiry_) && it->first <= now) {
+    for (const std::string& cid : it->second->cids)
+      closed_connections_.erase(cid);
+    closed_connection_memory_ -= it->second->memory;
+    it = closed_connection_expiry_.erase(it);
+  }
+  socket_stats_.memory = GetMemoryUsage();
+  if (closed_connection_expiry_.empty())
+    MaybeClose();
+  else
+    ScheduleClosedConnectionTimer(now);
+}
+
+void QuicSocket::ClearClosedConnections() {
+  closed_connections_.clear();
+  closed_connection_expiry_.clear();
+  closed_connection_memory_ = 0;
+  socket_stats_.memory = GetMemoryUsage();
+  if (closed_connection_timer_)
+    closed_connection_timer_->Stop();
+}
+
+void QuicSocket::SetAdmissionControl(
+    uint64_t max_loop_delay,
+    size_t max_sessions,
+    uint64_t resolution,
+    bool retry) {
+  QUIC_DEBUG(this,
+             "Setting admission control: max loop delay %" PRIu64
+             " ns, max sessions %" PRIu64 ", %s",
+             max_loop_delay,
+             static_cast<uint64_t>(max_sessions),
+             retry ? "retry" : "reject");
+  admission_.Configure(max_loop_delay, max_sessions);
+  SetFlag(QUICSOCKET_FLAGS_ADMISSION_RETRY, retry);
+  socket_stats_.loop_delay = 0;
+
+  // The event loop delay is only sampled while it is being checked.
+  if (max_loop_delay == 0) {
+    loop_delay_timer_.reset();
+    return;
+  }
+  if (!loop_delay_timer_)
+    loop_delay_timer_.reset(new Timer(env(), OnLoopDelayTimeoutCB, this));
+  loop_delay_resolution_ = resolution;
+  loop_delay_sampled_at_ = uv_hrtime();
+  loop_delay_timer_->Update(resolution);
+}
+
+void QuicSocket::OnLoopDelayTimeoutCB(void* data) {
+  static_cast<QuicSocket*>(data)->OnLoopDelayTimeout();
+}
+
+void QuicSocket::OnLoopDelayTimeout() {
+  uint64_t now = uv_hrtime();
+  uint64_t elapsed = now - loop_delay_sampled_at_;
+  uint64_t interval = loop_delay_resolution_ * 1000000;
+  admission_.RecordLoopDelay(elapsed > interval ? elapsed - interval : 0);
+  socket_stats_.loop_delay = admission_.loop_delay();
+  loop_delay_sampled_at_ = now;
+}
+
+void QuicSocket::RecordHandshakeDuration(uint64_t duration) {
+  handshake_duration_->Record(duration);
+}
+
+void QuicSocket::RecordSessionClosed(
+    uint64_t lifetime,
+    uint64_t smoothed_rtt) {
+  session_lifetime_->Record(lifetime);
+  // Sessions closed before an RTT sample was taken pass zero.
+  if (smoothed_rtt > 0)
+    session_rtt_->Record(smoothed_rtt);
+}
+
+void QuicSocket::RecordStreamTimeToFirstByte(uint64_t ttfb) {
+  stream_ttfb_->Record(ttfb);
+}
+
+void QuicSocket::UpdateSessionMemory(uint64_t previous, uint64_t current) {
+  CHECK_GE(session_memory_, previous);
+  session_memory_ = session_memory_ - previous + current;
+  socket_stats_.memory = GetMemoryUsage();
 }
 
 int QuicSocket::SetTTL(int ttl) {
-  Debug(this, "Setting UDP TTL to %d", ttl);
+  QUIC_DEBUG(this, "Setting UDP TTL to %d", ttl);
   return uv_udp_set_ttl(&handle_, ttl);
 }
 
 int QuicSocket::SetMulticastTTL(int ttl) {
-  Debug(this, "Setting UDP Multicast TTL to %d", ttl);
+  QUIC_DEBUG(this, "Setting UDP Multicast TTL to %d", ttl);
   return uv_udp_set_multicast_ttl(&handle_, ttl);
 }
 
 int QuicSocket::SetBroadcast(bool on) {
-  Debug(this, "Turning UDP Broadcast %s", on ? "on" : "off");
+  QUIC_DEBUG(this, "Turning UDP Broadcast %s", on ? "on" : "off");
   return uv_udp_set_broadcast(&handle_, on ? 1 : 0);
 }
 
 int QuicSocket::SetMulticastLoopback(bool on) {
-  Debug(this, "Turning UDP Multicast Loopback %s", on ? "on" : "off");
+  QUIC_DEBUG(this, "Turning UDP Multicast Loopback %s", on ? "on" : "off");
   return uv_udp_set_multicast_loop(&handle_, on ? 1 : 0);
 }
 
 int QuicSocket::SetMulticastInterface(const char* iface) {
-  Debug(this, "Setting the UDP Multicast Interface to %s", iface);
+  QUIC_DEBUG(this, "Setting the UDP Multicast Interface to %s", iface);
   return uv_udp_set_multicast_interface(&handle_, iface);
 }
 
 int QuicSocket::AddMembership(const char* address, const char* iface) {
-  Debug(this, "Joining UDP group: address %s, iface %s", address, iface);
+  QUIC_DEBUG(this, "Joining UDP group: address %s, iface %s", address, iface);
   return uv_udp_set_membership(&handle_, address, iface, UV_JOIN_GROUP);
 }
 
 int QuicSocket::DropMembership(const char* address, const char* iface) {
-  Debug(this, "Leaving UDP group: address %s, iface %s", address, iface);
+  QUIC_DEBUG(this, "Leaving UDP group: address %s, iface %s", address, iface);
   return uv_udp_set_membership(&handle_, address, iface, UV_LEAVE_GROUP);
 }
 
@@ -822,9 +1451,9 @@ int QuicSocket::SendPacket(
   if (buffer->Length() == 0 || buffer->RemainingLength() == 0)
     return 0;
 
-  char* host;
-  SocketAddress::GetAddress(dest, &host);
-  Debug(this, "Sending to %s at port %d", host, SocketAddress::GetPort(dest));
+  QUIC_DEBUG(this, "Sending to %s at port %d",
+             SocketAddress::GetAddress(dest).c_str(),
+             SocketAddress::GetPort(dest));
 
   QuicSocket::SendWrap* wrap =
       new QuicSocket::SendWrap(
@@ -849,9 +1478,9 @@ void QuicSocket::OnSend(
     &socket_stats_,
     &socket_stats::packets_sent);
 
-  Debug(this, "Packet sent status: %d (label: %s)",
-        status,
-        diagnostic_label != nullptr ? diagnostic_label : "unspecified");
+  QUIC_DEBUG(this, "Packet sent status: %d (label: %s)",
+             status,
+             diagnostic_label != nullptr ? diagnostic_label : "unspecified");
 
   DecrementPendingCallbacks();
   MaybeClose();
@@ -875,13 +1504,18 @@ void QuicSocket::SendWrapBase::OnSend(uv_udp_send_t* req, int status) {
   wrap->Done(status);
 }
 
-bool QuicSocket::SendWrapBase::IsDiagnosticPacketLoss() {
-  if (Socket()->IsDiagnosticPacketLoss(Socket()->tx_loss_)) {
-    Debug(Socket(), "Simulating transmitted packet loss.");
-    Done(0);
-    return true;
-  }
-  return false;
+bool QuicSocket::SendWrapBase::Emulate(const uv_buf_t* bufs, size_t nbufs) {
+  if (LIKELY(!socket_->Emulate(true, bufs, nbufs, **Address())))
+    return false;
+  // As far as the QuicSession is concerned, the packet has been sent.
+  Complete();
+  return true;
+}
+
+void QuicSocket::SendWrapBase::Complete() {
+  std::unique_ptr<SendWrapBase> self(this);
+  Advance();
+  Done(0);
 }
 
 void QuicSocket::SendWrapBase::Done(int status) {
@@ -898,21 +1532,27 @@ QuicSocket::SendWrapStack::SendWrapStack(
 }
 
 int QuicSocket::SendWrapStack::Send() {
-  Debug(Socket(), "Sending %" PRIu64 " bytes (label: %s)",
-        buf_.length(),
-        diagnostic_label());
+  QUIC_DEBUG(Socket(), "Sending %" PRIu64 " bytes (label: %s)",
+             buf_.length(),
+             diagnostic_label());
 
   CHECK_GT(buf_.length(), 0);
 
-  // If DiagnosticPacketLoss returns true, it will call Done() internally
-  if (UNLIKELY(IsDiagnosticPacketLoss()))
-    return 0;
-
   uv_buf_t buf =
       uv_buf_init(
           reinterpret_cast<char*>(*buf_),
           buf_.length());
 
+  // If Emulate returns true, it will call Done() internally
+  if (UNLIKELY(Emulate(&buf, 1)))
+    return 0;
+
+  if (Socket()->IsLoopback()) {
+    Socket()->SendLoopback(&buf, 1, **Address());
+    Complete();
+    return 0;
+  }
+
   return uv_udp_send(
       req(),
       &Socket()->handle_,
@@ -947,15 +1587,15 @@ void QuicSocket::SendWrap::Done(int status) {
   // If the weak_ref to the QuicBuffer is still valid
   // consume the data, otherwise, do nothing
   if (status == 0) {
-    Debug(Socket(), "Consuming %" PRId64 " bytes (label: %s)",
-          length_,
-          diagnostic_label());
+    QUIC_DEBUG(Socket(), "Consuming %" PRId64 " bytes (label: %s)",
+               length_,
+               diagnostic_label());
     buffer_->Consume(length_);
   } else {
-    Debug(Socket(), "Cancelling %" PRId64 " bytes (status: %d, label: %s)",
-          length_,
-          status,
-          diagnostic_label());
+    QUIC_DEBUG(Socket(), "Cancelling %" PRId64 " bytes (status: %d, label: %s)",
+               length_,
+               status,
+               diagnostic_label());
     buffer_->Cancel(status);
   }
   SendWrapBase::Done(status);
@@ -973,14 +1613,20 @@ int QuicSocket::SendWrap::Send() {
   // len should never be zero
   CHECK_GT(len, 0);
 
-  Debug(Socket(),
-        "Sending %" PRIu64 " bytes (label: %s)",
-        length_,
-        diagnostic_label());
+  QUIC_DEBUG(Socket(),
+             "Sending %" PRIu64 " bytes (label: %s)",
+             length_,
+             diagnostic_label());
+
+  // If Emulate returns true, it will call Done() internally
+  if (UNLIKELY(Emulate(vec.data(), vec.size())))
+    return 0;
 
-  // If DiagnosticPacketLoss returns true, it will call Done() internally
-  if (UNLIKELY(IsDiagnosticPacketLoss()))
+  if (Socket()->IsLoopback()) {
+    Socket()->SendLoopback(vec.data(), vec.size(), **Address());
+    Complete();
     return 0;
+  }
 
   int err = uv_udp_send(
       req(),
@@ -990,25 +1636,169 @@ int QuicSocket::SendWrap::Send() {
       **Address(),
       OnSend);
 
-  if (err == 0) {
-    Debug(Socket(), "Advancing read head %" PRIu64, length_);
-    buffer_->SeekHeadOffset(length_);
-  }
+  if (err == 0)
+    Advance();
   return err;
 }
 
+void QuicSocket::SendWrap::Advance() {
+  QUIC_DEBUG(Socket(), "Advancing read head %" PRIu64, length_);
+  buffer_->SeekHeadOffset(length_);
+}
+
+
 
+bool QuicSocket::Emulate(
+    bool outbound,
+    const uv_buf_t* bufs,
+    size_t nbufs,
+    const sockaddr* addr,
+    unsigned int flags) {
+  NetworkEmulator* emulator = outbound ? &tx_emulator_ : &rx_emulator_;
+  if (LIKELY(!emulator->IsEnabled()))
+    return false;
 
-bool QuicSocket::IsDiagnosticPacketLoss(double prob) {
-  if (LIKELY(prob == 0.0)) return false;
-  unsigned char c = 255;
-  EntropySource(&c, 1);
-  return (static_cast<double>(c) / 255) < prob;
+  size_t length = 0;
+  for (size_t n = 0; n < nbufs; n++)
+    length += bufs[n].len;
+
+  uint64_t now = uv_hrtime();
+  NetworkEmulator::Schedule schedule = emulator->Next(now, length);
+  if (schedule.drop) {
+    QUIC_DEBUG(this, "Emulating %s packet loss.",
+               outbound ? "transmitted" : "received");
+    return true;
+  }
+
+  auto hold = [&]() {
+    std::unique_ptr<EmulatedPacket> packet(new EmulatedPacket());
+    packet->socket = this;
+    packet->outbound = outbound;
+    packet->flags = flags;
+    packet->address.Copy(addr);
+    packet->data.reserve(length);
+    for (size_t n = 0; n < nbufs; n++) {
+      const uint8_t* base = reinterpret_cast<const uint8_t*>(bufs[n].base);
+      packet->data.insert(packet->data.end(), base, base + bufs[n].len);
+    }
+    emulated_packets_.emplace(schedule.deliver_at, std::move(packet));
+  };
+
+  bool delayed = schedule.deliver_at > now;
+  if (schedule.duplicate)
+    hold();
+  if (delayed)
+    hold();
+  if (!emulated_packets_.empty())
+    ScheduleEmulatorTimer(now);
+  return delayed;
+}
+
+void QuicSocket::ScheduleEmulatorTimer(uint64_t now) {
+  if (emulated_packets_.empty())
+    return;
+  uint64_t deliver_at = emulated_packets_.begin()->first;
+  uint64_t timeout = 0;
+  if (deliver_at > now)
+    timeout = (deliver_at - now + 999999) / 1000000;
+  emulator_timer_->Once(timeout);
+}
+
+void QuicSocket::OnEmulatorTimeoutCB(void* data) {
+  static_cast<QuicSocket*>(data)->OnEmulatorTimeout();
+}
+
+void QuicSocket::OnEmulatorTimeout() {
+  uint64_t now = uv_hrtime();
+  // Delivering a received packet may cause new packets to be sent and
+  // held, so the earliest entry is looked up again on every iteration.
+  while (!emulated_packets_.empty()) {
+    auto it = emulated_packets_.begin();
+    if (it->first > now)
+      break;
+    std::unique_ptr<EmulatedPacket> packet = std::move(it->second);
+    emulated_packets_.erase(it);
+    DeliverEmulatedPacket(std::move(packet));
+  }
+  ScheduleEmulatorTimer(now);
+}
+
+void QuicSocket::DeliverEmulatedPacket(
+    std::unique_ptr<EmulatedPacket> packet) {
+  if (!packet->outbound) {
+    ProcessReceivedPacket(
+        packet->data.size(),
+        packet->data.data(),
+        *packet->address,
+        packet->flags);
+    return;
+  }
+
+  uv_buf_t buf =
+      uv_buf_init(
+          reinterpret_cast<char*>(packet->data.data()),
+          packet->data.size());
+  if (IsLoopback()) {
+    SendLoopback(&buf, 1, *packet->address);
+    return;
+  }
+  packet->req.data = packet.get();
+  int err = uv_udp_send(
+      &packet->req,
+      &handle_,
+      &buf, 1,
+      *packet->address,
+      OnEmulatedSend);
+  if (err != 0) {
+    QUIC_DEBUG(this, "Sending emulated packet failed. Error %d", err);
+    return;
+  }
+  IncrementPendingCallbacks();
+  packet.release();
+}
+
+void QuicSocket::OnEmulatedSend(uv_udp_send_t* req, int status) {
+  std::unique_ptr<EmulatedPacket> packet(
+      static_cast<EmulatedPacket*>(req->data));
+  QuicSocket* socket = packet->socket;
+  socket->DecrementPendingCallbacks();
+  socket->MaybeClose();
+}
+
+void QuicSocket::SendLoopback(
+    const uv_buf_t* bufs,
+    size_t nbufs,
+    const sockaddr* dest) {
+  if (!loopback_peer_ ||
+      loopback_peer_->IsClosed() ||
+      memcmp(*loopback_peer_address_,
+             dest,
+             SocketAddress::GetAddressLen(dest)) != 0) {
+    loopback_peer_ = LoopbackEndpoint::Find(dest);
+    loopback_peer_address_.Copy(dest);
+  }
+  // As with UDP, a datagram sent to a port that nothing is bound to, or
+  // to an endpoint that is not keeping up, is silently lost.
+  if (!loopback_peer_ || !loopback_peer_->Send(*local_address_, bufs, nbufs)) {
+    QUIC_DEBUG(this, "Loopback datagram to port %d dropped.",
+               SocketAddress::GetPort(dest));
+  }
 }
 
-void QuicSocket::SetDiagnosticPacketLoss(double rx, double tx) {
-  rx_loss_ = rx;
-  tx_loss_ = tx;
+void QuicSocket::SetLinkProfile(
+    bool tx,
+    const LinkProfile& profile,
+    uint32_t seed) {
+  QUIC_DEBUG(this, "Setting %s link profile with seed %u.",
+             tx ? "transmit" : "receive", seed);
+  // The receive and transmit directions draw from independent streams
+  // so that configuring one does not change the pattern of the other.
+  if (tx)
+    tx_emulator_.Configure(profile, seed, 1);
+  else
+    rx_emulator_.Configure(profile, seed, 0);
+  if (!emulator_timer_)
+    emulator_timer_.reset(new Timer(env(), OnEmulatorTimeoutCB, this));
 }
 
 inline void QuicSocket::CheckAllocatedSize(size_t previous_size) {
@@ -1017,13 +1807,31 @@ inline void QuicSocket::CheckAllocatedSize(size_t previous_size) {
 
 inline void QuicSocket::IncrementAllocatedSize(size_t size) {
   current_ngtcp2_memory_ += size;
+  socket_stats_.memory = GetMemoryUsage();
 }
 
 inline void QuicSocket::DecrementAllocatedSize(size_t size) {
   current_ngtcp2_memory_ -= size;
+  socket_stats_.memory = GetMemoryUsage();
 }
 
 
+// Loopback QuicSockets are never bound at the UDP level, so their local
+// address is reported from the LoopbackEndpoint binding instead.
+void QuicSocket::GetSockName(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  QuicSocket* socket;
+  ASSIGN_OR_RETURN_UNWRAP(&socket, args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+  if (!socket->IsLoopback())
+    return GetSockOrPeerName<QuicSocket, uv_udp_getsockname>(args);
+  CHECK(args[0]->IsObject());
+  if (!socket->IsLoopbackBound())
+    return args.GetReturnValue().Set(UV_EBADF);
+  AddressToJS(env, **socket->GetLocalAddress(), args[0].As<Object>());
+  args.GetReturnValue().Set(0);
+}
+
 // JavaScript API
 namespace {
 void NewQuicSocket(const FunctionCallbackInfo<Value>& args) {
@@ -1039,35 +1847,76 @@ void NewQuicSocket(const FunctionCallbackInfo<Value>& args) {
   CHECK_GE(retry_token_expiration, MIN_RETRYTOKEN_EXPIRATION);
   CHECK_LE(retry_token_expiration, MAX_RETRYTOKEN_EXPIRATION);
 
+  std::string qlog_dir;
+  if (args[3]->IsString()) {
+    Utf8Value dir(env->isolate(), args[3]);
+    qlog_dir = *dir;
+  }
+
+  uint64_t max_memory = DEFAULT_MAX_SOCKET_MEMORY;
+  double max_memory_value;
+  if (args[4]->IsNumber() &&
+      args[4]->NumberValue(env->context()).To(&max_memory_value)) {
+    max_memory = static_cast<uint64_t>(max_memory_value);
+  }
+
+  double max_initial_rate = 0;
+  double max_initial_burst = 0;
+  if (args[5]->IsNumber())
+    USE(args[5]->NumberValue(env->context()).To(&max_initial_rate));
+  if (args[6]->IsNumber())
+    USE(args[6]->NumberValue(env->context()).To(&max_initial_burst));
+
+  ArrayBufferViewContents<uint8_t> reset_secret;
+  if (args[7]->IsArrayBufferView()) {
+    reset_secret.Read(args[7].As<ArrayBufferView>());
+    CHECK_EQ(reset_secret.length(), RESET_SECRETLEN);
+  }
+
   new QuicSocket(
       env,
       args.This(),
       retry_token_expiration,
       max_connections_per_host,
-      options);
-}
-
-// Enabling diagnostic packet loss enables a mode where the QuicSocket
-// instance will randomly ignore received packets in order to simulate
-// packet loss. This is not an API that should be enabled in production
-// but is useful when debugging and diagnosing performance issues.
-// Diagnostic packet loss is enabled by setting either the tx or rx
-// arguments to a value between 0.0 and 1.0. Setting both values to 0.0
-// disables the mechanism.
-void QuicSocketSetDiagnosticPacketLoss(
-  const FunctionCallbackInfo<Value>& args) {
+      max_initial_rate,
+      max_initial_burst,
+      max_memory,
+      options,
+      qlog_dir,
+      reset_secret.data());
+}
+
+// Network emulation impairs the packets received or transmitted by the
+// QuicSocket (delay, jitter, bandwidth limits, reordering, duplication
+// and burst loss) in order to reproduce a given link. This is not an
+// API that should be enabled in production but is useful when testing
+// and diagnosing performance issues. The first argument selects the
+// transmit (true) or receive (false) direction, the second is the seed.
+// The profile itself is read from the linkProfile state buffer, with
+// times in milliseconds.
+void QuicSocketSetLinkProfile(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   QuicSocket* socket;
   ASSIGN_OR_RETURN_UNWRAP(&socket, args.Holder());
-  double rx = 0.0f;
-  double tx = 0.0f;
-  USE(args[0]->NumberValue(env->context()).To(&rx));
-  USE(args[1]->NumberValue(env->context()).To(&tx));
-  CHECK_GE(rx, 0.0f);
-  CHECK_GE(tx, 0.0f);
-  CHECK_LE(rx, 1.0f);
-  CHECK_LE(tx, 1.0f);
-  socket->SetDiagnosticPacketLoss(rx, tx);
+  CHECK(args[0]->IsBoolean());
+  uint32_t seed = 0;
+  USE(args[1]->Uint32Value(env->context()).To(&seed));
+
+  AliasedFloat64Array& buffer = env->quic_state()->quiclinkprofile_buffer;
+  LinkProfile profile;
+  profile.delay = static_cast<uint64_t>(buffer[IDX_QUIC_LINK_DELAY] * 1e6);
+  profile.jitter = static_cast<uint64_t>(buffer[IDX_QUIC_LINK_JITTER] * 1e6);
+  profile.rate = static_cast<uint64_t>(buffer[IDX_QUIC_LINK_RATE]);
+  profile.queue_limit =
+      static_cast<uint64_t>(buffer[IDX_QUIC_LINK_QUEUE_LIMIT]);
+  profile.reorder = buffer[IDX_QUIC_LINK_REORDER];
+  profile.duplicate = buffer[IDX_QUIC_LINK_DUPLICATE];
+  profile.loss = buffer[IDX_QUIC_LINK_LOSS];
+  profile.burst_loss = buffer[IDX_QUIC_LINK_BURST_LOSS];
+  profile.burst_enter = buffer[IDX_QUIC_LINK_BURST_ENTER];
+  profile.burst_exit = buffer[IDX_QUIC_LINK_BURST_EXIT];
+
+  socket->SetLinkProfile(args[0]->IsTrue(), profile, seed);
 }
 
 void QuicSocketAddMembership(const FunctionCallbackInfo<Value>& args) {
@@ -1166,6 +2015,19 @@ void QuicSocketListen(const FunctionCallbackInfo<Value>& args) {
   socket->Listen(sc, preferred_address, alpn, options);
 }
 
+void QuicSocketAddContext(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  QuicSocket* socket;
+  ASSIGN_OR_RETURN_UNWRAP(&socket, args.Holder());
+  CHECK(args[0]->IsString());  // servername
+  CHECK(args[1]->IsObject());  // Secure Context
+  SecureContext* sc;
+  ASSIGN_OR_RETURN_UNWRAP(&sc, args[1].As<Object>());
+
+  Utf8Value servername(env->isolate(), args[0]);
+  args.GetReturnValue().Set(socket->AddSNIContext(*servername, sc));
+}
+
 void QuicSocketStopListening(const FunctionCallbackInfo<Value>& args) {
   QuicSocket* socket;
   ASSIGN_OR_RETURN_UNWRAP(&socket, args.Holder());
@@ -1221,6 +2083,32 @@ void QuicSocketSetServerBusy(const FunctionCallbackInfo<Value>& args) {
   socket->SetServerBusy(args[0]->IsTrue());
 }
 
+void QuicSocketDrain(const FunctionCallbackInfo<Value>& args) {
+  QuicSocket* socket;
+  ASSIGN_OR_RETURN_UNWRAP(&socket, args.Holder());
+  socket->StartDraining();
+}
+
+void QuicSocketSetAdmissionControl(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  QuicSocket* socket;
+  ASSIGN_OR_RETURN_UNWRAP(&socket, args.Holder());
+  CHECK_EQ(args.Length(), 4);
+  CHECK(args[3]->IsBoolean());
+  double max_loop_delay = 0;
+  double max_sessions = 0;
+  uint32_t resolution = 0;
+  USE(args[0]->NumberValue(env->context()).To(&max_loop_delay));
+  USE(args[1]->NumberValue(env->context()).To(&max_sessions));
+  USE(args[2]->Uint32Value(env->context()).To(&resolution));
+  CHECK_GT(resolution, 0u);
+  socket->SetAdmissionControl(
+      static_cast<uint64_t>(max_loop_delay * 1e6),
+      static_cast<size_t>(max_sessions),
+      resolution,
+      args[3]->IsTrue());
+}
+
 void QuicSocketSetMulticastTTL(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   QuicSocket* socket;
@@ -1256,6 +2144,9 @@ void QuicSocket::Initialize(
   socket->SetClassName(class_name);
   socket->InstanceTemplate()->SetInternalFieldCount(1);
   socket->InstanceTemplate()->Set(env->owner_symbol(), Null(isolate));
+  env->SetProtoMethod(socket,
+                      "addContext",
+                      QuicSocketAddContext);
   env->SetProtoMethod(socket,
                       "addMembership",
                       QuicSocketAddMembership);
@@ -1270,7 +2161,7 @@ void QuicSocket::Initialize(
                       QuicSocketDropMembership);
   env->SetProtoMethod(socket,
                       "getsockname",
-                      node::GetSockOrPeerName<QuicSocket, uv_udp_getsockname>);
+                      GetSockName);
   env->SetProtoMethod(socket,
                       "listen",
                       QuicSocketListen);
@@ -1281,8 +2172,8 @@ void QuicSocket::Initialize(
                       "receiveStop",
                       QuicSocketReceiveStop);
   env->SetProtoMethod(socket,
-                      "setDiagnosticPacketLoss",
-                      QuicSocketSetDiagnosticPacketLoss);
+                      "setLinkProfile",
+                      QuicSocketSetLinkProfile);
   env->SetProtoMethod(socket,
                       "setTTL",
                       QuicSocketSetTTL);
@@ -1301,6 +2192,12 @@ void QuicSocket::Initialize(
   env->SetProtoMethod(socket,
                       "setServerBusy",
                       QuicSocketSetServerBusy);
+  env->SetProtoMethod(socket,
+                      "drain",
+                      QuicSocketDrain);
+  env->SetProtoMethod(socket,
+                      "setAdmissionControl",
+                      QuicSocketSetAdmissionControl);
   env->SetProtoMethod(socket,
                       "stopListening",
                       QuicSocketStopListening);
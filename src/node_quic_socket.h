@@ -6,6 +6,7 @@
 #include "node.h"
 #include "node_crypto.h"  // SSLWrap
 #include "node_internals.h"
+#include "node_mutex.h"
 #include "ngtcp2/ngtcp2.h"
 #include "node_quic_session.h"
 #include "node_quic_util.h"
@@ -14,8 +15,10 @@
 #include "v8.h"
 #include "uv.h"
 
+#include <atomic>
 #include <deque>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -41,8 +44,89 @@ typedef enum QuicSocketOptions : uint32_t {
   // validated addresses. Address validation will be skipped
   // if the address is currently in the cache.
   QUICSOCKET_OPTIONS_VALIDATE_ADDRESS_LRU = 0x2,
+
+  // When enabled, the QuicSocket does not use the UDP stack at
+  // all but exchanges datagrams in memory with other loopback
+  // QuicSockets in the same process (see LoopbackEndpoint).
+  QUICSOCKET_OPTIONS_LOOPBACK = 0x4,
+
+  // When enabled, the QuicSocket does not send stateless resets
+  // for packets received for unknown connections.
+  QUICSOCKET_OPTIONS_DISABLE_STATELESS_RESET = 0x8,
 } QuicSocketOptions;
 
+class QuicSocket;
+
+// The in-memory transport used by QuicSockets created with the
+// QUICSOCKET_OPTIONS_LOOPBACK option. Loopback endpoints share a single
+// port space per address family for the whole process, regardless of
+// the IP address they are bound to, and may live on different threads.
+// Senders push datagrams onto the receiving endpoint's lock-free queue
+// and wake its event loop using a uv_async_t; the receiving QuicSocket
+// then processes them as if they had arrived from a UDP socket.
+class LoopbackEndpoint {
+ public:
+  // Registers a new endpoint for the given address. If the port is 0,
+  // an unused port is assigned. The assigned port and the loopback
+  // address are written back into addr.
+  static std::shared_ptr<LoopbackEndpoint> Bind(
+      QuicSocket* socket,
+      sockaddr_storage* addr,
+      int* err);
+
+  // Returns the endpoint bound to the given address, if any. This may
+  // be called from any thread.
+  static std::shared_ptr<LoopbackEndpoint> Find(const sockaddr* addr);
+
+  // Queues a datagram for the endpoint. This may be called from any
+  // thread. Returns false if the datagram was dropped because the
+  // endpoint is closed or its queue is full.
+  bool Send(const sockaddr* from, const uv_buf_t* bufs, size_t nbufs);
+
+  // Unregisters the endpoint and stops delivering datagrams. Must be
+  // called on the thread of the owning QuicSocket.
+  void Close();
+
+  bool IsClosed() const { return closed_; }
+
+  ~LoopbackEndpoint();
+
+ private:
+  struct Datagram {
+    std::atomic<Datagram*> next { nullptr };
+    SocketAddress remote;
+    std::vector<uint8_t> data;
+  };
+
+  LoopbackEndpoint(QuicSocket* socket, const sockaddr* addr);
+
+  void Push(Datagram* datagram);
+  Datagram* Pop();
+  void Drain();
+
+  static void OnAsync(uv_async_t* handle);
+
+  Environment* env_;
+  QuicSocket* socket_;
+  SocketAddress address_;
+  uv_async_t async_;
+  // Keeps the endpoint alive until the async_ handle has been closed.
+  std::shared_ptr<LoopbackEndpoint> self_;
+
+  // Multiple producer, single consumer queue. Producers swap
+  // themselves into head_; the owning thread consumes from tail_.
+  std::atomic<Datagram*> head_;
+  Datagram* tail_;
+  Datagram stub_;
+  std::atomic<size_t> queued_ { 0 };
+
+  // Held by senders while they wake the owning thread, and by Close()
+  // while it sets closed_, so that async_ is never used once Close()
+  // has started closing it.
+  Mutex async_mutex_;
+  std::atomic<bool> closed_ { false };
+};
+
 class QuicSocket : public HandleWrap,
                    public mem::Tracker {
  public:
@@ -56,11 +140,32 @@ class QuicSocket : public HandleWrap,
       Local<Object> wrap,
       uint64_t retry_token_expiration,
       size_t max_connections_per_host,
-      uint32_t options = 0);
+      double max_initial_rate = 0,
+      double max_initial_burst = 0,
+      uint64_t max_memory = DEFAULT_MAX_SOCKET_MEMORY,
+      uint32_t options = 0,
+      const std::string& qlog_dir = std::string(),
+      const uint8_t* reset_secret = nullptr);
   ~QuicSocket() override;
 
   SocketAddress* GetLocalAddress() { return &local_address_; }
 
+  // The secret the stateless reset tokens for the CIDs of the
+  // QuicSessions using this QuicSocket are derived from.
+  const std::array<uint8_t, RESET_SECRETLEN>& GetResetSecret() const {
+    return reset_secret_;
+  }
+
+  // The directory QuicSessions write qlog traces to. Empty if qlog
+  // output is disabled.
+  const std::string& GetQlogDir() const { return qlog_dir_; }
+
+  bool IsLoopback() {
+    return IsOptionSet(QUICSOCKET_OPTIONS_LOOPBACK);
+  }
+
+  bool IsLoopbackBound() const { return loopback_ != nullptr; }
+
   void Close(
       v8::Local<v8::Value> close_callback = v8::Local<v8::Value>()) override;
 
@@ -75,6 +180,9 @@ class QuicSocket : public HandleWrap,
   void AssociateCID(
       QuicCID* cid,
       QuicCID* scid);
+  void AssociateStatelessResetToken(
+      const uint8_t* token,
+      QuicCID* scid);
   int Bind(
       const char* address,
       uint32_t port,
@@ -82,6 +190,8 @@ class QuicSocket : public HandleWrap,
       int family);
   void DisassociateCID(
       QuicCID* cid);
+  void DisassociateStatelessResetToken(
+      const uint8_t* token);
   int DropMembership(
       const char* address,
       const char* iface);
@@ -94,7 +204,7 @@ class QuicSocket : public HandleWrap,
   int ReceiveStop();
   void RemoveSession(
       QuicCID* cid,
-      const sockaddr* addr);
+      const SourcePrefix& prefix);
   void ReportSendError(
       int error);
   int SetBroadcast(
@@ -113,13 +223,84 @@ class QuicSocket : public HandleWrap,
       std::shared_ptr<QuicSession> session,
       const char* diagnostic_label = nullptr);
   void SetServerBusy(bool on);
-  void SetDiagnosticPacketLoss(double rx = 0.0, double tx = 0.0);
+
+  // Draining stops the QuicSocket from accepting new QuicServerSessions.
+  // The JavaScript side then destroys the existing sessions in batches.
+  // A draining QuicSocket does not finish closing before the closing
+  // periods of those sessions are over.
+  void StartDraining();
+  bool IsDraining() {
+    return IsFlagSet(QUICSOCKET_FLAGS_DRAINING);
+  }
+
+  // A QuicServerSession that is destroyed in its closing period only
+  // leaves behind the CONNECTION_CLOSE packet it sent, which is sent
+  // again in response to packets that still arrive for any of its CIDs
+  // until the closing period (duration, in nanoseconds) is over. Closed
+  // connections are not kept once the QuicSocket is closing, unless it
+  // is draining.
+  void AddClosedConnection(
+      std::vector<std::string>&& cids,
+      const uint8_t* packet,
+      size_t packetlen,
+      uint64_t duration);
+
+  // Turns new connections away automatically while the event loop delay
+  // or the number of sessions is above the given thresholds. The event
+  // loop delay is sampled every resolution milliseconds. When retry is
+  // true, clients are first sent a Retry packet, and are only refused
+  // if they are still arriving while the QuicSocket is overloaded once
+  // they have answered it. A threshold of zero is not checked.
+  void SetAdmissionControl(
+      uint64_t max_loop_delay,
+      size_t max_sessions,
+      uint64_t resolution,
+      bool retry);
+
+  // The QuicSocket aggregates the latency of all of its QuicSessions
+  // into histograms, which remain available after the sessions have
+  // been destroyed. All values are in nanoseconds.
+  void RecordHandshakeDuration(uint64_t duration);
+  void RecordSessionClosed(uint64_t lifetime, uint64_t smoothed_rtt);
+  void RecordStreamTimeToFirstByte(uint64_t ttfb);
+
+  // The memory held by the QuicSocket and all of its QuicSessions.
+  // Each QuicSession reports changes of its own memory usage, moving
+  // from previous to current bytes, through UpdateSessionMemory().
+  uint64_t GetMemoryUsage() const {
+    return current_ngtcp2_memory_ + session_memory_ +
+           closed_connection_memory_;
+  }
+  bool IsMemoryConstrained() const {
+    return IsNearMemoryLimit(GetMemoryUsage(), max_memory_);
+  }
+  bool IsMemoryExceeded() const {
+    return GetMemoryUsage() > max_memory_;
+  }
+  void UpdateSessionMemory(uint64_t previous, uint64_t current);
+
+  // Impairs packets received (tx == false) or transmitted (tx == true)
+  // by this QuicSocket according to the given profile. The seed makes
+  // the impairment reproducible across runs.
+  void SetLinkProfile(bool tx, const LinkProfile& profile, uint32_t seed);
   void StopListening();
 
   crypto::SecureContext* GetServerSecureContext() {
     return server_secure_context_;
   }
 
+  // Registers an additional SecureContext to be used for clients
+  // requesting the given servername. Returns false if the servername
+  // cannot be matched natively (see SNIContextIndex).
+  bool AddSNIContext(
+      const std::string& servername,
+      crypto::SecureContext* context);
+
+  std::shared_ptr<SNIContextIndex::Entry> FindSNIContext(
+      const char* servername) const {
+    return sni_contexts_.Find(servername);
+  }
+
   const uv_udp_t* operator*() const { return &handle_; }
 
   void MemoryInfo(MemoryTracker* tracker) const override;
@@ -132,6 +313,8 @@ class QuicSocket : public HandleWrap,
   inline void DecrementAllocatedSize(size_t size) override;
 
  private:
+  static void GetSockName(const FunctionCallbackInfo<Value>& args);
+
   static void OnAlloc(
       uv_handle_t* handle,
       size_t suggested_size,
@@ -150,6 +333,16 @@ class QuicSocket : public HandleWrap,
       const struct sockaddr* addr,
       unsigned int flags);
 
+  void ProcessReceivedPacket(
+      ssize_t nread,
+      const uint8_t* data,
+      const struct sockaddr* addr,
+      unsigned int flags);
+
+  std::shared_ptr<QuicSession> FindStatelessResetSession(
+      ssize_t nread,
+      const uint8_t* data);
+
   void SendInitialConnectionClose(
       uint32_t version,
       uint64_t error_code,
@@ -162,6 +355,11 @@ class QuicSocket : public HandleWrap,
       QuicCID* scid,
       const sockaddr* addr);
 
+  bool SendStatelessReset(
+      QuicCID* dcid,
+      const sockaddr* addr,
+      size_t pktlen);
+
   void OnSend(
       int status,
       size_t length,
@@ -185,10 +383,6 @@ class QuicSocket : public HandleWrap,
       QuicCID* scid,
       const sockaddr* addr);
 
-  void IncrementSocketAddressCounter(const sockaddr* addr);
-  void DecrementSocketAddressCounter(const sockaddr* addr);
-  size_t GetCurrentSocketAddressCounter(const sockaddr* addr);
-
   void IncrementPendingCallbacks() { pending_callbacks_++; }
   void DecrementPendingCallbacks() { pending_callbacks_--; }
   bool HasPendingCallbacks() { return pending_callbacks_ > 0; }
@@ -197,10 +391,56 @@ class QuicSocket : public HandleWrap,
             int (*F)(const typename T::HandleType*, sockaddr*, int*)>
   friend void node::GetSockOrPeerName(
       const v8::FunctionCallbackInfo<v8::Value>&);
+  friend class LoopbackEndpoint;
+
+  // A packet held back by the NetworkEmulator. Outbound packets are
+  // handed to libuv directly from here once they are due, bypassing
+  // SendWrap, which has already completed.
+  struct EmulatedPacket {
+    uv_udp_send_t req;
+    QuicSocket* socket;
+    bool outbound;
+    unsigned int flags;
+    SocketAddress address;
+    std::vector<uint8_t> data;
+  };
+
+  // Passes a packet through the rx_emulator_ or tx_emulator_. Returns
+  // true if the packet was dropped or held for later delivery, false
+  // if it should be processed or sent immediately.
+  bool Emulate(
+      bool outbound,
+      const uv_buf_t* bufs,
+      size_t nbufs,
+      const sockaddr* addr,
+      unsigned int flags = 0);
+  void DeliverEmulatedPacket(std::unique_ptr<EmulatedPacket> packet);
+
+  // Delivers a datagram to the loopback endpoint bound to dest. The
+  // datagram is copied, so the send completes synchronously.
+  void SendLoopback(
+      const uv_buf_t* bufs,
+      size_t nbufs,
+      const sockaddr* dest);
+  void ScheduleEmulatorTimer(uint64_t now);
+  void OnEmulatorTimeout();
+  void OnLoopDelayTimeout();
+
+  // Sends the CONNECTION_CLOSE packet again if the dcid belongs to a
+  // closed connection, backing off exponentially like
+  // QuicSession::ShouldAttemptConnectionClose(). Returns false if the
+  // dcid is not known.
+  bool SendClosedConnection(
+      const std::string& dcid,
+      const sockaddr* addr);
+  void ScheduleClosedConnectionTimer(uint64_t now);
+  void OnClosedConnectionTimeout();
+  void ClearClosedConnections();
 
-  // Returns true if, and only if, diagnostic packet loss is enabled
-  // and the current packet should be artificially considered lost.
-  bool IsDiagnosticPacketLoss(double prob);
+  static void OnClosedConnectionTimeoutCB(void* data);
+  static void OnEmulatorTimeoutCB(void* data);
+  static void OnLoopDelayTimeoutCB(void* data);
+  static void OnEmulatedSend(uv_udp_send_t* req, int status);
 
   // Fields and TypeDefs
   typedef uv_udp_t HandleType;
@@ -214,6 +454,11 @@ class QuicSocket : public HandleWrap,
     QUICSOCKET_FLAGS_PENDING_CLOSE = 0x2,
     QUICSOCKET_FLAGS_SERVER_LISTENING = 0x4,
     QUICSOCKET_FLAGS_SERVER_BUSY = 0x8,
+    // Set when overloaded clients are to be sent a Retry packet
+    // before they are refused.
+    QUICSOCKET_FLAGS_ADMISSION_RETRY = 0x10,
+    // Set once the QuicSocket has started draining its sessions.
+    QUICSOCKET_FLAGS_DRAINING = 0x20,
   } QuicSocketFlags;
 
   void SetFlag(QuicSocketFlags flag, bool on = true) {
@@ -244,33 +489,74 @@ class QuicSocket : public HandleWrap,
   uint32_t server_options_;
 
   size_t pending_callbacks_;
-  size_t max_connections_per_host_;
   size_t current_ngtcp2_memory_;
+  uint64_t session_memory_ = 0;
+  uint64_t max_memory_;
 
   uint64_t retry_token_expiration_;
 
-  // Used to specify diagnostic packet loss probabilities
-  double rx_loss_;
-  double tx_loss_;
+  std::string qlog_dir_;
+
+  std::shared_ptr<LoopbackEndpoint> loopback_;
+  // The endpoint most recently sent to, cached to avoid looking up
+  // the destination in the process-wide registry for every packet.
+  std::shared_ptr<LoopbackEndpoint> loopback_peer_;
+  SocketAddress loopback_peer_address_;
+
+  NetworkEmulator rx_emulator_;
+  NetworkEmulator tx_emulator_;
+  TimerPointer emulator_timer_;
+  // Packets held by the emulators, keyed by delivery time in
+  // nanoseconds. Packets due at the same time keep their order.
+  std::multimap<uint64_t, std::unique_ptr<EmulatedPacket>> emulated_packets_;
+
+  AdmissionControl admission_;
+  TimerPointer loop_delay_timer_;
+  uint64_t loop_delay_resolution_ = 0;
+  uint64_t loop_delay_sampled_at_ = 0;
 
   SocketAddress local_address_;
   QuicSessionConfig server_session_config_;
   crypto::SecureContext* server_secure_context_;
+  SNIContextIndex sni_contexts_;
   std::string server_alpn_;
   std::unordered_map<std::string, std::shared_ptr<QuicSession>> sessions_;
   std::unordered_map<std::string, std::string> dcid_to_scid_;
+  // Maps the stateless reset tokens received from servers to the
+  // client sessions they were received by. A stateless reset carries
+  // a random DCID, so the trailing token is all that identifies it.
+  std::unordered_map<std::string, std::string> token_to_scid_;
   std::array<uint8_t, TOKEN_SECRETLEN> token_secret_;
-
-  // Counts the number of active connections per remote
-  // address. A custom std::hash specialization for
-  // sockaddr instances is used. Values are incremented
-  // when a QuicSession is added to the socket, and
-  // decremented when the QuicSession is removed. If the
-  // value reaches the value of max_connections_per_host_,
-  // attempts to create new connections will be ignored
-  // until the value falls back below the limit.
-  std::unordered_map<const sockaddr*, size_t, SocketAddress::Hash>
-    addr_counts_;
+  std::array<uint8_t, RESET_SECRETLEN> reset_secret_;
+
+  // A token bucket that limits the rate at which stateless resets
+  // are sent, as the packets that trigger them are easily spoofed.
+  double stateless_reset_tokens_ = MAX_STATELESS_RESET_RATE;
+  uint64_t stateless_reset_updated_at_ = 0;
+
+  // A QuicServerSession destroyed in its closing period, reduced to
+  // its CONNECTION_CLOSE packet. Records are looked up by each of the
+  // CIDs of the connection and expire in the order of their expiration
+  // time in nanoseconds. The memory they hold is counted as part of the
+  // memory used by the QuicSocket.
+  struct ClosedConnection {
+    std::vector<std::string> cids;
+    std::vector<uint8_t> packet;
+    size_t attempts = 0;
+    size_t limit = 1;
+    size_t memory = 0;
+  };
+  std::unordered_map<std::string, std::shared_ptr<ClosedConnection>>
+      closed_connections_;
+  std::multimap<uint64_t, std::shared_ptr<ClosedConnection>>
+      closed_connection_expiry_;
+  TimerPointer closed_connection_timer_;
+  uint64_t closed_connection_memory_ = 0;
+
+  // Counts the active QuicServerSessions and limits the rate of new
+  // connections per source prefix. Initial packets over either limit
+  // are dropped before any cryptographic work is done for them.
+  SourcePrefixLimiter prefix_limiter_;
 
   // The validated_addrs_ vector is used as an LRU cache for
   // validated addresses only when the VALIDATE_ADDRESS_LRU
@@ -314,11 +600,48 @@ class QuicSocket : public HandleWrap,
     // The total number of QuicClientSessions that have been
     // associated with this QuicSocket instance.
     uint64_t client_sessions;
+
+    // The memory currently held by this QuicSocket instance
+    // and all of its QuicSessions.
+    uint64_t memory;
+
+    // The total number of Initial packets for which a new
+    // QuicServerSession was accepted or refused with SERVER_BUSY.
+    uint64_t handshakes_admitted;
+    uint64_t handshakes_rejected;
+
+    // The total number of Retry packets sent by this QuicSocket.
+    uint64_t handshakes_retried;
+
+    // The smoothed event loop delay in nanoseconds, while
+    // admission control is monitoring it.
+    uint64_t loop_delay;
+
+    // The total number of Initial packets dropped because their
+    // source prefix had too many connections or was starting new
+    // connections too quickly.
+    uint64_t initials_connection_limited;
+    uint64_t initials_rate_limited;
+
+    // The total number of stateless resets sent for packets received
+    // for unknown connections.
+    uint64_t stateless_resets;
   };
-  socket_stats socket_stats_{0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  socket_stats socket_stats_{};
 
   AliasedBigUint64Array stats_buffer_;
 
+  // The time from the creation of a QuicSession to the completion of
+  // its TLS handshake.
+  std::unique_ptr<HistogramBase> handshake_duration_;
+  // The smoothed RTT of each QuicSession when it is destroyed.
+  std::unique_ptr<HistogramBase> session_rtt_;
+  // The time from the creation of a QuicSession to its destruction.
+  std::unique_ptr<HistogramBase> session_lifetime_;
+  // The time from the creation of a locally initiated QuicStream to
+  // the first data received on it.
+  std::unique_ptr<HistogramBase> stream_ttfb_;
+
   template <typename... Members>
   void IncrementSocketStat(
       uint64_t amount,
@@ -359,7 +682,18 @@ class QuicSocket : public HandleWrap,
 
     virtual size_t Length() = 0;
 
-    bool IsDiagnosticPacketLoss();
+    // Called when the packet has been handed off, before Done(). SendWrap
+    // uses this to advance the read head of its QuicBuffer.
+    virtual void Advance() {}
+
+    // Completes the send synchronously for packets that were not handed
+    // to libuv. The wrap is deleted.
+    void Complete();
+
+    // Passes the packet through the socket's NetworkEmulator. When
+    // this returns true, the packet has been dropped or held for
+    // later delivery and Done() has been called.
+    bool Emulate(const uv_buf_t* bufs, size_t nbufs);
 
    private:
     uv_udp_send_t req_;
@@ -393,6 +727,8 @@ class QuicSocket : public HandleWrap,
 
     size_t Length() override { return length_; }
 
+    void Advance() override;
+
    private:
     QuicBuffer* buffer_;
     std::shared_ptr<QuicSession> session_;
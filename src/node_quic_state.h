@@ -21,9 +21,42 @@ typedef enum QuicSessionConfigIndex : int {
   IDX_QUIC_SESSION_DISABLE_MIGRATION,
   IDX_QUIC_SESSION_MAX_ACK_DELAY,
   IDX_QUIC_SESSION_MAX_CRYPTO_BUFFER,
+  IDX_QUIC_SESSION_MAX_MEMORY,
+  IDX_QUIC_SESSION_MAX_STREAM_WINDOW,
+  IDX_QUIC_SESSION_MAX_CONNECTION_WINDOW,
   IDX_QUIC_SESSION_CONFIG_COUNT
 } QuicSessionConfigIndex;
 
+typedef enum QuicLinkProfileIndex : int {
+  IDX_QUIC_LINK_DELAY,
+  IDX_QUIC_LINK_JITTER,
+  IDX_QUIC_LINK_RATE,
+  IDX_QUIC_LINK_QUEUE_LIMIT,
+  IDX_QUIC_LINK_REORDER,
+  IDX_QUIC_LINK_DUPLICATE,
+  IDX_QUIC_LINK_LOSS,
+  IDX_QUIC_LINK_BURST_LOSS,
+  IDX_QUIC_LINK_BURST_ENTER,
+  IDX_QUIC_LINK_BURST_EXIT,
+  IDX_QUIC_LINK_PROFILE_COUNT
+} QuicLinkProfileIndex;
+
+// The statistics of a QuicSession passed to 'quic' PerformanceObservers.
+// Times are in milliseconds.
+typedef enum QuicSessionPerformanceIndex : int {
+  IDX_QUIC_SESSION_PERF_TYPE,
+  IDX_QUIC_SESSION_PERF_HANDSHAKE_DURATION,
+  IDX_QUIC_SESSION_PERF_SMOOTHED_RTT,
+  IDX_QUIC_SESSION_PERF_MIN_RTT,
+  IDX_QUIC_SESSION_PERF_BYTES_SENT,
+  IDX_QUIC_SESSION_PERF_BYTES_RECEIVED,
+  IDX_QUIC_SESSION_PERF_STREAMS_IN,
+  IDX_QUIC_SESSION_PERF_STREAMS_OUT,
+  IDX_QUIC_SESSION_PERF_KEYUPDATES,
+  IDX_QUIC_SESSION_PERF_LOSS_RETRANSMITS,
+  IDX_QUIC_SESSION_PERF_COUNT
+} QuicSessionPerformanceIndex;
+
 class QuicState {
  public:
   explicit QuicState(v8::Isolate* isolate) :
@@ -34,16 +67,30 @@ class QuicState {
       isolate,
       offsetof(quic_state_internal, quicsessionconfig_buffer),
       IDX_QUIC_SESSION_CONFIG_COUNT + 1,
+      root_buffer),
+    quiclinkprofile_buffer(
+      isolate,
+      offsetof(quic_state_internal, quiclinkprofile_buffer),
+      IDX_QUIC_LINK_PROFILE_COUNT,
+      root_buffer),
+    quicsessionperformance_buffer(
+      isolate,
+      offsetof(quic_state_internal, quicsessionperformance_buffer),
+      IDX_QUIC_SESSION_PERF_COUNT,
       root_buffer) {
   }
 
   AliasedUint8Array root_buffer;
   AliasedFloat64Array quicsessionconfig_buffer;
+  AliasedFloat64Array quiclinkprofile_buffer;
+  AliasedFloat64Array quicsessionperformance_buffer;
 
  private:
   struct quic_state_internal {
     // doubles first so that they are always sizeof(double)-aligned
     double quicsessionconfig_buffer[IDX_QUIC_SESSION_CONFIG_COUNT + 1];
+    double quiclinkprofile_buffer[IDX_QUIC_LINK_PROFILE_COUNT];
+    double quicsessionperformance_buffer[IDX_QUIC_SESSION_PERF_COUNT];
   };
 };
 
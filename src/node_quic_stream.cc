@@ -17,14 +17,17 @@
 
 namespace node {
 
+using v8::Array;
 using v8::Context;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::Object;
 using v8::ObjectTemplate;
 using v8::String;
+using v8::Uint32;
 using v8::Value;
 
 namespace quic {
@@ -61,36 +64,65 @@ QuicStream::QuicStream(
     max_offset_ack_(0),
     flags_(QUICSTREAM_FLAG_INITIAL),
     available_outbound_length_(0),
-    inbound_consumed_data_while_paused_(0),
-    data_rx_rate_(
-      HistogramBase::New(
-        session->env(),
-        1, std::numeric_limits<int64_t>::max())),
-    data_rx_size_(
-      HistogramBase::New(
-        session->env(),
-        1, NGTCP2_MAX_PKT_SIZE)),
-    data_rx_ack_(
-      HistogramBase::New(
-        session->env(),
-        1, std::numeric_limits<int64_t>::max())),
-    stats_buffer_(
-      session->env()->isolate(),
-      sizeof(stream_stats_) / sizeof(uint64_t),
-      reinterpret_cast<uint64_t*>(&stream_stats_)) {
+    withheld_offset_(0) {
   CHECK_NOT_NULL(session);
   session->AddStream(this);
-  Debug(this, "Created");
+  QUIC_DEBUG(this, "Created");
   StreamBase::AttachToObject(GetObject());
   PushStreamListener(&stream_listener_);
   stream_stats_.created_at = uv_hrtime();
 
+  // The receive window starts at the initial flow control limit that
+  // applies to this kind of stream.
+  ngtcp2_transport_params params;
+  session->GetLocalTransportParams(&params);
+  uint64_t window = params.initial_max_stream_data_uni;
+  if (GetDirection() == QUIC_STREAM_BIRECTIONAL) {
+    window = IsLocallyInitiated() ?
+        params.initial_max_stream_data_bidi_local :
+        params.initial_max_stream_data_bidi_remote;
+  }
+  receive_window_.Initialize(window, session->GetMaxStreamWindow());
+  stream_stats_.receive_window = receive_window_.size();
+
+  // The stats array and each histogram allocate memory and are defined as
+  // properties of the JavaScript object, which dominates the cost of a
+  // QuicStream used for a single small exchange. With liteStreams, they
+  // are created once the application asks for a QuicStream.
+  if (!session->HasLiteStreams())
+    AttachStats();
+}
+
+void QuicStream::AttachStats() {
+  if (stats_buffer_)
+    return;
+  Local<Object> wrap = object();
+
+  stats_buffer_.reset(
+      new AliasedBigUint64Array(
+          env()->isolate(),
+          sizeof(stream_stats_) / sizeof(uint64_t),
+          reinterpret_cast<uint64_t*>(&stream_stats_)));
+
   USE(wrap->DefineOwnProperty(
       env()->context(),
       env()->stats_string(),
-      stats_buffer_.GetJSArray(),
+      stats_buffer_->GetJSArray(),
       PropertyAttribute::ReadOnly));
 
+  data_rx_rate_.reset(
+      HistogramBase::New(
+          env(),
+          1, std::numeric_limits<int64_t>::max()));
+  data_rx_size_.reset(
+      HistogramBase::New(
+          env(),
+          1, NGTCP2_MAX_PKT_SIZE));
+  data_rx_ack_.reset(
+      HistogramBase::New(
+          env(),
+          1, std::numeric_limits<int64_t>::max()));
+
   USE(wrap->DefineOwnProperty(
       env()->context(),
       FIXED_ONE_BYTE_STRING(env()->isolate(), "data_rx_rate"),
@@ -124,21 +156,21 @@ void QuicStream::Destroy() {
   SetWriteClose();
 
   uint64_t now = uv_hrtime();
-  Debug(this,
-        "Destroying.\n"
-        "  Duration: %" PRIu64 "\n"
-        "  Bytes Received: %" PRIu64 "\n"
-        "  Bytes Sent: %" PRIu64,
-        now - stream_stats_.created_at,
-        stream_stats_.bytes_received,
-        stream_stats_.bytes_sent);
+  QUIC_DEBUG(this,
+             "Destroying.\n"
+             "  Duration: %" PRIu64 "\n"
+             "  Bytes Received: %" PRIu64 "\n"
+             "  Bytes Sent: %" PRIu64,
+             now - stream_stats_.created_at,
+             stream_stats_.bytes_received,
+             stream_stats_.bytes_sent);
 
   // If there is data currently buffered in the streambuf_,
   // then cancel will call out to invoke an arbitrary
   // JavaScript callback (the on write callback). Within
   // that callback, however, the QuicStream will no longer
   // be usable to send or receive data.
-  streambuf_.Cancel();
+  session_->DecrementStreamMemory(streambuf_.Cancel());
   CHECK_EQ(streambuf_.Length(), 0);
 
   // The QuicSession maintains a map of std::unique_ptrs to
@@ -156,7 +188,7 @@ void QuicStream::Destroy() {
 int QuicStream::DoShutdown(ShutdownWrap* req_wrap) {
   if (IsDestroyed())
     return UV_EPIPE;
-  Debug(this, "Shutdown writable side");
+  QUIC_DEBUG(this, "Shutdown writable side");
   // Do nothing if the stream was already shutdown. Specifically,
   // we should not attempt to send anything on the QuicSession
   if (!IsWritable())
@@ -164,15 +196,27 @@ int QuicStream::DoShutdown(ShutdownWrap* req_wrap) {
   stream_stats_.closing_at = uv_hrtime();
   SetWriteClose();
 
-  // If we're not currently within an ngtcp2 callback, then we need to
-  // tell the QuicSession to initiate serialization and sending of any
-  // pending frames.
-  if (!QuicSession::Ngtcp2CallbackScope::InNgtcp2CallbackScope(session_))
-    session_->SendStreamData(this);
+  // Lets the application, if any, know that the final data for the
+  // stream can now be framed, then sends it.
+  Flush();
 
   return 1;
 }
 
+void QuicStream::Flush() {
+  if (IsDestroyed())
+    return;
+
+  session_->ResumeStream(stream_id_);
+
+  // If we're not within an ngtcp2 callback, go ahead and send
+  // the pending stream data. Otherwise, the data will be flushed
+  // once the ngtcp2 callback scope exits and all streams with
+  // data pending are flushed.
+  if (!QuicSession::Ngtcp2CallbackScope::InNgtcp2CallbackScope(session_))
+    session_->SendStreamData(this);
+}
+
 int QuicStream::DoWrite(
     WriteWrap* req_wrap,
     uv_buf_t* bufs,
@@ -210,17 +254,13 @@ int QuicStream::DoWrite(
           },
           req_wrap,
           req_wrap->object());
-  Debug(this, "Queuing %" PRIu64 " bytes of data from %d buffers",
-        length, nbufs);
+  QUIC_DEBUG(this, "Queuing %" PRIu64 " bytes of data from %d buffers",
+             length, nbufs);
   IncrementStat(length, &stream_stats_, &stream_stats::bytes_sent);
   stream_stats_.stream_sent_at = uv_hrtime();
-
-  // If we're not within an ngtcp2 callback, go ahead and send
-  // the pending stream data. Otherwise, the data will be flushed
-  // once the ngtcp2 callback scope exits and all streams with
-  // data pending are flushed.
-  if (!QuicSession::Ngtcp2CallbackScope::InNgtcp2CallbackScope(session_))
-    session_->SendStreamData(this);
+  session_->IncrementStreamMemory(length);
+  session_->UpdateMemoryUsage();
+  Flush();
 
   // IncrementAvailableOutboundLength(len);
   return 0;
@@ -240,15 +280,24 @@ void QuicStream::AckedDataOffset(uint64_t offset, size_t datalen) {
   CHECK_GE(offset, max_offset_ack_);
   max_offset_ack_ = offset;
 
-  Debug(this, "Acknowledging %d bytes", datalen);
+  Acknowledge(datalen);
+}
+
+void QuicStream::Acknowledge(size_t datalen) {
+  if (IsDestroyed())
+    return;
+
+  QUIC_DEBUG(this, "Acknowledging %d bytes", datalen);
 
   // Consumes the given number of bytes in the buffer. This may
   // have the side-effect of causing the onwrite callback to be
   // invoked if a complete chunk of buffered data has been acknowledged.
-  streambuf_.Consume(datalen);
+  // The callback may write to or destroy the QuicStream, so only the
+  // bytes consumed here are released.
+  session_->DecrementStreamMemory(streambuf_.Consume(datalen));
 
   uint64_t now = uv_hrtime();
-  if (stream_stats_.stream_acked_at > 0)
+  if (stream_stats_.stream_acked_at > 0 && data_rx_ack_)
     data_rx_ack_->Record(now - stream_stats_.stream_acked_at);
   stream_stats_.stream_acked_at = now;
 }
@@ -265,6 +314,73 @@ size_t QuicStream::DrainInto(std::vector<ngtcp2_vec>* vec) {
   return length;
 }
 
+size_t QuicStream::DrainChunk(const uint8_t** data) {
+  CHECK(!IsDestroyed());
+  uv_buf_t buf = streambuf_.Head();
+  // Empty chunks only carry a write callback, so they are skipped.
+  while (buf.base != nullptr && buf.len == 0) {
+    streambuf_.SeekHead();
+    buf = streambuf_.Head();
+  }
+  *data = reinterpret_cast<const uint8_t*>(buf.base);
+  if (buf.len > 0)
+    Commit(buf.len);
+  return buf.len;
+}
+
+void QuicStream::BeginHeaders(QuicStreamHeadersKind kind) {
+  headers_.clear();
+  headers_kind_ = kind;
+  headers_length_ = 0;
+}
+
+bool QuicStream::AddHeader(
+    const uint8_t* name,
+    size_t namelen,
+    const uint8_t* value,
+    size_t valuelen) {
+  // The size of a header block is counted as it is for HTTP/2, with
+  // 32 bytes of overhead for each field.
+  headers_length_ += namelen + valuelen + 32;
+  if (headers_length_ > DEFAULT_MAX_HEADER_LIST_SIZE)
+    return false;
+  headers_.emplace_back(reinterpret_cast<const char*>(name), namelen);
+  headers_.emplace_back(reinterpret_cast<const char*>(value), valuelen);
+  return true;
+}
+
+// Passes the collected block of headers on to the JavaScript side as
+// a flat array of alternating names and values.
+void QuicStream::EndHeaders() {
+  Isolate* isolate = env()->isolate();
+  HandleScope scope(isolate);
+  Context::Scope context_scope(env()->context());
+
+  std::vector<Local<Value>> headers(headers_.size());
+  for (size_t n = 0; n < headers_.size(); n++) {
+    headers[n] = OneByteString(
+        isolate,
+        headers_[n].data(),
+        headers_[n].length());
+  }
+
+  Local<Value> argv[] = {
+    Array::New(isolate, headers.data(), headers.size()),
+    Integer::New(isolate, headers_kind_)
+  };
+
+  headers_.clear();
+  headers_kind_ = QUICSTREAM_HEADERS_KIND_NONE;
+  headers_length_ = 0;
+
+  // Grab a shared pointer to this to prevent the QuicStream
+  // from being freed while the MakeCallback is running.
+  std::shared_ptr<QuicStream> ptr(this->shared_from_this());
+  MakeCallback(env()->quic_on_stream_headers_function(),
+               arraysize(argv),
+               argv);
+}
+
 inline void QuicStream::IncrementAvailableOutboundLength(size_t amount) {
   available_outbound_length_ += amount;
 }
@@ -278,13 +394,34 @@ int QuicStream::ReadStart() {
   CHECK(IsReadable());
   SetReadStart();
   SetReadResume();
-  session_->ExtendStreamOffset(this, inbound_consumed_data_while_paused_);
+  ReleaseWithheldOffset();
   return 0;
 }
 
+void QuicStream::ReleaseWithheldOffset() {
+  if (withheld_offset_ == 0 ||
+      IsReadPaused() ||
+      session_->IsMemoryConstrained()) {
+    return;
+  }
+  // As with the connection level credit, returning withheld credit
+  // never grows the receive window.
+  ExtendReceiveWindow(withheld_offset_, 0);
+  withheld_offset_ = 0;
+}
+
+void QuicStream::ExtendReceiveWindow(size_t amount, uint64_t rtt) {
+  uint64_t extend = receive_window_.Consume(amount, uv_hrtime(), rtt);
+  stream_stats_.receive_window = receive_window_.size();
+  session_->ExtendStreamOffset(this, extend);
+}
+
 int QuicStream::ReadStop() {
   CHECK(!this->IsDestroyed());
-  CHECK(IsReadable());
+  // A StreamPipe stops reading once the final stream frame has been
+  // received, after the readable side has already been closed.
+  if (!IsReadable())
+    return 0;
   SetReadPause();
   return 0;
 }
@@ -303,10 +440,10 @@ void QuicStream::ReceiveData(
     size_t datalen,
     uint64_t offset) {
   CHECK(!IsDestroyed());
-  Debug(this, "Receiving %d bytes. Final? %s. Readable? %s",
-        datalen,
-        fin ? "yes" : "no",
-        IsReadable() ? "yes" : "no");
+  QUIC_DEBUG(this, "Receiving %d bytes. Final? %s. Readable? %s",
+             datalen,
+             fin ? "yes" : "no",
+             IsReadable() ? "yes" : "no");
 
   // If the QuicStream is not (or was never) readable, just ignore the chunk.
   if (!IsReadable())
@@ -356,11 +493,12 @@ void QuicStream::ReceiveData(
       EmitRead(avail, buf);
       // Reading can be paused while we are processing. If that's
       // the case, we still want to acknowledge the current bytes
-      // so that pausing does not throw off our flow control.
-      if (read_paused)
-        inbound_consumed_data_while_paused_ += avail;
+      // so that pausing does not throw off our flow control. The
+      // same applies while the QuicSession is low on memory.
+      if (read_paused || session_->IsMemoryConstrained())
+        withheld_offset_ += avail;
       else
-        session_->ExtendStreamOffset(this, avail);
+        ExtendReceiveWindow(avail, session_->GetSmoothedRTT());
     }
   }
 
@@ -377,10 +515,16 @@ inline void QuicStream::IncrementStats(size_t datalen) {
   IncrementStat(len, &stream_stats_, &stream_stats::bytes_received);
 
   uint64_t now = uv_hrtime();
-  if (stream_stats_.stream_received_at > 0)
-    data_rx_rate_->Record(now - stream_stats_.stream_received_at);
+  if (stream_stats_.stream_received_at > 0) {
+    if (data_rx_rate_)
+      data_rx_rate_->Record(now - stream_stats_.stream_received_at);
+  } else if (IsLocallyInitiated()) {
+    session_->Socket()->RecordStreamTimeToFirstByte(
+        now - stream_stats_.created_at);
+  }
   stream_stats_.stream_received_at = now;
-  data_rx_size_->Record(len);
+  if (data_rx_size_)
+    data_rx_size_->Record(len);
 }
 
 void QuicStream::Shutdown(uint64_t app_error_code) {
@@ -406,6 +550,20 @@ QuicStream* QuicStream::New(QuicSession* session, int64_t stream_id) {
 
 // JavaScript API
 namespace {
+// Used to ask a StreamPipe that has just been started for the first
+// chunk of data.
+void QuicStreamFlush(const FunctionCallbackInfo<Value>& args) {
+  QuicStream* stream;
+  ASSIGN_OR_RETURN_UNWRAP(&stream, args.Holder());
+  stream->Flush();
+}
+
+void QuicStreamAttachStats(const FunctionCallbackInfo<Value>& args) {
+  QuicStream* stream;
+  ASSIGN_OR_RETURN_UNWRAP(&stream, args.Holder());
+  stream->AttachStats();
+}
+
 void QuicStreamGetID(const FunctionCallbackInfo<Value>& args) {
   QuicStream* stream;
   ASSIGN_OR_RETURN_UNWRAP(&stream, args.Holder());
@@ -459,6 +617,30 @@ void QuicStreamShutdown(const FunctionCallbackInfo<Value>& args) {
       family == QUIC_ERROR_APPLICATION ?
           code : static_cast<uint64_t>(NGTCP2_NO_ERROR));
 }
+
+// Submits a block of headers as passed from the JavaScript side in
+// the form [kind, [string, count]]. Returns false if the headers could
+// not be submitted.
+void QuicStreamSubmitHeaders(const FunctionCallbackInfo<Value>& args) {
+  QuicStream* stream;
+  ASSIGN_OR_RETURN_UNWRAP(&stream, args.Holder());
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsArray());
+
+  uint32_t kind = args[0].As<Uint32>()->Value();
+  CHECK(kind == QUICSTREAM_HEADERS_KIND_INFORMATIONAL ||
+        kind == QUICSTREAM_HEADERS_KIND_INITIAL ||
+        kind == QUICSTREAM_HEADERS_KIND_TRAILING);
+
+  if (stream->IsDestroyed())
+    return args.GetReturnValue().Set(false);
+
+  args.GetReturnValue().Set(
+      stream->Session()->SubmitHeaders(
+          stream->GetID(),
+          static_cast<QuicStreamHeadersKind>(kind),
+          args[1].As<Array>()));
+}
 }  // namespace
 
 void QuicStream::Initialize(
@@ -477,6 +659,9 @@ void QuicStream::Initialize(
   env->SetProtoMethod(stream, "destroy", QuicStreamDestroy);
   env->SetProtoMethod(stream, "shutdownStream", QuicStreamShutdown);
   env->SetProtoMethod(stream, "id", QuicStreamGetID);
+  env->SetProtoMethod(stream, "flush", QuicStreamFlush);
+  env->SetProtoMethod(stream, "submitHeaders", QuicStreamSubmitHeaders);
+  env->SetProtoMethod(stream, "attachStats", QuicStreamAttachStats);
   env->set_quicserverstream_constructor_template(streamt);
   target->Set(env->context(),
               class_name,
@@ -12,6 +12,8 @@
 #include "v8.h"
 
 #include <deque>
+#include <string>
+#include <vector>
 
 namespace node {
 namespace quic {
@@ -168,6 +170,12 @@ class QuicStream : public AsyncWrap,
 
   int64_t GetID() const { return stream_id_; }
 
+  inline bool IsLocallyInitiated() const {
+    return session_->Side() == NGTCP2_CRYPTO_SIDE_SERVER ?
+        GetOrigin() == QUIC_STREAM_SERVER :
+        GetOrigin() == QUIC_STREAM_CLIENT;
+  }
+
   inline bool IsDestroyed() const {
     return flags_ & QUICSTREAM_FLAG_DESTROYED;
   }
@@ -191,11 +199,8 @@ class QuicStream : public AsyncWrap,
   // If WasEverWritable() is false, then no stream frames should
   // ever be sent from the local peer, including final stream frames.
   inline bool WasEverWritable() const {
-    if (GetDirection() == QUIC_STREAM_UNIDIRECTIONAL) {
-      return session_->Side() == NGTCP2_CRYPTO_SIDE_SERVER ?
-          GetOrigin() == QUIC_STREAM_SERVER :
-          GetOrigin() == QUIC_STREAM_CLIENT;
-    }
+    if (GetDirection() == QUIC_STREAM_UNIDIRECTIONAL)
+      return IsLocallyInitiated();
     return true;
   }
 
@@ -269,14 +274,35 @@ class QuicStream : public AsyncWrap,
 
   virtual void AckedDataOffset(uint64_t offset, size_t datalen);
 
+  // Releases the given number of bytes of acknowledged data from the
+  // front of the outbound queue.
+  void Acknowledge(size_t datalen);
+
+  void ReleaseWithheldOffset();
+
   virtual void Destroy();
 
+  // Creates the stats array and the data_rx_* histograms and defines them
+  // on the JavaScript object. For liteStreams sessions this is deferred
+  // until a QuicStream is created for the stream in JavaScript.
+  void AttachStats();
+
   int DoWrite(
       WriteWrap* req_wrap,
       uv_buf_t* bufs,
       size_t nbufs,
       uv_stream_t* send_handle) override;
 
+  // Lets the QuicSession frame any data that has been queued for the
+  // QuicStream and, when not within an ngtcp2 callback, send it.
+  void Flush();
+
+  // A QuicStream may be the sink of a StreamPipe. WantsWrite() is called
+  // once all of the queued outbound data has been serialized in order to
+  // ask the source for the next chunk.
+  bool HasWantsWrite() const override { return true; }
+  void WantsWrite() { EmitWantsWrite(DEFAULT_STREAM_WANTS_WRITE_SIZE); }
+
   inline void IncrementAvailableOutboundLength(size_t amount);
   inline void DecrementAvailableOutboundLength(size_t amount);
 
@@ -301,6 +327,26 @@ class QuicStream : public AsyncWrap,
 
   size_t DrainInto(std::vector<ngtcp2_vec>* vec);
 
+  // Points data at the next chunk of outbound data that has not yet been
+  // serialized and marks it as serialized. The data remains in the outbound
+  // queue until it has been acknowledged. Returns the length of the chunk,
+  // or zero if there is no pending outbound data.
+  size_t DrainChunk(const uint8_t** data);
+
+  uint64_t GetReceivedBytes() const { return stream_stats_.bytes_received; }
+
+  // Headers are collected between BeginHeaders() and EndHeaders(), then
+  // passed to the JavaScript side as a single block. AddHeader() returns
+  // false once the block grows larger than DEFAULT_MAX_HEADER_LIST_SIZE.
+  void BeginHeaders(QuicStreamHeadersKind kind);
+  void SetHeadersKind(QuicStreamHeadersKind kind) { headers_kind_ = kind; }
+  bool AddHeader(
+      const uint8_t* name,
+      size_t namelen,
+      const uint8_t* value,
+      size_t valuelen);
+  void EndHeaders();
+
   AsyncWrap* GetAsyncWrap() override { return this; }
 
   void MemoryInfo(MemoryTracker* tracker) const override {
@@ -347,7 +393,7 @@ class QuicStream : public AsyncWrap,
   }
 
   inline void SetReadResume() {
-    flags_ &= QUICSTREAM_FLAG_READ_PAUSED;
+    flags_ &= ~QUICSTREAM_FLAG_READ_PAUSED;
   }
 
   inline void SetDestroyed() {
@@ -355,6 +401,7 @@ class QuicStream : public AsyncWrap,
   }
 
   inline void IncrementStats(size_t datalen);
+  void ExtendReceiveWindow(size_t amount, uint64_t rtt);
 
   QuicStreamListener stream_listener_;
   QuicSession* session_;
@@ -365,7 +412,18 @@ class QuicStream : public AsyncWrap,
 
   QuicBuffer streambuf_;
   size_t available_outbound_length_;
-  size_t inbound_consumed_data_while_paused_;
+
+  // The block of headers currently being received.
+  std::vector<std::string> headers_;
+  QuicStreamHeadersKind headers_kind_ = QUICSTREAM_HEADERS_KIND_NONE;
+  size_t headers_length_ = 0;
+
+  // Flow control credit for data that has been passed on to the
+  // JavaScript side while reading was paused or while the QuicSession
+  // was low on memory. It is returned to the peer once neither is the
+  // case any longer.
+  size_t withheld_offset_;
+  ReceiveWindow receive_window_;
 
   struct stream_stats {
     // The timestamp at which the stream was created
@@ -383,8 +441,10 @@ class QuicStream : public AsyncWrap,
     uint64_t bytes_received;
     // The total number of bytes sent
     uint64_t bytes_sent;
+    // The current size of the receive window
+    uint64_t receive_window;
   };
-  stream_stats stream_stats_{0, 0, 0, 0, 0, 0, 0};
+  stream_stats stream_stats_{0, 0, 0, 0, 0, 0, 0, 0};
 
   // data_rx_rate_ measures the elapsed time between data packets
   // for this stream. When used in combination with the data_rx_size,
@@ -407,7 +467,7 @@ class QuicStream : public AsyncWrap,
   // generally taking too long to acknowledge sent stream data.
   std::unique_ptr<HistogramBase> data_rx_ack_;
 
-  AliasedBigUint64Array stats_buffer_;
+  std::unique_ptr<AliasedBigUint64Array> stats_buffer_;
 };
 
 }  // namespace quic
@@ -3,6 +3,8 @@
 #include "util-inl.h"
 #include "uv.h"
 
+#include <algorithm>
+
 namespace node {
 namespace quic {
 
@@ -26,5 +28,251 @@ void Timer::CleanupHook(void* data) {
   Free(static_cast<Timer*>(data));
 }
 
+void NetworkEmulator::Configure(
+    const LinkProfile& profile,
+    uint32_t seed,
+    uint32_t stream) {
+  // std::seed_seq and std::mt19937_64 are fully specified by the
+  // standard, so a given seed produces the same sequence everywhere.
+  std::seed_seq seq { seed, stream };
+  rng_.seed(seq);
+  profile_ = profile;
+  bad_state_ = false;
+  link_free_at_ = 0;
+  last_delivery_ = 0;
+  enabled_ =
+      profile.delay > 0 ||
+      profile.jitter > 0 ||
+      profile.rate > 0 ||
+      profile.reorder > 0.0 ||
+      profile.duplicate > 0.0 ||
+      profile.loss > 0.0 ||
+      profile.burst_enter > 0.0;
+}
+
+// Unlike std::uniform_real_distribution, whose output is implementation
+// defined, this maps the top 53 bits of the generator onto [0, 1).
+double NetworkEmulator::Uniform() {
+  return static_cast<double>(rng_() >> 11) * (1.0 / (1ULL << 53));
+}
+
+NetworkEmulator::Schedule NetworkEmulator::Next(
+    uint64_t now,
+    size_t length) {
+  double transition = Uniform();
+  double lose = Uniform();
+  double jitter = Uniform();
+  double reorder = Uniform();
+  double duplicate = Uniform();
+
+  Schedule schedule { true, false, now };
+
+  if (bad_state_) {
+    if (transition < profile_.burst_exit)
+      bad_state_ = false;
+  } else if (transition < profile_.burst_enter) {
+    bad_state_ = true;
+  }
+  if (lose < (bad_state_ ? profile_.burst_loss : profile_.loss))
+    return schedule;
+
+  uint64_t departure = now;
+  if (profile_.rate > 0) {
+    uint64_t start = std::max(now, link_free_at_);
+    double backlog = static_cast<double>(start - now) * profile_.rate / 1e9;
+    if (profile_.queue_limit > 0 && backlog + length > profile_.queue_limit)
+      return schedule;
+    link_free_at_ =
+        start + static_cast<uint64_t>(length * 1e9 / profile_.rate);
+    departure = link_free_at_;
+  }
+
+  schedule.drop = false;
+  schedule.duplicate = duplicate < profile_.duplicate;
+
+  if (reorder < profile_.reorder) {
+    schedule.deliver_at = departure;
+    return schedule;
+  }
+
+  int64_t offset = 0;
+  if (profile_.jitter > 0) {
+    offset = static_cast<int64_t>(
+        (jitter * 2.0 - 1.0) * static_cast<double>(profile_.jitter));
+  }
+  uint64_t delay = profile_.delay;
+  if (offset < 0 && static_cast<uint64_t>(-offset) > delay)
+    delay = 0;
+  else
+    delay += offset;
+
+  schedule.deliver_at = std::max(departure + delay, last_delivery_);
+  last_delivery_ = schedule.deliver_at;
+  return schedule;
+}
+
+void ReceiveWindow::Initialize(uint64_t size, uint64_t max_size) {
+  size_ = size;
+  max_size_ = std::max(size, max_size);
+  consumed_ = 0;
+  epoch_start_ = 0;
+}
+
+uint64_t ReceiveWindow::Consume(uint64_t amount, uint64_t now, uint64_t rtt) {
+  if (epoch_start_ == 0)
+    epoch_start_ = now;
+  consumed_ += amount;
+  if (consumed_ < size_ / 2)
+    return amount;
+
+  uint64_t extend = amount;
+  if (rtt > 0 && size_ < max_size_ && now - epoch_start_ < 2 * rtt) {
+    uint64_t increase = std::min(size_, max_size_ - size_);
+    size_ += increase;
+    extend += increase;
+  }
+  consumed_ = 0;
+  epoch_start_ = now;
+  return extend;
+}
+
+void AdmissionControl::Configure(uint64_t max_loop_delay, size_t max_sessions) {
+  max_loop_delay_ = max_loop_delay;
+  max_sessions_ = max_sessions;
+  loop_delay_ = 0;
+  overloaded_ = false;
+}
+
+// The samples are smoothed so that a single slow turn of the event loop
+// does not turn connections away, while a sustained delay does within a
+// few samples.
+void AdmissionControl::RecordLoopDelay(uint64_t delay) {
+  loop_delay_ = loop_delay_ - loop_delay_ / 4 + delay / 4;
+}
+
+bool AdmissionControl::IsOverloaded(size_t sessions) {
+  bool delayed = max_loop_delay_ > 0 && loop_delay_ >= max_loop_delay_;
+  bool full = max_sessions_ > 0 && sessions >= max_sessions_;
+  if (delayed || full) {
+    overloaded_ = true;
+  } else if (overloaded_) {
+    overloaded_ =
+        (max_loop_delay_ > 0 &&
+         loop_delay_ >= max_loop_delay_ - max_loop_delay_ / 4) ||
+        (max_sessions_ > 0 && sessions >= max_sessions_ - max_sessions_ / 4);
+  }
+  return overloaded_;
+}
+
+SourcePrefix SourcePrefix::From(const sockaddr* addr) {
+  SourcePrefix prefix;
+  prefix.family = addr->sa_family;
+  switch (addr->sa_family) {
+    case AF_INET:
+      prefix.bits =
+          reinterpret_cast<const sockaddr_in*>(addr)->sin_addr.s_addr;
+      break;
+    case AF_INET6: {
+      const sockaddr_in6* addr6 = reinterpret_cast<const sockaddr_in6*>(addr);
+      memcpy(&prefix.bits, &addr6->sin6_addr, sizeof(prefix.bits));
+      break;
+    }
+    default:
+      UNREACHABLE();
+  }
+  return prefix;
+}
+
+void SourcePrefixLimiter::Configure(
+    size_t max_connections,
+    double rate,
+    double burst) {
+  max_connections_ = max_connections;
+  rate_ = rate;
+  burst_ = std::max(burst, 1.0);
+}
+
+void SourcePrefixLimiter::Refill(Entry* entry, uint64_t now) {
+  if (rate_ > 0 && now > entry->updated_at) {
+    entry->tokens =
+        std::min(burst_,
+                 entry->tokens + (now - entry->updated_at) * rate_ / 1e9);
+  }
+  entry->updated_at = now;
+}
+
+SourcePrefixLimiter::Result SourcePrefixLimiter::AcceptInitial(
+    const SourcePrefix& prefix,
+    uint64_t now) {
+  if (max_connections_ == 0 && rate_ == 0)
+    return Result::OK;
+
+  if (entries_.size() >= prune_at_)
+    Prune(now);
+
+  auto it = entries_.find(prefix);
+  if (it == std::end(entries_)) {
+    Entry entry;
+    entry.tokens = burst_;
+    entry.updated_at = now;
+    it = entries_.emplace(prefix, entry).first;
+  }
+  Entry* entry = &it->second;
+
+  if (max_connections_ > 0 && entry->connections >= max_connections_)
+    return Result::CONNECTION_LIMIT;
+
+  if (rate_ > 0) {
+    Refill(entry, now);
+    if (entry->tokens < 1)
+      return Result::RATE_LIMIT;
+    entry->tokens -= 1;
+  }
+  return Result::OK;
+}
+
+void SourcePrefixLimiter::AddConnection(const SourcePrefix& prefix) {
+  if (prefix.family == AF_UNSPEC)
+    return;
+  auto it = entries_.find(prefix);
+  if (it == std::end(entries_)) {
+    Entry entry;
+    entry.tokens = burst_;
+    it = entries_.emplace(prefix, entry).first;
+  }
+  it->second.connections++;
+}
+
+void SourcePrefixLimiter::RemoveConnection(const SourcePrefix& prefix) {
+  auto it = entries_.find(prefix);
+  if (it == std::end(entries_))
+    return;
+  CHECK_GT(it->second.connections, 0);
+  // Without a rate limit, an entry without connections carries no state.
+  if (--it->second.connections == 0 && rate_ == 0)
+    entries_.erase(it);
+}
+
+size_t SourcePrefixLimiter::GetConnectionCount(
+    const SourcePrefix& prefix) const {
+  auto it = entries_.find(prefix);
+  return it == std::end(entries_) ? 0 : it->second.connections;
+}
+
+// Pruning is amortized: the table is only swept once it has doubled in
+// size since the previous sweep.
+void SourcePrefixLimiter::Prune(uint64_t now) {
+  for (auto it = std::begin(entries_); it != std::end(entries_);) {
+    Refill(&it->second, now);
+    if (it->second.connections == 0 &&
+        (rate_ == 0 || it->second.tokens >= burst_)) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  prune_at_ = std::max(MIN_SOURCE_PREFIX_PRUNE, entries_.size() * 2);
+}
+
 }  // namespace quic
 }  // namespace node
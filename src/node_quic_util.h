@@ -3,6 +3,7 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include "debug_utils.h"
 #include "node_quic_buffer.h"
 #include "string_bytes.h"
 #include "uv.h"
@@ -12,9 +13,34 @@
 #include <openssl/ssl.h>
 
 #include <functional>
+#include <random>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+// QUIC_DEBUG(wrap, format, ...) behaves like Debug(wrap, format, ...) but
+// the format arguments are only evaluated when debug output is enabled
+// for the category of the AsyncWrap (e.g. NODE_DEBUG_NATIVE=QUICSOCKET).
+// When it is not, the cost is a single load and branch on the cached
+// per-category flag, so arguments like cid.ToHex().c_str() can be passed
+// freely on hot paths. Define NODE_QUIC_DEBUG as 0 at build time to
+// remove QUIC debug output entirely.
+#ifndef NODE_QUIC_DEBUG
+#define NODE_QUIC_DEBUG 1
+#endif
+
+#define QUIC_DEBUG(wrap, ...)                                                 \
+  do {                                                                        \
+    if (NODE_QUIC_DEBUG) {                                                    \
+      ::node::AsyncWrap* quic_debug_wrap = (wrap);                            \
+      if (UNLIKELY(quic_debug_wrap->env()->debug_enabled(                     \
+              static_cast<::node::DebugCategory>(                             \
+                  quic_debug_wrap->provider_type())))) {                      \
+        ::node::UnconditionalAsyncWrapDebug(quic_debug_wrap, __VA_ARGS__);    \
+      }                                                                       \
+    }                                                                         \
+  } while (0)
+
 namespace node {
 namespace quic {
 
@@ -24,9 +50,12 @@ constexpr size_t MIN_INITIAL_QUIC_PKT_SIZE = 1200;
 constexpr size_t NGTCP2_SV_SCIDLEN = NGTCP2_MAX_CIDLEN;
 constexpr size_t TOKEN_RAND_DATALEN = 16;
 constexpr size_t TOKEN_SECRETLEN = 16;
+constexpr size_t RESET_SECRETLEN = 16;
 
 constexpr size_t kMaxSizeT = std::numeric_limits<size_t>::max();
 constexpr size_t DEFAULT_MAX_CONNECTIONS_PER_HOST = 100;
+constexpr size_t MIN_SOURCE_PREFIX_PRUNE = 1024;
+constexpr double MAX_STATELESS_RESET_RATE = 100;
 constexpr uint64_t MIN_MAX_CRYPTO_BUFFER = 4096;
 constexpr uint64_t MIN_RETRYTOKEN_EXPIRATION = 1;
 constexpr uint64_t MAX_RETRYTOKEN_EXPIRATION = 60;
@@ -40,6 +69,29 @@ constexpr uint64_t DEFAULT_MAX_STREAMS_BIDI = 100;
 constexpr uint64_t DEFAULT_MAX_STREAMS_UNI = 3;
 constexpr uint64_t DEFAULT_IDLE_TIMEOUT = 10 * 1000;
 constexpr uint64_t DEFAULT_RETRYTOKEN_EXPIRATION = 10ULL;
+constexpr uint64_t MIN_MAX_SESSION_MEMORY = 64 * 1024;
+constexpr uint64_t DEFAULT_MAX_SESSION_MEMORY = 16 * 1024 * 1024;
+constexpr uint64_t DEFAULT_MAX_SOCKET_MEMORY =
+    std::numeric_limits<uint64_t>::max();
+// Receive windows start at the initial flow control limits and are
+// grown up to these maximums. They are kept well below the default
+// session memory ceiling.
+constexpr uint64_t DEFAULT_MAX_STREAM_WINDOW = 4 * 1024 * 1024;
+constexpr uint64_t DEFAULT_MAX_CONNECTION_WINDOW = 8 * 1024 * 1024;
+// The largest header block, counted as in HTTP/2 (name + value + 32
+// per field), that an HTTP/3 QuicSession will accept from its peer.
+constexpr size_t DEFAULT_MAX_HEADER_LIST_SIZE = 64 * 1024;
+// The amount of data a QuicStream asks a StreamPipe source (for instance,
+// a FileHandle) for once all of its queued outbound data has been
+// serialized.
+constexpr size_t DEFAULT_STREAM_WANTS_WRITE_SIZE = 64 * 1024;
+
+// Once a QuicSession or QuicSocket holds more than three quarters of
+// its memory ceiling, flow control credit is withheld from peers until
+// enough memory has been released again.
+inline bool IsNearMemoryLimit(uint64_t usage, uint64_t limit) {
+  return usage > limit - limit / 4;
+}
 
 typedef enum SelectPreferredAddressPolicy : int {
   // Ignore the server-provided preferred address
@@ -48,6 +100,16 @@ typedef enum SelectPreferredAddressPolicy : int {
   QUIC_PREFERRED_ADDRESS_ACCEPT
 } SelectPreferredAddressPolicy;
 
+// The kinds of header blocks that can be received or submitted on a
+// QuicStream when the QuicSession uses an application protocol, such
+// as HTTP/3, that supports headers.
+typedef enum QuicStreamHeadersKind : int {
+  QUICSTREAM_HEADERS_KIND_NONE,
+  QUICSTREAM_HEADERS_KIND_INFORMATIONAL,
+  QUICSTREAM_HEADERS_KIND_INITIAL,
+  QUICSTREAM_HEADERS_KIND_TRAILING
+} QuicStreamHeadersKind;
+
 // Fun hash combine trick based on a variadic template that
 // I came across a while back but can't remember where. Will add an attribution
 // if I can find the source.
@@ -200,7 +262,7 @@ class SocketAddress {
     }
 
     char host[NI_MAXHOST];
-    if (uv_inet_ntop(af, binaddr, host, sizeof(host)) == 0)
+    if (uv_inet_ntop(af, binaddr, host, sizeof(host)) != 0)
       return false;
 
     addrinfo hints{};
@@ -240,16 +302,16 @@ class SocketAddress {
         reinterpret_cast<const sockaddr_in6*>(addr)->sin6_port);
   }
 
-  static void GetAddress(const sockaddr* addr, char** host) {
-    char hostbuf[INET6_ADDRSTRLEN];
+  static std::string GetAddress(const sockaddr* addr) {
+    char host[INET6_ADDRSTRLEN];
     const void* src = addr->sa_family == AF_INET ?
         static_cast<const void*>(
             &(reinterpret_cast<const sockaddr_in*>(addr)->sin_addr)) :
         static_cast<const void*>(
             &(reinterpret_cast<const sockaddr_in6*>(addr)->sin6_addr));
-    if (uv_inet_ntop(addr->sa_family, src, hostbuf, sizeof(hostbuf)) == 0) {
-      *host = hostbuf;
-    }
+    if (uv_inet_ntop(addr->sa_family, src, host, sizeof(host)) != 0)
+      return std::string();
+    return std::string(host);
   }
 
   static size_t GetAddressLen(const sockaddr* addr) {
@@ -432,6 +494,15 @@ class Timer {
     uv_unref(reinterpret_cast<uv_handle_t*>(&timer_));
   }
 
+  // Schedules a single invocation after timeout milliseconds, replacing
+  // any pending invocation. Unlike Update, the timer does not repeat.
+  inline void Once(uint64_t timeout) {
+    if (stopped_)
+      return;
+    uv_timer_start(&timer_, OnTimeout, timeout, 0);
+    uv_unref(reinterpret_cast<uv_handle_t*>(&timer_));
+  }
+
   static void Free(Timer* timer);
 
  private:
@@ -451,6 +522,190 @@ class Timer {
 
 using TimerPointer = DeleteFnPtr<Timer, Timer::Free>;
 
+// The impairments applied by a NetworkEmulator to packets travelling
+// in one direction. Times are in nanoseconds and probabilities are
+// between 0.0 and 1.0.
+struct LinkProfile {
+  uint64_t delay = 0;
+  // Each packet's delay varies uniformly within +/- jitter. Jitter
+  // alone never reorders packets.
+  uint64_t jitter = 0;
+  // The bottleneck rate in bytes per second. Zero is unlimited.
+  uint64_t rate = 0;
+  // The number of bytes that may wait for the bottleneck before
+  // packets are tail dropped. Zero is unbounded.
+  uint64_t queue_limit = 0;
+  // The probability that a packet skips the delay, overtaking the
+  // packets sent before it.
+  double reorder = 0.0;
+  double duplicate = 0.0;
+  // Gilbert-Elliott burst loss. loss and burst_loss are the loss
+  // probabilities in the good and bad states; burst_enter and
+  // burst_exit are the per packet probabilities of switching state.
+  // With burst_enter at 0.0 this is plain random loss.
+  double loss = 0.0;
+  double burst_loss = 0.0;
+  double burst_enter = 0.0;
+  double burst_exit = 0.0;
+};
+
+// A seeded model of a network link, used by QuicSocket to impair
+// received and transmitted packets for testing and benchmarking.
+// Every packet consumes the same number of random draws, so the
+// pattern of losses, reordering and duplicates depends only on the
+// seed and the packet's position in the sequence. The NetworkEmulator
+// only decides what happens to each packet; holding and releasing
+// delayed packets is up to the caller.
+class NetworkEmulator {
+ public:
+  struct Schedule {
+    bool drop;
+    // When true, a second copy of the packet is delivered at the
+    // same time as the first.
+    bool duplicate;
+    uint64_t deliver_at;
+  };
+
+  void Configure(const LinkProfile& profile, uint32_t seed, uint32_t stream);
+
+  bool IsEnabled() const { return enabled_; }
+
+  // Returns the fate of a packet of the given length entering the link
+  // at now, in nanoseconds.
+  Schedule Next(uint64_t now, size_t length);
+
+ private:
+  double Uniform();
+
+  LinkProfile profile_;
+  std::mt19937_64 rng_;
+  bool enabled_ = false;
+  bool bad_state_ = false;
+  uint64_t link_free_at_ = 0;
+  uint64_t last_delivery_ = 0;
+};
+
+// Tracks the size of a stream or connection level receive window and
+// grows it when the window, rather than the network or the reader, is
+// limiting the transfer. Each time half of the window has been consumed,
+// the window is doubled (up to its maximum) if that took less than two
+// smoothed round trips. Growing the window is done by extending the flow
+// control limit by more than the number of bytes consumed.
+class ReceiveWindow {
+ public:
+  void Initialize(uint64_t size, uint64_t max_size);
+
+  uint64_t size() const { return size_; }
+
+  // Records that amount bytes have been consumed at now, in nanoseconds,
+  // and returns the number of bytes by which the flow control limit is
+  // to be extended. The window never grows when rtt is zero.
+  uint64_t Consume(uint64_t amount, uint64_t now, uint64_t rtt);
+
+ private:
+  uint64_t size_ = 0;
+  uint64_t max_size_ = 0;
+  uint64_t consumed_ = 0;
+  uint64_t epoch_start_ = 0;
+};
+
+// Decides whether a QuicSocket has the capacity to accept new
+// connections, based on how far the event loop is running behind and on
+// the number of sessions it holds. Like the ELDHistogram used by
+// perf_hooks.monitorEventLoopDelay(), the event loop delay is measured
+// by how late a repeating timer fires. The socket is overloaded once
+// either threshold is reached, and remains overloaded until both
+// measurements have fallen below three quarters of their thresholds.
+class AdmissionControl {
+ public:
+  // Delays are in nanoseconds. A threshold of zero is not checked.
+  void Configure(uint64_t max_loop_delay, size_t max_sessions);
+
+  bool IsEnabled() const { return max_loop_delay_ > 0 || max_sessions_ > 0; }
+
+  // Records how late, in nanoseconds, the sampling timer has fired.
+  void RecordLoopDelay(uint64_t delay);
+
+  // The smoothed event loop delay in nanoseconds.
+  uint64_t loop_delay() const { return loop_delay_; }
+
+  bool IsOverloaded(size_t sessions);
+
+ private:
+  uint64_t max_loop_delay_ = 0;
+  size_t max_sessions_ = 0;
+  uint64_t loop_delay_ = 0;
+  bool overloaded_ = false;
+};
+
+// The prefix under which the address of a client is aggregated when new
+// connections are limited: the full address for IPv4 (/32) and the
+// network prefix for IPv6 (/64), as a single IPv6 host commonly has a
+// whole /64 to choose addresses from. A default constructed
+// SourcePrefix matches no client and is ignored by SourcePrefixLimiter.
+struct SourcePrefix {
+  uint64_t bits = 0;
+  int family = AF_UNSPEC;
+
+  static SourcePrefix From(const sockaddr* addr);
+
+  bool operator==(const SourcePrefix& other) const {
+    return bits == other.bits && family == other.family;
+  }
+
+  struct Hash {
+    size_t operator()(const SourcePrefix& prefix) const {
+      size_t hash = 0;
+      hash_combine(&hash, prefix.bits, prefix.family);
+      return hash;
+    }
+  };
+};
+
+// Limits, per SourcePrefix, both the number of concurrent connections
+// and the rate at which new connections may be started. The rate is
+// enforced with a token bucket that holds up to burst tokens and is
+// refilled at rate tokens per second; every Initial packet that would
+// start a new connection takes one token. A limit of zero is not
+// enforced. Entries for prefixes that have no connections and a full
+// bucket carry no state and are pruned as the table grows.
+class SourcePrefixLimiter {
+ public:
+  enum class Result {
+    OK,
+    CONNECTION_LIMIT,
+    RATE_LIMIT
+  };
+
+  void Configure(size_t max_connections, double rate, double burst);
+
+  // Decides whether an Initial packet from prefix, received at now
+  // (in nanoseconds), may start a new connection.
+  Result AcceptInitial(const SourcePrefix& prefix, uint64_t now);
+
+  void AddConnection(const SourcePrefix& prefix);
+  void RemoveConnection(const SourcePrefix& prefix);
+
+  size_t GetConnectionCount(const SourcePrefix& prefix) const;
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    size_t connections = 0;
+    double tokens = 0;
+    uint64_t updated_at = 0;
+  };
+
+  void Refill(Entry* entry, uint64_t now);
+  void Prune(uint64_t now);
+
+  std::unordered_map<SourcePrefix, Entry, SourcePrefix::Hash> entries_;
+  size_t max_connections_ = 0;
+  double rate_ = 0;
+  double burst_ = 0;
+  size_t prune_at_ = MIN_SOURCE_PREFIX_PRUNE;
+};
+
 }  // namespace quic
 }  // namespace node
 
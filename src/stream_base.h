@@ -224,6 +224,12 @@ class StreamResource {
   // Returns true if the stream supports the `OnStreamWantsWrite()` interface.
   virtual bool HasWantsWrite() const { return false; }
 
+  // Set by a StreamPipe while this stream is its sink. Streams that only
+  // emit `OnStreamWantsWrite()` for the benefit of a StreamPipe check this
+  // first, so that other writes do not pay for it.
+  bool is_pipe_sink() const { return is_pipe_sink_; }
+  void set_pipe_sink(bool value) { is_pipe_sink_ = value; }
+
   // Optionally, this may provide an error message to be used for
   // failing writes.
   virtual const char* Error() const;
@@ -253,6 +259,7 @@ class StreamResource {
   StreamListener* listener_ = nullptr;
   uint64_t bytes_read_ = 0;
   uint64_t bytes_written_ = 0;
+  bool is_pipe_sink_ = false;
 
   friend class StreamListener;
 };
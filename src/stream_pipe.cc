@@ -9,6 +9,7 @@ using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::Local;
 using v8::Object;
+using v8::Uint32;
 using v8::Value;
 
 namespace node {
@@ -26,6 +27,7 @@ StreamPipe::StreamPipe(StreamBase* source,
   sink->PushStreamListener(&writable_listener_);
 
   CHECK(sink->HasWantsWrite());
+  sink->set_pipe_sink(true);
 
   // Set up links between this object and the source/sink objects.
   // In particular, this makes sure that they are garbage collected as a group,
@@ -65,7 +67,10 @@ void StreamPipe::Unpipe() {
 
   is_closed_ = true;
   is_reading_ = false;
-  source()->RemoveStreamListener(&readable_listener_);
+  sink()->set_pipe_sink(false);
+  // A source destroyed after its EOF has already removed the listener.
+  if (source() != nullptr)
+    source()->RemoveStreamListener(&readable_listener_);
   sink()->RemoveStreamListener(&writable_listener_);
 
   // Delay the JS-facing part with SetImmediate, because this might be from
@@ -129,7 +134,7 @@ void StreamPipe::ReadableListener::OnStreamRead(ssize_t nread,
     previous_listener_->OnStreamRead(nread, uv_buf_init(nullptr, 0));
     // If we’re not writing, close now. Otherwise, we’ll do that in
     // `OnStreamAfterWrite()`.
-    if (!pipe->is_writing_) {
+    if (pipe->pending_writes_ == 0) {
       pipe->ShutdownWritable();
       pipe->Unpipe();
     }
@@ -141,11 +146,11 @@ void StreamPipe::ReadableListener::OnStreamRead(ssize_t nread,
 
 void StreamPipe::ProcessData(size_t nread, AllocatedBuffer&& buf) {
   uv_buf_t buffer = uv_buf_init(buf.data(), nread);
+  pending_writes_++;
   StreamWriteResult res = sink()->Write(&buffer, 1);
   if (!res.async) {
     writable_listener_.OnStreamAfterWrite(nullptr, res.err);
   } else {
-    is_writing_ = true;
     is_reading_ = false;
     res.wrap->SetAllocatedStorage(std::move(buf));
     if (source() != nullptr)
@@ -160,8 +165,10 @@ void StreamPipe::ShutdownWritable() {
 void StreamPipe::WritableListener::OnStreamAfterWrite(WriteWrap* w,
                                                       int status) {
   StreamPipe* pipe = ContainerOf(&StreamPipe::writable_listener_, this);
-  pipe->is_writing_ = false;
+  pipe->pending_writes_--;
   if (pipe->is_eof_) {
+    if (pipe->pending_writes_ > 0)
+      return;
     AsyncScope async_scope(pipe);
     pipe->ShutdownWritable();
     pipe->Unpipe();
@@ -204,7 +211,7 @@ void StreamPipe::WritableListener::OnStreamDestroy() {
 void StreamPipe::WritableListener::OnStreamWantsWrite(size_t suggested_size) {
   StreamPipe* pipe = ContainerOf(&StreamPipe::writable_listener_, this);
   pipe->wanted_data_ = suggested_size;
-  if (pipe->is_reading_ || pipe->is_closed_)
+  if (pipe->is_reading_ || pipe->is_closed_ || pipe->is_eof_)
     return;
   AsyncScope async_scope(pipe);
   pipe->is_reading_ = true;
@@ -236,6 +243,11 @@ void StreamPipe::Start(const FunctionCallbackInfo<Value>& args) {
   StreamPipe* pipe;
   ASSIGN_OR_RETURN_UNWRAP(&pipe, args.Holder());
   pipe->is_closed_ = false;
+  // A sink that can accept data right away, but that only emits
+  // OnStreamWantsWrite() once a write has completed, passes the amount of
+  // data it wants for the first read.
+  if (pipe->wanted_data_ == 0 && args[0]->IsUint32())
+    pipe->wanted_data_ = args[0].As<Uint32>()->Value();
   if (pipe->wanted_data_ > 0)
     pipe->writable_listener_.OnStreamWantsWrite(pipe->wanted_data_);
 }
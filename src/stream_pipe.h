@@ -29,18 +29,20 @@ class StreamPipe : public AsyncWrap {
   inline void ShutdownWritable();
 
   bool is_reading_ = false;
-  bool is_writing_ = false;
   bool is_eof_ = false;
   bool is_closed_ = true;
   bool sink_destroyed_ = false;
   bool source_destroyed_ = false;
 
   // Set a default value so that when we’re coming from Start(), we know
-  // that we don’t want to read just yet.
-  // This will likely need to be changed when supporting streams without
-  // `OnStreamWantsWrite()` support.
+  // that we don’t want to read just yet, unless Start() is passed the
+  // amount of data the sink wants first.
   size_t wanted_data_ = 0;
 
+  // Sinks like QuicStream ask for more data before earlier writes have
+  // completed, so several writes may be pending at once.
+  size_t pending_writes_ = 0;
+
   void ProcessData(size_t nread, AllocatedBuffer&& buf);
 
   class ReadableListener : public StreamListener {
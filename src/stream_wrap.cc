@@ -50,6 +50,9 @@ using v8::ReadOnly;
 using v8::Signature;
 using v8::Value;
 
+// The amount of data a StreamPipe is asked for once the write queue drains.
+static constexpr size_t kWantsWriteSize = 64 * 1024;
+
 
 void LibuvStreamWrap::Initialize(Local<Object> target,
                                  Local<Value> unused,
@@ -396,9 +399,16 @@ void LibuvStreamWrap::AfterUvWrite(uv_write_t* req, int status) {
   LibuvWriteWrap* req_wrap = static_cast<LibuvWriteWrap*>(
       LibuvWriteWrap::from_req(req));
   CHECK_NOT_NULL(req_wrap);
+  LibuvStreamWrap* wrap = static_cast<LibuvStreamWrap*>(req_wrap->stream());
   HandleScope scope(req_wrap->env()->isolate());
   Context::Scope context_scope(req_wrap->env()->context());
   req_wrap->Done(status);
+  if (status == 0 &&
+      wrap->is_pipe_sink() &&
+      wrap->IsAlive() &&
+      wrap->stream()->write_queue_size == 0) {
+    wrap->EmitWantsWrite(kWantsWriteSize);
+  }
 }
 
 }  // namespace node
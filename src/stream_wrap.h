@@ -56,6 +56,9 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
               uv_buf_t* bufs,
               size_t count,
               uv_stream_t* send_handle) override;
+  // While the stream is the sink of a StreamPipe, OnStreamWantsWrite() is
+  // emitted whenever the write queue drains.
+  bool HasWantsWrite() const override { return true; }
 
   inline uv_stream_t* stream() const {
     return stream_;
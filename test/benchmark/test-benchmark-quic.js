@@ -0,0 +1,36 @@
+'use strict';
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const runBenchmark = require('../common/benchmark');
+
+runBenchmark('quic',
+             [
+               'api=chunks',
+               'asyncSigning=false',
+               'chunk=1024',
+               'compat=true',
+               'concurrency=1',
+               'drain=true',
+               'halfOpen=false',
+               'length=1024',
+               'lite=true',
+               'method=proxy',
+               'metric=time',
+               'mode=fd',
+               'n=1',
+               'pool=true',
+               'resume=false',
+               'rtt=0',
+               'sessions=1',
+               'size=1',
+               'storm=1',
+               'streams=1',
+               'transport=loopback'
+             ],
+             {
+               NODEJS_BENCHMARK_ZERO_ALLOWED: 1,
+               duration: 0
+             });
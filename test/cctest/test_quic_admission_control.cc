@@ -0,0 +1,69 @@
+#include "node_quic_util.h"
+#include "env-inl.h"
+#include "util-inl.h"
+
+#include "gtest/gtest.h"
+
+using node::quic::AdmissionControl;
+
+namespace {
+
+constexpr uint64_t kMs = 1000000;
+
+}  // namespace
+
+TEST(AdmissionControl, Disabled) {
+  AdmissionControl admission;
+  EXPECT_FALSE(admission.IsEnabled());
+  admission.Configure(0, 0);
+  EXPECT_FALSE(admission.IsEnabled());
+  admission.RecordLoopDelay(1000 * kMs);
+  EXPECT_FALSE(admission.IsOverloaded(1000));
+
+  admission.Configure(0, 10);
+  EXPECT_TRUE(admission.IsEnabled());
+  admission.Configure(50 * kMs, 0);
+  EXPECT_TRUE(admission.IsEnabled());
+}
+
+TEST(AdmissionControl, SessionsWithHysteresis) {
+  AdmissionControl admission;
+  admission.Configure(0, 100);
+  EXPECT_FALSE(admission.IsOverloaded(99));
+  EXPECT_TRUE(admission.IsOverloaded(100));
+  // Remains overloaded until below three quarters of the threshold.
+  EXPECT_TRUE(admission.IsOverloaded(80));
+  EXPECT_TRUE(admission.IsOverloaded(75));
+  EXPECT_FALSE(admission.IsOverloaded(74));
+  EXPECT_FALSE(admission.IsOverloaded(99));
+}
+
+TEST(AdmissionControl, LoopDelayIsSmoothed) {
+  AdmissionControl admission;
+  admission.Configure(40 * kMs, 0);
+  // A single slow turn of the event loop is not enough.
+  admission.RecordLoopDelay(100 * kMs);
+  EXPECT_EQ(admission.loop_delay(), 25 * kMs);
+  EXPECT_FALSE(admission.IsOverloaded(0));
+
+  // A sustained delay is.
+  admission.RecordLoopDelay(100 * kMs);
+  admission.RecordLoopDelay(100 * kMs);
+  EXPECT_GE(admission.loop_delay(), 40 * kMs);
+  EXPECT_TRUE(admission.IsOverloaded(0));
+
+  // Recovering requires the delay to fall below 30ms.
+  while (admission.loop_delay() >= 30 * kMs) {
+    EXPECT_TRUE(admission.IsOverloaded(0));
+    admission.RecordLoopDelay(0);
+  }
+  EXPECT_FALSE(admission.IsOverloaded(0));
+}
+
+TEST(AdmissionControl, ConfigureResetsState) {
+  AdmissionControl admission;
+  admission.Configure(0, 1);
+  EXPECT_TRUE(admission.IsOverloaded(1));
+  admission.Configure(0, 10);
+  EXPECT_FALSE(admission.IsOverloaded(1));
+}
@@ -0,0 +1,85 @@
+#include "node_quic_util.h"
+#include "async_wrap-inl.h"
+#include "env-inl.h"
+#include "node_test_fixture.h"
+#include "util-inl.h"
+#include "v8.h"
+
+#include "gtest/gtest.h"
+
+using node::AsyncWrap;
+using node::DebugCategory;
+
+namespace {
+
+class TestQuicWrap : public AsyncWrap {
+ public:
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(TestQuicWrap)
+  SET_SELF_SIZE(TestQuicWrap)
+
+  TestQuicWrap(node::Environment* env, v8::Local<v8::Object> object)
+      : AsyncWrap(env, object, AsyncWrap::PROVIDER_QUICSOCKET) {}
+};
+
+int evaluated = 0;
+
+// Stands in for arguments like cid.ToHex().c_str() that are costly to
+// compute and should only be computed when they are going to be printed.
+const char* Evaluate() {
+  evaluated++;
+  return "evaluated";
+}
+
+// Defined at the end of this file, where NODE_QUIC_DEBUG is 0.
+void DebugWithQuicDebugDisabled(AsyncWrap* wrap);
+
+}  // namespace
+
+class QuicDebugTest : public EnvironmentTestFixture {};
+
+TEST_F(QuicDebugTest, ArgumentsEvaluatedOnlyWhenEnabled) {
+  const v8::HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env{handle_scope, argv};
+
+  v8::Local<v8::ObjectTemplate> obj_templ = v8::ObjectTemplate::New(isolate_);
+  obj_templ->SetInternalFieldCount(1);
+  v8::Local<v8::Object> object =
+      obj_templ->NewInstance(env.context()).ToLocalChecked();
+  TestQuicWrap wrap(*env, object);
+
+  evaluated = 0;
+  (*env)->set_debug_enabled(DebugCategory::QUICSOCKET, false);
+  QUIC_DEBUG(&wrap, "%s", Evaluate());
+  EXPECT_EQ(evaluated, 0);
+
+  // Output for other categories does not matter.
+  (*env)->set_debug_enabled(DebugCategory::QUICSTREAM, true);
+  QUIC_DEBUG(&wrap, "%s", Evaluate());
+  EXPECT_EQ(evaluated, 0);
+
+  (*env)->set_debug_enabled(DebugCategory::QUICSOCKET, true);
+  QUIC_DEBUG(&wrap, "%s", Evaluate());
+  EXPECT_EQ(evaluated, 1);
+
+  // When built with NODE_QUIC_DEBUG set to 0, the arguments are never
+  // evaluated, even if the category is enabled.
+  DebugWithQuicDebugDisabled(&wrap);
+  EXPECT_EQ(evaluated, 1);
+
+  (*env)->set_debug_enabled(DebugCategory::QUICSOCKET, false);
+  (*env)->set_debug_enabled(DebugCategory::QUICSTREAM, false);
+  wrap.persistent().Reset();  // ~BaseObject() expects an empty handle.
+}
+
+#undef NODE_QUIC_DEBUG
+#define NODE_QUIC_DEBUG 0
+
+namespace {
+
+void DebugWithQuicDebugDisabled(AsyncWrap* wrap) {
+  QUIC_DEBUG(wrap, "%s", Evaluate());
+}
+
+}  // namespace
@@ -0,0 +1,158 @@
+#include "node_quic_util.h"
+#include "env-inl.h"
+#include "util-inl.h"
+
+#include "gtest/gtest.h"
+#include <vector>
+
+using node::quic::LinkProfile;
+using node::quic::NetworkEmulator;
+
+namespace {
+
+constexpr uint64_t kMs = 1000000;
+
+std::vector<bool> LossPattern(
+    const LinkProfile& profile,
+    uint32_t seed,
+    size_t count) {
+  NetworkEmulator emulator;
+  emulator.Configure(profile, seed, 0);
+  std::vector<bool> pattern;
+  for (size_t n = 0; n < count; n++)
+    pattern.push_back(emulator.Next(n * kMs, 1200).drop);
+  return pattern;
+}
+
+}  // namespace
+
+TEST(NetworkEmulator, Disabled) {
+  NetworkEmulator emulator;
+  CHECK_EQ(emulator.IsEnabled(), false);
+  emulator.Configure(LinkProfile(), 1, 0);
+  CHECK_EQ(emulator.IsEnabled(), false);
+
+  LinkProfile profile;
+  profile.loss = 0.1;
+  emulator.Configure(profile, 1, 0);
+  CHECK_EQ(emulator.IsEnabled(), true);
+}
+
+TEST(NetworkEmulator, Deterministic) {
+  LinkProfile profile;
+  profile.loss = 0.2;
+  CHECK(LossPattern(profile, 1, 1000) == LossPattern(profile, 1, 1000));
+  CHECK(LossPattern(profile, 1, 1000) != LossPattern(profile, 2, 1000));
+
+  // The pattern does not depend on when packets arrive.
+  NetworkEmulator a;
+  NetworkEmulator b;
+  a.Configure(profile, 1, 0);
+  b.Configure(profile, 1, 0);
+  for (size_t n = 0; n < 1000; n++)
+    CHECK_EQ(a.Next(n, 1200).drop, b.Next(n * 7 * kMs, 100).drop);
+}
+
+TEST(NetworkEmulator, RandomLoss) {
+  LinkProfile profile;
+  profile.loss = 0.1;
+  size_t lost = 0;
+  for (bool drop : LossPattern(profile, 1, 10000))
+    lost += drop;
+  CHECK_GT(lost, 800);
+  CHECK_LT(lost, 1200);
+}
+
+TEST(NetworkEmulator, BurstLoss) {
+  LinkProfile profile;
+  profile.burst_enter = 0.01;
+  profile.burst_exit = 0.25;
+  profile.burst_loss = 1.0;
+  std::vector<bool> pattern = LossPattern(profile, 1, 10000);
+
+  // Every loss happens in a burst, and bursts average four packets.
+  size_t lost = 0;
+  size_t bursts = 0;
+  for (size_t n = 0; n < pattern.size(); n++) {
+    lost += pattern[n];
+    if (pattern[n] && (n == 0 || !pattern[n - 1]))
+      bursts++;
+  }
+  CHECK_GT(bursts, 0);
+  CHECK_GT(lost / bursts, 2);
+  CHECK_LT(lost / bursts, 7);
+}
+
+TEST(NetworkEmulator, Delay) {
+  LinkProfile profile;
+  profile.delay = 50 * kMs;
+  profile.jitter = 10 * kMs;
+  NetworkEmulator emulator;
+  emulator.Configure(profile, 1, 0);
+
+  uint64_t last = 0;
+  for (uint64_t n = 0; n < 1000; n++) {
+    uint64_t now = n * kMs / 10;
+    NetworkEmulator::Schedule schedule = emulator.Next(now, 1200);
+    CHECK_EQ(schedule.drop, false);
+    CHECK_GE(schedule.deliver_at, now + 40 * kMs);
+    // Jitter never reorders packets.
+    CHECK_GE(schedule.deliver_at, last);
+    last = schedule.deliver_at;
+  }
+}
+
+TEST(NetworkEmulator, Reorder) {
+  LinkProfile profile;
+  profile.delay = 50 * kMs;
+  profile.reorder = 0.5;
+  NetworkEmulator emulator;
+  emulator.Configure(profile, 1, 0);
+
+  size_t reordered = 0;
+  for (uint64_t n = 0; n < 100; n++) {
+    NetworkEmulator::Schedule schedule = emulator.Next(n * kMs, 1200);
+    if (schedule.deliver_at == n * kMs)
+      reordered++;
+    else
+      CHECK_EQ(schedule.deliver_at, n * kMs + 50 * kMs);
+  }
+  CHECK_GT(reordered, 0);
+  CHECK_LT(reordered, 100);
+}
+
+TEST(NetworkEmulator, Rate) {
+  LinkProfile profile;
+  profile.rate = 1000000;  // 1 byte per microsecond
+  profile.queue_limit = 10000;
+  NetworkEmulator emulator;
+  emulator.Configure(profile, 1, 0);
+
+  // A burst of packets is serialized at the link rate until the queue
+  // is full, after which packets are tail dropped.
+  size_t delivered = 0;
+  uint64_t last = 0;
+  for (size_t n = 0; n < 20; n++) {
+    NetworkEmulator::Schedule schedule = emulator.Next(0, 1000);
+    if (schedule.drop)
+      continue;
+    delivered++;
+    CHECK_EQ(schedule.deliver_at, last + 1000 * 1000);
+    last = schedule.deliver_at;
+  }
+  CHECK_EQ(delivered, 10);
+
+  // Once the queue has drained, packets are accepted again.
+  CHECK_EQ(emulator.Next(last, 1000).drop, false);
+}
+
+TEST(NetworkEmulator, Duplicate) {
+  LinkProfile profile;
+  profile.duplicate = 1.0;
+  NetworkEmulator emulator;
+  emulator.Configure(profile, 1, 0);
+  NetworkEmulator::Schedule schedule = emulator.Next(0, 1200);
+  CHECK_EQ(schedule.drop, false);
+  CHECK_EQ(schedule.duplicate, true);
+  CHECK_EQ(schedule.deliver_at, 0);
+}
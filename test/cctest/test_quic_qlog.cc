@@ -0,0 +1,232 @@
+#include "node_quic_qlog.h"
+#include "util-inl.h"
+
+#include "gtest/gtest.h"
+#include "uv.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using node::quic::QlogTrace;
+using node::quic::QlogWriter;
+
+namespace {
+
+constexpr uint64_t kMs = 1000000;
+
+// Splits the JSON-SEQ output into its records, checking the framing.
+std::vector<std::string> Records(const std::string& output) {
+  std::vector<std::string> records;
+  size_t pos = 0;
+  while (pos < output.length()) {
+    CHECK_EQ(output[pos], '\x1e');
+    size_t end = output.find('\n', pos);
+    CHECK_NE(end, std::string::npos);
+    records.push_back(output.substr(pos + 1, end - pos - 1));
+    pos = end + 1;
+  }
+  return records;
+}
+
+// Returns the event records only, skipping the header.
+std::vector<std::string> Events(QlogTrace* trace) {
+  std::vector<std::string> records = Records(trace->Drain());
+  if (!records.empty() && records[0].find("qlog_version") != std::string::npos)
+    records.erase(records.begin());
+  return records;
+}
+
+ngtcp2_cid TestCID() {
+  ngtcp2_cid cid;
+  cid.datalen = 4;
+  cid.data[0] = 0x0a;
+  cid.data[1] = 0x0b;
+  cid.data[2] = 0x0c;
+  cid.data[3] = 0x0d;
+  return cid;
+}
+
+}  // namespace
+
+TEST(QlogTrace, Header) {
+  ngtcp2_cid cid = TestCID();
+  QlogTrace trace(true, &cid, 0);
+  std::vector<std::string> records = Records(trace.Drain());
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].find(
+      "{\"qlog_version\":\"0.3\",\"qlog_format\":\"JSON-SEQ\","), 0u);
+  EXPECT_NE(records[0].find("\"type\":\"server\""), std::string::npos);
+  EXPECT_NE(records[0].find("\"ODCID\":\"0a0b0c0d\""), std::string::npos);
+  EXPECT_NE(records[0].find("\"time_format\":\"relative\""), std::string::npos);
+
+  QlogTrace client(false, &cid, 0);
+  EXPECT_NE(client.Drain().find("\"type\":\"client\""), std::string::npos);
+}
+
+TEST(QlogTrace, ReceivedPacket) {
+  ngtcp2_cid cid = TestCID();
+  QlogTrace trace(true, &cid, 0);
+  trace.OnNgtcp2Log(1500000,
+      "I00000001 0x0a0b pkt rx pkn=0 dcid=0x0a0b scid=0x0c0d "
+      "type=Initial(0x00) len=1182 k=0");
+  trace.OnNgtcp2Log(1600000,
+      "I00000001 0x0a0b frm rx 0 Initial(0x00) CRYPTO(0x06) "
+      "offset=0 len=300");
+  trace.OnNgtcp2Log(1700000,
+      "I00000001 0x0a0b frm rx 0 Initial(0x00) PADDING(0x00) len=850");
+
+  std::vector<std::string> events = Events(&trace);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0],
+      "{\"time\":1.500,\"name\":\"transport:packet_received\",\"data\":{"
+      "\"header\":{\"packet_type\":\"initial\",\"packet_number\":0,"
+      "\"dcid\":\"0a0b\",\"scid\":\"0c0d\",\"payload_length\":1182,"
+      "\"key_phase\":0},"
+      "\"frames\":[{\"frame_type\":\"crypto\",\"offset\":0,\"length\":300},"
+      "{\"frame_type\":\"padding\",\"length\":850}]}}");
+}
+
+TEST(QlogTrace, SentPacket) {
+  ngtcp2_cid cid = TestCID();
+  QlogTrace trace(false, &cid, 0);
+  // ngtcp2 logs the frames of a sent packet before its header.
+  trace.OnNgtcp2Log(2 * kMs,
+      "I00000002 0x0a0b frm tx 3 Short(0x40) ACK(0x02) largest_ack=7 "
+      "ack_delay=1(125) ack_block_count=1");
+  trace.OnNgtcp2Log(2 * kMs,
+      "I00000002 0x0a0b frm tx 3 Short(0x40) ACK(0x02) block=[7..5] "
+      "block_count=2");
+  trace.OnNgtcp2Log(2 * kMs,
+      "I00000002 0x0a0b frm tx 3 Short(0x40) ACK(0x02) block=[3..1] "
+      "gap=0 block_count=2");
+  trace.OnNgtcp2Log(2 * kMs,
+      "I00000002 0x0a0b frm tx 3 Short(0x40) STREAM(0x0f) id=0x4 fin=1 "
+      "offset=10 len=100 uni=0");
+  trace.OnNgtcp2Log(2 * kMs,
+      "I00000002 0x0a0b pkt tx pkn=3 dcid=0x0c0d scid=0x type=Short(0x40) "
+      "len=0 k=1");
+  // A line for a different packet completes the previous one.
+  trace.OnNgtcp2Log(3 * kMs,
+      "I00000003 0x0a0b frm tx 4 Short(0x40) PING(0x01)");
+
+  std::vector<std::string> events = Events(&trace);
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0],
+      "{\"time\":2.000,\"name\":\"transport:packet_sent\",\"data\":{"
+      "\"header\":{\"packet_type\":\"1RTT\",\"packet_number\":3,"
+      "\"dcid\":\"0c0d\",\"scid\":\"\",\"key_phase\":1},"
+      "\"frames\":[{\"frame_type\":\"ack\",\"largest_ack\":7,"
+      "\"ack_delay\":1,\"ack_block_count\":1,"
+      "\"acked_ranges\":[[5,7],[1,3]]},"
+      "{\"frame_type\":\"stream\",\"stream_id\":4,\"fin\":true,"
+      "\"offset\":10,\"length\":100,\"uni\":0}]}}");
+  EXPECT_EQ(events[1],
+      "{\"time\":3.000,\"name\":\"transport:packet_sent\",\"data\":{"
+      "\"header\":{\"packet_type\":\"1RTT\",\"packet_number\":4},"
+      "\"frames\":[{\"frame_type\":\"ping\"}]}}");
+}
+
+TEST(QlogTrace, Recovery) {
+  ngtcp2_cid cid = TestCID();
+  QlogTrace trace(true, &cid, 0);
+  trace.OnNgtcp2Log(kMs,
+      "I00000001 0x0a0b rcv pkn=12 lost type=Short(0x40) sent_ts=100");
+  trace.OnNgtcp2Log(kMs,
+      "I00000001 0x0a0b rcv reduce cwnd because of packet loss cwnd=6000");
+  // Unchanged congestion windows are not repeated.
+  trace.OnNgtcp2Log(kMs,
+      "I00000001 0x0a0b rcv pkn=13 acked, slow start cwnd=6000");
+
+  ngtcp2_rcvry_stat stat{};
+  stat.latest_rtt = 20 * kMs;
+  stat.min_rtt = 10 * kMs;
+  stat.smoothed_rtt = 15 * kMs;
+  stat.rttvar = 5 * kMs;
+  trace.MetricsUpdated(2 * kMs, &stat, 1200);
+  // Only new RTT samples are recorded.
+  trace.MetricsUpdated(3 * kMs, &stat, 2400);
+
+  std::vector<std::string> events = Events(&trace);
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(events[0],
+      "{\"time\":1.000,\"name\":\"recovery:packet_lost\",\"data\":{"
+      "\"header\":{\"packet_type\":\"1RTT\",\"packet_number\":12}}}");
+  EXPECT_EQ(events[1],
+      "{\"time\":1.000,\"name\":\"recovery:metrics_updated\",\"data\":{"
+      "\"congestion_window\":6000}}");
+  EXPECT_EQ(events[2],
+      "{\"time\":2.000,\"name\":\"recovery:metrics_updated\",\"data\":{"
+      "\"min_rtt\":10.000,\"smoothed_rtt\":15.000,\"latest_rtt\":20.000,"
+      "\"rtt_variance\":5.000,\"bytes_in_flight\":1200}}");
+}
+
+TEST(QlogTrace, KeyUpdateAndInfo) {
+  ngtcp2_cid cid = TestCID();
+  QlogTrace trace(true, &cid, kMs);
+  trace.OnNgtcp2Log(2 * kMs,
+      "I00000001 0x0a0b pkt rx pkn=1 dcid=0x0a0b scid=0x type=Short(0x40) "
+      "len=0 k=1");
+  trace.KeyUpdated(3 * kMs, false);
+  trace.OnNgtcp2Log(4 * kMs,
+      "I00000003 0x0a0b con path \"a\\b\"\tvalidated");
+
+  std::vector<std::string> events = Events(&trace);
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_NE(events[0].find("transport:packet_received"), std::string::npos);
+  EXPECT_EQ(events[1],
+      "{\"time\":2.000,\"name\":\"security:key_updated\",\"data\":{"
+      "\"key_type\":\"1rtt\",\"trigger\":\"remote_update\"}}");
+  EXPECT_EQ(events[2],
+      "{\"time\":3.000,\"name\":\"generic:info\",\"data\":{"
+      "\"message\":\"con path \\\"a\\\\b\\\"\\tvalidated\"}}");
+}
+
+TEST(QlogWriter, WritesInBackground) {
+  uv_loop_t loop;
+  ASSERT_EQ(uv_loop_init(&loop), 0);
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/qlog-writer-%d.sqlog",
+           getenv("TMPDIR") != nullptr ? getenv("TMPDIR") : "/tmp",
+           uv_os_getpid());
+
+  QlogWriter* writer = QlogWriter::Open(&loop, path);
+  ASSERT_NE(writer, nullptr);
+  {
+    ngtcp2_cid cid = TestCID();
+    QlogTrace trace(true, &cid, 0, writer);
+    trace.Info(kMs, "first");
+    trace.Info(2 * kMs, "second");
+    // Nothing is written until the loop runs.
+  }
+  // The QlogWriter frees itself once the file has been closed.
+  ASSERT_EQ(uv_run(&loop, UV_RUN_DEFAULT), 0);
+  ASSERT_EQ(uv_loop_close(&loop), 0);
+
+  std::string content;
+  FILE* file = fopen(path, "rb");
+  ASSERT_NE(file, nullptr);
+  char buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+    content.append(buf, len);
+  fclose(file);
+  remove(path);
+
+  std::vector<std::string> records = Records(content);
+  ASSERT_EQ(records.size(), 3u);
+  EXPECT_NE(records[0].find("qlog_version"), std::string::npos);
+  EXPECT_NE(records[1].find("\"message\":\"first\""), std::string::npos);
+  EXPECT_NE(records[2].find("\"message\":\"second\""), std::string::npos);
+}
+
+TEST(QlogWriter, OpenFailure) {
+  uv_loop_t loop;
+  ASSERT_EQ(uv_loop_init(&loop), 0);
+  QlogWriter* writer =
+      QlogWriter::Open(&loop, "/nonexistent-qlog-directory/trace.sqlog");
+  ASSERT_NE(writer, nullptr);
+  writer->Write(std::string("data"));
+  writer->Close();
+  ASSERT_EQ(uv_run(&loop, UV_RUN_DEFAULT), 0);
+  ASSERT_EQ(uv_loop_close(&loop), 0);
+}
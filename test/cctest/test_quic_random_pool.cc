@@ -0,0 +1,120 @@
+#include "node_quic_crypto.h"
+#include "env-inl.h"
+#include "util-inl.h"
+
+#include "gtest/gtest.h"
+#include <vector>
+
+using node::quic::RandomPool;
+using node::quic::kRandomPoolMaxAge;
+using node::quic::kRandomPoolSize;
+
+namespace {
+
+// A deterministic source whose output depends on the call and the
+// offset, so that the bytes handed out by the pool show where they
+// were taken from.
+std::vector<size_t> source_calls;
+
+uint8_t SourceByte(size_t call, size_t offset) {
+  return static_cast<uint8_t>(offset + 64 * call);
+}
+
+bool CountingSource(unsigned char* buffer, size_t length) {
+  for (size_t n = 0; n < length; n++)
+    buffer[n] = SourceByte(source_calls.size(), n);
+  source_calls.push_back(length);
+  return true;
+}
+
+void ResetSource() {
+  source_calls.clear();
+}
+
+}  // namespace
+
+TEST(RandomPool, HandsOutBytesOnce) {
+  ResetSource();
+  RandomPool pool(CountingSource);
+  uint8_t a[16];
+  uint8_t b[16];
+  pool.Fill(a, sizeof(a), 0);
+  pool.Fill(b, sizeof(b), 0);
+  EXPECT_EQ(source_calls, std::vector<size_t>({ kRandomPoolSize }));
+  for (size_t n = 0; n < sizeof(a); n++) {
+    EXPECT_EQ(a[n], SourceByte(0, n));
+    EXPECT_EQ(b[n], SourceByte(0, n + sizeof(a)));
+  }
+}
+
+TEST(RandomPool, RefillAtPoolBoundary) {
+  ResetSource();
+  RandomPool pool(CountingSource);
+  uint8_t buf[kRandomPoolSize / 4];
+
+  // Four quarter sized requests use up the pool exactly.
+  for (int n = 0; n < 4; n++)
+    pool.Fill(buf, sizeof(buf), 0);
+  EXPECT_EQ(source_calls.size(), 1u);
+
+  // The next request is served from a new pool.
+  pool.Fill(buf, 1, 0);
+  EXPECT_EQ(source_calls.size(), 2u);
+  EXPECT_EQ(buf[0], SourceByte(1, 0));
+}
+
+TEST(RandomPool, RefillWhenRequestDoesNotFit) {
+  ResetSource();
+  RandomPool pool(CountingSource);
+  uint8_t buf[kRandomPoolSize / 4];
+
+  // Leave fewer bytes in the pool than the next request needs.
+  for (int n = 0; n < 3; n++)
+    pool.Fill(buf, sizeof(buf), 0);
+  pool.Fill(buf, sizeof(buf) - 8, 0);
+  EXPECT_EQ(source_calls.size(), 1u);
+
+  // The request is not split across the two pools. The 8 bytes that
+  // were left over are discarded and never handed out.
+  pool.Fill(buf, 16, 0);
+  EXPECT_EQ(source_calls.size(), 2u);
+  for (size_t n = 0; n < 16; n++)
+    EXPECT_EQ(buf[n], SourceByte(1, n));
+}
+
+TEST(RandomPool, LargeRequestsBypassPool) {
+  ResetSource();
+  RandomPool pool(CountingSource);
+  uint8_t small[16];
+  pool.Fill(small, sizeof(small), 0);
+
+  // Requests larger than a quarter of the pool, including ones larger
+  // than the pool itself, go straight to the source.
+  std::vector<uint8_t> large(kRandomPoolSize * 2);
+  pool.Fill(large.data(), kRandomPoolSize / 4 + 1, 0);
+  pool.Fill(large.data(), large.size(), 0);
+  EXPECT_EQ(source_calls, std::vector<size_t>({
+    kRandomPoolSize,
+    kRandomPoolSize / 4 + 1,
+    kRandomPoolSize * 2
+  }));
+  EXPECT_EQ(large[0], SourceByte(2, 0));
+  EXPECT_EQ(large[kRandomPoolSize + 1], SourceByte(2, kRandomPoolSize + 1));
+
+  // The pool itself is left untouched by them.
+  pool.Fill(small, sizeof(small), 0);
+  EXPECT_EQ(source_calls.size(), 3u);
+  EXPECT_EQ(small[0], SourceByte(0, 16));
+}
+
+TEST(RandomPool, RefillWhenStale) {
+  ResetSource();
+  RandomPool pool(CountingSource);
+  uint8_t buf[16];
+  pool.Fill(buf, sizeof(buf), 1);
+  pool.Fill(buf, sizeof(buf), 1 + kRandomPoolMaxAge);
+  EXPECT_EQ(source_calls.size(), 1u);
+  pool.Fill(buf, sizeof(buf), 2 + kRandomPoolMaxAge);
+  EXPECT_EQ(source_calls.size(), 2u);
+  EXPECT_EQ(buf[0], SourceByte(1, 0));
+}
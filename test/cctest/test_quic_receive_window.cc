@@ -0,0 +1,65 @@
+#include "node_quic_util.h"
+#include "env-inl.h"
+#include "util-inl.h"
+
+#include "gtest/gtest.h"
+
+using node::quic::ReceiveWindow;
+
+namespace {
+
+constexpr uint64_t kMs = 1000000;
+constexpr uint64_t kRtt = 10 * kMs;
+
+}  // namespace
+
+TEST(ReceiveWindow, ExtendsByConsumedBytes) {
+  ReceiveWindow window;
+  window.Initialize(1000, 4000);
+  EXPECT_EQ(window.Consume(100, kMs, kRtt), 100u);
+  EXPECT_EQ(window.Consume(300, 2 * kMs, kRtt), 300u);
+  EXPECT_EQ(window.size(), 1000u);
+}
+
+TEST(ReceiveWindow, GrowsWhenDrainedQuickly) {
+  ReceiveWindow window;
+  window.Initialize(1000, 4000);
+  EXPECT_EQ(window.Consume(200, kMs, kRtt), 200u);
+  // Half of the window was consumed within two round trips.
+  EXPECT_EQ(window.Consume(300, 5 * kMs, kRtt), 1300u);
+  EXPECT_EQ(window.size(), 2000u);
+
+  // The next epoch starts at the time the window grew.
+  EXPECT_EQ(window.Consume(1000, 10 * kMs, kRtt), 3000u);
+  EXPECT_EQ(window.size(), 4000u);
+
+  // The window does not grow past its maximum.
+  EXPECT_EQ(window.Consume(2000, 11 * kMs, kRtt), 2000u);
+  EXPECT_EQ(window.size(), 4000u);
+}
+
+TEST(ReceiveWindow, GrowthIsCappedAtMaximum) {
+  ReceiveWindow window;
+  window.Initialize(1000, 1500);
+  EXPECT_EQ(window.Consume(500, kMs, kRtt), 1000u);
+  EXPECT_EQ(window.size(), 1500u);
+}
+
+TEST(ReceiveWindow, DoesNotGrowWhenDrainedSlowly) {
+  ReceiveWindow window;
+  window.Initialize(1000, 4000);
+  EXPECT_EQ(window.Consume(100, kMs, kRtt), 100u);
+  EXPECT_EQ(window.Consume(400, kMs + 2 * kRtt, kRtt), 400u);
+  EXPECT_EQ(window.size(), 1000u);
+
+  // Without an RTT sample the window never grows.
+  EXPECT_EQ(window.Consume(500, kMs + 2 * kRtt, 0), 500u);
+  EXPECT_EQ(window.size(), 1000u);
+}
+
+TEST(ReceiveWindow, MaximumBelowInitialSize) {
+  ReceiveWindow window;
+  window.Initialize(1000, 0);
+  EXPECT_EQ(window.Consume(1000, kMs, kRtt), 1000u);
+  EXPECT_EQ(window.size(), 1000u);
+}
@@ -0,0 +1,123 @@
+#include "node_quic_util.h"
+#include "env-inl.h"
+#include "util-inl.h"
+#include "uv.h"
+
+#include "gtest/gtest.h"
+
+using node::quic::SourcePrefix;
+using node::quic::SourcePrefixLimiter;
+
+namespace {
+
+constexpr uint64_t kSecond = 1000000000;
+
+SourcePrefix Prefix(const char* host, int port = 1234) {
+  sockaddr_storage storage;
+  if (uv_ip4_addr(host, port, reinterpret_cast<sockaddr_in*>(&storage)) != 0)
+    CHECK_EQ(uv_ip6_addr(host, port,
+                         reinterpret_cast<sockaddr_in6*>(&storage)), 0);
+  return SourcePrefix::From(reinterpret_cast<sockaddr*>(&storage));
+}
+
+}  // namespace
+
+TEST(SourcePrefix, Aggregation) {
+  // IPv4 addresses are distinguished by the full address, but not by port.
+  EXPECT_EQ(Prefix("10.0.0.1", 1), Prefix("10.0.0.1", 2));
+  EXPECT_FALSE(Prefix("10.0.0.1") == Prefix("10.0.0.2"));
+
+  // IPv6 addresses are aggregated by /64.
+  EXPECT_EQ(Prefix("2001:db8:1:2::1"), Prefix("2001:db8:1:2:ffff::2"));
+  EXPECT_FALSE(Prefix("2001:db8:1:2::1") == Prefix("2001:db8:1:3::1"));
+
+  EXPECT_EQ(SourcePrefix::Hash()(Prefix("10.0.0.1", 1)),
+            SourcePrefix::Hash()(Prefix("10.0.0.1", 2)));
+}
+
+TEST(SourcePrefixLimiter, Disabled) {
+  SourcePrefixLimiter limiter;
+  limiter.Configure(0, 0, 0);
+  for (int n = 0; n < 100; n++) {
+    EXPECT_EQ(limiter.AcceptInitial(Prefix("10.0.0.1"), 0),
+              SourcePrefixLimiter::Result::OK);
+  }
+  EXPECT_EQ(limiter.size(), 0u);
+}
+
+TEST(SourcePrefixLimiter, ConnectionLimit) {
+  SourcePrefixLimiter limiter;
+  limiter.Configure(2, 0, 0);
+  SourcePrefix prefix = Prefix("2001:db8::1");
+  EXPECT_EQ(limiter.AcceptInitial(prefix, 0), SourcePrefixLimiter::Result::OK);
+  limiter.AddConnection(prefix);
+  limiter.AddConnection(Prefix("2001:db8::2"));
+  EXPECT_EQ(limiter.GetConnectionCount(prefix), 2u);
+  EXPECT_EQ(limiter.AcceptInitial(prefix, 0),
+            SourcePrefixLimiter::Result::CONNECTION_LIMIT);
+  EXPECT_EQ(limiter.AcceptInitial(Prefix("2001:db9::1"), 0),
+            SourcePrefixLimiter::Result::OK);
+
+  limiter.RemoveConnection(prefix);
+  EXPECT_EQ(limiter.AcceptInitial(prefix, 0), SourcePrefixLimiter::Result::OK);
+  limiter.RemoveConnection(prefix);
+  EXPECT_EQ(limiter.GetConnectionCount(prefix), 0u);
+
+  // Sessions that were not counted are ignored.
+  limiter.AddConnection(SourcePrefix());
+  EXPECT_EQ(limiter.GetConnectionCount(SourcePrefix()), 0u);
+}
+
+TEST(SourcePrefixLimiter, TokenBucket) {
+  SourcePrefixLimiter limiter;
+  limiter.Configure(0, 10, 3);
+  SourcePrefix prefix = Prefix("10.0.0.1");
+  for (int n = 0; n < 3; n++) {
+    EXPECT_EQ(limiter.AcceptInitial(prefix, kSecond),
+              SourcePrefixLimiter::Result::OK);
+  }
+  EXPECT_EQ(limiter.AcceptInitial(prefix, kSecond),
+            SourcePrefixLimiter::Result::RATE_LIMIT);
+  // Other prefixes have buckets of their own.
+  EXPECT_EQ(limiter.AcceptInitial(Prefix("10.0.0.2"), kSecond),
+            SourcePrefixLimiter::Result::OK);
+
+  // One token is added every 100ms.
+  EXPECT_EQ(limiter.AcceptInitial(prefix, kSecond + kSecond / 20),
+            SourcePrefixLimiter::Result::RATE_LIMIT);
+  EXPECT_EQ(limiter.AcceptInitial(prefix, kSecond + kSecond / 10),
+            SourcePrefixLimiter::Result::OK);
+  EXPECT_EQ(limiter.AcceptInitial(prefix, kSecond + kSecond / 10),
+            SourcePrefixLimiter::Result::RATE_LIMIT);
+
+  // The bucket does not fill beyond the burst.
+  for (int n = 0; n < 3; n++) {
+    EXPECT_EQ(limiter.AcceptInitial(prefix, 100 * kSecond),
+              SourcePrefixLimiter::Result::OK);
+  }
+  EXPECT_EQ(limiter.AcceptInitial(prefix, 100 * kSecond),
+            SourcePrefixLimiter::Result::RATE_LIMIT);
+}
+
+TEST(SourcePrefixLimiter, Prune) {
+  SourcePrefixLimiter limiter;
+  limiter.Configure(1, 1, 1);
+  SourcePrefix connected = Prefix("192.168.0.1");
+  limiter.AddConnection(connected);
+
+  char host[32];
+  for (int n = 0; n < 2000; n++) {
+    snprintf(host, sizeof(host), "10.0.%d.%d", n / 256, n % 256);
+    limiter.AcceptInitial(Prefix(host), 0);
+  }
+  EXPECT_GT(limiter.size(), 1000u);
+
+  // Once their buckets have refilled, idle prefixes are pruned as the
+  // table grows, but prefixes with connections are kept.
+  for (int n = 0; n < 2000; n++) {
+    snprintf(host, sizeof(host), "10.1.%d.%d", n / 256, n % 256);
+    limiter.AcceptInitial(Prefix(host), 10 * kSecond);
+  }
+  EXPECT_LT(limiter.size(), 2100u);
+  EXPECT_EQ(limiter.GetConnectionCount(connected), 1u);
+}
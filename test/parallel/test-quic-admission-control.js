@@ -0,0 +1,95 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that a QuicSocket with admission control refuses new connections
+// while it is overloaded, optionally sending a Retry packet first, and
+// counts the admitted and rejected handshakes.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+
+{
+  const socket = createSocket();
+  ['a', 1.5, -1].forEach((value) => {
+    const code =
+      value === -1 ? 'ERR_OUT_OF_RANGE' : 'ERR_INVALID_ARG_TYPE';
+    assert.throws(
+      () => socket.setAdmissionControl({ maxEventLoopDelay: value }),
+      { code });
+    assert.throws(
+      () => socket.setAdmissionControl({ maxSessions: value }),
+      { code });
+  });
+  [0, 1.5, 2 ** 32].forEach((resolution) => {
+    assert.throws(() => socket.setAdmissionControl({ resolution }), {
+      code: Number.isInteger(resolution) ?
+        'ERR_OUT_OF_RANGE' : 'ERR_INVALID_ARG_TYPE'
+    });
+  });
+  [1, 'a', null].forEach((retry) => {
+    assert.throws(() => socket.setAdmissionControl({ retry }), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+  });
+  // Monitoring the event loop delay does not keep the process alive.
+  socket.setAdmissionControl({ maxEventLoopDelay: 1000 });
+  assert.strictEqual(socket.eventLoopDelay, 0n);
+  socket.setAdmissionControl();
+  socket.destroy();
+}
+
+function test(retry) {
+  const server = createSocket({ port: 0 });
+  server.setAdmissionControl({ maxSessions: 1, retry });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  // The session of the second client is refused with SERVER_BUSY.
+  server.on('session', common.mustCall(2));
+
+  server.on('ready', common.mustCall(() => {
+    const options = {
+      address: 'localhost',
+      key,
+      cert,
+      ca,
+      alpn: kALPN,
+      port: server.address.port,
+      servername: kServerName,
+    };
+    const client = createSocket({ port: 0 });
+    const req = client.connect(options);
+
+    req.on('secure', common.mustCall(() => {
+      const busyClient = createSocket({ port: 0 });
+      const busyReq = busyClient.connect(options);
+      busyReq.on('secure', common.mustNotCall());
+      busyReq.on('close', common.mustCall(() => {
+        assert.strictEqual(server.handshakesAdmitted, 1n);
+        assert.strictEqual(server.handshakesRejected, 1n);
+        assert.strictEqual(server.handshakesRetried, retry ? 1n : 0n);
+        busyClient.close();
+        req.close();
+      }));
+    }));
+
+    req.on('close', common.mustCall(() => {
+      server.close();
+      client.close();
+    }));
+  }));
+}
+
+test(false);
+test(true);
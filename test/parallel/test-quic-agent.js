@@ -0,0 +1,130 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that a QuicAgent opens the streams for an endpoint on a single
+// pooled QuicClientSession, that Alt-Svc values are parsed and tracked,
+// and that connect() uses an advertised QUIC alternative.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { Agent, createSocket } = require('quic');
+const { parseAltSvc } = require('internal/quic/agent');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kStreams = 3;
+
+{
+  const alternatives = parseAltSvc(
+    'h3-22=":8443"; ma=60, h2="alt.example.com:443", ' +
+    'h3-22="[::1]:443"; persist=1, bad, h3-22="nope", h3-22=":0"', 0);
+  assert.deepStrictEqual(alternatives, [
+    { alpn: 'h3-22', host: '', port: 8443, expires: 60000 },
+    { alpn: 'h2', host: 'alt.example.com', port: 443, expires: 86400000 },
+    { alpn: 'h3-22', host: '::1', port: 443, expires: 86400000 },
+  ]);
+  assert.strictEqual(parseAltSvc(' clear '), null);
+}
+
+[undefined, {}, { socket: {} }].forEach((options) => {
+  assert.throws(() => new Agent(options), { code: 'ERR_INVALID_ARG_TYPE' });
+});
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => {
+    stream.resume();
+    stream.on('end', () => stream.end());
+  }, kStreams + 1));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0, client: { key, cert, ca } });
+  const agent = new Agent({ socket: client, alpn: kALPN });
+  assert.strictEqual(agent.socket, client);
+
+  agent.setAltSvc('https://example.com', 'h3-22=":443", zzz=":443"; ma=60');
+  assert.deepStrictEqual(agent.getAltSvc('https://example.com:443/path'), [
+    { alpn: kALPN, host: '', port: 443 },
+  ]);
+  agent.setAltSvc('https://example.com', 'clear');
+  assert.deepStrictEqual(agent.getAltSvc('https://example.com'), []);
+  assert.throws(() => agent.setAltSvc(1, 'clear'), {
+    code: 'ERR_INVALID_ARG_TYPE'
+  });
+
+  const options = {
+    address: 'localhost',
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  };
+
+  let closed = 0;
+  function onStreamClose() {
+    if (++closed < kStreams + 1)
+      return;
+    agent.close(common.mustCall(() => {
+      assert.strictEqual(agent.closed, true);
+      assert.throws(() => agent.openStream(options, common.mustNotCall()), {
+        code: 'ERR_QUICAGENT_CLOSED'
+      });
+      client.close();
+      server.close();
+    }));
+  }
+
+  const sessions = new Set();
+  let opened = 0;
+  for (let n = 0; n < kStreams; n++) {
+    agent.openStream(options, common.mustCall((err, stream) => {
+      assert.ifError(err);
+      sessions.add(stream.session);
+      stream.resume();
+      stream.on('close', common.mustCall(onStreamClose));
+      stream.end('hello');
+      if (++opened < kStreams)
+        return;
+      assert.strictEqual(sessions.size, 1);
+      testConnect();
+    }));
+  }
+
+  // Without a usable alternative, the TCP connection is used.
+  agent.connect(
+    'https://example.com',
+    common.mustCall((callback) => callback(null, 'tcp')),
+    common.mustCall((err, stream, connection) => {
+      assert.ifError(err);
+      assert.strictEqual(stream, undefined);
+      assert.strictEqual(connection, 'tcp');
+    }));
+
+  // The advertised alternative is used, on the pooled session, before the
+  // TCP connection is even attempted.
+  function testConnect() {
+    const origin = `https://${kServerName}`;
+    agent.setAltSvc(origin, `${kALPN}="localhost:${server.address.port}"`);
+    agent.connect(
+      origin,
+      { tcpDelay: common.platformTimeout(60000) },
+      common.mustNotCall(),
+      common.mustCall((err, stream) => {
+        assert.ifError(err);
+        assert(sessions.has(stream.session));
+        stream.resume();
+        stream.on('close', common.mustCall(onStreamClose));
+        stream.end('hello');
+      }));
+  }
+}));
@@ -0,0 +1,76 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that the TLS handshake completes when the server computes the
+// handshake signature on the threadpool, and that the signature was
+// in fact computed there.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+const { debuglog } = require('util');
+const debug = debuglog('test');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+
+let client;
+const server = createSocket({ port: 0 });
+
+server.listen({ key, cert, ca, alpn: kALPN, asyncSigning: true });
+
+server.on('session', common.mustCall((session) => {
+  debug('QuicServerSession Created');
+
+  session.on('secure', common.mustCall(() => {
+    assert.strictEqual(session.asyncSigningCount, 1n);
+  }));
+  session.on('stream', common.mustCall((stream) => {
+    stream.on('data', (chunk) => stream.write(chunk));
+    stream.on('end', () => stream.end());
+  }));
+}));
+
+server.on('ready', common.mustCall(() => {
+  debug('Server is listening on port %d', server.address.port);
+  client = createSocket({
+    port: 0,
+    client: { key, cert, ca, alpn: kALPN }
+  });
+
+  const req = client.connect({
+    address: 'localhost',
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall((servername, alpn) => {
+    debug('QuicClientSession TLS Handshake Complete');
+    assert.strictEqual(servername, kServerName);
+    assert.strictEqual(alpn, kALPN);
+    assert.strictEqual(req.asyncSigningCount, 0n);
+
+    const stream = req.openStream();
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('end', common.mustCall(() => {
+      assert.strictEqual(data, 'hello');
+      server.close();
+      client.close();
+    }));
+    stream.end('hello');
+  }));
+
+  req.on('close', common.mustCall());
+}));
+
+server.on('close', common.mustCall());
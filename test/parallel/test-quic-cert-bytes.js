@@ -0,0 +1,61 @@
+'use strict';
+
+// Tests that the size of the certificate messages is recorded on both
+// sides of the connection.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+const { debuglog } = require('util');
+const debug = debuglog('test');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+
+let client;
+let serverSession;
+const server = createSocket({ port: 0 });
+
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  debug('QuicServerSession Created');
+  serverSession = session;
+}));
+
+server.on('ready', common.mustCall(() => {
+  debug('Server is listening on port %d', server.address.port);
+  client = createSocket({
+    port: 0,
+    client: { key, cert, ca, alpn: kALPN }
+  });
+
+  const req = client.connect({
+    address: 'localhost',
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    debug('QuicClientSession TLS Handshake Complete');
+    const sent = serverSession.certificateBytesSent;
+    assert(sent > 0n);
+    assert.strictEqual(req.certificateBytesReceived, sent);
+    assert.strictEqual(req.certificateBytesSent, 0n);
+    assert.strictEqual(serverSession.certificateBytesReceived, 0n);
+    server.close();
+    client.close();
+  }));
+
+  req.on('close', common.mustCall());
+}));
+
+server.on('close', common.mustCall());
@@ -62,10 +62,12 @@ const kKeylogs = [
 ];
 
 
+// The client is only closed once the server session has closed itself.
+// Otherwise, the server session may receive the CONNECTION_CLOSE of the
+// client first, and its close code would not be the one checked below.
 const countdown = new Countdown(2, () => {
-  debug('Countdown expired. Destroying sockets');
+  debug('Countdown expired. Closing the server');
   server.close();
-  client.close();
 });
 
 server.listen({
@@ -208,6 +210,7 @@ server.on('session', common.mustCall((session) => {
     debug(`Server session closed with code ${code} (family: ${family})`);
     assert.strictEqual(code, NGTCP2_NO_ERROR);
     assert.strictEqual(family, QUIC_ERROR_APPLICATION);
+    client.close();
   }));
 }));
 
@@ -0,0 +1,64 @@
+'use strict';
+
+// Tests that a QuicClientSession closed from its 'secure' listener still
+// completes the handshake and sends a CONNECTION_CLOSE to the server,
+// rather than leaving the QuicServerSession to its idle timeout.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kALPN = 'zzz';
+const kServerName = 'agent1';
+const kClients = 3;
+
+// With an idle timeout this long, the test times out if the server
+// sessions are not closed by the client.
+const server = createSocket({
+  port: 0,
+  server: { key, cert, ca, alpn: kALPN, idleTimeout: 600000 }
+});
+server.listen();
+
+let client;
+let closed = 0;
+server.on('session', common.mustCall((session) => {
+  session.on('secure', common.mustCall());
+  session.on('close', common.mustCall(() => {
+    if (++closed < kClients)
+      return;
+    client.close();
+    server.close();
+  }));
+}, kClients));
+
+server.on('ready', common.mustCall(() => {
+  client = createSocket({
+    port: 0,
+    client: { key, cert, ca, alpn: kALPN }
+  });
+
+  for (let n = 0; n < kClients; n++) {
+    const req = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+      servername: kServerName,
+    });
+    req.on('secure', common.mustCall((servername, alpn) => {
+      assert.strictEqual(servername, kServerName);
+      assert.strictEqual(alpn, kALPN);
+      req.close();
+    }));
+    req.on('close', common.mustCall());
+  }
+}));
+
+server.on('close', common.mustCall());
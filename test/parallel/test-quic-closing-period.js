@@ -0,0 +1,64 @@
+'use strict';
+
+// Tests that a QuicServerSession is destroyed as soon as it enters the
+// closing period, rather than when its idle timeout expires, and that the
+// QuicSocket only keeps the CONNECTION_CLOSE packets of those sessions.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kALPN = 'zzz';
+const kClients = 3;
+
+// Sessions that are refused while the server is busy enter the closing
+// period right away. With an idle timeout this long, the test times out
+// if they are kept until the idle timeout expires.
+const server = createSocket({
+  port: 0,
+  server: { key, cert, ca, alpn: kALPN, idleTimeout: 600000 }
+});
+server.setServerBusy();
+server.listen();
+
+let closed = 0;
+server.on('session', common.mustCall((session) => {
+  session.on('close', common.mustCall(() => {
+    if (++closed < kClients)
+      return;
+    // All that is left of the sessions are their CONNECTION_CLOSE packets.
+    assert(server.memoryUsage > 0n);
+    assert(server.memoryUsage < 2048n * BigInt(kClients));
+    server.close();
+  }));
+}, kClients));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({
+    port: 0,
+    client: { key, cert, ca, alpn: kALPN }
+  });
+
+  let refused = 0;
+  for (let n = 0; n < kClients; n++) {
+    const req = client.connect({
+      address: 'localhost',
+      port: server.address.port,
+    });
+    req.on('secure', common.mustNotCall());
+    req.on('close', common.mustCall(() => {
+      if (++refused === kClients)
+        client.close();
+    }));
+  }
+}));
+
+server.on('close', common.mustCall());
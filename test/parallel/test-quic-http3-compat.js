@@ -0,0 +1,131 @@
+'use strict';
+
+// Tests that HTTP/3 requests are surfaced through the Http3ServerRequest
+// and Http3ServerResponse compatibility objects when the QuicSocket has
+// 'request' listeners.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const {
+  createSocket,
+  Http3ServerRequest,
+  Http3ServerResponse
+} = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'h3-22';
+const kRequestBody = 'hello';
+const kResponseBody = 'world';
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('checkContinue', common.mustCall((req, res) => {
+  assert.strictEqual(req.headers.expect, '100-continue');
+  assert.strictEqual(res.writeContinue(), true);
+  server.emit('request', req, res);
+}));
+
+server.on('request', common.mustCall((req, res) => {
+  assert(req instanceof Http3ServerRequest);
+  assert(res instanceof Http3ServerResponse);
+  assert.strictEqual(req.httpVersion, '3.0');
+  assert.strictEqual(req.method, 'POST');
+  assert.strictEqual(req.scheme, 'https');
+  assert.strictEqual(req.authority, 'localhost');
+  assert.strictEqual(req.headers['x-request'], 'abc');
+  assert.strictEqual(req.stream.session, req.session);
+  assert.strictEqual(res.stream, req.stream);
+
+  assert.throws(() => { res.statusCode = 100; }, {
+    code: 'ERR_HTTP_INVALID_STATUS_CODE'
+  });
+  res.setHeader('X-Response', 'def');
+  assert.strictEqual(res.getHeader('x-response'), 'def');
+  assert.deepStrictEqual(res.getHeaderNames(), ['x-response']);
+  res.setTrailer('x-trailer', 'ghi');
+
+  let data = '';
+  req.setEncoding('utf8');
+  req.on('data', (chunk) => data += chunk);
+  req.on('end', common.mustCall(() => {
+    assert.strictEqual(data, kRequestBody);
+    assert.strictEqual(res.headersSent, false);
+    res.writeHead(201, { 'x-other': 'jkl' });
+    assert.strictEqual(res.headersSent, true);
+    assert.throws(() => res.setHeader('x-late', 'mno'), {
+      code: 'ERR_HTTP_HEADERS_SENT'
+    });
+    res.end(`${kResponseBody} ${req.url}`);
+    assert.strictEqual(res.writableEnded, true);
+  }));
+  res.on('finish', common.mustCall());
+}, 2));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  function request(path, expectContinue, callback) {
+    const stream = req.openStream();
+    const headers = {
+      ':method': 'POST',
+      ':scheme': 'https',
+      ':authority': 'localhost',
+      ':path': path,
+      'x-request': 'abc'
+    };
+    if (expectContinue) {
+      headers.expect = '100-continue';
+      stream.on('informationalHeaders', common.mustCall((headers) => {
+        assert.strictEqual(headers[':status'], 100);
+      }));
+    }
+    stream.submitInitialHeaders(headers);
+    stream.end(kRequestBody);
+
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('initialHeaders', common.mustCall((headers) => {
+      assert.strictEqual(headers[':status'], 201);
+      assert.strictEqual(headers['x-response'], 'def');
+      assert.strictEqual(headers['x-other'], 'jkl');
+      assert.strictEqual(typeof headers.date, 'string');
+    }));
+    stream.on('trailingHeaders', common.mustCall((headers) => {
+      assert.strictEqual(headers['x-trailer'], 'ghi');
+    }));
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('end', common.mustCall(() => {
+      assert.strictEqual(data, `${kResponseBody} ${path}`);
+    }));
+    stream.on('close', common.mustCall(callback));
+  }
+
+  req.on('secure', common.mustCall(() => {
+    request('/first', false, () => {
+      request('/second', true, () => req.close());
+    });
+  }));
+
+  req.on('close', common.mustCall(() => {
+    client.close();
+    server.close();
+  }));
+}));
@@ -0,0 +1,96 @@
+'use strict';
+
+// Tests that a request and response, including headers, body and trailers,
+// can be exchanged on a QuicStream when the negotiated ALPN is HTTP/3.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'h3-22';
+const kRequestBody = 'hello';
+const kResponseBody = 'world';
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => {
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('initialHeaders', common.mustCall((headers) => {
+      assert.strictEqual(headers[':method'], 'POST');
+      assert.strictEqual(headers[':path'], '/');
+      assert.strictEqual(headers['x-request'], 'abc');
+    }));
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('end', common.mustCall(() => {
+      assert.strictEqual(data, kRequestBody);
+      stream.submitInitialHeaders({ ':status': 200, 'x-response': 'def' });
+      stream.write(kResponseBody);
+      stream.submitTrailingHeaders({ 'x-trailer': 'ghi' });
+      stream.end();
+    }));
+  }));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    const stream = req.openStream();
+
+    assert.throws(() => stream.submitInitialHeaders('abc'), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+
+    stream.submitInitialHeaders({
+      ':method': 'POST',
+      ':scheme': 'https',
+      ':authority': 'localhost',
+      ':path': '/',
+      'x-request': 'abc'
+    });
+    stream.end(kRequestBody);
+
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('initialHeaders', common.mustCall((headers) => {
+      assert.strictEqual(headers[':status'], 200);
+      assert.strictEqual(headers['x-response'], 'def');
+    }));
+    stream.on('trailingHeaders', common.mustCall((headers) => {
+      assert.strictEqual(headers['x-trailer'], 'ghi');
+    }));
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('end', common.mustCall(() => {
+      assert.strictEqual(data, kResponseBody);
+    }));
+    stream.on('close', common.mustCall(() => {
+      req.close();
+    }));
+  }));
+
+  req.on('close', common.mustCall(() => {
+    client.close();
+    server.close();
+  }));
+}));
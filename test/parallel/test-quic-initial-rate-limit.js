@@ -0,0 +1,87 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that a QuicSocket drops the Initial packets of new connections from
+// a source prefix that has reached its connection or rate limit, and counts
+// the dropped packets.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kIdleTimeout = 1000;
+
+['maxInitialRate', 'maxInitialBurst'].forEach((option) => {
+  ['a', 1.5, -1].forEach((value) => {
+    assert.throws(() => createSocket({ [option]: value }), {
+      code: value === -1 ? 'ERR_OUT_OF_RANGE' : 'ERR_INVALID_ARG_TYPE'
+    });
+  });
+});
+
+{
+  const socket = createSocket({ maxInitialRate: 10, maxInitialBurst: 20 });
+  assert.strictEqual(socket.initialsConnectionLimited, 0n);
+  assert.strictEqual(socket.initialsRateLimited, 0n);
+  socket.destroy();
+}
+
+function test(socketOptions, check) {
+  const server = createSocket({ port: 0, ...socketOptions });
+  server.listen({ key, cert, ca, alpn: kALPN });
+
+  // The Initial packets of the second client are dropped, so the server
+  // never sees its session.
+  server.on('session', common.mustCall());
+
+  server.on('ready', common.mustCall(() => {
+    const options = {
+      address: 'localhost',
+      key,
+      cert,
+      ca,
+      alpn: kALPN,
+      port: server.address.port,
+      servername: kServerName,
+    };
+    const client = createSocket({ port: 0 });
+    const req = client.connect(options);
+
+    req.on('secure', common.mustCall(() => {
+      const limitedClient = createSocket({ port: 0 });
+      const limitedReq =
+        limitedClient.connect({ ...options, idleTimeout: kIdleTimeout });
+      limitedReq.on('secure', common.mustNotCall());
+      limitedReq.on('close', common.mustCall(() => {
+        check(server);
+        limitedClient.close();
+        req.close();
+      }));
+    }));
+
+    req.on('close', common.mustCall(() => {
+      server.close();
+      client.close();
+    }));
+  }));
+}
+
+test({ maxConnectionsPerHost: 1 }, (server) => {
+  assert(server.initialsConnectionLimited > 0n);
+  assert.strictEqual(server.initialsRateLimited, 0n);
+});
+
+test({ maxInitialRate: 1, maxInitialBurst: 1 }, (server) => {
+  assert.strictEqual(server.initialsConnectionLimited, 0n);
+  assert(server.initialsRateLimited > 0n);
+});
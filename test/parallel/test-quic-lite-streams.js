@@ -0,0 +1,106 @@
+'use strict';
+
+// Tests that, with the liteStreams option, the data received on streams
+// initiated by the peer is emitted using the 'streamData' event, that a
+// response can be sent using endStream(), and that a full QuicStream can
+// be obtained using getStream().
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kStreams = 3;
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN, liteStreams: true });
+
+server.on('session', common.mustCall((session) => {
+  const received = new Map();
+  session.on('stream', common.mustNotCall());
+  session.on('streamData', common.mustCall((id, chunk, fin) => {
+    assert(Buffer.isBuffer(chunk));
+    const previous = received.get(id) || Buffer.alloc(0);
+    received.set(id, Buffer.concat([previous, chunk]));
+    if (!fin)
+      return;
+    assert.strictEqual(chunk.length, 0);
+    assert.strictEqual(received.get(id).toString(), `ping ${id}`);
+
+    if (id === 0) {
+      // The first stream is responded to using a QuicStream.
+      const stream = session.getStream(id);
+      assert.strictEqual(stream.id, id);
+      assert.strictEqual(session.getStream(id), stream);
+      // The stats and histograms are attached when the QuicStream is
+      // created.
+      assert(stream.receiveWindow > 0n);
+      assert(stream.dataRateHistogram);
+      stream.on('data', common.mustNotCall());
+      stream.on('end', common.mustCall(() => stream.end('pong')));
+      stream.resume();
+      return;
+    }
+
+    assert.throws(() => session.endStream(id, 'pong'), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+    session.endStream(id, Buffer.from('pong'));
+  }, kStreams * 2));
+
+  assert.strictEqual(session.getStream(100), undefined);
+  assert.throws(() => session.endStream(100), {
+    code: 'ERR_INVALID_ARG_VALUE'
+  });
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const options = {
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  };
+
+  ['a', 1, {}].forEach((liteStreams) => {
+    assert.throws(() => client.connect({ ...options, liteStreams }), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+  });
+
+  const req = client.connect(options);
+
+  req.on('secure', common.mustCall(() => {
+    let countdown = kStreams;
+    for (let n = 0; n < kStreams; n++) {
+      const stream = req.openStream();
+      let data = '';
+      stream.setEncoding('utf8');
+      stream.on('data', (chunk) => data += chunk);
+      stream.on('end', common.mustCall(() => {
+        assert.strictEqual(data, 'pong');
+        if (--countdown === 0)
+          req.close();
+      }));
+      stream.end(`ping ${stream.id}`);
+    }
+  }));
+
+  req.on('close', common.mustCall(() => {
+    client.close();
+    server.close();
+  }));
+}));
@@ -0,0 +1,68 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that loopback QuicSockets on different threads can connect and
+// exchange data.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const { Worker, isMainThread, parentPort, workerData } =
+  require('worker_threads');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kData = 'ABCDEFGHIJKLMNOPQRSTUVWXYZ';
+
+if (!isMainThread) {
+  const client = createSocket({ port: 0, loopback: true });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: workerData.port,
+    servername: kServerName,
+  });
+  req.on('secure', () => {
+    const stream = req.openStream();
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('close', () => {
+      parentPort.postMessage(data);
+      client.close();
+    });
+    stream.end(kData);
+  });
+  return;
+}
+
+const server = createSocket({ port: 0, loopback: true });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => stream.pipe(stream)));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const worker = new Worker(__filename, {
+    workerData: { port: server.address.port }
+  });
+  worker.on('message', common.mustCall((data) => {
+    assert.strictEqual(data, kData);
+  }));
+  worker.on('exit', common.mustCall((code) => {
+    assert.strictEqual(code, 0);
+    server.close();
+  }));
+}));
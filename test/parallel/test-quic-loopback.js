@@ -0,0 +1,76 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that two loopback QuicSockets in the same thread can connect and
+// exchange data without using the UDP stack.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kData = 'ABCDEFGHIJKLMNOPQRSTUVWXYZ';
+
+[1, 'test', null, {}].forEach((loopback) => {
+  assert.throws(() => createSocket({ loopback }), {
+    code: 'ERR_INVALID_ARG_TYPE'
+  });
+});
+
+const server = createSocket({ port: 0, loopback: true });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => stream.pipe(stream)));
+}));
+
+server.on('ready', common.mustCall(() => {
+  assert.strictEqual(server.fd, undefined);
+  const { address, port } = server.address;
+  assert.strictEqual(address, '127.0.0.1');
+  assert(port > 0);
+
+  // Binding a second loopback QuicSocket to the same port fails.
+  const conflict = createSocket({ port, loopback: true });
+  conflict.on('error', common.mustCall((err) => {
+    assert.strictEqual(err.code, 'EADDRINUSE');
+  }));
+  conflict.listen({ key, cert, ca, alpn: kALPN });
+
+  const client = createSocket({ port: 0, loopback: true });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    const stream = req.openStream();
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('end', common.mustCall(() => {
+      assert.strictEqual(data, kData);
+      assert(client.bytesSent > 0n);
+      assert(server.bytesReceived > 0n);
+    }));
+    stream.on('close', common.mustCall(() => {
+      server.close();
+      client.close();
+    }));
+    stream.end(kData);
+  }));
+}));
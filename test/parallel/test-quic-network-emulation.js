@@ -0,0 +1,120 @@
+// Flags: --expose-internals --no-warnings
+'use strict';
+
+// Tests that a QuicSocket can emulate network impairments on received and
+// transmitted packets and that a connection still completes through them.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+const { debuglog } = require('util');
+const debug = debuglog('test');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kDelay = 10;
+const kData = 'ABCDEFGHIJKLMNOPQRSTUVWXYZ';
+
+{
+  const socket = createSocket();
+
+  [1, 'test', null, 1n].forEach((rx) => {
+    assert.throws(() => socket.setNetworkEmulation({ rx }), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+  });
+
+  ['test', null, 1.5, 1n].forEach((seed) => {
+    assert.throws(() => socket.setNetworkEmulation({ seed }), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+  });
+
+  assert.throws(() => socket.setNetworkEmulation({ seed: 2 ** 32 }), {
+    code: 'ERR_OUT_OF_RANGE'
+  });
+
+  ['delay', 'jitter', 'rate', 'queueLimit'].forEach((name) => {
+    assert.throws(() => socket.setNetworkEmulation({ tx: { [name]: 1.5 } }), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+    assert.throws(() => socket.setNetworkEmulation({ tx: { [name]: -1 } }), {
+      code: 'ERR_OUT_OF_RANGE'
+    });
+  });
+
+  ['reorder', 'duplicate', 'loss', 'burstLoss', 'burstEnter', 'burstExit']
+    .forEach((name) => {
+      assert.throws(() => socket.setNetworkEmulation({ rx: { [name]: '1' } }), {
+        code: 'ERR_INVALID_ARG_TYPE'
+      });
+      [-0.1, 1.1, NaN].forEach((val) => {
+        assert.throws(
+          () => socket.setNetworkEmulation({ rx: { [name]: val } }), {
+            code: 'ERR_OUT_OF_RANGE'
+          });
+      });
+    });
+
+  socket.setNetworkEmulation();
+  socket.destroy();
+}
+
+const server = createSocket({ port: 0 });
+const profile = {
+  delay: kDelay,
+  jitter: 2,
+  rate: 1024 * 1024,
+  queueLimit: 64 * 1024,
+  reorder: 0.1,
+  duplicate: 0.1,
+};
+server.setNetworkEmulation({ seed: 1, rx: profile, tx: profile });
+
+server.listen({ key, cert, ca, alpn: kALPN });
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => stream.pipe(stream)));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const start = process.hrtime.bigint();
+
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    // The handshake takes at least one delayed round trip.
+    const elapsed = Number(process.hrtime.bigint() - start) / 1e6;
+    debug('Handshake completed after %d ms', elapsed);
+    assert(elapsed >= 2 * (kDelay - 2));
+
+    const stream = req.openStream();
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('end', common.mustCall(() => {
+      assert.strictEqual(data, kData);
+    }));
+    stream.on('close', common.mustCall(() => {
+      server.close();
+      client.close();
+    }));
+    stream.end(kData);
+  }));
+}));
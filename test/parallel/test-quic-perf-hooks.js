@@ -0,0 +1,108 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that QuicSockets aggregate the timings of their sessions and
+// streams in histograms, and that 'quic' PerformanceEntries are reported
+// when a QuicSession is destroyed.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const { PerformanceObserver } = require('perf_hooks');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kData = 'ABCDEFGHIJKLMNOPQRSTUVWXYZ';
+
+const entries = [];
+const obs = new PerformanceObserver((items) => {
+  entries.push(...items.getEntries());
+});
+obs.observe({ entryTypes: ['quic'] });
+
+process.on('exit', () => {
+  obs.disconnect();
+  assert.strictEqual(entries.length, 2);
+  const types = entries.map((entry) => entry.type).sort();
+  assert.deepStrictEqual(types, ['client', 'server']);
+  for (const entry of entries) {
+    assert.strictEqual(entry.entryType, 'quic');
+    assert.strictEqual(entry.name, 'QuicSession');
+    assert(entry.duration > 0);
+    assert(entry.handshakeDuration > 0);
+    assert(entry.handshakeDuration <= entry.duration);
+    assert(entry.smoothedRTT > 0);
+    assert(entry.minRTT > 0);
+    assert(entry.bytesSent > 0);
+    assert(entry.bytesReceived > 0);
+    assert.strictEqual(entry.keyUpdates, 0);
+    if (entry.type === 'client') {
+      assert.strictEqual(entry.streamsOut, 1);
+      assert.strictEqual(entry.streamsIn, 0);
+    } else {
+      assert.strictEqual(entry.streamsOut, 0);
+      assert.strictEqual(entry.streamsIn, 1);
+    }
+  }
+});
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => stream.pipe(stream)));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    assert.strictEqual(client.handshakeDurationHistogram.exceeds, 0);
+    assert(client.handshakeDurationHistogram.min > 0);
+
+    const stream = req.openStream();
+    stream.resume();
+    stream.on('close', common.mustCall(() => {
+      req.close();
+    }));
+    stream.end(kData);
+  }));
+
+  req.on('close', common.mustCall(() => {
+    // The QuicSession is destroyed synchronously before 'close' is
+    // emitted, so the socket histograms are already up to date.
+    const histograms = [
+      client.handshakeDurationHistogram,
+      client.rttHistogram,
+      client.sessionLifetimeHistogram,
+      client.streamTimeToFirstByteHistogram,
+    ];
+    for (const histogram of histograms) {
+      assert(histogram.min > 0);
+      assert(histogram.max >= histogram.min);
+      assert.strictEqual(histogram.exceeds, 0);
+    }
+    assert(client.sessionLifetimeHistogram.min >=
+           client.handshakeDurationHistogram.max);
+
+    server.close();
+    client.close();
+  }));
+}));
@@ -0,0 +1,106 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that QuicSockets created with the qlog option write a JSON-SEQ
+// qlog trace for every QuicSession.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kData = 'ABCDEFGHIJKLMNOPQRSTUVWXYZ';
+
+[1, true, {}].forEach((qlog) => {
+  assert.throws(() => createSocket({ qlog }), {
+    code: 'ERR_INVALID_ARG_TYPE'
+  });
+});
+
+function readTrace(suffix) {
+  const files = fs.readdirSync(tmpdir.path).filter((f) => f.endsWith(suffix));
+  assert.strictEqual(files.length, 1);
+  const content = fs.readFileSync(path.join(tmpdir.path, files[0]), 'utf8');
+  const records = content.split('\x1e');
+  assert.strictEqual(records.shift(), '');
+  return records.map((record) => {
+    assert(record.endsWith('\n'));
+    return JSON.parse(record);
+  });
+}
+
+process.on('exit', () => {
+  for (const vantagePoint of ['server', 'client']) {
+    const [header, ...events] = readTrace(`_${vantagePoint}.sqlog`);
+    assert.strictEqual(header.qlog_format, 'JSON-SEQ');
+    assert.strictEqual(header.trace.vantage_point.type, vantagePoint);
+    assert.strictEqual(typeof header.trace.common_fields.ODCID, 'string');
+
+    const names = new Set(events.map((event) => event.name));
+    assert(names.has('transport:packet_sent'));
+    assert(names.has('transport:packet_received'));
+    assert(names.has('recovery:metrics_updated'));
+
+    let last = 0;
+    for (const { time } of events) {
+      assert(time >= last);
+      last = time;
+    }
+
+    const frames = events
+      .filter((event) => event.name === 'transport:packet_received')
+      .flatMap((event) => event.data.frames);
+    assert(frames.some((frame) => frame.frame_type === 'stream'));
+  }
+});
+
+// Refreshed after the 'exit' listener above has been added, so that the
+// traces are checked before the tmpdir is removed on exit.
+tmpdir.refresh();
+
+const server = createSocket({ port: 0, qlog: tmpdir.path });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => stream.pipe(stream)));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0, qlog: tmpdir.path });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    const stream = req.openStream();
+    let data = '';
+    stream.setEncoding('utf8');
+    stream.on('data', (chunk) => data += chunk);
+    stream.on('end', common.mustCall(() => {
+      assert.strictEqual(data, kData);
+    }));
+    stream.on('close', common.mustCall(() => {
+      server.close();
+      client.close();
+    }));
+    stream.end(kData);
+  }));
+}));
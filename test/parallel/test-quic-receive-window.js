@@ -0,0 +1,102 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that the receive windows of QuicSessions and QuicStreams start at
+// the configured flow control limits, are reported in their stats, and
+// never grow beyond the configured maximums.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kStreamWindow = 16 * 1024;
+const kConnectionWindow = 64 * 1024;
+const kMaxStreamWindow = 256 * 1024;
+const kMaxConnectionWindow = 512 * 1024;
+const kRequestSize = 1024 * 1024;
+
+['maxStreamWindow', 'maxConnectionWindow'].forEach((option) => {
+  ['a', 1.5, -1].forEach((value) => {
+    const socket = createSocket();
+    assert.throws(() => socket.listen({ alpn: kALPN, [option]: value }), {
+      code: value === -1 ? 'ERR_OUT_OF_RANGE' : 'ERR_INVALID_ARG_TYPE'
+    });
+    socket.destroy();
+  });
+});
+
+function test(maxStreamWindow, maxConnectionWindow) {
+  const server = createSocket({ port: 0 });
+  server.listen({
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    maxData: kConnectionWindow,
+    maxStreamDataBidiRemote: kStreamWindow,
+    maxStreamWindow,
+    maxConnectionWindow,
+  });
+
+  server.on('session', common.mustCall((session) => {
+    assert.strictEqual(session.receiveWindow, BigInt(kConnectionWindow));
+
+    session.on('stream', common.mustCall((stream) => {
+      assert.strictEqual(stream.receiveWindow, BigInt(kStreamWindow));
+      let received = 0;
+      stream.on('data', (chunk) => received += chunk.length);
+      stream.on('end', common.mustCall(() => {
+        assert.strictEqual(received, kRequestSize);
+        const streamWindow = stream.receiveWindow;
+        const connectionWindow = session.receiveWindow;
+        assert(streamWindow >= BigInt(kStreamWindow));
+        assert(streamWindow <= BigInt(Math.max(kStreamWindow,
+                                               maxStreamWindow)));
+        assert(connectionWindow >= BigInt(kConnectionWindow));
+        assert(connectionWindow <= BigInt(Math.max(kConnectionWindow,
+                                                   maxConnectionWindow)));
+        stream.end();
+      }));
+    }));
+  }));
+
+  server.on('ready', common.mustCall(() => {
+    const client = createSocket({ port: 0 });
+    const req = client.connect({
+      address: 'localhost',
+      key,
+      cert,
+      ca,
+      alpn: kALPN,
+      port: server.address.port,
+      servername: kServerName,
+    });
+
+    req.on('secure', common.mustCall(() => {
+      const stream = req.openStream();
+      stream.resume();
+      stream.on('close', common.mustCall(() => req.close()));
+      stream.end(Buffer.alloc(kRequestSize));
+    }));
+
+    req.on('close', common.mustCall(() => {
+      server.close();
+      client.close();
+    }));
+  }));
+}
+
+test(kMaxStreamWindow, kMaxConnectionWindow);
+
+// Maximums below the initial windows disable auto-tuning.
+test(0, 0);
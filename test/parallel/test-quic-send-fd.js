@@ -0,0 +1,110 @@
+'use strict';
+
+// Tests that QuicStream.sendFD() and QuicStream.sendFile() send the given
+// range of a file and then end the stream.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fs = require('fs');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kFile = fixtures.path('person-large.jpg');
+const kData = fs.readFileSync(kFile);
+
+const cases = [
+  { method: 'sendFD', options: {}, expected: kData },
+  {
+    method: 'sendFD',
+    options: { offset: 1000, length: 70000 },
+    expected: kData.slice(1000, 71000)
+  },
+  { method: 'sendFile', options: { length: 0 }, expected: Buffer.alloc(0) },
+  {
+    method: 'sendFile',
+    options: { offset: 100000 },
+    expected: kData.slice(100000)
+  },
+];
+
+const fd = fs.openSync(kFile, 'r');
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => {
+    stream.setEncoding('utf8');
+    let index = '';
+    stream.on('data', (chunk) => index += chunk);
+    stream.on('end', common.mustCall(() => {
+      const { method, options } = cases[index];
+      if (method === 'sendFD')
+        stream.sendFD(fd, options);
+      else
+        stream.sendFile(kFile, options);
+    }));
+  }, cases.length));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    let remaining = cases.length;
+    cases.forEach(({ expected }, index) => {
+      const stream = req.openStream();
+      const chunks = [];
+      stream.on('data', (chunk) => chunks.push(chunk));
+      stream.on('end', common.mustCall(() => {
+        assert.deepStrictEqual(Buffer.concat(chunks), expected);
+      }));
+      stream.on('close', common.mustCall(() => {
+        if (--remaining === 0)
+          req.close();
+      }));
+      if (index === 0) {
+        [null, 'a'].forEach((options) => {
+          assert.throws(() => stream.sendFD(fd, options), {
+            code: 'ERR_INVALID_ARG_TYPE'
+          });
+        });
+        ['a', -1].forEach((fd) => {
+          assert.throws(() => stream.sendFD(fd), {
+            code: fd === 'a' ? 'ERR_INVALID_ARG_TYPE' : 'ERR_OUT_OF_RANGE'
+          });
+        });
+        [{ offset: -2 }, { length: 1.5 }].forEach((options) => {
+          assert.throws(() => stream.sendFile(kFile, options), {
+            code: 'ERR_OUT_OF_RANGE'
+          });
+        });
+      }
+      stream.end(`${index}`);
+    });
+  }));
+
+  req.on('close', common.mustCall(() => {
+    fs.closeSync(fd);
+    client.close();
+    server.close();
+  }));
+}));
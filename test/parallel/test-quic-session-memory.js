@@ -0,0 +1,81 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that a QuicSession is closed once it holds more memory than
+// allowed by the maxMemory option, and that memory usage is reported.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kMaxMemory = 512 * 1024;
+const kResponseSize = 4 * kMaxMemory;
+const kInternalError = 0x1;
+
+['a', 1.5, -1, 0].forEach((maxMemory) => {
+  assert.throws(() => createSocket({ maxMemory }), {
+    code: typeof maxMemory === 'number' && Number.isInteger(maxMemory) ?
+      'ERR_OUT_OF_RANGE' : 'ERR_INVALID_ARG_TYPE'
+  });
+});
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN, maxMemory: kMaxMemory });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => {
+    assert.strictEqual(typeof session.memoryUsage, 'bigint');
+    assert(session.memoryUsage > 0n);
+    assert(server.memoryUsage >= session.memoryUsage);
+
+    // The response is held in memory until the client acknowledges
+    // it, which puts the QuicSession over its limit once written.
+    stream.on('error', () => {});
+    stream.resume();
+    stream.end(Buffer.alloc(kResponseSize));
+  }));
+
+  session.on('close', common.mustCall(() => {
+    assert.strictEqual(session.closeCode.code, kInternalError);
+    assert(session.maxMemoryUsage > BigInt(kMaxMemory));
+  }));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    const stream = req.openStream();
+    stream.on('error', () => {});
+    stream.resume();
+    stream.end('hello');
+  }));
+
+  req.on('close', common.mustCall(() => {
+    server.close();
+    client.close();
+  }));
+}));
+
+server.on('close', common.mustCall(() => {
+  assert.strictEqual(server.memoryUsage, 0n);
+}));
@@ -0,0 +1,61 @@
+'use strict';
+
+// Tests that a QuicClientSession resumed from the session ticket of an
+// earlier session completes its handshake. The server name is not part
+// of a resumed TLS session, so 'secure' reports it as undefined.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kALPN = 'zzz';
+const kServerName = 'agent1';
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+server.on('session', common.mustCall(2));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({
+    port: 0,
+    client: { key, cert, ca, alpn: kALPN }
+  });
+  const options = {
+    address: 'localhost',
+    port: server.address.port,
+    servername: kServerName,
+  };
+
+  const req = client.connect(options);
+  req.on('secure', common.mustCall((servername) => {
+    assert.strictEqual(servername, kServerName);
+  }));
+  req.once('sessionTicket', common.mustCall((id, ticket, params) => {
+    req.close(common.mustCall(() => {
+      const resumed = client.connect({
+        ...options,
+        sessionTicket: ticket,
+        remoteTransportParams: params
+      });
+      resumed.on('secure', common.mustCall((servername, alpn, cipher) => {
+        assert.strictEqual(servername, undefined);
+        assert.strictEqual(alpn, kALPN);
+        assert.strictEqual(typeof cipher.name, 'string');
+        resumed.close(common.mustCall(() => {
+          client.close();
+          server.close();
+        }));
+      }));
+    }));
+  }));
+}));
+
+server.on('close', common.mustCall());
@@ -0,0 +1,67 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that a SecureContext registered using addContext() is selected
+// for a matching servername without an 'OCSPRequest' listener.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+const sniKey = fixtures.readKey('agent3-key.pem', 'binary');
+const sniCert = fixtures.readKey('agent3-cert.pem', 'binary');
+const sniCA = fixtures.readKey('ca2-cert.pem', 'binary');
+const { debuglog } = require('util');
+const debug = debuglog('test');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent3';
+const kALPN = 'zzz';
+
+let client;
+const server = createSocket({ port: 0 });
+
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  debug('QuicServerSession Created');
+  session.addContext(kServerName, { key: sniKey, cert: sniCert });
+  assert.throws(() => session.addContext(1), {
+    code: 'ERR_INVALID_ARG_TYPE'
+  });
+  // The server side of the handshake completes after the client side.
+  session.on('secure', common.mustCall(() => {
+    server.close();
+    client.close();
+  }));
+}));
+
+server.on('ready', common.mustCall(() => {
+  debug('Server is listening on port %d', server.address.port);
+  client = createSocket({
+    port: 0,
+    client: { key, cert, ca: [ca, sniCA], alpn: kALPN }
+  });
+
+  const req = client.connect({
+    address: 'localhost',
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall((servername) => {
+    debug('QuicClientSession TLS Handshake Complete');
+    assert.strictEqual(servername, kServerName);
+    assert.strictEqual(req.getPeerCertificate().subject.CN, kServerName);
+  }));
+
+  req.on('close', common.mustCall());
+}));
+
+server.on('close', common.mustCall());
@@ -0,0 +1,85 @@
+'use strict';
+
+// Tests that quicsocket.drain() stops accepting new connections and
+// destroys the existing sessions in batches, reporting its progress,
+// before closing the QuicSocket.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kClients = 4;
+
+{
+  const socket = createSocket();
+  ['a', -1, 1.5].forEach((value) => {
+    ['batchSize', 'window'].forEach((option) => {
+      assert.throws(() => socket.drain({ [option]: value }), {
+        code: value === -1 ? 'ERR_OUT_OF_RANGE' : 'ERR_INVALID_ARG_TYPE'
+      });
+    });
+  });
+  assert.throws(() => socket.drain({}, 'a'), {
+    code: 'ERR_INVALID_CALLBACK'
+  });
+
+  // A QuicSocket that is not bound is destroyed immediately.
+  socket.drain(common.mustCall());
+  assert(socket.destroyed);
+}
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('close', common.mustCall());
+}, kClients));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({
+    port: 0,
+    client: { key, cert, ca, alpn: kALPN }
+  });
+  const options = {
+    address: 'localhost',
+    port: server.address.port,
+    servername: kServerName,
+  };
+
+  let secure = 0;
+  let closed = 0;
+  for (let n = 0; n < kClients; n++) {
+    const req = client.connect(options);
+    req.on('secure', common.mustCall(() => {
+      if (++secure === kClients)
+        drain();
+    }));
+    // The CONNECTION_CLOSE sent for each drained session closes the
+    // client side as well.
+    req.on('close', common.mustCall(() => {
+      if (++closed === kClients)
+        client.close();
+    }));
+  }
+
+  function drain() {
+    const progress = [];
+    server.on('draining', (drained, remaining) => {
+      progress.push([drained, remaining]);
+    });
+    server.drain({ batchSize: 2, window: 100 }, common.mustCall(() => {
+      assert.deepStrictEqual(progress, [[2, 2], [4, 0]]);
+    }));
+    assert(server.closing);
+  }
+}));
@@ -0,0 +1,86 @@
+'use strict';
+
+// Tests that a QuicSocket that is restarted with the same stateless reset
+// secret closes the connections of the previous QuicSocket with a stateless
+// reset when their packets arrive.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kSecret = Buffer.from('0123456789abcdef');
+
+{
+  ['a', 1, {}].forEach((statelessResetSecret) => {
+    assert.throws(() => createSocket({ statelessResetSecret }), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+  });
+  [Buffer.alloc(15), new Uint8Array(17)].forEach((statelessResetSecret) => {
+    assert.throws(() => createSocket({ statelessResetSecret }), {
+      code: 'ERR_INVALID_ARG_VALUE'
+    });
+  });
+  assert.throws(() => createSocket({ disableStatelessReset: 1 }), {
+    code: 'ERR_INVALID_ARG_TYPE'
+  });
+
+  const socket = createSocket({ statelessResetSecret: kSecret });
+  assert.strictEqual(socket.statelessResets, 0n);
+  socket.destroy();
+}
+
+common.expectWarning({
+  ExperimentalWarning: 'QUIC protocol support is experimental and not ' +
+                       'yet supported for production use',
+  Warning: [[/network emulation is enabled/]]
+});
+
+const server = createSocket({ port: 0, statelessResetSecret: kSecret });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('ready', common.mustCall(() => {
+  const port = server.address.port;
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    // Simulate a crash: the CONNECTION_CLOSE sent by the server while it is
+    // destroyed never reaches the client.
+    server.setDiagnosticPacketLoss({ tx: 1.0 });
+    server.destroy();
+  }));
+
+  server.on('close', common.mustCall(() => {
+    const restarted = createSocket({ port, statelessResetSecret: kSecret });
+    restarted.listen({ key, cert, ca, alpn: kALPN });
+    restarted.on('ready', common.mustCall(() => {
+      req.openStream().end('hello');
+    }));
+
+    req.on('close', common.mustCall(() => {
+      assert(req.statelessReset);
+      assert(restarted.statelessResets > 0n);
+      client.close();
+      restarted.close();
+    }));
+  }));
+}));
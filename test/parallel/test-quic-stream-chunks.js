@@ -0,0 +1,76 @@
+'use strict';
+
+// Tests that data can be read from and written to a QuicStream using
+// readChunks() and writeChunks().
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kData = Buffer.alloc(100000, 'a');
+
+const server = createSocket({ port: 0 });
+server.listen({ key, cert, ca, alpn: kALPN });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall(async (stream) => {
+    const reader = stream.readChunks();
+    assert.throws(() => stream.readChunks(), {
+      code: 'ERR_QUICSTREAM_READ_STARTED'
+    });
+    for await (const chunks of reader) {
+      assert(Array.isArray(chunks));
+      assert(chunks.length > 0);
+      await stream.writeChunks(chunks);
+    }
+    stream.end();
+    await assert.rejects(stream.writeChunks(Buffer.from('a')), {
+      code: 'ERR_STREAM_WRITE_AFTER_END'
+    });
+  }));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(async () => {
+    const stream = req.openStream();
+    stream.on('close', common.mustCall(() => req.close()));
+
+    assert.throws(() => stream.writeChunks('a'), {
+      code: 'ERR_INVALID_ARG_TYPE'
+    });
+
+    stream.writeChunks([kData.slice(0, 50000), kData.slice(50000)]);
+    stream.end();
+
+    const received = [];
+    for await (const chunks of stream.readChunks())
+      received.push(...chunks);
+    assert.deepStrictEqual(Buffer.concat(received), kData);
+  }));
+
+  req.on('close', common.mustCall(() => {
+    client.close();
+    server.close();
+  }));
+}));
@@ -68,7 +68,21 @@ server.on('session', common.mustCall((session) => {
     debug('Unidirectional, Server-initiated stream %d opened', uni.id);
   }));
 
-  session.on('stream', common.mustNotCall());
+  session.on('stream', common.mustCall((stream) => {
+    debug('Bidirectional, Client-initiated stream %d received', stream.id);
+    stream.on('abort', common.mustNotCall());
+    stream.on('data', common.mustCall((chunk) => {
+      assert.strictEqual(chunk.toString(), 'hello');
+    }));
+    stream.on('end', common.mustCall(() => {
+      debug('Bidirectional, Client-initiated stream %d ended on server',
+            stream.id);
+    }));
+    stream.on('close', common.mustCall(() => {
+      debug('Bidirectional, Client-initiated stream %d closed on server',
+            stream.id);
+    }));
+  }));
   session.on('close', common.mustCall());
 }));
 
@@ -90,9 +104,6 @@ server.on('ready', common.mustCall(() => {
 
     const stream = req.openStream();
 
-    // TODO(@jasnell): The close happens synchronously, before any
-    // data for the stream is actually flushed our to the connected
-    // peer.
     stream.write('hello', common.mustCall());
     stream.close(1);
 
@@ -0,0 +1,88 @@
+'use strict';
+
+// Tests that QuicStream.proxy() pipes the data received on a QuicStream to
+// a net.Socket, and the data received on the net.Socket back to the
+// QuicStream.
+
+const common = require('../common');
+if (!common.hasQuic)
+  common.skip('missing quic');
+
+const assert = require('assert');
+const net = require('net');
+const fixtures = require('../common/fixtures');
+const key = fixtures.readKey('agent1-key.pem', 'binary');
+const cert = fixtures.readKey('agent1-cert.pem', 'binary');
+const ca = fixtures.readKey('ca1-cert.pem', 'binary');
+
+const { createSocket } = require('quic');
+
+const kServerName = 'agent1';
+const kALPN = 'zzz';
+const kData = Buffer.alloc(500000);
+for (let n = 0; n < kData.length; n++)
+  kData[n] = n % 251;
+
+// The TCP backend echoes everything back.
+const backend = net.createServer(common.mustCall((socket) => {
+  socket.pipe(socket);
+}));
+
+const server = createSocket({ port: 0 });
+
+server.on('session', common.mustCall((session) => {
+  session.on('stream', common.mustCall((stream) => {
+    [undefined, {}, 'a'].forEach((socket) => {
+      assert.throws(() => stream.proxy(socket), {
+        code: 'ERR_INVALID_ARG_TYPE'
+      });
+    });
+    assert.throws(() => stream.proxy(new net.Socket()), {
+      code: 'ERR_INVALID_ARG_VALUE'
+    });
+
+    const socket = net.connect(backend.address().port);
+    stream.proxy(socket);
+    assert.throws(() => stream.proxy(socket), {
+      code: 'ERR_QUICSTREAM_READ_STARTED'
+    });
+    assert.throws(() => stream.readChunks(), {
+      code: 'ERR_QUICSTREAM_READ_STARTED'
+    });
+    socket.on('close', common.mustCall());
+  }));
+}));
+
+server.on('ready', common.mustCall(() => {
+  const client = createSocket({ port: 0 });
+  const req = client.connect({
+    address: 'localhost',
+    key,
+    cert,
+    ca,
+    alpn: kALPN,
+    port: server.address.port,
+    servername: kServerName,
+  });
+
+  req.on('secure', common.mustCall(() => {
+    const stream = req.openStream();
+    const received = [];
+    stream.on('data', (chunk) => received.push(chunk));
+    stream.on('end', common.mustCall(() => {
+      assert.deepStrictEqual(Buffer.concat(received), kData);
+    }));
+    stream.on('close', common.mustCall(() => req.close()));
+    stream.end(kData);
+  }));
+
+  req.on('close', common.mustCall(() => {
+    client.close();
+    server.close();
+    backend.close();
+  }));
+}));
+
+backend.listen(0, common.mustCall(() => {
+  server.listen({ key, cert, ca, alpn: kALPN });
+}));
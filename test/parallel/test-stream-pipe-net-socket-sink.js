@@ -0,0 +1,62 @@
+// Flags: --expose-internals
+'use strict';
+
+// Tests that a net.Socket can be used as the sink of a native StreamPipe,
+// which it asks for more data once its write queue drains, and that it can
+// be written to from JavaScript before it is piped to.
+
+const common = require('../common');
+const assert = require('assert');
+const net = require('net');
+const { internalBinding } = require('internal/test/binding');
+const { StreamPipe } = internalBinding('stream_pipe');
+
+const kHead = Buffer.from('head');
+const kData = Buffer.alloc(4 * 1024 * 1024);
+for (let n = 0; n < kData.length; n++)
+  kData[n] = n % 251;
+
+const sourceServer = net.createServer(common.mustCall((socket) => {
+  socket.end(kData);
+}));
+
+const sinkServer = net.createServer(common.mustCall((socket) => {
+  const received = [];
+  socket.on('data', (chunk) => received.push(chunk));
+  socket.on('end', common.mustCall(() => {
+    assert.deepStrictEqual(Buffer.concat(received),
+                           Buffer.concat([kHead, kData]));
+    socket.end();
+    sourceServer.close();
+    sinkServer.close();
+  }));
+}));
+
+function startPipe(source, sink) {
+  source.pause();
+  source._handle.reading = false;
+  source._handle.readStop();
+
+  const pipe = new StreamPipe(source._handle, sink._handle);
+  // The source is not read from JavaScript, so it does not end by itself.
+  pipe.onunpipe = common.mustCall(() => source.destroy());
+  // The sink only asks for data once a write has completed, so the pipe is
+  // told how much to read first.
+  pipe.start(64 * 1024);
+}
+
+sourceServer.listen(0, common.mustCall(() => {
+  sinkServer.listen(0, common.mustCall(() => {
+    // The pipe shuts down the writable side of the sink once the source
+    // has ended, which the JavaScript side does not know about.
+    const sink = net.connect({
+      port: sinkServer.address().port,
+      allowHalfOpen: true
+    });
+    sink.on('end', common.mustCall(() => sink.destroy()));
+    sink.write(kHead, common.mustCall(() => {
+      const source = net.connect(sourceServer.address().port);
+      source.on('connect', common.mustCall(() => startPipe(source, sink)));
+    }));
+  }));
+}));